@@ -0,0 +1,172 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "ConsolidatedHistory.h"
+
+// ====== Globals ======
+
+// Length of one interval and number of points per level. The
+// rings span 1 hour, 6 hours, 3 days and 2 weeks.
+static const bigtime_t LEVEL_STEPS[]		= { 10000000LL, 60000000LL, 900000000LL, 3600000000LL };
+static const int32	   LEVEL_CAPACITIES[]	= { 360, 360, 288, 336 };
+
+// ====== CConsolidatedHistory ======
+
+CConsolidatedHistory::CConsolidatedHistory()
+{
+	for(int32 i=0 ; i<LEVEL_COUNT ; i++)
+		levels[i].points = new history_point[LEVEL_CAPACITIES[i]];
+
+	MakeEmpty();
+}
+
+CConsolidatedHistory::~CConsolidatedHistory()
+{
+	for(int32 i=0 ; i<LEVEL_COUNT ; i++)
+		delete [] levels[i].points;
+}
+
+int32 CConsolidatedHistory::CountLevels()
+{
+	return LEVEL_COUNT;
+}
+
+bigtime_t CConsolidatedHistory::Step(int32 level)
+{
+	return LEVEL_STEPS[level];
+}
+
+int32 CConsolidatedHistory::Capacity(int32 level)
+{
+	return LEVEL_CAPACITIES[level];
+}
+
+void CConsolidatedHistory::MakeEmpty()
+{
+	for(int32 i=0 ; i<LEVEL_COUNT ; i++) {
+		levels[i].insertPoint	= 0;
+		levels[i].count			= 0;
+		levels[i].serial		= 0;
+		levels[i].acc.bucket	= -1;
+		levels[i].acc.count		= 0;
+	}
+}
+
+void CConsolidatedHistory::Add(bigtime_t time, float value)
+{
+	Accumulate(0, time / LEVEL_STEPS[0], value, value, value, 1);
+}
+
+const history_point &CConsolidatedHistory::PointAt(int32 level, int32 index) const
+{
+	const CConsolidatedHistory::ring &l = levels[level];
+
+	MY_ASSERT(index >= 0 && index < l.count);
+
+	// 'insertPoint' is the position of the next point.
+	return l.points[(l.insertPoint - 1 - index + 2*LEVEL_CAPACITIES[level]) % LEVEL_CAPACITIES[level]];
+}
+
+// Max
+// Maximum of the last 'count' points of 'level'. Linear in 'count'.
+float CConsolidatedHistory::Max(int32 level, int32 count) const
+{
+	float result = 0.0;
+
+	count = MIN(count, levels[level].count);
+
+	for(int32 i=0 ; i<count ; i++)
+		result = MAX(result, PointAt(level, i).max);
+
+	return result;
+}
+
+// Accumulate
+// Adds the samples of an interval of the level before (or a raw sample)
+// to the unfinished interval of 'level'. Finishes the interval first,
+// if 'bucket' is later. Samples from the past (the clock isn't always
+// monotonic across data providers) are added to the current interval.
+void CConsolidatedHistory::Accumulate(int32 level, int64 bucket,
+	float min, float max, double sum, int32 count)
+{
+	accumulator &acc = levels[level].acc;
+
+	if(acc.bucket >= 0 && bucket > acc.bucket) {
+		int64 lastBucket = acc.bucket;
+	
+		Finish(level);
+		
+		// Intervals without any sample.
+		int64 gap = MIN(bucket - lastBucket - 1, (int64)LEVEL_CAPACITIES[level]);
+		history_point empty = { 0.0, 0.0, 0.0 };
+		
+		for(int64 i=0 ; i<gap ; i++)
+			AddPoint(level, empty);
+	}
+
+	if(acc.count == 0) {
+		acc.bucket	= MAX(bucket, acc.bucket);
+		acc.min		= min;
+		acc.max		= max;
+		acc.sum		= sum;
+		acc.count	= count;
+	} else {
+		acc.min		= MIN(acc.min, min);
+		acc.max		= MAX(acc.max, max);
+		acc.sum	   += sum;
+		acc.count  += count;
+	}
+}
+
+// Finish
+// Adds the point of the unfinished interval of 'level' to the ring and
+// passes it on to the next level.
+void CConsolidatedHistory::Finish(int32 level)
+{
+	accumulator &acc = levels[level].acc;
+
+	history_point point = { 0.0, 0.0, 0.0 };
+	
+	if(acc.count > 0) {
+		point.min	= acc.min;
+		point.max	= acc.max;
+		point.mean	= acc.sum / acc.count;
+	}
+	
+	AddPoint(level, point);
+
+	if(acc.count > 0 && level+1 < LEVEL_COUNT) {
+		// The steps are multiples of each other.
+		int64 nextBucket = acc.bucket * LEVEL_STEPS[level] / LEVEL_STEPS[level+1];
+	
+		Accumulate(level+1, nextBucket, acc.min, acc.max, acc.sum, acc.count);
+	}
+	
+	acc.count = 0;
+}
+
+void CConsolidatedHistory::AddPoint(int32 level, const history_point &point)
+{
+	CConsolidatedHistory::ring &l = levels[level];
+
+	l.points[l.insertPoint] = point;
+	l.insertPoint = (l.insertPoint + 1) % LEVEL_CAPACITIES[level];
+	l.count = MIN(l.count + 1, LEVEL_CAPACITIES[level]);
+	l.serial++;
+}
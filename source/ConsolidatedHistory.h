@@ -0,0 +1,89 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONSOLIDATED_HISTORY_H
+#define CONSOLIDATED_HISTORY_H
+
+//: A point of a consolidated history.
+struct history_point
+{
+	float	min;
+	float	max;
+	float	mean;
+};
+
+//: Multi-resolution history of a sample stream (like RRDtool).
+// The samples are consolidated into rings of coarser resolution
+// (10s, 1min, 15min and 1h). Each point stores the minimum, maximum
+// and mean of the samples of its interval. The intervals are aligned
+// to multiples of their length, so each level is fed by the finished
+// points of the level before (cascade). Intervals without any sample
+// are stored as zero points, so the n-th point of a level is always
+// n intervals old. The history doesn't contain the raw samples; they
+// are kept by the owner.
+class CConsolidatedHistory
+{
+	public:
+	CConsolidatedHistory();
+	~CConsolidatedHistory();
+
+	// 'time' is the real time (real_time_clock_usecs()) of the sample.
+	void Add(bigtime_t time, float value);
+	void MakeEmpty();
+
+	static int32 CountLevels();
+	// Length of the interval of one point in microseconds.
+	static bigtime_t Step(int32 level);
+	static int32 Capacity(int32 level);
+
+	// Number of finished points (at most the capacity).
+	int32 CountPoints(int32 level) const	{ return levels[level].count; }
+	// Incremented with every finished point.
+	uint32 Serial(int32 level) const		{ return levels[level].serial; }
+	// The point 'index' intervals before the last finished one.
+	const history_point &PointAt(int32 level, int32 index) const;
+
+	float Max(int32 level, int32 count) const;
+
+	protected:
+	// Points of the unfinished interval.
+	struct accumulator {
+		int64	bucket;			// time / Step(level), -1 if empty
+		float	min;
+		float	max;
+		double	sum;
+		int32	count;			// number of raw samples
+	};
+
+	struct ring {
+		history_point	*points;	// ring buffer
+		int32			 insertPoint;
+		int32			 count;
+		uint32			 serial;
+		accumulator		 acc;
+	};
+
+	void Accumulate(int32 level, int64 bucket, float min, float max, double sum, int32 count);
+	void Finish(int32 level);
+	void AddPoint(int32 level, const history_point &point);
+
+	enum { LEVEL_COUNT = 4 };
+
+	ring levels[LEVEL_COUNT];
+};
+
+#endif // CONSOLIDATED_HISTORY_H
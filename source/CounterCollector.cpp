@@ -0,0 +1,493 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "common.h"
+#include "my_assert.h"
+#include "CounterNamespaceImpl.h"
+#include "TimeSeriesStore.h"
+#include "CounterCollector.h"
+
+#include <signal.h>
+#include <new>
+
+// ====== Globals ======
+
+// Size of the stdio buffer of the CSV file.
+const size_t COLLECTOR_CSV_BUFFER_SIZE	= 64*1024;
+
+// Default sampling interval of --collect.
+const bigtime_t COLLECTOR_DEFAULT_INTERVAL = 100000;		// 100 ms
+
+// Collector stopped by SIGINT and SIGTERM.
+static CCounterCollector *signalCollector = NULL;
+
+static void stop_collector(int signal)
+{
+	if(signalCollector)
+		signalCollector->Stop();
+}
+
+// ====== Allocation counting ======
+
+// The global operators below count the allocations of this thread.
+// -1 while nothing is counted, so the rest of the application only
+// pays for one compare per allocation. Only the counted thread
+// changes the counters. Allocations by malloc() (e.g. of BString)
+// aren't seen.
+static thread_id countedThread = -1;
+static int64 countedAllocations = 0;
+static int64 countedBytes = 0;
+
+static void *counted_malloc(size_t size)
+{
+	if(countedThread >= 0 && find_thread(NULL) == countedThread) {
+		countedAllocations++;
+		countedBytes += size;
+	}
+	
+	return malloc(size);
+}
+
+void *operator new(size_t size)
+{
+	void *memory = counted_malloc(size);
+	
+	if(memory == NULL)
+		throw std::bad_alloc();
+		
+	return memory;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &)
+{
+	return counted_malloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &)
+{
+	return counted_malloc(size);
+}
+
+void operator delete(void *memory)
+{
+	free(memory);
+}
+
+void operator delete[](void *memory)
+{
+	free(memory);
+}
+
+// ====== CCounterCollector ======
+
+const bigtime_t CCounterCollector::MIN_INTERVAL = 10000;		// 10 ms
+
+CCounterCollector::CCounterCollector()
+{
+	csvFile			= NULL;
+	binaryFile		= NULL;
+	realStartTime	= 0;
+	interval		= COLLECTOR_DEFAULT_INTERVAL;
+	duration		= 0;
+	quit			= false;
+	samplerThread	= -1;
+	tickCount		= 0;
+	lateTickCount	= 0;
+	startTime		= endTime = 0;
+	samplerCPUTime	= 0;
+	startMemory		= endMemory = 0;
+	allocationCount	= 0;
+	allocatedBytes	= 0;
+}
+
+CCounterCollector::~CCounterCollector()
+{
+	Stop();
+	
+	if(samplerThread >= 0) {
+		status_t exitValue;
+		
+		while(wait_for_thread(samplerThread, &exitValue) == B_INTERRUPTED)
+			;
+	}
+	
+	if(csvFile && csvFile != stdout)
+		fclose(csvFile);
+		
+	delete binaryFile;
+}
+
+status_t CCounterCollector::AddCounter(const char *path)
+{
+	IDataProvider *provider = global_Namespace->DataProvider(path);
+	
+	if(provider == NULL)
+		return B_ENTRY_NOT_FOUND;
+		
+	counter *c = new counter;
+	
+	c->path		= path;
+	c->provider	= provider;
+	
+	counterList.AddItem(c);
+	context.AddProvider(provider);
+	
+	return B_OK;
+}
+
+status_t CCounterCollector::SetOutput(const char *path, bool binary)
+{
+	if(binary) {
+		if(path == NULL)
+			return B_BAD_VALUE;
+			
+		binaryFile = new CTimeSeriesWriter(path, B_ERASE_FILE, real_time_clock_usecs() / 1000);
+		
+		RETURN_IF_FAILED( binaryFile->InitCheck() );
+		
+		// The series id is the index of the counter.
+		for(int32 i=0 ; i<counterList.CountItems() ; i++)
+			RETURN_IF_FAILED( binaryFile->WriteSeries(i, counterList.ItemAt(i)->path.String()) );
+			
+		return B_OK;
+	}
+	
+	csvFile = path ? fopen(path, "w") : stdout;
+	
+	if(csvFile == NULL)
+		return errno;
+		
+	// Fewer, larger writes.
+	setvbuf(csvFile, NULL, _IOFBF, COLLECTOR_CSV_BUFFER_SIZE);
+	
+	fprintf(csvFile, "time");
+	
+	for(int32 i=0 ; i<counterList.CountItems() ; i++)
+		fprintf(csvFile, ",\"%s\"", counterList.ItemAt(i)->path.String());
+		
+	fprintf(csvFile, "\n");
+	
+	return B_OK;
+}
+
+status_t CCounterCollector::Run(bigtime_t _interval, bigtime_t _duration)
+{
+	interval = MAX(_interval, MIN_INTERVAL);
+	duration = _duration;
+
+	// Short intervals need a high priority to keep the time.
+	samplerThread = spawn_thread(SamplerThread, "collector", 
+		interval < FAST_PULSE_RATE ? B_URGENT_DISPLAY_PRIORITY : B_NORMAL_PRIORITY, this);
+		
+	if(samplerThread < B_OK)
+		return samplerThread;
+	
+	RETURN_IF_FAILED( resume_thread(samplerThread) );
+	
+	status_t exitValue = B_OK;
+	status_t status;
+	
+	// Ctrl+C interrupts the wait (see stop_collector()).
+	do {
+		status = wait_for_thread(samplerThread, &exitValue);
+	} while(status == B_INTERRUPTED);
+	
+	samplerThread = -1;
+	
+	return status == B_OK ? exitValue : status;
+}
+
+void CCounterCollector::Stop()
+{
+	quit = true;
+}
+
+int32 CCounterCollector::SamplerThread(void *data)
+{
+	CCounterCollector *collector = (CCounterCollector *)data;
+	
+	collector->SampleLoop();
+	
+	return B_OK;
+}
+
+// SampleLoop
+// Samples all counters each interval. If a tick is late by more than
+// an interval, the missed ticks are skipped.
+void CCounterCollector::SampleLoop()
+{
+	startTime		= system_time();
+	realStartTime	= real_time_clock_usecs() / 1000;
+	
+	bigtime_t nextTick = startTime;
+	
+	while(!quit && (duration == 0 || nextTick - startTime < duration)) {
+		snooze_until(nextTick, B_SYSTEM_TIMEBASE);
+		
+		bigtime_t now = system_time();
+		
+		context.Sample();
+		
+		WriteTick(now);
+		
+		if(tickCount++ == 0) {
+			// The first tick allocated the buffers.
+			startMemory = TeamMemory();
+			
+			countedAllocations	= 0;
+			countedBytes		= 0;
+			countedThread		= find_thread(NULL);
+		}
+		
+		nextTick += interval;
+		
+		if(now - nextTick > interval) {
+			lateTickCount++;
+			nextTick = now + interval;
+		}
+	}
+	
+	countedThread = -1;
+	
+	allocationCount	= countedAllocations;
+	allocatedBytes	= countedBytes;
+	
+	endTime = system_time();
+	endMemory = TeamMemory();
+	
+	thread_info threadInfo;
+	
+	if(get_thread_info(find_thread(NULL), &threadInfo) == B_OK)
+		samplerCPUTime = threadInfo.user_time + threadInfo.kernel_time;
+		
+	if(csvFile)
+		fflush(csvFile);
+		
+	if(binaryFile) {
+		WriteBlocks();
+		binaryFile->File()->Sync();
+	}
+}
+
+// WriteTick
+// Writes the samples of the last Sample() to the sink. The binary sink
+// skips invalid values and writes the block of a counter, when it's
+// full.
+void CCounterCollector::WriteTick(bigtime_t time)
+{
+	int64 timeMs = realStartTime + (time - startTime) / 1000;
+
+	if(csvFile)
+		fprintf(csvFile, "%.3f", (time - startTime) / 1000.0);
+
+	for(int32 i=0 ; i<counterList.CountItems() ; i++) {
+		counter *c = counterList.ItemAt(i);
+	
+		data_sample sample;
+		double value;
+		
+		bool valid = context.GetSample(i, sample);
+		bool normalized = c->normalizer.Normalize(c->provider, sample, valid, interval, value);
+		
+		if(csvFile) {
+			// Invalid values are left empty.
+			if(normalized)
+				fprintf(csvFile, ",%g", value);
+			else
+				fputc(',', csvFile);
+		}
+		
+		if(binaryFile && normalized) {
+			c->encoder.Append(timeMs, value);
+			
+			if(c->encoder.IsFull()) {
+				binaryFile->WriteBlock(i, c->encoder);
+				c->encoder.Reset();
+			}
+		}
+	}
+	
+	if(csvFile)
+		fputc('\n', csvFile);
+}
+
+// WriteBlocks
+// Writes the samples, which are still in the encoders.
+void CCounterCollector::WriteBlocks()
+{
+	for(int32 i=0 ; i<counterList.CountItems() ; i++) {
+		counter *c = counterList.ItemAt(i);
+		
+		if(!c->encoder.IsEmpty()) {
+			binaryFile->WriteBlock(i, c->encoder);
+			c->encoder.Reset();
+		}
+	}
+}
+
+// TeamMemory
+// Size of all areas of the team in bytes.
+size_t CCounterCollector::TeamMemory()
+{
+	size_t size = 0;
+	ssize_t cookie = 0;
+	area_info areaInfo;
+	
+	while(get_next_area_info(B_CURRENT_TEAM, &cookie, &areaInfo) == B_OK)
+		size += areaInfo.ram_size;
+		
+	return size;
+}
+
+void CCounterCollector::PrintReport(FILE *file)
+{
+	bigtime_t wallTime	 = MAX(endTime - startTime, 1);
+	int64 sampleCount	 = MAX(tickCount * counterList.CountItems(), 1);
+	
+	team_usage_info usage;
+	bigtime_t teamCPUTime = 0;
+	
+	if(get_team_usage_info(B_CURRENT_TEAM, B_TEAM_USAGE_SELF, &usage) == B_OK)
+		teamCPUTime = usage.user_time + usage.kernel_time;
+	
+	fprintf(file, "Collected %Ld ticks of %ld counters in %.1f s (%Ld late)\n",
+		tickCount, counterList.CountItems(), wallTime / 1000000.0, lateTickCount);
+	fprintf(file, "Sampler CPU time: %.1f ms (%.2f %%, %.1f us per tick)\n",
+		samplerCPUTime / 1000.0, samplerCPUTime * 100.0 / wallTime,
+		tickCount > 0 ? (double)samplerCPUTime / tickCount : 0.0);
+	fprintf(file, "Team CPU time: %.1f ms (%.2f %%)\n",
+		teamCPUTime / 1000.0, teamCPUTime * 100.0 / wallTime);
+	// The areas grow by pages, so this isn't the heap allocated per sample.
+	fprintf(file, "Area growth after the first tick: %ld bytes (page granular, %.2f bytes per sample)\n",
+		(ssize_t)(endMemory - startMemory), (ssize_t)(endMemory - startMemory) / (double)sampleCount);
+	
+	// The first tick isn't counted.
+	int64 countedSamples = MAX((tickCount-1) * counterList.CountItems(), 1);
+	
+	fprintf(file, "Sampler allocations after the first tick: %Ld (%Ld bytes, %.3f allocations and %.2f bytes per sample)\n",
+		allocationCount, allocatedBytes, allocationCount / (double)countedSamples,
+		allocatedBytes / (double)countedSamples);
+		
+	if(binaryFile) {
+		fprintf(file, "Binary output: %Ld bytes (%.2f bytes per sample)\n",
+			binaryFile->Size(), binaryFile->Size() / (double)sampleCount);
+	}
+}
+
+// ====== collect_main ======
+
+// next_argument
+// Returns the argument following the option 'option' or NULL.
+static const char *next_argument(int argc, char **argv, const char *option)
+{
+	for(int i=1 ; i<argc-1 ; i++) {
+		if(strcmp(argv[i], option) == 0)
+			return argv[i+1];
+	}
+	
+	return NULL;
+}
+
+static void print_collect_usage()
+{
+	fprintf(stderr, "Usage: TaskManager --collect [--interval <ms>] [--duration <s>]\n"
+					"                   [--output <file>] [--binary] <counter path> ...\n"
+					"Samples the counters (for example \"/Total/CPU Usage/Average\") every\n"
+					"interval (default: %Ld ms, minimum: %Ld ms) and writes them as CSV to\n"
+					"the output file or stdout. --binary writes the values compressed in the\n"
+					"format of the history files instead. It needs --output. Stop with Ctrl+C.\n",
+		COLLECTOR_DEFAULT_INTERVAL / 1000, CCounterCollector::MIN_INTERVAL / 1000);
+}
+
+int collect_main(int argc, char **argv)
+{
+	const char *intervalArg	= next_argument(argc, argv, "--interval");
+	const char *durationArg	= next_argument(argc, argv, "--duration");
+	const char *outputArg	= next_argument(argc, argv, "--output");
+	bool binary				= false;
+	
+	bigtime_t interval = intervalArg ? (bigtime_t)(atof(intervalArg) * 1000) : COLLECTOR_DEFAULT_INTERVAL;
+	bigtime_t duration = durationArg ? (bigtime_t)(atof(durationArg) * 1000000) : 0;
+	
+	if(interval < CCounterCollector::MIN_INTERVAL) {
+		fprintf(stderr, "The interval is raised to %Ld ms.\n", CCounterCollector::MIN_INTERVAL / 1000);
+		interval = CCounterCollector::MIN_INTERVAL;
+	}
+	
+	// Each tick must read fresh data from the kernel. This must be
+	// set before any cache is used.
+	char maxCacheAge[32];
+	
+	sprintf(maxCacheAge, "%Ld", interval/2);
+	setenv(MAX_CACHE_AGE_ENV, maxCacheAge, 1);
+	
+	InitGlobalNamespace();
+	
+	CCounterCollector collector;
+	
+	for(int i=1 ; i<argc ; i++) {
+		if(strcmp(argv[i], "--binary") == 0) {
+			binary = true;
+		} else if(strcmp(argv[i], "--interval") == 0 || strcmp(argv[i], "--duration") == 0 || 
+				  strcmp(argv[i], "--output") == 0) {
+			// skip the argument of the option
+			i++;
+		} else if(strncmp(argv[i], "--", 2) == 0) {
+			// --collect
+		} else if(collector.AddCounter(argv[i]) != B_OK) {
+			fprintf(stderr, "Unknown counter '%s'.\n", argv[i]);
+			return 1;
+		}
+	}
+	
+	if(collector.CountCounters() == 0) {
+		print_collect_usage();
+		return 1;
+	}
+	
+	if(binary && outputArg == NULL) {
+		fprintf(stderr, "--binary needs an output file (--output <file>).\n\n");
+		print_collect_usage();
+		return 1;
+	}
+	
+	status_t status = collector.SetOutput(outputArg, binary);
+	
+	if(status != B_OK) {
+		fprintf(stderr, "Can't write '%s': %s\n", outputArg ? outputArg : "stdout", strerror(status));
+		return 1;
+	}
+	
+	signalCollector = &collector;
+	
+	signal(SIGINT, stop_collector);
+	signal(SIGTERM, stop_collector);
+	
+	status = collector.Run(interval, duration);
+	
+	signalCollector = NULL;
+	
+	collector.PrintReport(stderr);
+	
+	return status == B_OK ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COUNTER_COLLECTOR_H
+#define COUNTER_COLLECTOR_H
+
+#include "PointerList.h"
+#include "DataProvider.h"
+#include "SamplingContext.h"
+#include "TimeSeriesCodec.h"
+
+class CTimeSeriesWriter;
+
+//: Samples performance counters without user interface.
+// The counters are created by path from the global namespace and
+// sampled by a dedicated thread. The sink is either a CSV file with the
+// normalized values (one line per tick) or a binary file in the format
+// of the time series store (see TimeSeriesStore.h). The binary sink
+// compresses the values of each counter with a CTimeSeriesEncoder, so
+// a tick usually takes a few bits per counter.
+// After the first tick the sampling thread shouldn't allocate memory.
+// The report written at the end shows the allocations of the sampling
+// thread after the first tick (counted by the global operator new),
+// the area growth of the team and the CPU time spent.
+class CCounterCollector
+{
+	public:
+	CCounterCollector();
+	~CCounterCollector();
+	
+	status_t AddCounter(const char *path);
+	int32 CountCounters() const { return counterList.CountItems(); }
+
+	// Writes CSV to 'path' or to stdout, if 'path' is NULL. A binary
+	// sink always needs a path.
+	status_t SetOutput(const char *path, bool binary);
+
+	// Samples every 'interval' until 'duration' passed or Stop() is
+	// called. A 'duration' of zero means forever.
+	status_t Run(bigtime_t interval, bigtime_t duration);
+	void Stop();
+	
+	void PrintReport(FILE *file);
+	
+	static const bigtime_t MIN_INTERVAL;
+
+	protected:
+	struct counter {
+		BString				 path;
+		IDataProvider		*provider;
+		CSampleNormalizer	 normalizer;
+		CTimeSeriesEncoder	 encoder;		// binary sink only
+		
+		~counter() { delete provider; }
+	};
+
+	static int32 SamplerThread(void *data);
+	void SampleLoop();
+	void WriteTick(bigtime_t time);
+	void WriteBlocks();
+	static size_t TeamMemory();
+	
+	CPointerList<counter>	 counterList;
+	CSamplingContext		 context;
+	FILE					*csvFile;		// NULL for binary sink
+	CTimeSeriesWriter		*binaryFile;	// NULL for CSV sink
+	int64					 realStartTime;	// in milliseconds
+	bigtime_t				 interval;
+	bigtime_t				 duration;
+	volatile bool			 quit;			// set by Stop()
+	thread_id				 samplerThread;
+	
+	// statistics
+	int64					 tickCount;
+	int64					 lateTickCount;	// ticks which missed their time
+	bigtime_t				 startTime;
+	bigtime_t				 endTime;
+	bigtime_t				 samplerCPUTime;
+	size_t					 startMemory;	// after the first tick
+	size_t					 endMemory;
+	int64					 allocationCount;	// by operator new after the first tick
+	int64					 allocatedBytes;
+};
+
+// Runs the --collect mode without BApplication, so it doesn't need a
+// desktop session. Returns the exit code of the process.
+int collect_main(int argc, char **argv);
+
+#endif // COUNTER_COLLECTOR_H
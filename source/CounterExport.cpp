@@ -0,0 +1,309 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#include "pch.h"
+#include "my_assert.h"
+#include "DataProvider.h"
+#include "CounterExport.h"
+
+// The area may be cloned by other teams.
+#ifdef B_CLONEABLE_AREA
+const uint32 COUNTER_EXPORT_PROTECTION	= B_READ_AREA | B_WRITE_AREA | B_CLONEABLE_AREA;
+#else
+const uint32 COUNTER_EXPORT_PROTECTION	= B_READ_AREA | B_WRITE_AREA;
+#endif
+
+// ====== CCounterExport ======
+
+const int32 CCounterExport::SLOT_CAPACITY		= 4096;
+const int32 CCounterExport::STRING_TABLE_SIZE	= 4096*64;
+
+CCounterExport::CCounterExport() :
+	locker("CounterExport")
+{
+	area		= B_NO_INIT;
+	header		= NULL;
+	slots		= NULL;
+	stringTable	= NULL;
+}
+
+CCounterExport::~CCounterExport()
+{
+	if(area >= B_OK)
+		delete_area(area);
+		
+	RemoveFromList(ClassName());
+}
+
+CCounterExport *CCounterExport::CreateInstance(const char *areaName)
+{
+	// Initialize to quiet compiler.
+	CCounterExport *counterExport = NULL;
+
+	counterExport = CreateSingleton(counterExport, "CCounterExport");
+	
+	if(counterExport->area < B_OK)
+		counterExport->CreateArea(areaName);
+		
+	return counterExport;
+}
+
+CCounterExport *CCounterExport::Instance()
+{
+	CCounterExport *counterExport = dynamic_cast<CCounterExport *>(Find("CCounterExport"));
+	
+	return counterExport && counterExport->InitCheck() == B_OK ? counterExport : NULL;
+}
+
+// CreateArea
+// Creates the area named 'areaName' and initializes the header.
+void CCounterExport::CreateArea(const char *areaName)
+{
+	size_t slotOffset	 = (sizeof(counter_export_header) + 7) & ~7;
+	size_t stringOffset	 = slotOffset + SLOT_CAPACITY * sizeof(counter_export_slot);
+	size_t size			 = stringOffset + STRING_TABLE_SIZE;
+	
+	size = (size + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+	
+	void *address;
+	
+	area = create_area(areaName, &address, B_ANY_ADDRESS, size, 
+		B_NO_LOCK, COUNTER_EXPORT_PROTECTION);
+		
+	if(area < B_OK)
+		return;
+		
+	header		= (counter_export_header *)address;
+	slots		= (counter_export_slot *)((char *)address + slotOffset);
+	stringTable	= (char *)address + stringOffset;
+	
+	header->version				= COUNTER_EXPORT_VERSION;
+	header->slotCapacity		= SLOT_CAPACITY;
+	header->slotCount			= 0;
+	header->slotOffset			= slotOffset;
+	header->stringTableOffset	= stringOffset;
+	header->stringTableSize		= STRING_TABLE_SIZE;
+	header->stringTableUsed		= 0;
+	header->generation			= 0;
+	
+	thread_info threadInfo;
+	
+	get_thread_info(find_thread(NULL), &threadInfo);
+	
+	header->writerTeam			= threadInfo.team;
+	
+	// Readers check the magic last.
+	atomic_set((int32 *)&header->magic, COUNTER_EXPORT_MAGIC);
+}
+
+// Register
+// An inactive slot with the same path is reused. So the string table
+// doesn't grow, if a counter is removed and added again.
+int32 CCounterExport::Register(const char *path)
+{
+	BAutolock autoLocker(locker);
+
+	int32 count = header->slotCount;
+
+	for(int32 i=0 ; i<count ; i++) {
+		if(!slots[i].active && strcmp(stringTable + slots[i].pathOffset, path) == 0) {
+			SetActive(&slots[i], true);
+			return i;
+		}
+	}
+	
+	if(count >= SLOT_CAPACITY)
+		return -1;
+		
+	int32 pathOffset = AddString(path);
+	
+	if(pathOffset < 0)
+		return -1;
+	
+	counter_export_slot *slot = &slots[count];
+	
+	slot->sequence		= 0;
+	slot->pathOffset	= pathOffset;
+	slot->active		= 1;
+	slot->valid			= 0;
+	slot->timeStamp		= 0;
+	slot->value			= slot->min = slot->max = slot->avg = 0.0;
+	
+	atomic_add(&header->generation, 1);
+	
+	// publish the slot
+	atomic_set(&header->slotCount, count+1);
+	
+	return count;
+}
+
+void CCounterExport::Unregister(int32 slot)
+{
+	BAutolock autoLocker(locker);
+	
+	if(slot >= 0 && slot < header->slotCount)
+		SetActive(&slots[slot], false);
+}
+
+void CCounterExport::Publish(int32 index, const counter_export_value &value)
+{
+	if(index < 0 || index >= SLOT_CAPACITY)
+		return;
+		
+	counter_export_slot *slot = &slots[index];
+	
+	atomic_add(&slot->sequence, 1);
+	
+	COUNTER_EXPORT_RELEASE_FENCE();
+	
+	// Samples of data providers without a time stamp are stamped with
+	// the time they are published. The time stamp is never a marker
+	// for invalid values, that's what 'valid' is for.
+	slot->timeStamp	= value.timeStamp != 0 ? value.timeStamp : system_time();
+	slot->value		= value.value;
+	slot->min		= value.min;
+	slot->max		= value.max;
+	slot->avg		= value.avg;
+	slot->valid		= value.valid ? 1 : 0;
+	
+	COUNTER_EXPORT_RELEASE_FENCE();
+	
+	atomic_add(&slot->sequence, 1);
+}
+
+// AddString
+// Appends 'string' to the string table. Returns its offset or -1,
+// if the table is full. The locker must be held.
+int32 CCounterExport::AddString(const char *string)
+{
+	int32 length = strlen(string) + 1;
+	int32 offset = header->stringTableUsed;
+	
+	if(offset + length > STRING_TABLE_SIZE)
+		return -1;
+		
+	memcpy(stringTable + offset, string, length);
+	
+	header->stringTableUsed = offset + length;
+	
+	return offset;
+}
+
+// SetActive
+// Changes the state of a slot. The locker must be held.
+void CCounterExport::SetActive(counter_export_slot *slot, bool active)
+{
+	atomic_add(&slot->sequence, 1);
+	
+	COUNTER_EXPORT_RELEASE_FENCE();
+	
+	slot->active = active ? 1 : 0;
+	
+	if(active) {
+		// Don't show the values of the former owner.
+		slot->valid = 0;
+		slot->value = slot->min = slot->max = slot->avg = 0.0;
+	}
+	
+	COUNTER_EXPORT_RELEASE_FENCE();
+	
+	atomic_add(&slot->sequence, 1);
+	
+	atomic_add(&header->generation, 1);
+}
+
+
+// ====== CExportedCounter ======
+
+CExportedCounter::CExportedCounter()
+{
+	slot		= -1;
+	min			= 0.0;
+	max			= 0.0;
+	avg			= 0.0;
+	valueCount	= 0;
+}
+
+CExportedCounter::~CExportedCounter()
+{
+	Unregister();
+}
+
+void CExportedCounter::SetPath(const char *_path)
+{
+	if(path == _path)
+		return;
+
+	Unregister();
+
+	path		= _path;
+	min			= 0.0;
+	max			= 0.0;
+	avg			= 0.0;
+	valueCount	= 0;
+}
+
+// Publish
+// Invalid values are published with the statistics of the valid ones,
+// but aren't part of them.
+void CExportedCounter::Publish(const data_sample &sample, double value, bool valid)
+{
+	CCounterExport *counterExport = CCounterExport::Instance();
+	
+	if(counterExport == NULL || path.Length() == 0)
+		return;
+		
+	if(valid) {
+		if(valueCount == 0) {
+			min = max = avg = value;
+		} else {
+			min = MIN(value, min);
+			max = MAX(value, max);
+			avg = (avg*valueCount + value) / (valueCount+1);
+		}
+		
+		valueCount++;
+	}
+	
+	if(slot < 0) {
+		slot = counterExport->Register(path.String());
+		
+		if(slot < 0)
+			return;
+	}
+	
+	counter_export_value exportValue;
+	
+	exportValue.timeStamp	= sample.timeStamp;
+	exportValue.value		= value;
+	exportValue.min			= min;
+	exportValue.max			= max;
+	exportValue.avg			= avg;
+	exportValue.valid		= valid;
+	
+	counterExport->Publish(slot, exportValue);
+}
+
+void CExportedCounter::Unregister()
+{
+	CCounterExport *counterExport = CCounterExport::Instance();
+
+	if(counterExport && slot >= 0)
+		counterExport->Unregister(slot);
+		
+	slot = -1;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef COUNTER_EXPORT_H
+#define COUNTER_EXPORT_H
+
+#include "Singleton.h"
+#include "SharedCounters.h"
+
+struct data_sample;
+
+//: Publishes the counters of the views in a shared area.
+// See SharedCounters.h for the layout. The export is created by the
+// application. The deskbar replicant runs in the Deskbar and creates
+// its own export named COUNTER_EXPORT_DESKBAR_AREA_NAME. Views in
+// other teams don't export their counters, as Instance() returns
+// NULL there.
+class CCounterExport : public CSingleton
+{
+	public:
+	static CCounterExport *CreateInstance(const char *areaName=COUNTER_EXPORT_AREA_NAME);
+	static CCounterExport *Instance();
+
+	virtual ~CCounterExport();
+	virtual void Reactivate() {}
+	
+	status_t InitCheck() { return area >= B_OK ? B_OK : area; }
+
+	// Returns the slot for 'path' or -1, if the area is full.
+	int32 Register(const char *path);
+	void Unregister(int32 slot);
+	
+	// Only the owner of the slot may publish values, so the slots
+	// aren't locked.
+	void Publish(int32 slot, const counter_export_value &value);
+
+	protected:
+	CCounterExport();
+	
+	void CreateArea(const char *areaName);
+	int32 AddString(const char *string);
+	void SetActive(counter_export_slot *slot, bool active);
+	
+	static const int32 SLOT_CAPACITY;
+	static const int32 STRING_TABLE_SIZE;
+	
+	BLocker					 locker;				// guards Register() and Unregister()
+	area_id					 area;
+	counter_export_header	*header;
+	counter_export_slot		*slots;
+	char					*stringTable;
+	
+	friend class CSingleton;
+};
+
+//: A counter of a view, which doesn't keep statistics itself.
+// Tracks the minimum, maximum and average of the published values
+// and registers the counter with the first value. Does nothing, if
+// there is no export in this team.
+class CExportedCounter
+{
+	public:
+	CExportedCounter();
+	~CExportedCounter();
+	
+	// The counter path or, if it isn't known, the display name
+	// of the data provider. Changing the path resets the statistics.
+	void SetPath(const char *path);
+	const char *Path() const { return path.String(); }
+	
+	void Publish(const data_sample &sample, double value, bool valid);
+	void Unregister();
+	
+	protected:
+	BString		path;
+	int32		slot;				// slot in CCounterExport or -1
+	double		min, max, avg;
+	int32		valueCount;
+};
+
+#endif // COUNTER_EXPORT_H
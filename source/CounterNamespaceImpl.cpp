@@ -19,6 +19,8 @@
 #include "alert.h"
 #include "help.h"
 #include "my_assert.h"
+#include "SystemInfo.h"
+#include "SystemSnapshot.h"
 #include "CounterNamespaceImpl.h"
 
 #include <Catalog.h>
@@ -35,6 +37,38 @@ void InitGlobalNamespace()
 
 CPointer<IPerformanceCounterNamespace> global_Namespace;
 
+// InstantiateDataProvider
+// Instantiates an archived data provider. Plugins are loaded on first
+// use, so the plugin providing the class may have to be loaded first.
+IDataProvider *InstantiateDataProvider(BMessage *archive)
+{
+	CPerformanceCounterNamespace *counterNamespace = 
+		dynamic_cast<CPerformanceCounterNamespace *>((IPerformanceCounterNamespace *)global_Namespace);
+
+	if(counterNamespace)
+		return counterNamespace->InstantiateDataProvider(archive);
+		
+	return dynamic_cast<IDataProvider *>(instantiate_object(archive));
+}
+
+// CounterPathExists
+// Tests, if the counter 'path' exists, without enumerating the
+// counter tree again.
+bool CounterPathExists(const char *path)
+{
+	CPerformanceCounterNamespace *counterNamespace = 
+		dynamic_cast<CPerformanceCounterNamespace *>((IPerformanceCounterNamespace *)global_Namespace);
+
+	if(counterNamespace)
+		return counterNamespace->CounterExists(path);
+		
+	IDataProvider *provider = global_Namespace->DataProvider(path);
+	
+	delete provider;
+	
+	return provider != NULL;
+}
+
 // ==== CRootNode ====
 
 CRootNode::CRootNode(IPerformanceCounterNamespace *ns)
@@ -63,33 +97,95 @@ void CRootNode::InitChildren()
 	}
 }
 
+status_t CRootNode::GetNextChildren(counter_cursor *cursor, int32 maxCount, BList *children)
+{
+	return namesp->GetNextChildren(Path(), cursor, maxCount, children);
+}
+
+int32 CRootNode::CountChildrenHint()
+{
+	return namesp->CountChildrenHint(Path());
+}
+
+// ==== CPluginRootCounter ====
+
+CPluginRootCounter::CPluginRootCounter(IPerformanceCounterNamespace *ns, const char *_name) :
+	CRootNode(ns)
+{
+	name = _name;
+	path = "/";
+	path << name;
+}
+
 // ==== CPerformanceCounterNamespace ====
 
-CPerformanceCounterNamespace::CPerformanceCounterNamespace()
+CPerformanceCounterNamespace::CPerformanceCounterNamespace() :
+	pathIndexLocker("CounterPathIndex"),
+	pathIndex(this)
 {
+	bigtime_t startTime = system_time();
+
+	lastTeamSetTime	= -1;
+	lastTeamSetHash	= 0;
+
 	// --- load plugins
 
+	// Plugins with manifest aren't loaded here, only their
+	// manifest is read (see CPlugin).
+
 	// One plugin is the default plugin. If that plugin can't
 	// be loaded the taskamanager isn't displaying anything
 	// inside the "Usage" tab.
 	const char *defaultPluginName = "taskmanager_default.so";
-	bool defaultPluginLoaded = false;
 	
 	BPath  addonDirPath = get_app_dir();
 
 	addonDirPath.Append("add_ons");
 	
-	BEntry addonDirEntry(addonDirPath.Path());
+	BPath  isolatedDirPath(addonDirPath.Path(), "isolated");
+	
+	bool defaultPluginLoaded = AddPlugins(addonDirPath, false, defaultPluginName);
+	
+	// The plugins in the subdirectory "isolated" are loaded
+	// by the plugin host.
+	if(AddPlugins(isolatedDirPath, true, defaultPluginName))
+		defaultPluginLoaded = true;
+	
+	if(!defaultPluginLoaded) {
+		// default plugin couldn't be loaded. Display warning.
+		BString message (B_TRANSLATE("The default plugin '\0' couldn't be loaded. Be TaskManager won't work correctly.\n\nBe TaskManager was looking in this directory for plugins: '\1'."));
+	
+		message << defaultPluginName
+				<< addonDirPath.Path();
+			
+		show_alert_with_help(message, "error_default_not_found.html");
+	}
+	
+	initTime = system_time() - startTime;
+}
+
+// AddPlugins
+// Adds all add-ons in 'dirPath' to the plugin list. Returns true, if
+// the default plugin is one of them.
+bool CPerformanceCounterNamespace::AddPlugins(const BPath &dirPath, bool isolated, 
+	const char *defaultPluginName)
+{
+	bool defaultPluginLoaded = false;
+
+	BEntry addonDirEntry(dirPath.Path());
 	BDirectory addonDir(&addonDirEntry);
 	
 	BEntry addonEntry;
 	BPath  addonPath;
 
 	while(addonDir.GetNextEntry(&addonEntry) == B_OK) {
+		if(addonEntry.IsDirectory())
+			continue;
+	
 		// load addon
 		addonEntry.GetPath(&addonPath);
 		
-		CPlugin *plugin = new CPlugin(addonPath.Path());
+		CPlugin *plugin = new CPlugin(addonPath.Path(), &pushSourceHost, isolated);
 
 		if(plugin->InitCheck() == B_OK) {
 			pluginList.AddItem(plugin);
@@ -100,15 +196,7 @@ CPerformanceCounterNamespace::CPerformanceCounterNamespace()
 			delete plugin;
 	}
 	
-	if(!defaultPluginLoaded) {
-		// default plugin couldn't be loaded. Display warning.
-		BString message (B_TRANSLATE("The default plugin '\0' couldn't be loaded. Be TaskManager won't work correctly.\n\nBe TaskManager was looking in this directory for plugins: '\1'."));
-	
-		message << defaultPluginName
-				<< addonDirPath.Path();
-			
-		show_alert_with_help(message, "error_default_not_found.html");
-	}
+	return defaultPluginLoaded;
 }
 
 status_t CPerformanceCounterNamespace::EnumChildren(const char *path, BList *children)
@@ -124,64 +212,436 @@ status_t CPerformanceCounterNamespace::EnumChildren(const char *path, BList *chi
 	return B_OK;
 }
 
+// GetNextChildren
+// The plugins are asked one after another. A page ends with the
+// page of a plugin, even if it contains less than 'maxCount' items.
+status_t CPerformanceCounterNamespace::GetNextChildren(const char *path, counter_cursor *cursor,
+	int32 maxCount, BList *children)
+{
+	if(cursor->plugin < pluginList.CountItems()) {
+		bool done = false;
+	
+		RETURN_IF_FAILED( pluginList.ItemAt(cursor->plugin)->GetNextChildren(this, path, 
+			&cursor->cookie, &done, maxCount, children) );
+			
+		if(done) {
+			cursor->plugin++;
+			cursor->cookie = 0;
+		}
+	}
+	
+	cursor->done = cursor->plugin >= pluginList.CountItems();
+	
+	return B_OK;
+}
+
+int32 CPerformanceCounterNamespace::CountChildrenHint(const char *path)
+{
+	int32 count = 0;
+
+	for(int i=0 ; i<pluginList.CountItems() ; i++) {
+		int32 pluginCount = pluginList.ItemAt(i)->CountChildrenHint(path);
+		
+		if(pluginCount < 0)
+			return -1;
+			
+		count += pluginCount;
+	}
+	
+	return count;
+}
+
 IDataProvider *CPerformanceCounterNamespace::DataProvider(const char *path)
 {
-	// seperate components.
-	CPointerList<BString> components;
-	BString sPath = path;
+	BAutolock autoLocker(pathIndexLocker);
+
+	InvalidateVolatilePaths();
+
+	IPerformanceCounter *counter = pathIndex.Find(path);
+	
+	if(counter == NULL || counter->DataProvider() == NULL)
+		return NULL;
+	
+	return counter->DataProvider()->Clone();
+}
+
+bool CPerformanceCounterNamespace::CounterExists(const char *path)
+{
+	BAutolock autoLocker(pathIndexLocker);
+
+	InvalidateVolatilePaths();
+
+	return pathIndex.Find(path) != NULL;
+}
+
+void CPerformanceCounterNamespace::LoadPluginForClass(const char *className)
+{
+	for(int i=0 ; i<pluginList.CountItems() ; i++) {
+		CPlugin *plugin = pluginList.ItemAt(i);
+	
+		if(plugin->ProvidesClass(className)) {
+			plugin->Load();
+			break;
+		}
+	}
+}
+
+IDataProvider *CPerformanceCounterNamespace::InstantiateDataProvider(BMessage *archive)
+{
+	const char *className = archive->FindString("class");
+	
+	if(className) {
+		LoadPluginForClass(className);
+	
+		// If the class isn't in one of the loaded images, it may be
+		// in an isolated plugin. instantiate_object() would load
+		// the add-on into this team.
+		if(find_instantiation_func(className) == NULL) {
+			for(int i=0 ; i<pluginList.CountItems() ; i++) {
+				IDataProvider *provider = pluginList.ItemAt(i)->InstantiateRemoteProvider(archive);
+				
+				if(provider)
+					return provider;
+			}
+		}
+	}
+	
+	return dynamic_cast<IDataProvider *>(instantiate_object(archive));
+}
+
+void CPerformanceCounterNamespace::PrintStartupTiming()
+{
+	printf("Plugin initialization: %.1f ms\n", initTime / 1000.0);
+	
+	for(int i=0 ; i<pluginList.CountItems() ; i++) {
+		CPlugin *plugin = pluginList.ItemAt(i);
+		
+		if(plugin->IsLoaded())
+			printf("  %s: loaded in %.1f ms\n", plugin->Path(), plugin->LoadTime() / 1000.0);
+		else
+			printf("  %s: not loaded\n", plugin->Path());
+	}
+}
+
+// InvalidateVolatilePaths
+// Drops the cached teams, if the set of teams changed since the last lookup.
+// Lookups of new teams are handled by the index anyway, but counters of
+// teams which died would stay in the index. The team count isn't enough,
+// a team may have died while another one was created. The set is only
+// compared, if there is a new snapshot.
+void CPerformanceCounterNamespace::InvalidateVolatilePaths()
+{
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(SNAPSHOT_TEAMS);
 	
-	// Don't begin at index 0. Char at index 0 is always a '/'.
-	for(int i=1 ; i<sPath.Length() ; i++) {
-		int32 slash = sPath.FindFirst("/", i);
+	if(snapshot == NULL)
+		return;
 		
-		if(slash == B_ERROR)
-			slash = sPath.Length();
+	if(snapshot->TimeStamp() != lastTeamSetTime) {
+		// The sum doesn't depend on the order of the teams.
+		uint32 teamSetHash = snapshot->CountTeams();
+		
+		for(int32 i=0 ; i<snapshot->CountTeams() ; i++)
+			teamSetHash += (uint32)snapshot->TeamId(i) * 2654435761UL;
+			
+		if(teamSetHash != lastTeamSetHash) {
+			pathIndex.Invalidate("/Teams");
+			lastTeamSetHash = teamSetHash;
+		}
+		
+		lastTeamSetTime = snapshot->TimeStamp();
+	}
+	
+	release_system_snapshot(snapshot);
+}
+
+// ==== CCounterPathIndex ====
+
+CCounterPathIndex::CCounterPathIndex(IPerformanceCounterNamespace *ns) :
+	root(new CRootNode(ns), true)
+{
+	namesp = ns;
+}
+
+CCounterPathIndex::~CCounterPathIndex()
+{
+}
+
+IPerformanceCounter *CCounterPathIndex::Find(const char *path)
+{
+	CNode *node = FindNode(path, true);
+	
+	return node ? node->counter : NULL;
+}
+
+void CCounterPathIndex::Invalidate(const char *path)
+{
+	CNode *node = FindNode(path, false);
+	
+	if(node) {
+		node->children.MakeEmpty();
+		node->missingNames.MakeEmpty();
+		node->enumerated = false;
+	}
+}
+
+// FindNode
+// Walks down the components of 'path'. The path is split in place,
+// no copies of the components are made. If 'enumerate' is false only
+// the cached nodes are searched. A miss enumerates the parent again,
+// unless it was just enumerated or the miss is cached.
+CCounterPathIndex::CNode *CCounterPathIndex::FindNode(const char *path, bool enumerate)
+{
+	CNode *node = &root;
+	
+	// Char at index 0 is always a '/'.
+	const char *component = path[0] == '/' ? path+1 : path;
+	
+	while(*component != '\0') {
+		const char *slash = strchr(component, '/');
+		int32 length = slash ? slash-component : strlen(component);
+	
+		bool fresh = false;
+	
+		if(!node->enumerated) {
+			if(!enumerate)
+				return NULL;
+			
+			EnumChildren(node);
+			fresh = true;
+		}
+	
+		CNode *child = FindChild(node, component, length);
 		
-		BString *component = new BString;
+		if(child == NULL && enumerate) {
+			if(!fresh && !IsMissing(node, component, length)) {
+				// The children may have changed since they were enumerated.
+				EnumChildren(node);
+				
+				child = FindChild(node, component, length);
+			}
+			
+			if(child == NULL && !IsMissing(node, component, length))
+				node->missingNames.AddItem(new BString(component, length));
+		}
 		
-		sPath.CopyInto(*component, i, slash-i);
+		if(child == NULL)
+			return NULL;
+			
+		node = child;
 		
-		components.AddItem(component);
+		if(slash == NULL)
+			break;
 		
-		i=slash;
+		component = slash+1;
 	}
 	
-	CPointer<IPerformanceCounter> root = Root();
-	IPerformanceCounter *current = root;
+	return node;
+}
+
+// FindChild
+// Binary search for the child with the internal name 'name'.
+// 'name' isn't null terminated. It's 'length' chars long.
+CCounterPathIndex::CNode *CCounterPathIndex::FindChild(CNode *parent, const char *name, int32 length)
+{
+	int32 low = 0, high = parent->children.CountItems()-1;
 	
-	for(int i=0 ; i<components.CountItems() ; i++) {
-		current = FindObject(current, components.ItemAt(i)->String());
+	while(low <= high) {
+		int32 middle = (low + high) / 2;
+		
+		CNode *child = parent->children.ItemAt(middle);
+		const char *childName = child->counter->InternalName();
 		
-		if(!current) break;
+		int result = strncmp(childName, name, length);
+		
+		if(result == 0 && childName[length] != '\0')
+			result = 1;		// 'name' is a prefix of the child's name
+		
+		if(result == 0)
+			return child;
+		else if(result < 0)
+			low = middle+1;
+		else
+			high = middle-1;
 	}
 	
-	return current ? current->DataProvider()->Clone() : NULL;
+	return NULL;
 }
 
-IPerformanceCounter *CPerformanceCounterNamespace::FindObject(IPerformanceCounter *parent, const char *name)
+// EnumChildren
+// (Re)reads the children of 'node'. Cached subtrees of the old children
+// are dropped. Counters which don't support IPagedPerformanceCounter
+// cache their children themselves. They aren't read again.
+void CCounterPathIndex::EnumChildren(CNode *node)
 {
-	for(int i=0 ; i<parent->CountChildren() ; i++) {
-		if(strcmp(parent->ChildAt(i)->InternalName(), name) == 0) {
-			return parent->ChildAt(i);
+	node->children.MakeEmpty();
+
+	IPagedPerformanceCounter *pagedCounter = 
+		dynamic_cast<IPagedPerformanceCounter *>(node->counter);
+
+	if(pagedCounter) {
+		BList counters;
+		counter_cursor cursor = { 0, 0, 0, false };
+		
+		while(!cursor.done) {
+			if(pagedCounter->GetNextChildren(&cursor, INT32_MAX, &counters) != B_OK)
+				break;
 		}
+		
+		// the nodes own the counters.
+		for(int32 i=0 ; i<counters.CountItems() ; i++)
+			node->children.AddItem(new CNode((IPerformanceCounter *)counters.ItemAt(i), true));
+	} else {
+		for(int32 i=0 ; i<node->counter->CountChildren() ; i++)
+			node->children.AddItem(new CNode(node->counter->ChildAt(i), false));
 	}
 	
-	return NULL;
+	node->children.SortItems(CompareNodes);
+	node->missingNames.MakeEmpty();
+	node->enumerated = true;
+	node->enumTime = system_time();
+}
+
+// IsMissing
+// Returns true, if 'name' wasn't found by an enumeration of 'parent',
+// which is younger than PATH_MISS_TIMEOUT.
+bool CCounterPathIndex::IsMissing(CNode *parent, const char *name, int32 length)
+{
+	if(system_time() - parent->enumTime > PATH_MISS_TIMEOUT)
+		return false;
+
+	for(int32 i=0 ; i<parent->missingNames.CountItems() ; i++) {
+		const BString *missingName = parent->missingNames.ItemAt(i);
+	
+		if(missingName->Length() == length && 
+			strncmp(missingName->String(), name, length) == 0)
+			return true;
+	}
+	
+	return false;
+}
+
+bool CCounterPathIndex::CompareNodes(CNode *a, CNode *b)
+{
+	return strcmp(a->counter->InternalName(), b->counter->InternalName()) < 0;
 }
 
 // ==== CPerformanceCounterNamespace::CPlugin ====
 
-CPerformanceCounterNamespace::CPlugin::CPlugin(const char *path)
+CPerformanceCounterNamespace::CPlugin::CPlugin(const char *_path, CPushSourceHost *_host, bool _isolated) :
+	loadLocker("PluginLoader")
+{
+	path		= _path;
+	host		= _host;
+	isolated	= _isolated;
+	hasManifest	= false;
+	loadTried	= false;
+	loadTime	= 0;
+	addonImage	= -1;
+	plugin		= NULL;
+	pagedPlugin	= NULL;
+	remotePlugin = NULL;
+
+	if(ReadManifest()) {
+		// load on first use.
+		initStatus = B_OK;
+	} else {
+		initStatus = Load();
+	}
+}
+
+CPerformanceCounterNamespace::CPlugin::~CPlugin()
+{
+	// The plugin may run threads in the add-on. Delete it
+	// before the image is unloaded.
+	delete plugin;
+
+	if(addonImage >= 0) unload_add_on(addonImage);
+}
+
+// ReadManifest
+// Reads the manifest from the resources of the add-on. The add-on
+// image isn't loaded.
+bool CPerformanceCounterNamespace::CPlugin::ReadManifest()
+{
+	BFile file(path.String(), B_READ_ONLY);
+	BResources resources;
+	
+	if(file.InitCheck() != B_OK || resources.SetTo(&file) != B_OK)
+		return false;
+
+	size_t size;
+	const void *data = resources.LoadResource(B_MESSAGE_TYPE, PLUGIN_MANIFEST_RESOURCE, &size);
+	
+	if(data == NULL || manifest.Unflatten((const char *)data) != B_OK || 
+		manifest.what != PLUGIN_MANIFEST)
+		return false;
+	
+	hasManifest = true;
+	
+	// Hide the counters of plugins, whose device isn't present.
+	const char *required;
+	
+	for(int32 i=0 ; manifest.FindString(PLUGIN_MANIFEST_REQUIRES, i, &required) == B_OK ; i++) {
+		if(!BEntry(required).Exists()) {
+			manifest.RemoveName(PLUGIN_MANIFEST_ROOT);
+			break;
+		}
+	}
+	
+	return true;
+}
+
+// Load
+// Loads the add-on image and creates the plugin object. An error
+// is only reported once. Later calls return the same error.
+// Plugins exporting ABI version 2 or newer are created by
+// CreateCounterPluginV2() and get the push source host. Version 1
+// plugins are created by CreateCounterPlugin() and only pulled.
+status_t CPerformanceCounterNamespace::CPlugin::Load()
 {
+	BAutolock autoLocker(loadLocker);
+
+	if(loadTried)
+		return initStatus;
+		
+	loadTried = true;
+
+	bigtime_t startTime = system_time();
+
+	if(isolated) {
+		initStatus = StartHost();
+		loadTime = system_time() - startTime;
+
+		return initStatus;
+	}
+
 	BString message;
 	initStatus = B_ERROR;
 
-	addonImage = load_add_on(path);
+	addonImage = load_add_on(path.String());
 	
 	if(addonImage >= B_OK) {
+		int32 *abiVersion = NULL;
 		counter_plugin_entry_point entryPoint;
-	
-		if((initStatus = get_image_symbol(addonImage, "CreateCounterPlugin", 
+		counter_plugin_entry_point_v2 entryPointV2;
+		
+		if(get_image_symbol(addonImage, "counter_plugin_abi_version",
+			B_SYMBOL_TYPE_DATA, (void **)&abiVersion) == B_OK && *abiVersion >= 2 &&
+		   (initStatus = get_image_symbol(addonImage, "CreateCounterPluginV2", 
+			B_SYMBOL_TYPE_TEXT, (void **)&entryPointV2)) == B_OK) {
+			// version 2 entry point located.
+			if((initStatus = entryPointV2(host, &plugin)) != B_OK) {
+				message << B_TRANSLATE("CreateCounterPlugin() failed ('\0')\nReason: \1");
+			
+				message << path 
+						<< strerror(initStatus);
+		
+				show_alert(message);
+			} else {
+				// successfully loaded plugin.
+				pagedPlugin = dynamic_cast<IPagedCounterPlugin *>(plugin);
+			}
+		} else if((initStatus = get_image_symbol(addonImage, "CreateCounterPlugin", 
 			B_SYMBOL_TYPE_TEXT, (void **)&entryPoint)) == B_OK) {
 			// entry point located.
 			if((initStatus = entryPoint(&plugin)) != B_OK) {
@@ -193,6 +653,7 @@ CPerformanceCounterNamespace::CPlugin::CPlugin(const char *path)
 				show_alert(message);
 			} else {
 				// successfully loaded plugin.
+				pagedPlugin = dynamic_cast<IPagedCounterPlugin *>(plugin);
 			}
 		} else {
 			message << B_TRANSLATE("Can't find CreateCounterPlugin entry point in '\0'\nReason: \1");
@@ -213,14 +674,181 @@ CPerformanceCounterNamespace::CPlugin::CPlugin(const char *path)
 		
 		show_alert_with_help(message, "error_load_failed.html");
 	}
+	
+	loadTime = system_time() - startTime;
+	
+	return initStatus;
 }
 
-CPerformanceCounterNamespace::CPlugin::~CPlugin()
+// StartHost
+// Starts the plugin host process for an isolated plugin. The
+// loadLocker must be held.
+status_t CPerformanceCounterNamespace::CPlugin::StartHost()
 {
-	if(addonImage >= 0) unload_add_on(addonImage);
+	bigtime_t deadline;
+	
+	if(manifest.FindInt64(PLUGIN_MANIFEST_DEADLINE, &deadline) != B_OK)
+		deadline = PLUGIN_HOST_DEFAULT_DEADLINE;
+		
+	CRemotePlugin *remote = new CRemotePlugin(path.String(), deadline, host);
+	
+	// Start() doesn't wait for the host. If the host fails later,
+	// the remote plugin reports it.
+	status_t status = remote->Start();
+	
+	if(status != B_OK) {
+		delete remote;
+		
+		BString message(B_TRANSLATE("Can't start the plugin host for '\0'\nReason: \1"));
+		
+		message << path
+				<< strerror(status);
+				
+		show_alert(message);
+		
+		return status;
+	}
+	
+	plugin		 = remote;
+	remotePlugin = remote;
+	
+	return B_OK;
+}
+
+// InstantiateRemoteProvider
+// Creates a data provider, which is instantiated from 'archive' by the
+// plugin host. Returns NULL, if the plugin isn't isolated or its
+// manifest doesn't list the class. The host isn't asked, if it can
+// instantiate the archive, as nothing waits for the host. Therefore
+// isolated plugins without manifest can't be unarchived.
+IDataProvider *CPerformanceCounterNamespace::CPlugin::InstantiateRemoteProvider(BMessage *archive)
+{
+	if(!isolated || !hasManifest)
+		return NULL;
+		
+	const char *className = archive->FindString("class");
+		
+	if(className == NULL || !ProvidesClass(className))
+		return NULL;
+		
+	if(Load() != B_OK)
+		return NULL;
+		
+	return remotePlugin->InstantiateProvider(archive);
+}
+
+bool CPerformanceCounterNamespace::CPlugin::ProvidesClass(const char *className)
+{
+	const char *manifestClass;
+
+	for(int32 i=0 ; manifest.FindString(PLUGIN_MANIFEST_CLASS, i, &manifestClass) == B_OK ; i++) {
+		if(strcmp(manifestClass, className) == 0)
+			return true;
+	}
+	
+	return false;
+}
+
+// ServesPath
+// Returns false, if the first component of 'path' isn't one of the
+// top level counters of the manifest. Plugins without manifest may
+// serve any path.
+bool CPerformanceCounterNamespace::CPlugin::ServesPath(const char *path)
+{
+	if(!hasManifest)
+		return true;
+
+	// Char at index 0 is always a '/'.
+	const char *component = path[0] == '/' ? path+1 : path;
+	const char *slash = strchr(component, '/');
+	int32 length = slash ? slash-component : strlen(component);
+
+	const char *root;
+	
+	for(int32 i=0 ; manifest.FindString(PLUGIN_MANIFEST_ROOT, i, &root) == B_OK ; i++) {
+		if(strncmp(root, component, length) == 0 && root[length] == '\0')
+			return true;
+	}
+	
+	return false;
+}
+
+status_t CPerformanceCounterNamespace::CPlugin::AddRootCounters(
+	IPerformanceCounterNamespace *counterNamespace, BList *children)
+{
+	const char *root;
+	
+	for(int32 i=0 ; manifest.FindString(PLUGIN_MANIFEST_ROOT, i, &root) == B_OK ; i++)
+		children->AddItem(new CPluginRootCounter(counterNamespace, root));
+		
+	return B_OK;
 }
 
 status_t CPerformanceCounterNamespace::CPlugin::EnumChildren(IPerformanceCounterNamespace *counterNamespace, const char *path, BList *children)
 {
+	if(hasManifest) {
+		if(strcmp(path, "/") == 0)
+			return AddRootCounters(counterNamespace, children);
+			
+		if(!ServesPath(path))
+			return B_OK;
+	}
+
+	// A plugin which can't be loaded has no children. The
+	// error was already reported by Load().
+	if(Load() != B_OK)
+		return B_OK;
+
 	return plugin->EnumChildren(counterNamespace, path, children);
 }
+
+status_t CPerformanceCounterNamespace::CPlugin::GetNextChildren(IPerformanceCounterNamespace *counterNamespace, 
+	const char *path, int32 *cookie, bool *done, int32 maxCount, BList *children)
+{
+	if(hasManifest) {
+		if(strcmp(path, "/") == 0) {
+			*done = true;
+			return AddRootCounters(counterNamespace, children);
+		}
+
+		if(!ServesPath(path)) {
+			*done = true;
+			return B_OK;
+		}
+	}
+
+	if(Load() != B_OK) {
+		*done = true;
+		return B_OK;
+	}
+
+	if(pagedPlugin)
+		return pagedPlugin->GetNextChildren(counterNamespace, path, cookie, done, maxCount, children);
+		
+	// Plugin doesn't support paging. Return all children as one page.
+	*done = true;
+	
+	return plugin->EnumChildren(counterNamespace, path, children);
+}
+
+int32 CPerformanceCounterNamespace::CPlugin::CountChildrenHint(const char *path)
+{
+	if(hasManifest) {
+		if(strcmp(path, "/") == 0) {
+			type_code type;
+			int32 count = 0;
+			
+			manifest.GetInfo(PLUGIN_MANIFEST_ROOT, &type, &count);
+			
+			return count;
+		}
+			
+		if(!ServesPath(path))
+			return 0;
+	}
+
+	if(Load() != B_OK)
+		return 0;
+
+	return pagedPlugin ? pagedPlugin->CountChildrenHint(path) : -1;
+}
@@ -20,12 +20,16 @@
 
 #include "PointerList.h"
 #include "PerformanceCounter.h"
+#include "PushSourceHost.h"
+#include "RemotePlugin.h"
 
 extern CPointer<IPerformanceCounterNamespace> global_Namespace;
 
 void InitGlobalNamespace();
+IDataProvider *InstantiateDataProvider(BMessage *archive);
+bool CounterPathExists(const char *path);
 
-class CRootNode : public IPerformanceCounter 
+class CRootNode : public IPerformanceCounter, public IPagedPerformanceCounter
 {
 	public:
 	CRootNode(IPerformanceCounterNamespace *ns);
@@ -37,6 +41,9 @@ class CRootNode : public IPerformanceCounter
 	virtual const char *Path() const { return "/"; }
 	virtual const char *InternalName() const { return "Root"; }
 
+	virtual status_t GetNextChildren(counter_cursor *cursor, int32 maxCount, BList *children);
+	virtual int32 CountChildrenHint();
+
 	protected:
 	virtual void InitChildren();
 	
@@ -45,6 +52,75 @@ class CRootNode : public IPerformanceCounter
 	IPerformanceCounterNamespace *namesp;
 };
 
+//: Top level counter of a plugin with manifest.
+// Created from the manifest without loading the plugin. The children
+// are enumerated by path, which loads the plugin.
+class CPluginRootCounter : public CRootNode
+{
+	public:
+	CPluginRootCounter(IPerformanceCounterNamespace *ns, const char *name);
+
+	virtual const char *Name() const { return name.String(); }
+	virtual const char *Path() const { return path.String(); }
+	virtual const char *InternalName() const { return name.String(); }
+	
+	protected:
+	BString name;
+	BString path;
+};
+
+//: Cached trie of the counter paths.
+// Maps a path to its performance counter without asking the plugins
+// for the children of each level again. A node enumerates the children
+// of its counter once and keeps them sorted by internal name, so a
+// lookup is a binary search per path component. The children are
+// created by IPagedPerformanceCounter::GetNextChildren(), so the index
+// owns them and can drop them by Invalidate(). If a component isn't found,
+// the children of its parent are enumerated once more, as they may have
+// changed (a new team or volume). If it's still missing, the miss is
+// cached for PATH_MISS_TIMEOUT, so looking up a dead team doesn't
+// enumerate all teams each time. The index isn't locked.
+class CCounterPathIndex
+{
+	public:
+	CCounterPathIndex(IPerformanceCounterNamespace *ns);
+	~CCounterPathIndex();
+
+	// Returns the counter for 'path' or NULL. The counter is owned by the
+	// index and is valid until the next call of Find() or Invalidate().
+	IPerformanceCounter *Find(const char *path);
+	// Drops the cached children of 'path' and all their descendants.
+	void Invalidate(const char *path);
+
+	protected:
+	class CNode
+	{
+		public:
+		CNode(IPerformanceCounter *_counter, bool _owned) 
+			{ counter = _counter; owned = _owned; enumerated = false; enumTime = 0; }
+		~CNode() { if(owned) delete counter; }
+
+		IPerformanceCounter		*counter;
+		bool					 owned;			// false for children of non paged counters
+		CPointerList<CNode>		 children;		// sorted by internal name
+		bool					 enumerated;
+		bigtime_t				 enumTime;		// system_time() of the last enumeration
+		CPointerList<BString>	 missingNames;	// not found by the last enumeration
+	};
+
+	void EnumChildren(CNode *node);
+	CNode *FindChild(CNode *parent, const char *name, int32 length);
+	CNode *FindNode(const char *path, bool enumerate);
+	bool IsMissing(CNode *parent, const char *name, int32 length);
+
+	static const bigtime_t PATH_MISS_TIMEOUT = 5000000;
+
+	static bool CompareNodes(CNode *a, CNode *b);
+
+	IPerformanceCounterNamespace	*namesp;
+	CNode							 root;
+};
+
 class CPerformanceCounterNamespace : public IPerformanceCounterNamespace
 {
 	public:
@@ -54,26 +130,88 @@ class CPerformanceCounterNamespace : public IPerformanceCounterNamespace
 	virtual status_t EnumChildren(const char *path, BList *children);
 	virtual IDataProvider *DataProvider(const char *path);
 	virtual IPerformanceCounter *Root() { return new CRootNode(this); }
+
+	virtual status_t GetNextChildren(const char *path, counter_cursor *cursor,
+							int32 maxCount, BList *children);
+	virtual int32 CountChildrenHint(const char *path);
 	
-	protected:
-	IPerformanceCounter *FindObject(IPerformanceCounter *parent, const char *name);
+	// Returns true, if there is a counter for 'path'. The lookup uses
+	// the path index, no counters are created for the caller.
+	bool CounterExists(const char *path);
+	
+	// Loads the plugin, whose manifest lists the archivable class 'className'.
+	void LoadPluginForClass(const char *className);
+	
+	// Instantiates an archived data provider. The plugin of the class is
+	// loaded, if needed. Classes of isolated plugins are instantiated
+	// by their plugin host.
+	IDataProvider *InstantiateDataProvider(BMessage *archive);
+	
+	// Prints the time spent in the constructor and the load time of
+	// each plugin to stdout.
+	void PrintStartupTiming();
 	
+	protected:
+	void InvalidateVolatilePaths();
+	bool AddPlugins(const BPath &dirPath, bool isolated, const char *defaultPluginName);
+
+	//: A plugin add-on.
+	// If the add-on has a manifest, the constructor only reads the
+	// manifest. The add-on is loaded, when it's used for the first time.
+	// Isolated add-ons are loaded by a plugin host process (see
+	// CRemotePlugin) instead.
 	class CPlugin
 	{
 		public:
-		CPlugin(const char *path);
+		CPlugin(const char *path, CPushSourceHost *host, bool isolated);
 		virtual ~CPlugin();
 
 		status_t InitCheck() { return initStatus; }
 		status_t EnumChildren(IPerformanceCounterNamespace *counterNamespace, const char *path, BList *children);
+		status_t GetNextChildren(IPerformanceCounterNamespace *counterNamespace, const char *path, 
+					int32 *cookie, bool *done, int32 maxCount, BList *children);
+		int32 CountChildrenHint(const char *path);
 
+		status_t Load();
+		bool IsLoaded() { return plugin != NULL; }
+		bigtime_t LoadTime() { return loadTime; }
+		const char *Path() { return path.String(); }
+
+		bool ProvidesClass(const char *className);
+		IDataProvider *InstantiateRemoteProvider(BMessage *archive);
+		
 		protected:
+		bool ReadManifest();
+		status_t StartHost();
+		bool ServesPath(const char *path);
+		status_t AddRootCounters(IPerformanceCounterNamespace *counterNamespace, BList *children);
+		
+		BString path;
+		CPushSourceHost *host;
+		bool isolated;
+		BMessage manifest;
+		bool hasManifest;
+		BLocker loadLocker;
+		bool loadTried;
+		bigtime_t loadTime;						// time spent in Load()
 		status_t initStatus;
 		image_id addonImage;
 		IPerformanceCounterPlugin *plugin;
+		IPagedCounterPlugin *pagedPlugin;		// NULL if not supported by the plugin
+		CRemotePlugin *remotePlugin;			// NULL if not isolated
 	};
 	
+	// The plugins unregister their push sources, when they are
+	// deleted or unloaded. Therefore the host must be destructed
+	// after them.
+	CPushSourceHost pushSourceHost;
 	CPointerList<CPlugin> pluginList;
+	bigtime_t initTime;						// time spent in the constructor
+	
+	BLocker				pathIndexLocker;
+	CCounterPathIndex	pathIndex;
+	bigtime_t			lastTeamSetTime;	// time stamp of the snapshot, which was compared last
+	uint32				lastTeamSetHash;	// hash of the team ids at the last lookup
 };
 
 #endif // COUNTER_NAMESPACE_IMPL_H
@@ -20,11 +20,14 @@
 #include "my_assert.h"
 #include "common.h"
 #include "SystemInfo.h"
+#include "SystemSnapshot.h"
+#include "TopKTracker.h"
 #include "CounterNamespaceImpl.h"
 #include "ProcessView.h"
 #include "Color.h"
 #include "AsynchronousPopupMenu.h"
 #include "DataProvider.h"
+#include "ReplayDataProvider.h"
 #include "TaskManager.h"
 #include "MainWindow.h"
 #include "Detector.h"
@@ -39,6 +42,9 @@
 
 // ==== globals ====
 
+// Interval in which the replicant asks the application for its replay session.
+const bigtime_t DESKBAR_REPLAY_REFRESH = 5000000;		// 5 s
+
 BView *create_deskbar_replicant()
 {
 	return new CDeskbarLedView(DESKBAR_REPLICANT_ID);
@@ -77,22 +83,54 @@ CDataProviderInfo::~CDataProviderInfo()
 
 void CDataProviderInfo::UpdateValue()
 {
-	value = 0.0;
+	data_sample sample = { 0.0, 0 };
 
-	if(dataProvider && dataProvider->GetNextValue(value)) {
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_RELATIVE)
-			value /= view->ReplicantPulseRate();
-			
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT) {
-			value *= 100.0;
+	bool valid = dataProvider && get_next_sample(dataProvider, sample);
+
+	UpdateValue(sample, valid);
+}
+
+// UpdateValue
+// Sets the current value from a raw sample of the data provider,
+// which was taken by the caller.
+void CDataProviderInfo::UpdateValue(const data_sample &sample, bool valid)
+{
+	double newValue = 0.0;
+
+	if(normalizer.Normalize(dataProvider, sample, valid, view->ReplicantPulseRate(), newValue)) {
+		if(dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT)
+			newValue = MAX(MIN(newValue, 100.0), 0.0);
 			
-			value = MAX(MIN(value, 100.0), 0.0);
-		}
+		exportedCounter.Publish(sample, newValue, true);
+	} else {
+		newValue = 0.0;
+		
+		exportedCounter.Publish(sample, newValue, false);
 	}
+
+	value = newValue;
 }
 
 // ==== CDeskbarLedView ====
 
+// export_counters
+// The replicant runs in the Deskbar, where there is no counter export
+// of the application. It publishes its counters in an area of its own.
+static void export_counters()
+{
+	if(CCounterExport::Instance() != NULL || be_app == NULL)
+		return;
+		
+	BMessenger appMessenger(APP_SIGNATURE);
+	
+	// The view is also created by the application itself (see
+	// CMainWindow::ShowDeskbarReplicant()).
+	if(appMessenger.IsValid() && appMessenger.Team() == be_app_messenger.Team())
+		return;
+
+	CCounterExport::CreateInstance(COUNTER_EXPORT_DESKBAR_AREA_NAME);
+}
+
 CDeskbarLedView::CDeskbarLedView(const char *name) :
 	CPulseView(BRect(0,0,12,15), name, B_FOLLOW_NONE, B_WILL_DRAW)
 {
@@ -112,6 +150,10 @@ CDeskbarLedView::CDeskbarLedView(BMessage *archive) :
 
 CDeskbarLedView::~CDeskbarLedView()
 {
+	// The providers keep the recording of the session.
+	if(replaySessionOwner)
+		CReplaySession::DeleteInstance();
+
 	if(tooltip) {
 		tooltip->Lock();
 		tooltip->Quit();
@@ -119,6 +161,7 @@ CDeskbarLedView::~CDeskbarLedView()
 	 
 	delete detector;
 	delete tooltipDataProvider;
+	delete topTeams;
 	
 	detector = NULL;
 	tooltipDataProvider = NULL;
@@ -131,13 +174,35 @@ void CDeskbarLedView::Init()
 		InitGlobalNamespace();
 	}
 
+	export_counters();
+
 	ledOnColor		= DEFAULT_LED_ON_COLOR;
 	ledOffColor		= DEFAULT_LED_OFF_COLOR;
 
 	detector		= NULL;
 	tooltip			= NULL;
 
+	topTeams			= new CTopKTracker(TOOLTIP_TEAM_COUNT);
+	topTeamsGeneration	= 0;
+	topTeamsTime		= 0;
+	topTeamsActiveTime	= 0;
+
 	pulseRate		= NORMAL_PULSE_RATE;
+
+	replaySessionOwner	= false;
+	replayRequestTime	= 0;
+	tooltipDataProvider	= NULL;
+	
+	CreateDataProviders();
+}
+
+// CreateDataProviders
+// (Re-)creates the data providers of the LEDs and the tooltip. If a
+// replay session is active, they replay the recording.
+void CDeskbarLedView::CreateDataProviders()
+{
+	dataProviderList.MakeEmpty();
+	delete tooltipDataProvider;
 	
 	char path[255];
 
@@ -150,17 +215,22 @@ void CDeskbarLedView::Init()
 	for(int32 cpuNum=0 ; cpuNum<sysInfo.cpu_count ; cpuNum++) {
 		sprintf(path, "/Total/CPU Usage/CPU %ld", cpuNum+1);
 
-		dataProvider = global_Namespace->DataProvider(path);
+		dataProvider = replay_data_provider(global_Namespace->DataProvider(path), path);
 		
 		if(dataProvider != NULL) {
-			dataProviderList.AddItem(
-				new CDataProviderInfo(this, dataProvider, 100.0, ledOnColor));
+			CDataProviderInfo *info = new CDataProviderInfo(this, dataProvider, 100.0, ledOnColor);
+			
+			info->SetCounterPath(path);
+			
+			dataProviderList.AddItem(info);
 		}
 	}
 
-	dataProvider = global_Namespace->DataProvider("/Total/CPU Usage/Average");
+	dataProvider = replay_data_provider(
+		global_Namespace->DataProvider("/Total/CPU Usage/Average"), "/Total/CPU Usage/Average");
 	
 	tooltipDataProvider = new CDataProviderInfo(this, dataProvider, 100.0);
+	tooltipDataProvider->SetCounterPath("/Total/CPU Usage/Average");
 	
 	float width  = MAX(12, (5*dataProviderList.CountItems())+2);
 	float height = 15;
@@ -168,6 +238,54 @@ void CDeskbarLedView::Init()
 	ResizeTo(width, height);
 }
 
+// RequestReplaySession
+// The replicant runs in the Deskbar. If the application replays a
+// recording, the replicant replays it, too. The session is requested
+// asynchronously, so the Deskbar never waits for the application. The
+// reply (MSG_REPLAY_SESSION) is handled by MessageReceived().
+void CDeskbarLedView::RequestReplaySession()
+{
+	replayRequestTime = system_time();
+
+	BMessenger appMessenger(APP_SIGNATURE);
+	
+	// The view is also created by the application itself (see
+	// CMainWindow::ShowDeskbarReplicant()).
+	if(!appMessenger.IsValid() || appMessenger.Team() == be_app_messenger.Team())
+		return;
+
+	BMessage request(MSG_GET_REPLAY_SESSION);
+	
+	appMessenger.SendMessage(&request, this);
+}
+
+// SetReplaySession
+// Sets the replay session of the replicant from the reply to
+// MSG_GET_REPLAY_SESSION. The reply is empty, if the application
+// doesn't replay. The data providers are only re-created, if the
+// session changed.
+void CDeskbarLedView::SetReplaySession(BMessage *reply)
+{
+	CReplaySession *session = CReplaySession::Instance();
+	
+	bool replaying = session != NULL;
+
+	if(reply->HasString(REPLAY_ARCHIVE_PATH)) {
+		if(session && session->IsArchivedIn(reply))
+			return;
+	
+		if(CReplaySession::CreateInstance()->SetTo(reply) != B_OK)
+			CReplaySession::DeleteInstance();
+	} else {
+		CReplaySession::DeleteInstance();
+	}
+	
+	replaySessionOwner = CReplaySession::Instance() != NULL;
+	
+	if(replaying || replaySessionOwner)
+		CreateDataProviders();
+}
+
 BArchivable *CDeskbarLedView::Instantiate(BMessage *archive)
 {
 	if (!validate_instantiation(archive, "CDeskbarLedView"))
@@ -288,6 +406,9 @@ void CDeskbarLedView::MessageReceived(BMessage *message)
 				contextMenu->Go(point, true, clickToOpen, true);
 			}
 			break;
+		case MSG_REPLAY_SESSION:
+			SetReplaySession(message);
+			break;
 		case MSG_MENU_BEGINNING:
 			menuVisible = true;
 			break;
@@ -313,6 +434,8 @@ void CDeskbarLedView::AttachedToWindow()
 	tooltip->Show();
 	tooltip->Hide();
 	
+	RequestReplaySession();
+	
 	SetViewColor(CColor::Transparent);
 }
 
@@ -333,6 +456,25 @@ void CDeskbarLedView::UpdateTooltip(bool forceShow, BPoint point)
 		
 			sprintf(buffer, B_TRANSLATE("CPU Usage: %.0f %%"), usage);
 
+			BString text(buffer);
+			int32 displayed = 0;
+
+			for(int32 i=0 ; i<topTeams->CountTop() && topTeamsActiveTime>0 ; i++) {
+				if(topTeams->TopValueAt(i) <= 0)
+					break;
+
+				if(topTeamNames[i].Length() == 0)
+					continue;
+
+				text << (displayed == 0 ? " (" : ", ") << topTeamNames[i] << " "
+					 << (int32)(topTeams->TopValueAt(i) * 100 / topTeamsActiveTime) << " %";
+
+				displayed++;
+			}
+
+			if(displayed > 0)
+				text << ")";
+
 			BRect  screenRect  = ConvertToScreen(Bounds());
 			BPoint screenPoint = ConvertToScreen(BPoint(Bounds().Width()/2, Bounds().Height()/2));
 
@@ -361,22 +503,97 @@ void CDeskbarLedView::UpdateTooltip(bool forceShow, BPoint point)
 					break;
 			}
 	
-			tooltip->ShowTooltip(buffer, screenRect, screenPoint, corner);
+			tooltip->ShowTooltip(text.String(), screenRect, screenPoint, corner);
 		}
 	}
 }
 
+// UpdateTopTeams
+// Feeds the CPU times of all teams to the top teams tracker. Only
+// teams whose CPU time changed are reordered. The deltas are only
+// meaningful for consecutive samples, so the tracker is emptied
+// while the tooltip is hidden.
+void CDeskbarLedView::UpdateTopTeams()
+{
+	if(tooltip == NULL || !tooltip->Visible()) {
+		if(topTeamsTime != 0) {
+			topTeams->MakeEmpty();
+			topTeamsTime = topTeamsActiveTime = 0;
+		}
+
+		return;
+	}
+
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(SNAPSHOT_THREADS);
+
+	if(snapshot == NULL)
+		return;
+
+	topTeamsGeneration++;
+
+	for(int32 i=0 ; i<snapshot->CountTeams() ; i++) {
+		team_id id = snapshot->TeamId(i);
+
+		// The kernel team contains the idle threads.
+		if(id == B_SYSTEM_TEAM)
+			continue;
+
+		topTeams->SetDelta(id, snapshot->TeamUserTime(i)+snapshot->TeamKernelTime(i), 
+			topTeamsGeneration);
+	}
+
+	topTeams->RemoveStale(topTeamsGeneration);
+
+	// The names are taken while the snapshot is at hand, so the
+	// tooltip doesn't ask the kernel.
+	for(int32 i=0 ; i<topTeams->CountTop() ; i++) {
+		int32 index = snapshot->FindTeam(topTeams->TopIdAt(i));
+
+		topTeamNames[i] = (index >= 0) ? snapshot->TeamName(index) : "";
+	}
+
+	topTeamsActiveTime = (topTeamsTime != 0) ? 
+		(snapshot->TimeStamp()-topTeamsTime) * snapshot->SystemInfo().cpu_count : 0;
+	topTeamsTime = snapshot->TimeStamp();
+
+	release_system_snapshot(snapshot);
+}
+
 void CDeskbarLedView::Pulse()
 {
+	if(system_time() - replayRequestTime > DESKBAR_REPLAY_REFRESH)
+		RequestReplaySession();
+
+	UpdateTopTeams();
 	UpdateTooltip(false);
 
+	// The CPU providers and the tooltip provider are sampled
+	// at once.
+	samplingContext.MakeEmpty();
+
+	for(int i=0 ; i<dataProviderList.CountItems() ; i++)
+		samplingContext.AddProvider(dataProviderList.ItemAt(i)->DataProvider());
+
+	int32 tooltipIndex = -1;
+
+	if(tooltipDataProvider->DataProvider())
+		tooltipIndex = samplingContext.AddProvider(tooltipDataProvider->DataProvider());
+	
+	samplingContext.Sample();
+
 	for(int i=0 ; i<dataProviderList.CountItems() ; i++) {
 		CDataProviderInfo *dataProviderInfo = dataProviderList.ItemAt(i);
 		
-		dataProviderInfo->UpdateValue();
+		data_sample sample;
+		bool valid = samplingContext.GetSample(i, sample);
+		
+		dataProviderInfo->UpdateValue(sample, valid);
 	}
 	
-	tooltipDataProvider->UpdateValue();
+	data_sample sample = { 0.0, 0 };
+	bool valid = (tooltipIndex >= 0) && samplingContext.GetSample(tooltipIndex, sample);
+	
+	tooltipDataProvider->UpdateValue(sample, valid);
 
 	Invalidate();
 }
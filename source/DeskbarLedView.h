@@ -19,8 +19,11 @@
 #define DESKBAR_LED_VIEW_H
 
 #include "PulseView.h"
+#include "SamplingContext.h"
+#include "CounterExport.h"
 
 class CTooltip;
+class CTopKTracker;
 class CContextMenuDetector;
 class IDataProvider;
 class CAsynchronousPopUpMenu;
@@ -42,15 +45,22 @@ class _EXPORT CDataProviderInfo
 	void		SetMaxValue(float m) { maxValue = m; }
 	float 		CurrentValue()	{ return value; }
 	void 		UpdateValue();
+	void		UpdateValue(const data_sample &sample, bool valid);
 	void		UpdateValue(bigtime_t relativeTime);
 	rgb_color	Color()			{ return color; }
 	void		SetColor(rgb_color c) { color = c; }
+	IDataProvider *DataProvider() { return dataProvider; }
+	
+	// The values are exported by this path (see CCounterExport).
+	void		SetCounterPath(const char *path) { exportedCounter.SetPath(path); }
 	
 	protected:
 	CPulseView *view;
 	rgb_color color;
 	float maxValue, value;
 	IDataProvider *dataProvider;
+	CSampleNormalizer normalizer;
+	CExportedCounter exportedCounter;
 };
 
 class _EXPORT CDeskbarLedView : public CPulseView
@@ -73,12 +83,17 @@ class _EXPORT CDeskbarLedView : public CPulseView
 	void Init();
 	
 	void UpdateTooltip(bool forceShow, BPoint point=BPoint(-1,-1));
+	void UpdateTopTeams();
 	
 	virtual void Pulse();
 	
 	virtual CAsynchronousPopUpMenu *ContextMenu();
 	
 	protected:
+	void CreateDataProviders();
+	void RequestReplaySession();
+	void SetReplaySession(BMessage *reply);
+	
 	CTooltip *tooltip;
 	
 	// Set to true when the tooltip shouln't 
@@ -94,6 +109,20 @@ class _EXPORT CDeskbarLedView : public CPulseView
 	
 	CPointerList<CDataProviderInfo> dataProviderList;
 	CDataProviderInfo *tooltipDataProvider;
+	CSamplingContext samplingContext;		// Used by Pulse().
+
+	// Teams using the most CPU time. Only tracked while the
+	// tooltip is visible.
+	static const int32 TOOLTIP_TEAM_COUNT = 3;
+
+	CTopKTracker *topTeams;
+	BString topTeamNames[TOOLTIP_TEAM_COUNT];	// same order as 'topTeams'
+	uint32 topTeamsGeneration;
+	bigtime_t topTeamsTime;				// time stamp of last sample
+	bigtime_t topTeamsActiveTime;		// CPU time available since the sample before
+
+	bool replaySessionOwner;			// the replay session was set by this replicant
+	bigtime_t replayRequestTime;		// time of the last MSG_GET_REPLAY_SESSION
 };
 
 #endif // DESKBAR_LED_VIEW_H
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "ExecutableInfoCache.h"
+
+// ====== CExecutableInfoCache::CEntry ======
+
+CExecutableInfoCache::CEntry::CEntry(dev_t _device, ino_t _node, const char *_name,
+	bool _systemTeam, BBitmap *_miniIcon)
+{
+	device		= _device;
+	node		= _node;
+	name		= _name;
+	systemTeam	= _systemTeam;
+	miniIcon	= _miniIcon;
+}
+
+CExecutableInfoCache::CEntry::~CEntry()
+{
+	delete miniIcon;
+}
+
+// ====== CExecutableInfoCache ======
+
+const int32 CExecutableInfoCache::MAX_ENTRIES = 128;
+
+CExecutableInfoCache::CExecutableInfoCache() :
+	locker("ExecutableInfoCache")
+{
+	hits = misses = 0;
+
+	find_directory(B_BEOS_SYSTEM_DIRECTORY, &systemDirPath);
+}
+
+CExecutableInfoCache::~CExecutableInfoCache()
+{
+	entryList.MakeEmpty();
+
+	RemoveFromList(ClassName());
+}
+
+status_t CExecutableInfoCache::Lookup(dev_t device, ino_t node, const char *path,
+	BString *name, bool *systemTeam, BBitmap **miniIcon)
+{
+	if(path == NULL)
+		return B_BAD_VALUE;
+
+	BAutolock autoLocker(locker);
+
+	CEntry *entry = NULL;
+
+	for(int32 i=0 ; i<entryList.CountItems() ; i++) {
+		if(entryList.ItemAt(i)->Matches(device, node)) {
+			entry = entryList.RemoveItem(i);
+			break;
+		}
+	}
+
+	if(entry != NULL) {
+		hits++;
+	} else {
+		misses++;
+
+		entry = CreateEntry(device, node, path);
+
+		if(entryList.CountItems() >= MAX_ENTRIES) {
+			// drop least recently used entry
+			delete entryList.RemoveItem(entryList.CountItems()-1);
+		}
+	}
+
+	// move to front
+	entryList.AddItem(entry, 0);
+
+	if(name)
+		*name = entry->name;
+
+	if(systemTeam)
+		*systemTeam = entry->systemTeam;
+
+	if(miniIcon)
+		*miniIcon = entry->miniIcon ? new BBitmap(entry->miniIcon) : NULL;
+
+	return B_OK;
+}
+
+status_t CExecutableInfoCache::Lookup(const char *path, BString *name,
+	bool *systemTeam, BBitmap **miniIcon)
+{
+	if(path == NULL)
+		return B_BAD_VALUE;
+
+	struct stat st;
+
+	if(lstat(path, &st) != 0)
+		return errno;
+
+	return Lookup(st.st_dev, st.st_ino, path, name, systemTeam, miniIcon);
+}
+
+// CreateEntry
+// Collects all the information about the executable 'path'. That's
+// the expensive part, which the cache avoids.
+CExecutableInfoCache::CEntry *CExecutableInfoCache::CreateEntry(dev_t device, ino_t node,
+	const char *path)
+{
+	BEntry appEntry(path);
+
+	// All teams which have their image in the system directory
+	// (or one of its subdirs) are system teams.
+	BDirectory systemDir(systemDirPath.Path());
+
+	bool systemTeam = systemDir.Contains(&appEntry);
+
+	entry_ref appRef;
+	BBitmap *icon = NULL;
+
+	if(appEntry.GetRef(&appRef) == B_OK) {
+		icon = new BBitmap(BRect(0,0,15,15), B_RGBA32);
+
+		// This code also returns an icon for applications not on BeFS devices
+		// and/or without an icon in their resources.
+		if(BNodeInfo::GetTrackerIcon(&appRef, icon, B_MINI_ICON) != B_OK) {
+			delete icon;
+			icon = NULL;
+		}
+	}
+
+	const char *leaf = strrchr(path, '/');
+
+	return new CEntry(device, node, leaf != NULL ? leaf+1 : path, systemTeam, icon);
+}
+
+CExecutableInfoCache *CExecutableInfoCache::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CExecutableInfoCache *cache = NULL;
+
+	return CreateSingleton(cache, "CExecutableInfoCache");
+}
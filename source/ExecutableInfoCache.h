@@ -0,0 +1,86 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXECUTABLE_INFO_CACHE_H
+#define EXECUTABLE_INFO_CACHE_H
+
+#include "Singleton.h"
+
+//: Bounded LRU cache of per executable metadata.
+// Starting the same executable again and again (a build spawns
+// thousands of 'gcc' and 'sh' teams) resolves the same system team
+// flag and the same tracker icon every time. This cache stores these
+// values keyed by the device and inode of the executable, which the
+// image info of a team already contains, so a hit touches neither
+// the file system nor the team's images.
+class CExecutableInfoCache : public CSingleton
+{
+	public:
+	static CExecutableInfoCache *CreateInstance();
+
+	virtual ~CExecutableInfoCache();
+	virtual void Reactivate() {}
+
+	// Looks up the executable with 'device' and 'node'. 'path' is
+	// only read on a miss. All output parameters may be NULL. If
+	// 'miniIcon' is not NULL it receives a copy of the icon, which
+	// is owned by the caller (NULL, if the file has no icon).
+	status_t Lookup(dev_t device, ino_t node, const char *path,
+		BString *name, bool *systemTeam, BBitmap **miniIcon);
+
+	// Same as above for an executable only known by its path.
+	status_t Lookup(const char *path, BString *name, bool *systemTeam,
+		BBitmap **miniIcon);
+
+	int32 Hits() const		{ return hits; }
+	int32 Misses() const	{ return misses; }
+
+	protected:
+	CExecutableInfoCache();
+
+	class CEntry
+	{
+		public:
+		CEntry(dev_t device, ino_t node, const char *name, bool systemTeam, BBitmap *miniIcon);
+		~CEntry();
+
+		bool Matches(dev_t _device, ino_t _node) const
+		{
+			return device == _device && node == _node;
+		}
+
+		dev_t		 device;
+		ino_t		 node;
+		BString		 name;				// leaf of the path
+		bool		 systemTeam;
+		BBitmap		*miniIcon;
+	};
+
+	CEntry *CreateEntry(dev_t device, ino_t node, const char *path);
+
+	static const int32 MAX_ENTRIES;
+
+	BLocker				locker;
+	CPointerList<CEntry> entryList;		// most recently used first
+	BPath				systemDirPath;
+	int32				hits;
+	int32				misses;
+
+	friend class CSingleton;
+};
+
+#endif // EXECUTABLE_INFO_CACHE_H
@@ -24,6 +24,11 @@
 #include "GraphView.h"
 #include "Detector.h"
 #include "DataProvider.h"
+#include "CounterNamespaceImpl.h"
+#include "CounterExport.h"
+#include "TimeSeriesStore.h"
+#include "SessionRecorder.h"
+#include "ReplayDataProvider.h"
 
 #include "msg_helper.h"
 
@@ -39,6 +44,7 @@ const char * const DATA_INFO_ARCHIVE_VALUE_COUNT			= "DATAINFO:ValueCount";
 const char * const DATA_INFO_ARCHIVE_LINE_COLOR				= "DATAINFO:LineColor";
 const char * const DATA_INFO_ARCHIVE_SCALE					= "DATAINFO:Scale";
 const char * const DATA_INFO_ARCHIVE_DATA_PROVIDER			= "DATAINFO:DataProvider";
+const char * const DATA_INFO_ARCHIVE_COUNTER_PATH			= "DATAINFO:CounterPath";
 
 // archive fields of CGraphView
 const char * const GRAPH_VIEW_ARCHIVE_VALUE_COUNT			= "GRAPHVIEW:ValueCount";
@@ -48,6 +54,8 @@ const char * const GRAPH_VIEW_ARCHIVE_GRID_COLOR			= "GRAPHVIEW:GridColor";
 const char * const GRAPH_VIEW_ARCHIVE_GRID_SPACE			= "GRAPHVIEW:GridSpace";
 const char * const GRAPH_VIEW_ARCHVIE_DATA_INFO_LIST		= "GRAPHVIEW:DataInfoList";
 const char * const GRAPH_VIEW_ARCHIVE_AUTO_SCALE			= "GRAPHVIEW:AutoScale";
+const char * const GRAPH_VIEW_ARCHIVE_WINDOWED_EXTENTS		= "GRAPHVIEW:WindowedExtents";
+const char * const GRAPH_VIEW_ARCHIVE_TIME_SPAN				= "GRAPHVIEW:TimeSpan";
 
 // archive fields of COverlayGraphView
 const char * const OVERLAY_VIEW_ARCHIVE_OVERLAY_INDEX		= "OVERLAY:OverlayIndex";
@@ -60,12 +68,16 @@ const char * const GRAPH_VIEW_PROP_POINT_DISTANCE			= "PointDistance";
 const char * const GRAPH_VIEW_PROP_GRID_SPACE				= "GridSpace";
 const char * const GRAPH_VIEW_PROP_GRID_COLOR				= "GridColor";
 const char * const GRAPH_VIEW_PROP_MAX_VALUE				= "MaxValue";
+const char * const GRAPH_VIEW_PROP_WINDOWED_EXTENTS			= "WindowedExtents";
+const char * const GRAPH_VIEW_PROP_TIME_SPAN				= "TimeSpan";
 
 // scripting properties of CDataInfo
 const char * const DATA_INFO_PROP_COLOR						= "Color";
 const char * const DATA_INFO_PROP_SCALE						= "Scale";
 const char * const DATA_INFO_PROP_MAX						= "Max";
 const char * const DATA_INFO_PROP_AVG						= "Avg";
+const char * const DATA_INFO_PROP_WINDOW_MIN				= "WindowMin";
+const char * const DATA_INFO_PROP_WINDOW_MAX				= "WindowMax";
 const char * const DATA_INFO_PROP_CURRENT					= "Current";
 const char * const DATA_INFO_PROP_DATA_PROVIDER				= "DataProvider";
 
@@ -77,6 +89,7 @@ const char * const OVERLAY_VIEW_PROP_BG_COLOR				= "BackgroundColor";
 
 // message fields of MSG_ADD_DATA_PROVIDER
 const char * const MESSAGE_DATA_ID_DATA_PROVIDER			= "ADDDP:DataProvider";
+const char * const MESSAGE_DATA_ID_COUNTER_PATH				= "ADDDP:CounterPath";
 
 // message field for various DATA_PROVIDER related messages
 const char * const MESSAGE_DATA_ID_SCALE	                = "COMMON:Scale";
@@ -85,6 +98,57 @@ const char * const MESSAGE_DATA_ID_SCALE	                = "COMMON:Scale";
 const rgb_color DEFAULT_GRAPH_VIEW_BG						= { 0, 0, 0, 255 };
 const rgb_color	DEFAULT_GRID_COLOR			                = { 0, 128, 0, 255 };
 
+// Time span read from the time series store by CDataInfo::Backfill().
+const bigtime_t DATA_INFO_BACKFILL_SPAN						= 24*3600*1000000LL;
+
+// ====== CBackfillSink ======
+
+//: Receives the samples read by CDataInfo::Backfill().
+// All samples are added to the consolidated history, the last 'count'
+// samples are kept for the sample buffer.
+class CBackfillSink : public ITimeSeriesSink
+{
+	public:
+	CBackfillSink(CConsolidatedHistory *_history, int32 _count)
+	{
+		history	= _history;
+		count	= _count;
+		added	= 0;
+		times	= new bigtime_t[count];
+		values	= new float[count];
+	}
+	
+	virtual ~CBackfillSink()
+	{
+		delete [] times;
+		delete [] values;
+	}
+	
+	virtual void AddSample(bigtime_t time, float value)
+	{
+		history->Add(time, value);
+		
+		times[added % count]  = time;
+		values[added % count] = value;
+		
+		added++;
+	}
+	
+	// Number of kept samples.
+	int32 CountSamples() const { return MIN(added, count); }
+
+	// 'index' 0 is the oldest kept sample.
+	bigtime_t TimeAt(int32 index) const	{ return times[(added - CountSamples() + index) % count]; }
+	float ValueAt(int32 index) const	{ return values[(added - CountSamples() + index) % count]; }
+	
+	protected:
+	CConsolidatedHistory	*history;
+	int32					 count;
+	int32					 added;
+	bigtime_t				*times;
+	float					*values;
+};
+
 
 // ====== CGraphViewUI =====
 
@@ -99,7 +163,8 @@ void CGraphViewUI::Draw(BView *view, const BRect &updateRect)
 {
 	BRect clientRect = view->Bounds();
 
-	int32 valueCount = graphView->ValueCount();
+	int32 valueCount = graphView->CountPoints();
+	int32 resolution = graphView->Resolution();
 	int32 distance   = graphView->PointDistance();
 	int32 maxValue	 = graphView->MaxValue();
 	int32 gridSpace	 = graphView->GridSpace();
@@ -133,12 +198,33 @@ void CGraphViewUI::Draw(BView *view, const BRect &updateRect)
 		
 		for(int k=0 ; k<graphView->CountDataProvider() ; k++) {
 			const CDataInfo *dataInfo = graphView->DataProviderAt(k);
+
+			history_point p1, p2;
+
+			if(!dataInfo->Point(resolution, i, p1) || !dataInfo->Point(resolution, i+1, p2)) {
+				// The history doesn't reach that far back (yet).
+				continue;
+			}
 		
-			float y1 = clientRect.bottom - dataInfo->Value(i) * scale;
-			float y2 = clientRect.bottom - dataInfo->Value(i+1) * scale;
+			float y1 = clientRect.bottom - p1.mean * scale;
+			float y2 = clientRect.bottom - p2.mean * scale;
+			
+			rgb_color color = dataInfo->Color();
+			
+			if(p1.max > p1.min) {
+				// range of the consolidated samples
+				rgb_color rangeColor = color;
+				rangeColor.alpha = 80;
+				
+				view->SetDrawingMode(B_OP_ALPHA);
+				view->SetHighColor(rangeColor);
+				view->StrokeLine(BPoint(x1, clientRect.bottom - p1.min * scale), 
+								 BPoint(x1, clientRect.bottom - p1.max * scale));
+				view->SetDrawingMode(B_OP_COPY);
+			}
 			
 			// connect two values
-			view->SetHighColor(dataInfo->Color());
+			view->SetHighColor(color);
 			view->StrokeLine(BPoint(x1,y1), BPoint(x2,y2));
 		}
 	}
@@ -216,7 +302,7 @@ void COverlayGraphViewUI::Draw(BView *view, const BRect &updateRect)
 
 		sprintf(curString, "%s %.2f %s", B_TRANSLATE("cur:"), dataInfo->Cur()*mul, unitString);
 		sprintf(maxString, "%s %.2f %s", B_TRANSLATE("avg:"), dataInfo->Avg()*mul, unitString);
-		sprintf(avgString, "%s %.2f %s", B_TRANSLATE("max:"), dataInfo->Max()*mul, unitString);
+		sprintf(avgString, "%s %.2f %s", B_TRANSLATE("max:"), dataInfo->Max(graphView->WindowedExtents())*mul, unitString);
 
 		maxStringWidth = MAX(maxStringWidth, view->StringWidth(curString));
 		maxStringWidth = MAX(maxStringWidth, view->StringWidth(maxString));
@@ -369,6 +455,8 @@ CGraphView::CGraphView(BRect frame, const char *title, int32 _maxValue, int32 _d
 	gridSpace   = 10;
 
 	autoScale = false;
+	windowedExtents = false;
+	timeSpan = 0;
 
 	Init();
 }
@@ -398,6 +486,12 @@ CGraphView::CGraphView(BMessage *archive) :
 	if(archive->FindBool(GRAPH_VIEW_ARCHIVE_AUTO_SCALE, &autoScale) != B_OK)
 		autoScale = false;
 
+	if(archive->FindBool(GRAPH_VIEW_ARCHIVE_WINDOWED_EXTENTS, &windowedExtents) != B_OK)
+		windowedExtents = false;
+
+	if(archive->FindInt64(GRAPH_VIEW_ARCHIVE_TIME_SPAN, &timeSpan) != B_OK)
+		timeSpan = 0;
+
 	if(archive->FindInt32(GRAPH_VIEW_ARCHIVE_GRID_SPACE, &gridSpace) != B_OK)
 		gridSpace = 10;
 
@@ -437,6 +531,8 @@ status_t CGraphView::Archive(BMessage *data, bool deep) const
 	data->AddInt32(GRAPH_VIEW_ARCHIVE_MAX_VALUE, maxValue);
 	data->AddInt32(GRAPH_VIEW_ARCHIVE_GRID_SPACE, gridSpace);
 	data->AddBool(GRAPH_VIEW_ARCHIVE_AUTO_SCALE, autoScale);
+	data->AddBool(GRAPH_VIEW_ARCHIVE_WINDOWED_EXTENTS, windowedExtents);
+	data->AddInt64(GRAPH_VIEW_ARCHIVE_TIME_SPAN, timeSpan);
 		
 	AddColor(data, GRAPH_VIEW_ARCHIVE_GRID_COLOR, gridColor);
 		
@@ -461,7 +557,8 @@ status_t CGraphView::Archive(BMessage *data, bool deep) const
 //!param:	color		- The color used to display the data provider
 //!param:	scale		- The scale factor applied to the data provider's samples before they are displayed.
 //!param:	updated		- Set to true if the passed data provider was already displayed by this view
-int32 CGraphView::AddDataProvider(IDataProvider *provider, rgb_color color, float scale, bool *updated)
+int32 CGraphView::AddDataProvider(IDataProvider *provider, rgb_color color, float scale, bool *updated,
+	const char *counterPath)
 {
 	if(updated)
 		*updated = false;
@@ -469,6 +566,9 @@ int32 CGraphView::AddDataProvider(IDataProvider *provider, rgb_color color, floa
 	if(provider == NULL)
 		return -1;
 
+	// Replay the counter, if it's part of the replayed recording.
+	provider = replay_data_provider(provider, counterPath);
+
 	// check for duplicates
 	for(int i=0 ; i<dataInfoList.CountItems() ; i++) {
 		if(dataInfoList.ItemAt(i)->DataProvider() &&
@@ -490,6 +590,12 @@ int32 CGraphView::AddDataProvider(IDataProvider *provider, rgb_color color, floa
 
 	CDataInfo *dataInfo = new CDataInfo(this, valueCount, provider, color, scale);
 
+	if(counterPath)
+		dataInfo->SetCounterPath(counterPath);
+
+	// Show what happened before the view was opened.
+	dataInfo->Backfill();
+
 	dataInfoList.AddItem(dataInfo);
 
 	if(Window()) {
@@ -518,6 +624,8 @@ int32 CGraphView::CountDataProvider() const
 void CGraphView::Init()
 {
 	gridOffset  = 0;
+	resolution  = 0;
+	drawnSerial = 0;
 	
 	notifyMessenger = NULL;
 	notifyMessage	= NULL;
@@ -608,6 +716,38 @@ BPopUpMenu *CGraphView::ContextMenu()
 	}
 	
 	contextMenu->AddItem(updateSpeedSubMenu);
+
+	BMenu *timeSpanSubMenu = new BMenu(B_TRANSLATE("Time Span"));
+
+	const int32 maxEntries=5;
+	struct {
+		const char *key;
+		bigtime_t span;
+	} menuInfo[maxEntries] = {
+		{ B_TRANSLATE_MARK("Live"),					 0, },
+		{ B_TRANSLATE_MARK("1 Hour"),		   3600LL*1000000, },
+		{ B_TRANSLATE_MARK("6 Hours"),		 6*3600LL*1000000, },
+		{ B_TRANSLATE_MARK("1 Day"),		24*3600LL*1000000, },
+		{ B_TRANSLATE_MARK("1 Week"),	  7*24*3600LL*1000000, },
+	};
+
+	for(int32 i=0 ; i<maxEntries ; i++) {
+		BMessage *msg = new BMessage(B_SET_PROPERTY);
+		
+		msg->AddSpecifier(GRAPH_VIEW_PROP_TIME_SPAN);
+		msg->AddInt64("data", menuInfo[i].span);
+	
+		BMenuItem *item = new BMenuItem(B_TRANSLATE(menuInfo[i].key), msg);
+		
+		item->SetMarked(menuInfo[i].span == timeSpan);
+		
+		timeSpanSubMenu->AddItem(item);
+	}
+
+	timeSpanSubMenu->SetRadioMode(true);
+	timeSpanSubMenu->SetTargetForItems(this);
+
+	contextMenu->AddItem(timeSpanSubMenu);
 	
 	return contextMenu;
 }
@@ -618,16 +758,60 @@ void CGraphView::Pulse()
 {
 	float currentMaxValue = 0.0;
 
+	// sample all data providers at once
+	samplingContext.MakeEmpty();
+
 	for(int32 i=0 ; i<dataInfoList.CountItems() ; i++) {
+		IDataProvider *dataProvider = dataInfoList.ItemAt(i)->DataProvider();
+	
+		if(dataProvider)
+			samplingContext.AddProvider(dataProvider);
+	}
+
+	samplingContext.Sample();
+
+	int32 newResolution = SelectResolution();
+	int32 visiblePoints = MIN(CountPoints(), (int32)(Bounds().Width() / distance) + 1);
+
+	for(int32 i=0, index=0 ; i<dataInfoList.CountItems() ; i++) {
 		CDataInfo *dataInfo = dataInfoList.ItemAt(i);
+		
+		data_sample sample = { 0.0, 0 };
+		bool valid = false;
+		
+		if(dataInfo->DataProvider())
+			valid = samplingContext.GetSample(index++, sample);
+	
+		bool update = dataInfo->Update(sample, valid);
 	
-		bool update = dataInfo->Update();
+		if(update) {
+			float dataMax = resolution == 0 ? 
+				dataInfo->Max(windowedExtents) : 
+				dataInfo->History().Max(resolution-1, visiblePoints);
+		
+			currentMaxValue = MAX(dataMax*dataInfo->Scale(), currentMaxValue);
+		}
+	}
+
+	// In a coarser resolution, the view only scrolls if a new
+	// point was finished.
+	bool advanced = true;
 	
-		if(update)
-			currentMaxValue = MAX(dataInfo->Max()*dataInfo->Scale(), currentMaxValue);
+	if(resolution > 0 && dataInfoList.CountItems() > 0) {
+		// All data infos are updated at the same time. The first
+		// one is good enough to detect new points.
+		uint32 serial = dataInfoList.ItemAt(0)->History().Serial(resolution-1);
+		
+		advanced	= serial != drawnSerial;
+		drawnSerial = serial;
 	}
 
-	if(autoScale && currentMaxValue > maxValue) {
+	if(newResolution != resolution) {
+		resolution	= newResolution;
+		drawnSerial	= 0;
+		
+		Invalidate();
+	} else if(autoScale && currentMaxValue > maxValue) {
 		while(currentMaxValue > maxValue)
 			maxValue *= 2;
 			
@@ -641,19 +825,70 @@ void CGraphView::Pulse()
 		}
 		
 		Invalidate();
-	} else {
-		if (!IsHidden()) {
+	} else if(advanced) {
+		if(resolution > 0) {
+			// Points are finished at most every few seconds.
+			// There may be more than one since the last pulse.
+			Invalidate();
+		} else if (!IsHidden()) {
 			CopyContent();
 		}
 	}
-		
-	gridOffset++;
+	
+	if(advanced)
+		gridOffset++;
 
 	if(gridOffset >= gridSpace) {
 		gridOffset = 0;
 	}		
 }
 
+//: Set the time span shown by the view.
+void CGraphView::SetTimeSpan(bigtime_t span)
+{
+	timeSpan = MAX(span, 0);
+	
+	int32 newResolution = SelectResolution();
+	
+	if(newResolution != resolution) {
+		resolution	= newResolution;
+		drawnSerial	= 0;
+		
+		Invalidate();
+	}
+}
+
+//: Number of points in the current resolution.
+int32 CGraphView::CountPoints() const
+{
+	return resolution == 0 ? valueCount : CConsolidatedHistory::Capacity(resolution-1);
+}
+
+// SelectResolution
+// Returns the finest resolution, in which the time span fits into the
+// view. The coarsest resolution is used for longer time spans.
+int32 CGraphView::SelectResolution() const
+{
+	if(timeSpan <= 0)
+		return 0;
+
+	int32 visiblePoints = MAX(1, (int32)(Bounds().Width() / distance));
+
+	if((bigtime_t)MIN(visiblePoints, valueCount) * ReplicantPulseRate() >= timeSpan)
+		return 0;
+
+	int32 levelCount = CConsolidatedHistory::CountLevels();
+
+	for(int32 i=0 ; i<levelCount ; i++) {
+		int32 points = MIN(visiblePoints, CConsolidatedHistory::Capacity(i));
+	
+		if((bigtime_t)points * CConsolidatedHistory::Step(i) >= timeSpan)
+			return i+1;
+	}
+	
+	return levelCount;
+}
+
 //: UI delegate factory method.
 IUI *CGraphView::CreateUI()
 {
@@ -890,13 +1125,35 @@ status_t CGraphView::GetSupportedSuites(BMessage *message)
 			0										// extra_data
 		},
 		{ 										// 6th property
+			(char *)GRAPH_VIEW_PROP_WINDOWED_EXTENTS,	// name
+			{										// commands
+				B_SET_PROPERTY,
+				B_GET_PROPERTY,
+				0
+			},
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 7th property
+			(char *)GRAPH_VIEW_PROP_TIME_SPAN,		// name
+			{										// commands
+				B_SET_PROPERTY,
+				B_GET_PROPERTY,
+				0
+			},
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 8th property
 			(char *)GRAPH_VIEW_PROP_DATA_INFO,		// name
 			{ B_COUNT_PROPERTIES, 0 },				// commands
 			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
 			"",										// usage
 			0										// extra_data
 		},
-		{ 										// 7th property
+		{ 										// 9th property
 			(char *)GRAPH_VIEW_PROP_DATA_INFO,		// name
 			{ B_DELETE_PROPERTY, 0 },				// commands
 			{ 										// specifiers
@@ -907,7 +1164,7 @@ status_t CGraphView::GetSupportedSuites(BMessage *message)
 			"",										// usage
 			0										// extra_data
 		},
-		{ 										// 8th property
+		{ 										// 10th property
 			(char *)GRAPH_VIEW_PROP_DATA_INFO,		// name
 			{ 0 },									// commands
 			{ 										// specifiers
@@ -1006,7 +1263,9 @@ BHandler *CGraphView::ResolveSpecifier(BMessage *message, int32 index,
 					strcmp(property, GRAPH_VIEW_PROP_POINT_DISTANCE) == 0 ||
 					strcmp(property, GRAPH_VIEW_PROP_GRID_SPACE) == 0 ||
 					strcmp(property, GRAPH_VIEW_PROP_GRID_COLOR) == 0 ||
-					strcmp(property, GRAPH_VIEW_PROP_MAX_VALUE) == 0 ) {
+					strcmp(property, GRAPH_VIEW_PROP_MAX_VALUE) == 0 ||
+					strcmp(property, GRAPH_VIEW_PROP_WINDOWED_EXTENTS) == 0 ||
+					strcmp(property, GRAPH_VIEW_PROP_TIME_SPAN) == 0 ) {
 					return this;
 				}
 			}
@@ -1044,7 +1303,9 @@ void CGraphView::MessageReceived(BMessage *msg)
 						
 						bool updated=false;
 						
-						int32 index = AddDataProvider(dataProvider, color, scale, &updated);
+						// The counter path is used to export the values (see CCounterExport).
+						int32 index = AddDataProvider(dataProvider, color, scale, &updated,
+							msg->FindString(MESSAGE_DATA_ID_COUNTER_PATH));
 
 						if(updated) {
 							SendNotify_DataInfoChanged(index);
@@ -1126,6 +1387,12 @@ void CGraphView::MessageReceived(BMessage *msg)
 					} else if(strcmp(property, GRAPH_VIEW_PROP_AUTO_SCALE) == 0) {
 						// GET_PROPERTY for 'AutoScale' property.
 						result = reply.AddBool("result", autoScale);
+					} else if(strcmp(property, GRAPH_VIEW_PROP_WINDOWED_EXTENTS) == 0) {
+						// GET_PROPERTY for 'WindowedExtents' property.
+						result = reply.AddBool("result", windowedExtents);
+					} else if(strcmp(property, GRAPH_VIEW_PROP_TIME_SPAN) == 0) {
+						// GET_PROPERTY for 'TimeSpan' property.
+						result = reply.AddInt64("result", timeSpan);
 					} else if(strcmp(property, GRAPH_VIEW_PROP_POINT_DISTANCE) == 0) {
 						// GET_PROPERTY for 'PointDistance' property.
 						result = reply.AddInt32("result", distance);
@@ -1203,6 +1470,23 @@ void CGraphView::MessageReceived(BMessage *msg)
 							autoScale = newValue;
 							Invalidate();
 						}
+					} else if(strcmp(property, GRAPH_VIEW_PROP_WINDOWED_EXTENTS) == 0) {
+						bool newValue;
+						
+						if((result = msg->FindBool("data", &newValue)) == B_OK) {
+							windowedExtents = newValue;
+							Invalidate();
+						}
+					} else if(strcmp(property, GRAPH_VIEW_PROP_TIME_SPAN) == 0) {
+						bigtime_t newValue;
+						
+						if((result = msg->FindInt64("data", &newValue)) == B_OK) {
+							if(newValue < 0) {
+								result = B_BAD_VALUE;
+							} else {
+								SetTimeSpan(newValue);
+							}
+						}
 					} else if(strcmp(property, GRAPH_VIEW_PROP_POINT_DISTANCE) == 0) {
 						int32 newValue;
 						
@@ -1351,6 +1635,7 @@ CDataInfo::CDataInfo(
 
 	Init();
 	Clear();
+	UpdateSeriesName();
 }
 
 CDataInfo::CDataInfo(BMessage *archive) : 
@@ -1361,10 +1646,15 @@ CDataInfo::CDataInfo(BMessage *archive) :
 	scale	   = archive->FindFloat(DATA_INFO_ARCHIVE_SCALE);
 	color      = FindColor(archive, DATA_INFO_ARCHIVE_LINE_COLOR);
 	
+	archive->FindString(DATA_INFO_ARCHIVE_COUNTER_PATH, &counterPath);
+	
 	BMessage dataProviderArchive;
 
 	if(archive->FindMessage(DATA_INFO_ARCHIVE_DATA_PROVIDER, &dataProviderArchive) == B_OK) {
-		dataProvider = dynamic_cast<IDataProvider *>(instantiate_object(&dataProviderArchive));
+		// Plugins are loaded on first use.
+		dataProvider = InstantiateDataProvider(&dataProviderArchive);
+		dataProvider = replay_data_provider(dataProvider, 
+			counterPath.Length() > 0 ? counterPath.String() : NULL);
 		
 		if(dataProvider == NULL) {
 			BString message;
@@ -1385,26 +1675,60 @@ CDataInfo::CDataInfo(BMessage *archive) :
 
 	Init();
 	Clear();
+	UpdateSeriesName();
+	
+	// Show what happened while the view wasn't displayed. The view
+	// isn't known yet, so the gaps are filled at the normal pulse rate.
+	Backfill();
 }
 
 //! Initializes the members of this object.
 void CDataInfo::Init()
 {
-	valueArray = new float[valueCount];
+	AllocValues();
 	
 	insertPoint   = 0;
 	avgValueCount = 0;
+	exportSlot	  = -1;
 
-	avg = max = 0.0;
+	avg = min = max = 0.0;
 }
 
 //! Destructor
 CDataInfo::~CDataInfo()
 {
-	delete valueArray;
+	UnregisterExport();
+	FreeValues();
 	delete dataProvider;
 }
 
+//: Allocates the sample buffer.
+// The storage type depends on the data provider. Percent values are
+// stored as fixed point numbers, which takes half the memory of floats.
+void CDataInfo::AllocValues()
+{
+	valueArray	 = NULL;
+	percentArray = NULL;
+
+	windowExtent = new CSlidingExtent(valueCount);
+
+	if(dataProvider && (dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT))
+		percentArray = new uint16[valueCount];
+	else
+		valueArray = new float[valueCount];
+}
+
+void CDataInfo::FreeValues()
+{
+	delete [] valueArray;
+	delete [] percentArray;
+	delete windowExtent;
+
+	valueArray	 = NULL;
+	percentArray = NULL;
+	windowExtent = NULL;
+}
+
 //: Archives this object.
 // Archives the CDataInfo by recording all its data in a BMessage archive. 
 // If the deep flag is true, this function also archives the IDataProvider.
@@ -1418,6 +1742,9 @@ status_t CDataInfo::Archive(BMessage *archive, bool deep = true) const
 	archive->AddFloat(DATA_INFO_ARCHIVE_SCALE, scale);
 	archive->AddData(DATA_INFO_ARCHIVE_LINE_COLOR, B_RGB_COLOR_TYPE, &color, sizeof(rgb_color));
 	
+	if(counterPath.Length() > 0)
+		archive->AddString(DATA_INFO_ARCHIVE_COUNTER_PATH, counterPath);
+	
 	if(deep) {
 		BMessage providerArchive;
 		
@@ -1436,6 +1763,21 @@ void CDataInfo::SetDataProvider(IDataProvider *provider)
 {
 	delete dataProvider; 
 	dataProvider = provider;
+	
+	normalizer.Reset();
+	
+	// The exported path may depend on the provider.
+	UnregisterExport();
+	UpdateSeriesName();
+
+	bool percent = provider && (provider->Flags() & IDataProvider::DP_TYPE_PERCENT);
+
+	if(percent != (percentArray != NULL)) {
+		// The storage type changed. The old samples are dropped.
+		FreeValues();
+		AllocValues();
+		Clear();
+	}
 }
 
 //! BeOS hook function.
@@ -1479,13 +1821,27 @@ status_t CDataInfo::GetSupportedSuites(BMessage *message)
 			0										// extra_data
 		},
 		{ 										// 5th property
-			(char *)DATA_INFO_PROP_CURRENT,			// name
+			(char *)DATA_INFO_PROP_WINDOW_MIN,		// name
 			{ B_GET_PROPERTY, 0 },					// commands
 			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
 			"",										// usage
 			0										// extra_data
 		},
 		{ 										// 6th property
+			(char *)DATA_INFO_PROP_WINDOW_MAX,		// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 7th property
+			(char *)DATA_INFO_PROP_CURRENT,			// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 8th property
 			(char *)DATA_INFO_PROP_DATA_PROVIDER,	// name
 			{ B_GET_PROPERTY, 0 },					// commands
 			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
@@ -1529,6 +1885,8 @@ BHandler *CDataInfo::ResolveSpecifier(BMessage *message, int32 index,
 					strcmp(property, DATA_INFO_PROP_DATA_PROVIDER) == 0 ||
 					strcmp(property, DATA_INFO_PROP_MAX) == 0 ||
 					strcmp(property, DATA_INFO_PROP_AVG) == 0 ||
+					strcmp(property, DATA_INFO_PROP_WINDOW_MIN) == 0 ||
+					strcmp(property, DATA_INFO_PROP_WINDOW_MAX) == 0 ||
 					strcmp(property, DATA_INFO_PROP_CURRENT) == 0) {
 					return this;
 				}
@@ -1586,6 +1944,12 @@ status_t CDataInfo::GetProperty(const char *property, int32 what, BMessage &repl
 	} else if(strcmp(property, DATA_INFO_PROP_AVG) == 0 && what == B_DIRECT_SPECIFIER) {
 		// GET_PROPERTY for 'Avg' property.
 		result = reply.AddFloat("result", Avg());
+	} else if(strcmp(property, DATA_INFO_PROP_WINDOW_MIN) == 0 && what == B_DIRECT_SPECIFIER) {
+		// GET_PROPERTY for 'WindowMin' property.
+		result = reply.AddFloat("result", WindowMin());
+	} else if(strcmp(property, DATA_INFO_PROP_WINDOW_MAX) == 0 && what == B_DIRECT_SPECIFIER) {
+		// GET_PROPERTY for 'WindowMax' property.
+		result = reply.AddFloat("result", WindowMax());
 	} else if(strcmp(property, DATA_INFO_PROP_CURRENT) == 0 && what == B_DIRECT_SPECIFIER) {
 		// GET_PROPERTY for 'Current' property.
 		result = reply.AddFloat("result", Cur());
@@ -1664,49 +2028,240 @@ BArchivable *CDataInfo::Instantiate(BMessage *archive)
 float CDataInfo::Value(int32 index) const
 {
 	// array is used as ring buffer
-	return valueArray[(insertPoint+index+1)%valueCount] * scale;
+	return StoredValue((insertPoint+index+1)%valueCount) * scale;
+}
+
+//: Get a point of the history in the given resolution.
+// Resolution 0 are the samples in the sample buffer (min, max and mean
+// are the same), all others the levels of the consolidated history (see
+// CGraphView::Resolution()). The values are scaled. Returns false, if
+// the history doesn't contain the point (yet).
+//!param: index - Number of points before the last one.
+bool CDataInfo::Point(int32 resolution, int32 index, history_point &point) const
+{
+	if(resolution == 0) {
+		if(index >= valueCount)
+			return false;
+	
+		point.min = point.max = point.mean = Value(index);
+		
+		return true;
+	}
+
+	if(index >= history.CountPoints(resolution-1))
+		return false;
+	
+	point = history.PointAt(resolution-1, index);
+
+	point.min  *= scale;
+	point.max  *= scale;
+	point.mean *= scale;
+	
+	return true;
 }
 
 //: Clear the sample buffer.
 void CDataInfo::Clear()
 {
-	memset(valueArray, 0, sizeof(float)*valueCount);
+	if(percentArray)
+		memset(percentArray, 0, sizeof(uint16)*valueCount);
+	else
+		memset(valueArray, 0, sizeof(float)*valueCount);
+
+	windowExtent->MakeEmpty();
+	history.MakeEmpty();
 }
 
 //: Add a new entry to the sample buffer.
 bool CDataInfo::Update()
 {
-	float value=0.0;
+	data_sample sample = { 0.0, 0 };
 
-	if(dataProvider && dataProvider->GetNextValue(value)) {
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_RELATIVE)
-			value /= view->ReplicantPulseRate();
-			
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT) {
-			value *= 100.0;
-			
+	bool valid = dataProvider && get_next_sample(dataProvider, sample);
+
+	return Update(sample, valid);
+}
+
+//: Add a sample taken by the caller to the sample buffer.
+// 'sample' is the raw sample returned by the data provider. If there is
+// no value to display, a zero is added.
+bool CDataInfo::Update(const data_sample &sample, bool valid)
+{
+	CSessionRecorder *recorder = CSessionRecorder::Instance();
+	
+	if(recorder)
+		recorder->Record(dataProvider, SeriesName().String(), sample, valid);
+
+	// Only narrowed to float for display.
+	double value = 0.0;
+
+	if(normalizer.Normalize(dataProvider, sample, valid, view->ReplicantPulseRate(), value)) {
+		if(dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT)
 			value = MIN(MAX(value, 0.0), 100.0);
-		}
 		
 		max = MAX(value, max);
 		
 		if(avgValueCount == 0) {
-			avg = value;
+			avg = min = value;
 			avgValueCount++;
 		} else  {
 			avg = (avg*avgValueCount + value) / ++avgValueCount;
+			min = MIN(value, min);
 		}
+		
+		Export(sample, value, true);
+		Record(value);
+	} else {
+		Export(sample, value, false);
 	}
 
+	// The history uses the real time, so it matches the time
+	// series store.
+	history.Add(real_time_clock_usecs(), value);
+
+	StoreValue(value);
+		
+	return true;
+}
+
+//: Add a value to the sample buffer.
+void CDataInfo::StoreValue(double value)
+{
+	// The window covers the samples in the ring buffer.
+	windowExtent->Add(value);
+
 	// add new value to array
-	valueArray[insertPoint--] = value;
+	if(percentArray)
+		percentArray[insertPoint--] = (uint16)(MIN(MAX(value, 0.0), 100.0) * 100.0 + 0.5);
+	else
+		valueArray[insertPoint--] = value;
 		
 	if(insertPoint < 0) {
 		// array is used as ring buffer
 		insertPoint = valueCount-1;
 	}
+}
+
+//: Update the name of the counter in the export and the time series store.
+// The counter path, if it's known. Otherwise the display name of the
+// data provider. It's kept in a member, as it's needed for every sample.
+void CDataInfo::UpdateSeriesName()
+{
+	if(counterPath.Length() > 0)
+		seriesName = counterPath;
+	else if(dataProvider)
+		seriesName = dataProvider->DisplayName();
+	else
+		seriesName = "";
+}
+
+//: Add a valid value to the time series store.
+void CDataInfo::Record(double value)
+{
+	CTimeSeriesStore *store = CTimeSeriesStore::Instance();
+	
+	if(store == NULL || dataProvider == NULL || IsReplay())
+		return;
 		
-	return true;
+	store->Append(SeriesName().String(), real_time_clock_usecs(), value);
+}
+
+//: Test if the data provider replays a recording.
+// Replayed values aren't stored and the time series store isn't read
+// for them, as they don't belong to the live history.
+bool CDataInfo::IsReplay() const
+{
+	return dynamic_cast<CReplayDataProvider *>(dataProvider) != NULL;
+}
+
+//: Fill the sample buffer and the history with the values of earlier sessions.
+// The values of the last DATA_INFO_BACKFILL_SPAN are read from the time
+// series store. The sample buffer receives the latest values as if
+// they were sampled at the current pulse rate. Times in which the
+// application didn't run are filled with zeros. Max, min and average
+// only cover the values sampled by this object.
+void CDataInfo::Backfill()
+{
+	CTimeSeriesStore *store = CTimeSeriesStore::Instance();
+	
+	if(store == NULL || dataProvider == NULL || IsReplay())
+		return;
+		
+	bigtime_t now = real_time_clock_usecs();
+	
+	CBackfillSink sink(&history, valueCount);
+	
+	if(store->ReadRange(SeriesName().String(), now - DATA_INFO_BACKFILL_SPAN, now, &sink) == 0)
+		return;
+	
+	bigtime_t pulseRate = view ? view->ReplicantPulseRate() : NORMAL_PULSE_RATE;
+	bigtime_t lastTime	= 0;
+	
+	for(int32 i=0 ; i<=sink.CountSamples() ; i++) {
+		// The last pass fills the gap until now.
+		bigtime_t time = i < sink.CountSamples() ? sink.TimeAt(i) : now;
+	
+		if(lastTime > 0) {
+			bigtime_t missing = MIN((time - lastTime) / pulseRate - 1, (bigtime_t)valueCount);
+			
+			for(bigtime_t k=0 ; k<missing ; k++)
+				StoreValue(0.0);
+		}
+		
+		if(i < sink.CountSamples())
+			StoreValue(sink.ValueAt(i));
+			
+		lastTime = time;
+	}
+}
+
+//: Set the path of the counter of the data provider.
+// The path is used to export the values. If it's unknown, the
+// display name of the data provider is exported instead.
+void CDataInfo::SetCounterPath(const char *path)
+{
+	counterPath = path;
+
+	UnregisterExport();
+	UpdateSeriesName();
+}
+
+//: Publish the latest value in the counter export.
+// The counter is registered with the first value.
+void CDataInfo::Export(const data_sample &sample, double value, bool valid)
+{
+	CCounterExport *counterExport = CCounterExport::Instance();
+	
+	if(counterExport == NULL || dataProvider == NULL)
+		return;
+		
+	if(exportSlot < 0) {
+		exportSlot = counterExport->Register(SeriesName().String());
+		
+		if(exportSlot < 0)
+			return;
+	}
+	
+	counter_export_value exportValue;
+	
+	exportValue.timeStamp	= sample.timeStamp;
+	exportValue.value		= value;
+	exportValue.min			= min;
+	exportValue.max			= max;
+	exportValue.avg			= avg;
+	exportValue.valid		= valid;
+	
+	counterExport->Publish(exportSlot, exportValue);
+}
+
+void CDataInfo::UnregisterExport()
+{
+	CCounterExport *counterExport = CCounterExport::Instance();
+
+	if(counterExport && exportSlot >= 0)
+		counterExport->Unregister(exportSlot);
+		
+	exportSlot = -1;
 }
 
 // ==== COverlayGraphView ====
@@ -24,6 +24,9 @@
 
 #include "PulseView.h"
 #include "PointerList.h"
+#include "SamplingContext.h"
+#include "SlidingExtent.h"
+#include "ConsolidatedHistory.h"
 
 // ====== Archive Fields ======
 
@@ -35,12 +38,15 @@ extern const char * const GRAPH_VIEW_ARCHIVE_GRID_SPACE;			// int32
 extern const char * const GRAPH_VIEW_ARCHIVE_GRID_COLOR;			// rgb_color
 extern const char * const GRAPH_VIEW_ARCHVIE_DATA_INFO_LIST;		// CDataInfo[]
 extern const char * const GRAPH_VIEW_ARCHIVE_AUTO_SCALE;			// bool
+extern const char * const GRAPH_VIEW_ARCHIVE_WINDOWED_EXTENTS;	// bool
+extern const char * const GRAPH_VIEW_ARCHIVE_TIME_SPAN;			// bigtime_t
 
 // CDataInfo
 extern const char * const DATA_INFO_ARCHIVE_VALUE_COUNT;			// int32
 extern const char * const DATA_INFO_ARCHIVE_LINE_COLOR;				// rgb_color
 extern const char * const DATA_INFO_ARCHIVE_SCALE;					// float
 extern const char * const DATA_INFO_ARCHIVE_DATA_PROVIDER;			// CArchivableDataProvider
+extern const char * const DATA_INFO_ARCHIVE_COUNTER_PATH;			// string
 
 // COverlayGraphView
 extern const char * const OVERLAY_VIEW_ARCHIVE_OVERLAY_INDEX;		// int32
@@ -55,12 +61,16 @@ extern const char * const GRAPH_VIEW_PROP_POINT_DISTANCE;			// int32
 extern const char * const GRAPH_VIEW_PROP_GRID_SPACE;				// int32
 extern const char * const GRAPH_VIEW_PROP_GRID_COLOR;				// rgb_color
 extern const char * const GRAPH_VIEW_PROP_MAX_VALUE;				// float
+extern const char * const GRAPH_VIEW_PROP_WINDOWED_EXTENTS;		// bool
+extern const char * const GRAPH_VIEW_PROP_TIME_SPAN;				// bigtime_t
 
 // CDataInfo
 extern const char * const DATA_INFO_PROP_COLOR;						// rgb_color
 extern const char * const DATA_INFO_PROP_SCALE;						// float
 extern const char * const DATA_INFO_PROP_MAX;						// float
 extern const char * const DATA_INFO_PROP_AVG;						// float
+extern const char * const DATA_INFO_PROP_WINDOW_MIN;				// float
+extern const char * const DATA_INFO_PROP_WINDOW_MAX;				// float
 extern const char * const DATA_INFO_PROP_CURRENT;					// float
 extern const char * const DATA_INFO_PROP_DATA_PROVIDER;				// IDataProvider *
 
@@ -119,6 +129,9 @@ extern const char * const MESSAGE_DATA_ID_DATA_PROVIDER;			// IDataProvider *
 // MSG_ADD_DATA_PROVIDER
 extern const char * const MESSAGE_DATA_ID_SCALE;					// float
 
+// MSG_ADD_DATA_PROVIDER (optional)
+extern const char * const MESSAGE_DATA_ID_COUNTER_PATH;				// string
+
 // ====== Class Defs ======
 
 class CGraphView;
@@ -173,31 +186,62 @@ class _EXPORT CDataInfo : public BHandler
 	void SetDataProvider(IDataProvider *provider);
 	void SetColor(rgb_color c) { color = c; }
 	void SetScale(float s) { scale = s; }
+	void SetCounterPath(const char *path);
 
 	IDataProvider *DataProvider() const { return dataProvider; }
 	rgb_color Color() const { return color; }
 	float Scale() const { return scale; }
+	const char *CounterPath() const { return counterPath.String(); }
 	float Max() const { return max; }
-	float Cur() const { return valueArray[(insertPoint+1)%valueCount]; }
+	float Cur() const { return StoredValue((insertPoint+1)%valueCount); }
 	float Avg() const { return avg; }
+	float WindowMin() const { return windowExtent->Min(); }
+	float WindowMax() const { return windowExtent->Max(); }
+	float Max(bool windowed) const { return windowed ? WindowMax() : Max(); }
 
 	float Value(int32 index) const;
+	bool Point(int32 resolution, int32 index, history_point &point) const;
+	const CConsolidatedHistory &History() const { return history; }
 	bool Update();
+	bool Update(const data_sample &sample, bool valid);
+	void Backfill();
 	void Clear();
 
 	protected:
 	void Init();
+	void AllocValues();
+	void FreeValues();
+	void StoreValue(double value);
+	const BString &SeriesName() const { return seriesName; }
+	void UpdateSeriesName();
+	void Export(const data_sample &sample, double value, bool valid);
+	void UnregisterExport();
+	void Record(double value);
+	bool IsReplay() const;
+
+	float StoredValue(int32 pos) const
+	{
+		return percentArray ? percentArray[pos] / 100.0 : valueArray[pos];
+	}
 
 	CPulseView		 	 *view;				// GraphView which this object is attached to.
 	float 				 *valueArray;		// Array of values (used as ring buffer)
+	uint16				 *percentArray;		// Replaces 'valueArray' for percent values (in 1/100 %)
 	IDataProvider 		 *dataProvider;	
 	int32 				  valueCount;		// Size of 'valueArray'.
 	int32 				  insertPoint;		// Current insertion point into ring buffer.
 	float 				  scale;
+	float				  min;				// Minimum of all values
 	float				  max;				// Maximum value in 'valueArray'
 	float				  avg;				// Average
 	int32				  avgValueCount;	// Number of values used to calc avg.
 	rgb_color			  color;
+	CSampleNormalizer	  normalizer;
+	BString				  counterPath;		// empty, if unknown
+	BString				  seriesName;		// see UpdateSeriesName()
+	int32				  exportSlot;		// slot in CCounterExport or -1
+	CSlidingExtent		 *windowExtent;		// min/max of the values in the sample buffer
+	CConsolidatedHistory  history;			// coarser resolutions of the samples
 };
 
 //: UI delegate for CGraphView
@@ -274,7 +318,7 @@ class _EXPORT CGraphView : public CPulseView
 
 	int32 AddDataProvider(IDataProvider *provider, 
 				rgb_color color, float scale=1.0, 
-				bool *updated=NULL);
+				bool *updated=NULL, const char *counterPath=NULL);
 	
 	const CDataInfo *DataProviderAt(int32 index) const;
 	int32 CountDataProvider() const;
@@ -285,6 +329,22 @@ class _EXPORT CGraphView : public CPulseView
 	void SetAutoScale(bool as) { autoScale = as; }
 	bool AutoScale() { return autoScale; }
 
+	// If set, autoscaling and the overlay use the maximum of the
+	// displayed history instead of the maximum of all values.
+	void SetWindowedExtents(bool we) { windowedExtents = we; }
+	bool WindowedExtents() const { return windowedExtents; }
+
+	// Time shown by the view. The resolution of the history is
+	// chosen, so that the time span fits into the view. 0 shows the
+	// samples taken at the pulse rate.
+	void SetTimeSpan(bigtime_t span);
+	bigtime_t TimeSpan() const { return timeSpan; }
+
+	// 0 for the samples, otherwise the level of the consolidated
+	// history plus one (see CDataInfo::Point()).
+	int32 Resolution() const { return resolution; }
+	int32 CountPoints() const;
+
 	void SetNotification(BHandler *handler, BMessage *message=NULL);
 
 	void SendNotify_DataInfoChanged(int32 dataInfoIndex);
@@ -293,6 +353,7 @@ class _EXPORT CGraphView : public CPulseView
 
 	protected:
 	void Init();
+	int32 SelectResolution() const;
 
 	virtual BPopUpMenu *ContextMenu();
 	virtual IUI *CreateUI();
@@ -311,6 +372,11 @@ class _EXPORT CGraphView : public CPulseView
 	int32 valueCount;
 
 	bool autoScale;
+	bool windowedExtents;
+
+	bigtime_t timeSpan;
+	int32 resolution;
+	uint32 drawnSerial;				// history serial of the last drawn point
 
 	rgb_color gridColor;
 
@@ -322,6 +388,7 @@ class _EXPORT CGraphView : public CPulseView
 	CContextMenuDetector *detector;
 	
 	CPointerList<CDataInfo> dataInfoList;
+	CSamplingContext samplingContext;	// Used by Pulse().
 };
 
 class _EXPORT COverlayGraphView : public CGraphView
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+//: Hash index mapping ids (team_id, thread_id) to model entries.
+// Open addressing with linear probing. Every slot carries the
+// generation in which the id was last seen by the model's update.
+// Entries whose generation is behind the current one after a full
+// walk have died and are removed from the model. The index doesn't
+// own the entries.
+template<class T>
+class CIdIndex
+{
+	public:
+	CIdIndex(int32 initialCapacity=64)
+	{
+		// round up to a power of two
+		for(capacity=16 ; capacity<initialCapacity ; capacity*=2)
+			;
+
+		slots = new slot[capacity];
+
+		MakeEmpty();
+	}
+
+	~CIdIndex()
+	{
+		delete [] slots;
+	}
+
+	T *Find(int32 id) const
+	{
+		const slot &s = slots[SlotIndex(id)];
+
+		return s.id == id ? s.entry : NULL;
+	}
+
+	// Looks up 'id' and, if found, stamps the slot with 'generation'.
+	T *Touch(int32 id, uint32 generation)
+	{
+		slot &s = slots[SlotIndex(id)];
+
+		if(s.id != id)
+			return NULL;
+
+		s.generation = generation;
+
+		return s.entry;
+	}
+
+	bool IsCurrent(int32 id, uint32 generation) const
+	{
+		const slot &s = slots[SlotIndex(id)];
+
+		return s.id == id && s.generation == generation;
+	}
+
+	void Insert(int32 id, T *entry, uint32 generation)
+	{
+		// keep the load factor below 1/2.
+		if((count+1)*2 > capacity)
+			Resize(capacity*2);
+
+		slot &s = slots[SlotIndex(id)];
+
+		if(s.id == -1)
+			count++;
+
+		s.id			= id;
+		s.generation	= generation;
+		s.entry			= entry;
+	}
+
+	// Uses backward shift deletion, so the table never contains
+	// tombstones and lookups stay short even under heavy churn.
+	void Remove(int32 id)
+	{
+		int32 mask = capacity-1;
+		int32 hole = SlotIndex(id);
+
+		if(slots[hole].id != id)
+			return;
+
+		slots[hole].id = -1;
+		count--;
+
+		for(int32 i=(hole+1) & mask ; slots[i].id != -1 ; i=(i+1) & mask) {
+			int32 home = HomeIndex(slots[i].id);
+
+			// Move the slot into the hole, if its home position isn't
+			// in the (cyclic) range (hole, i].
+			bool inRange = (hole <= i) ? (hole < home && home <= i) :
+										 (hole < home || home <= i);
+
+			if(!inRange) {
+				slots[hole] = slots[i];
+				slots[i].id = -1;
+				hole = i;
+			}
+		}
+	}
+
+	void MakeEmpty()
+	{
+		for(int32 i=0 ; i<capacity ; i++) {
+			slots[i].id			= -1;
+			slots[i].generation	= 0;
+			slots[i].entry		= NULL;
+		}
+
+		count = 0;
+	}
+
+	int32 CountItems() const { return count; }
+
+	protected:
+	struct slot {
+		int32		 id;			// -1 if slot is empty
+		uint32		 generation;
+		T			*entry;
+	};
+
+	int32 HomeIndex(int32 id) const
+	{
+		// Fibonacci hashing. Ids are handed out sequentially, so the
+		// low bits alone would cluster badly.
+		return (int32)(((uint32)id * 2654435761UL) >> 8) & (capacity-1);
+	}
+
+	// Returns the index of the slot containing 'id' or of the empty
+	// slot where 'id' would be inserted.
+	int32 SlotIndex(int32 id) const
+	{
+		int32 mask = capacity-1;
+		int32 i = HomeIndex(id);
+
+		while(slots[i].id != -1 && slots[i].id != id)
+			i = (i+1) & mask;
+
+		return i;
+	}
+
+	void Resize(int32 newCapacity)
+	{
+		slot *oldSlots = slots;
+		int32 oldCapacity = capacity;
+
+		slots = new slot[newCapacity];
+		capacity = newCapacity;
+
+		MakeEmpty();
+
+		for(int32 i=0 ; i<oldCapacity ; i++) {
+			if(oldSlots[i].id != -1) {
+				slots[SlotIndex(oldSlots[i].id)] = oldSlots[i];
+				count++;
+			}
+		}
+
+		delete [] oldSlots;
+	}
+
+	slot	*slots;
+	int32	 capacity;						// always a power of two
+	int32	 count;
+};
+
+#endif // ID_INDEX_H
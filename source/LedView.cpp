@@ -21,6 +21,9 @@
 #include "msg_helper.h"
 #include "LedView.h"
 #include "DataProvider.h"
+#include "SessionRecorder.h"
+#include "ReplayDataProvider.h"
+#include "CounterNamespaceImpl.h"
 
 #include "msg_helper.h"
 
@@ -35,6 +38,7 @@ const char * const LED_VIEW_ARCHIVE_LED_MAX_WIDTH	= "LEDVIEW:LedMaxWidth";
 const char * const LED_VIEW_ARCHIVE_LED_ON_COLOR	= "LEDVIEW:LedOnColor";
 const char * const LED_VIEW_ARCHIVE_LED_OFF_COLOR	= "LEDVIEW:LedOffColor";
 const char * const LED_VIEW_ARCHIVE_DATA_PROVIDER	= "LEDVIEW:DataProvider";
+const char * const LED_VIEW_ARCHIVE_COUNTER_PATH	= "LEDVIEW:CounterPath";
 
 // scripting properties
 const char * const LED_VIEW_PROP_LED_ON_COLOR		= "LEDOnColor";
@@ -82,11 +86,16 @@ CLedView::CLedView(BMessage *archive) :
 	ledMaxWidth	= archive->FindInt32(LED_VIEW_ARCHIVE_LED_MAX_WIDTH);
 	ledOnColor	= FindColor(archive, LED_VIEW_ARCHIVE_LED_ON_COLOR);
 	ledOffColor	= FindColor(archive, LED_VIEW_ARCHIVE_LED_OFF_COLOR);
+	counterPath	= archive->FindString(LED_VIEW_ARCHIVE_COUNTER_PATH);
+	
+	dataProvider = NULL;
 
 	BMessage providerArchive;
 	
 	if(archive->FindMessage(LED_VIEW_ARCHIVE_DATA_PROVIDER, &providerArchive) == B_OK) {
-		dataProvider = dynamic_cast<IDataProvider *>(instantiate_object(&providerArchive));
+		dataProvider = InstantiateDataProvider(&providerArchive);
+		dataProvider = replay_data_provider(dataProvider, 
+			counterPath.Length() > 0 ? counterPath.String() : NULL);
 	}
 
 	Init();
@@ -104,14 +113,36 @@ void CLedView::Init()
 	
 	// init string
 	displayString[0] = '\0';
+	
+	UpdateExportPath();
+}
+
+// UpdateExportPath
+// The values are exported by the counter path. If it's unknown, the
+// display name of the data provider is used.
+void CLedView::UpdateExportPath()
+{
+	if(dataProvider == NULL)
+		exportedCounter.SetPath("");
+	else if(counterPath.Length() > 0)
+		exportedCounter.SetPath(counterPath.String());
+	else
+		exportedCounter.SetPath(dataProvider->DisplayName().String());
 }
 
-void CLedView::SetDataProvider(IDataProvider *provider)
+void CLedView::SetDataProvider(IDataProvider *provider, const char *path)
 {
 	if(dataProvider)
 		delete dataProvider;
 		
-	dataProvider = provider;
+	counterPath = path;
+
+	// Replay the counter, if it's part of the replayed recording.
+	dataProvider = replay_data_provider(provider, path);
+
+	normalizer.Reset();
+	
+	UpdateExportPath();
 }
 
 status_t CLedView::Archive(BMessage *data, bool deep) const
@@ -129,6 +160,9 @@ status_t CLedView::Archive(BMessage *data, bool deep) const
 		data->AddInt32(LED_VIEW_ARCHIVE_LED_MAX_WIDTH, ledMaxWidth);
 		data->AddData(LED_VIEW_ARCHIVE_LED_ON_COLOR, B_RGB_COLOR_TYPE, &ledOnColor, sizeof(rgb_color));
 		data->AddData(LED_VIEW_ARCHIVE_LED_OFF_COLOR, B_RGB_COLOR_TYPE, &ledOffColor, sizeof(rgb_color));
+		
+		if(counterPath.Length() > 0)
+			data->AddString(LED_VIEW_ARCHIVE_COUNTER_PATH, counterPath);
 
 		if(deep) {
 			BMessage providerArchive;
@@ -160,17 +194,25 @@ void CLedView::AttachedToWindow()
 
 bool CLedView::GetNextValue(float &nextValue)
 { 
-	if(dataProvider && dataProvider->GetNextValue(nextValue)) {
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_RELATIVE)
-			nextValue /= ReplicantPulseRate();
-			
-		if(dataProvider->Flags() & IDataProvider::DP_TYPE_PERCENT)
-			nextValue *= 100.0;
-			
-		return true;
-	}
+	data_sample sample = { 0.0, 0 };
+
+	bool valid = dataProvider && get_next_sample(dataProvider, sample);
+
+	CSessionRecorder *recorder = CSessionRecorder::Instance();
 	
-	return false;
+	// The counter is recorded by the name it's exported with.
+	if(recorder && dataProvider)
+		recorder->Record(dataProvider, exportedCounter.Path(), sample, valid);
+
+	double value = 0.0;
+
+	bool update = normalizer.Normalize(dataProvider, sample, valid, ReplicantPulseRate(), value);
+
+	exportedCounter.Publish(sample, value, update);
+
+	nextValue = value;
+
+	return update;
 }
 
 bool CLedView::GetNextString(char *string, size_t len)
@@ -21,6 +21,8 @@
 // ====== Includes =======
 
 #include "PulseView.h"
+#include "SamplingContext.h"
+#include "CounterExport.h"
 
 // ====== Archive Fields ======
 
@@ -33,6 +35,7 @@ extern const char * const LED_VIEW_ARCHIVE_LED_MAX_WIDTH;			// int32
 extern const char * const LED_VIEW_ARCHIVE_LED_ON_COLOR;			// rgb_color
 extern const char * const LED_VIEW_ARCHIVE_LED_OFF_COLOR;			// rgb_color
 extern const char * const LED_VIEW_ARCHIVE_DATA_PROVIDER;			// CArchivableDataProvider
+extern const char * const LED_VIEW_ARCHIVE_COUNTER_PATH;			// string
 
 // ====== Scripting Properties ======
 
@@ -75,10 +78,14 @@ class _EXPORT CLedView : public CPulseView
 
 	int32 MaxValue() { return maxValue; }
 	void  SetMaxValue(int32 mv) { maxValue = mv; }
-	void  SetDataProvider(IDataProvider *provider);
+	
+	// 'path' is the counter path of 'provider', if it's known. It's
+	// used to export the values (see CCounterExport).
+	void  SetDataProvider(IDataProvider *provider, const char *path=NULL);
 	
 	protected:
 	void Init();
+	void UpdateExportPath();
 	
 	virtual bool GetNextValue(float &value);
 	virtual bool GetNextString(char *string, size_t len);
@@ -102,6 +109,9 @@ class _EXPORT CLedView : public CPulseView
 	rgb_color ledOffColor;
 	
 	IDataProvider			*dataProvider;
+	BString					 counterPath;		// empty, if unknown
+	CSampleNormalizer		 normalizer;
+	CExportedCounter		 exportedCounter;
 };
 
 #endif // LED_VIEW_H
\ No newline at end of file
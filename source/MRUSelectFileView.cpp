@@ -20,6 +20,7 @@
 #include "FileGlyphMenuItem.h"
 #include "Preferences.h"
 #include "CommandLineParser.h"
+#include "ExecutableInfoCache.h"
 #include "MRUSelectFileView.h"
 
 #include "my_assert.h"
@@ -269,13 +270,10 @@ void CMRUSelectFileView::DisplayMRUList()
 			msg->AddInt32(MESSAGE_DATA_ID_MRU_INDEX, -1);
 			msg->AddString(MESSAGE_DATA_ID_MRU_PATH, recentAppPath.Path());
 			
-			BBitmap *icon = new BBitmap(BRect(0,0,15,15), B_RGBA32);
+			BBitmap *icon = NULL;
 				
 			// load icon for file
-			if(BNodeInfo::GetTrackerIcon(&recentAppRef, icon, B_MINI_ICON) != B_OK) {
-				delete icon;
-				icon = NULL;
-			}
+			CExecutableInfoCache::CreateInstance()->Lookup(recentAppPath.Path(), NULL, NULL, &icon);
 	
 			const char *filename = recentAppPath.Leaf();
 	
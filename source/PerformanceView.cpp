@@ -50,6 +50,7 @@ const char * const MESSAGE_DATA_ID_EXPAND_FOUND		  = "SELECTDP:ExpandFound";
 // static data
 const float CPerformanceAddView::dist = 10.0;
 const int32 CPerformanceAddView::MAX_USERDEFINED_COLORS = 5;
+const int32 CPerformanceAddView::COUNTER_PAGE_SIZE = 50;
 
 CPerformanceAddView::CPerformanceAddView(BRect frame, BHandler *handler) :
 	CLocalizedDialogBase(frame,
@@ -232,8 +233,7 @@ void CPerformanceAddView::AttachedToWindow()
 						bounds.bottom-5*dist-buttonHeight-colorSelectHeight);
 
 	// COutlineListViewEx automatically deletes the tree items.
-	treeView = new COutlineListViewEx(treeViewRect, "ListView", B_SINGLE_SELECTION_LIST,
-						B_FOLLOW_ALL);
+	treeView = new CCounterTreeView(treeViewRect, this);
 	
 	treeView->SetInvocationMessage(new BMessage(MSG_OK));
 	treeView->SetSelectionMessage(new BMessage(MSG_SELECTION_CHANGED));
@@ -263,32 +263,158 @@ void CPerformanceAddView::AttachedToWindow()
 	treeView->SetTarget(this);
 }
 
+// FillTreeView
+// Only the top level items are created. The children of an item are
+// loaded, when it's expanded (see LoadChildren()).
 void CPerformanceAddView::FillTreeView()
 {
 	CPointer<IPerformanceCounter> root = global_Namespace->Root();
+	IPagedPerformanceCounter *pagedRoot = dynamic_cast<IPagedPerformanceCounter *>((IPerformanceCounter *)root);
+
+	MY_ASSERT(pagedRoot != NULL);
+	
+	BList counters;
+	counter_cursor cursor = { 0, 0, 0, false };
+	
+	while(!cursor.done) {
+		if(pagedRoot->GetNextChildren(&cursor, COUNTER_PAGE_SIZE, &counters) != B_OK)
+			break;
+	}
+	
+	int32 index = 0;
 	
-	AddChildren(root, NULL); 
+	for(int32 i=0 ; i<counters.CountItems() ; i++)
+		AddCounterItem(new CCounterItem((IPerformanceCounter *)counters.ItemAt(i), true, 0), index);
 
 	// Sorting the tree simply takes too long (about 2 secs).	
 	// treeView->FullListSortItems(ItemCompareFunc);
 }
 
-void CPerformanceAddView::AddChildren(IPerformanceCounter *counter, BListItem *parent)
+// LoadChildren
+// Adds the next page of children below 'parent'. If there are more
+// children, a placeholder item is appended, which loads the next page,
+// when it's scrolled into view.
+void CPerformanceAddView::LoadChildren(CCounterItem *parent)
 {
-	for(int i=0 ; i<counter->CountChildren() ; i++) {
-		IPerformanceCounter *child = counter->ChildAt(i);
+	if(parent->moreItem) {
+		treeView->RemoveItem(parent->moreItem);
+		delete parent->moreItem;
+		parent->moreItem = NULL;
+	}
+	
+	if(parent->loaded && parent->cursor.done)
+		return;
+
+	// new items are appended after the last loaded child.
+	int32 index = treeView->FullListIndexOf(parent) + 1 + 
+		treeView->CountItemsUnder(parent, false);
+	uint32 level = parent->OutlineLevel() + 1;
+
+	IPagedPerformanceCounter *pagedCounter = 
+		dynamic_cast<IPagedPerformanceCounter *>(parent->Counter());
+
+	if(pagedCounter) {
+		BList counters;
 		
-		BStringItem *item = new CCounterItem(child);
+		if(pagedCounter->GetNextChildren(&parent->cursor, COUNTER_PAGE_SIZE, &counters) != B_OK)
+			parent->cursor.done = true;
 		
-		if(parent == NULL) {
-			treeView->AddItem(item);
-		} else {
-			treeView->AddUnder(item, parent);
-			treeView->Collapse(item);
+		for(int32 i=0 ; i<counters.CountItems() ; i++)
+			AddCounterItem(new CCounterItem((IPerformanceCounter *)counters.ItemAt(i), true, level), index);
+	} else {
+		// The counter caches its children. Load all of them.
+		IPerformanceCounter *counter = parent->Counter();
+	
+		for(int32 i=0 ; i<counter->CountChildren() ; i++)
+			AddCounterItem(new CCounterItem(counter->ChildAt(i), false, level), index);
+
+		parent->cursor.done = true;
+	}
+	
+	parent->loaded = true;
+	
+	if(!parent->cursor.done) {
+		parent->moreItem = new CMoreItem(this, parent, level);
+		treeView->AddItem(parent->moreItem, index);
+	}
+}
+
+// AddCounterItem
+// Inserts 'item' at the full list 'index' and increments 'index'. Items
+// which may have children get a placeholder child, so that they can
+// be expanded.
+void CPerformanceAddView::AddCounterItem(CCounterItem *item, int32 &index)
+{
+	treeView->AddItem(item, index++);
+	
+	IPagedPerformanceCounter *pagedCounter = 
+		dynamic_cast<IPagedPerformanceCounter *>(item->Counter());
+	
+	bool hasChildren = pagedCounter ? 
+		pagedCounter->CountChildrenHint() != 0 : 
+		item->Counter()->CountChildren() > 0;
+	
+	if(hasChildren) {
+		item->moreItem = new CMoreItem(this, item, item->OutlineLevel()+1);
+		treeView->AddItem(item->moreItem, index++);
+	}
+}
+
+// FindChildItem
+// Searches the child 'name' of 'parent' (NULL for the top level). 'name'
+// isn't null terminated. It's 'length' chars long. Children are loaded
+// until the item is found.
+CPerformanceAddView::CCounterItem *CPerformanceAddView::FindChildItem(CCounterItem *parent, 
+	const char *name, int32 length)
+{
+	while(true) {
+		int32 start = parent ? treeView->FullListIndexOf(parent) + 1 : 0;
+		uint32 level = parent ? parent->OutlineLevel() + 1 : 0;
+		BListItem *item;
+		
+		for(int32 i=start ; (item = treeView->FullListItemAt(i)) != NULL && 
+			item->OutlineLevel() >= level ; i++) {
+			CCounterItem *counterItem = dynamic_cast<CCounterItem *>(item);
+		
+			if(counterItem && item->OutlineLevel() == level) {
+				const char *internalName = counterItem->Counter()->InternalName();
+				
+				if(strncmp(internalName, name, length) == 0 && internalName[length] == '\0')
+					return counterItem;
+			}
 		}
+		
+		if(parent == NULL || (parent->loaded && parent->cursor.done))
+			return NULL;
+			
+		LoadChildren(parent);
+	}
+}
 
-		AddChildren(child, item);
+// FindCounterItem
+// Returns the full list index of the item of the counter 'path' or -1.
+// The children of all items along the path are loaded.
+int32 CPerformanceAddView::FindCounterItem(const char *path)
+{
+	CCounterItem *item = NULL;
+
+	// Char at index 0 is always a '/'.
+	const char *component = path[0] == '/' ? path+1 : path;
+
+	while(*component != '\0') {
+		const char *slash = strchr(component, '/');
+		int32 length = slash ? slash-component : strlen(component);
+		
+		if((item = FindChildItem(item, component, length)) == NULL)
+			return -1;
+		
+		if(slash == NULL)
+			break;
+			
+		component = slash+1;
 	}
+	
+	return item ? treeView->FullListIndexOf(item) : -1;
 }
 
 rgb_color CPerformanceAddView::SelectedColor()
@@ -631,15 +757,15 @@ bool CPerformanceAddView::Ok()
 		CCounterItem *counterItem = dynamic_cast<CCounterItem *>(
 			treeView->FullListItemAt(selIndex));
 
-		MY_ASSERT(counterItem != NULL);
-			
-		IDataProvider *dataProvider = counterItem->DataProvider();
+		// placeholder items have no data provider.
+		IDataProvider *dataProvider = counterItem ? counterItem->DataProvider() : NULL;
 	
 		if(dataProvider && Messenger().IsValid()) {
 			// The destination needs to create a clone of that
 			// object, when it wants to store it.
 			addMessage.AddPointer(MESSAGE_DATA_ID_DATA_PROVIDER, 
 				dataProvider);
+			addMessage.AddString(MESSAGE_DATA_ID_COUNTER_PATH, counterItem->Path());
 			addMessage.AddFloat(MESSAGE_DATA_ID_SCALE, selScale);
 
 			AddColor(&addMessage, MESSAGE_DATA_ID_COLOR, SelectedColor());
@@ -781,27 +907,33 @@ void CPerformanceAddView::MessageReceived(BMessage *message)
 				IDataProvider *selDataProvider = NULL;
 				const char *selPerfCounterPath = NULL;
 
-				if(message->FindPointer(MESSAGE_DATA_ID_DATA_PROVIDER, (void **)&selDataProvider) == B_OK ||
-				   message->FindString(MESSAGE_DATA_ID_PERF_COUNTER_PATH, &selPerfCounterPath) == B_OK) {
-					CCounterItem *item;
-				
+				message->FindPointer(MESSAGE_DATA_ID_DATA_PROVIDER, (void **)&selDataProvider);
+				message->FindString(MESSAGE_DATA_ID_PERF_COUNTER_PATH, &selPerfCounterPath);
+
+				if(selDataProvider || selPerfCounterPath) {
 					int32 foundIndex = -1;
 				
-					for(int32 i=0 ; (item = dynamic_cast<CCounterItem *>(treeView->FullListItemAt(i))) != NULL ; i++) {
-						if(selDataProvider) {
-							IDataProvider *itemDataProvider = item->DataProvider();
+					if(selPerfCounterPath) {
+						// Items are only loaded along the path, if the
+						// counter still exists.
+						if(CounterPathExists(selPerfCounterPath))
+							foundIndex = FindCounterItem(selPerfCounterPath);
+					} else {
+						// Data providers without known path (from old
+						// settings) are only searched in the loaded items.
+						BListItem *item;
+					
+						for(int32 i=0 ; (item = treeView->FullListItemAt(i)) != NULL ; i++) {
+							CCounterItem *counterItem = dynamic_cast<CCounterItem *>(item);
+							
+							IDataProvider *itemDataProvider = 
+								counterItem ? counterItem->DataProvider() : NULL;
 
 							if(itemDataProvider && itemDataProvider->Equal(selDataProvider)) {
 								// found correct data provider
 								foundIndex = i;
 								break;
 							}
-						} else if(selPerfCounterPath) {
-							if(strcmp(item->Path(), selPerfCounterPath) == 0) {
-								// found correct data provider
-								foundIndex = i;
-								break;
-							}
 						}
 					}
 					
@@ -820,6 +952,20 @@ void CPerformanceAddView::MessageReceived(BMessage *message)
 				}
 			}
 			break;
+		case MSG_LOAD_MORE_COUNTERS:
+			{
+				CCounterItem *parent;
+				CMoreItem *item;
+				
+				// Ignore the request, if the placeholder was already
+				// replaced (e.g. by FindChildItem()).
+				if(message->FindPointer("parent", (void **)&parent) == B_OK &&
+				   message->FindPointer("item", (void **)&item) == B_OK &&
+				   parent->moreItem == item) {
+					LoadChildren(parent);
+				}
+			}
+			break;
 		default:
 			CLocalizedDialogBase::MessageReceived(message);
 	}
@@ -827,16 +973,70 @@ void CPerformanceAddView::MessageReceived(BMessage *message)
 
 // ==== CPerformanceAddView::CCounterItem ====
 
-CPerformanceAddView::CCounterItem::CCounterItem(IPerformanceCounter *counter) :
-	BStringItem(counter->Name())
+CPerformanceAddView::CCounterItem::CCounterItem(IPerformanceCounter *_counter, 
+	bool _ownsCounter, uint32 level) :
+	BStringItem(_counter->Name(), level, false)
 {
-	dataProvider = counter->DataProvider() ? counter->DataProvider()->Clone() : NULL;
-	path		 = counter->Path();
+	counter		= _counter;
+	ownsCounter	= _ownsCounter;
+	loaded		= false;
+	moreItem	= NULL;
+
+	cursor.part		= 0;
+	cursor.plugin	= 0;
+	cursor.cookie	= 0;
+	cursor.done		= false;
 }
 
 CPerformanceAddView::CCounterItem::~CCounterItem()
 {
-	delete dataProvider;
+	if(ownsCounter)
+		delete counter;
+}
+
+// ==== CPerformanceAddView::CMoreItem ====
+
+CPerformanceAddView::CMoreItem::CMoreItem(BHandler *_target, CCounterItem *_parent, uint32 level) :
+	BStringItem(B_TRANSLATE("Loading" B_UTF8_ELLIPSIS), level)
+{
+	target		= _target;
+	parent		= _parent;
+	requested	= false;
+}
+
+void CPerformanceAddView::CMoreItem::DrawItem(BView *owner, BRect frame, bool complete)
+{
+	BStringItem::DrawItem(owner, frame, complete);
+	
+	if(!requested) {
+		// The item is visible. Load the next page.
+		BMessage loadMessage(MSG_LOAD_MORE_COUNTERS);
+		
+		loadMessage.AddPointer("parent", parent);
+		loadMessage.AddPointer("item", this);
+		
+		owner->Looper()->PostMessage(&loadMessage, target);
+
+		requested = true;
+	}
+}
+
+// ==== CPerformanceAddView::CCounterTreeView ====
+
+CPerformanceAddView::CCounterTreeView::CCounterTreeView(BRect frame, CPerformanceAddView *_addView) :
+	COutlineListViewEx(frame, "ListView", B_SINGLE_SELECTION_LIST, B_FOLLOW_ALL)
+{
+	addView = _addView;
+}
+
+void CPerformanceAddView::CCounterTreeView::Expand(BListItem *item)
+{
+	CCounterItem *counterItem = dynamic_cast<CCounterItem *>(item);
+	
+	if(counterItem && !counterItem->Loaded())
+		addView->LoadChildren(counterItem);
+
+	COutlineListViewEx::Expand(item);
 }
 
 // ==== CPerformanceAddWindow ====
@@ -1066,6 +1266,7 @@ CPerformanceView::CPerformanceView(BRect frame) :
 	graphView->MoveTo(borderView->ClientRect().LeftTop() + borderView->Frame().LeftTop());
 	graphView->ResizeTo(borderView->ClientRect().Width(), borderView->ClientRect().Height());
 	graphView->SetAutoScale(true);
+	graphView->SetWindowedExtents(true);
 
 	dragger->MoveTo(borderView->Frame().RightBottom() - BPoint(2,2));
 	dragger->ResizeTo(7, 7);
@@ -1162,6 +1363,9 @@ void CPerformanceView::MessageReceived(BMessage *message)
 		
 							BMessage selectMsg(MSG_SELECT_DATA_PROVIDER);
 							selectMsg.AddPointer(MESSAGE_DATA_ID_DATA_PROVIDER, dataProvider);
+							
+							if(dataInfo->CounterPath()[0] != '\0')
+								selectMsg.AddString(MESSAGE_DATA_ID_PERF_COUNTER_PATH, dataInfo->CounterPath());
 					
 							window->PostMessage(&selectMsg);
 						}
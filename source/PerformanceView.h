@@ -24,6 +24,7 @@
 #include "ListViewEx.h"
 #include "MakSplitterView.h"	// splitter view
 #include "Singleton.h"
+#include "PerformanceCounter.h"
 
 // ===== Message IDs ======
 
@@ -34,6 +35,7 @@ const int32 MSG_VIEW_COLOR_SELECTOR			= 'mVCS';
 const int32 MSG_SCALE_SELECTED				= 'mSSE';
 const int32 MSG_SELECT_DATA_PROVIDER		= 'mSED';
 const int32 MSG_SELECTION_CHANGED			= 'mSEC';
+const int32 MSG_LOAD_MORE_COUNTERS			= 'mLMC';
 
 // ===== Message Fields ======
 
@@ -44,8 +46,6 @@ extern const char * const MESSAGE_DATA_ID_PERF_COUNTER_PATH;		// string (optiona
 
 class CGraphView;
 class COverlayGraphView;
-class IDataProvider;
-class IPerformanceCounter;
 
 class CPerformanceAddWindow : public CSingletonWindow
 {
@@ -78,8 +78,13 @@ class CPerformanceAddView : public CLocalizedDialogBase, public BInvoker
 	virtual void GetPreferredSize(float *width, float *height);
 	
 	protected:
+	class CCounterItem;
+
 	void FillTreeView();
-	void AddChildren(IPerformanceCounter *counter, BListItem *item);
+	void LoadChildren(CCounterItem *parent);
+	void AddCounterItem(CCounterItem *item, int32 &index);
+	CCounterItem *FindChildItem(CCounterItem *parent, const char *name, int32 length);
+	int32 FindCounterItem(const char *path);
 	void CreateColorMenuField();
 	void CreateScaleMenuField();
 
@@ -109,20 +114,62 @@ class CPerformanceAddView : public CLocalizedDialogBase, public BInvoker
 	BMenuItem *CreateColorItem(const rgb_color &color, const char *name=NULL);
 	const char *PrefBaseName() { return "UserDefColor_"; }
 
+	class CMoreItem;
+
+	//: Tree item of a performance counter.
+	// The children are loaded, when the item is expanded for the first time.
 	class CCounterItem : public BStringItem
 	{
 		public:
-		CCounterItem(IPerformanceCounter *counter);
+		CCounterItem(IPerformanceCounter *counter, bool ownsCounter, uint32 level);
 		virtual ~CCounterItem();
 
-		IDataProvider *DataProvider() { return dataProvider; }
-		const char *Path() { return path.String(); }
+		IPerformanceCounter *Counter() { return counter; }
+		IDataProvider *DataProvider() { return counter->DataProvider(); }
+		const char *Path() { return counter->Path(); }
+		
+		bool Loaded() { return loaded; }
 		
 		protected:
-		IDataProvider *dataProvider;
-		BString path;
+		IPerformanceCounter *counter;
+		bool ownsCounter;
+		bool loaded;					// first page of children loaded
+		counter_cursor cursor;
+		CMoreItem *moreItem;			// placeholder for children not loaded yet
+		
+		friend class CPerformanceAddView;
 	};
 	
+	//: Placeholder for children, which aren't loaded yet.
+	// Requests the next page of children, when it's drawn.
+	class CMoreItem : public BStringItem
+	{
+		public:
+		CMoreItem(BHandler *target, CCounterItem *parent, uint32 level);
+
+		virtual void DrawItem(BView *owner, BRect frame, bool complete=false);
+
+		protected:
+		BHandler *target;
+		CCounterItem *parent;
+		bool requested;
+	};
+	
+	//: Tree view, which loads the children of an item, when it is expanded.
+	class CCounterTreeView : public COutlineListViewEx
+	{
+		public:
+		CCounterTreeView(BRect frame, CPerformanceAddView *addView);
+		
+		virtual void Expand(BListItem *item);
+		
+		protected:
+		CPerformanceAddView *addView;
+	};
+
+	// Number of children loaded at once.
+	static const int32 COUNTER_PAGE_SIZE;
+	
 	static const float dist;
 	static const int32 MAX_USERDEFINED_COLORS;
 
@@ -30,8 +30,12 @@
 #include "TaskManagerPrefs.h"
 #include "PerformanceView.h"
 #include "PointerList.h"
+#include "ExecutableInfoCache.h"
 #include "AlertEx.h"
+#include "SystemSnapshot.h"
+#include "IdIndex.h"
 #include "TeamModel.h"
+#include "ThreadModel.h"
 #include "Process.h"
 #include "ColumnListViewEx.h"
 #include "ProcessView.h"
@@ -51,14 +55,9 @@ class CTeamModelListener : public ITeamModelListener
 		teamView = _teamView;
 	}
 	
-	void ItemAdded(CTeamModelEntry *entry, int32 index)
+	void ItemsChanged(const CTeamModelBatch &batch)
 	{
-		teamView->AddTeam(entry, index);
-	}
-	
-	void ItemRemoved(CTeamModelEntry *entry, int32 index)
-	{
-		teamView->RemoveTeam(entry);
+		teamView->TeamsChanged(batch);
 	}
 	
 	protected:
@@ -68,7 +67,7 @@ class CTeamModelListener : public ITeamModelListener
 class CProcessItem : public CLVEasyItemEx
 {
 	public:
-	CProcessItem(CTeamModelEntry *_teamModelEntry); 
+	CProcessItem(CTeamModelEntry *_teamModelEntry, CProcessView *_processView); 
 		
 	team_id TeamId() const 			{ return teamModelEntry->TeamId(); }
 	bool	IsSystemTeam() const 	{ return teamModelEntry->IsSystemTeam(); }
@@ -79,14 +78,40 @@ class CProcessItem : public CLVEasyItemEx
 	static int CompareItems(const CLVListItem* a_Item1, const CLVListItem* a_Item2, int32 KeyColumn);
 	
 	int Compare(const CProcessItem &other, int32 key) const;
-	void Update(const system_info *sysInfo, bigtime_t cpuActiveTime);
+	int CompareColumn(const CProcessItem &other, int32 key) const;
+	bool Update(const CSystemSnapshot *snapshot, bigtime_t cpuActiveTime);
+
+	// Position in the process tree. 'depth' is the number of ancestors
+	// shown in the list. Returns true, if the depth changed.
+	bool SetParentItem(CProcessItem *newParentItem, int32 newDepth);
 	
 	virtual void DisplayContextMenu(BView *owner, BPoint point);
 	
 	protected:
 	CTeamModelEntry    *teamModelEntry;
+	CProcessView	   *processView;
+	CProcessItem	   *parentItem;		// NULL for roots and in the flat list
+	int32				depth;
 	bigtime_t			lastUserTime;		// total user time before last update
 	bigtime_t			lastKernelTime;		// total kernel time before last update
+	uint64				lastUsedPages;		// used pages of the system at last memory update
+	bool				refreshed;			// false until the first Update()
+	bool				cpuIdle;			// displayed CPU usage is zero
+};
+
+// Draws the team name indented by its depth in the process tree.
+class CTeamNamePainter : public CLVTextPainter
+{
+	public:
+	CTeamNamePainter(const char *name, const rgb_color &color);
+
+	void SetIndent(float newIndent);
+
+	virtual void DrawItemColumn(BView *owner, BRect item_column_rect, bool complete);
+	virtual float ContentWidth(BView *owner, BFont *font);
+
+	protected:
+	float indent;
 };
 
 class CUsagePainter : public CLVTextPainter
@@ -140,6 +165,9 @@ const char * const MESSAGE_DATA_ID_PRIORITY					= "TEAM:Prio";		// only if ACTIO
 
 // Properties of CProcessView
 const char * const PROCESS_VIEW_PROP_HIDE_SYSTEM_TEAMS		= "HideSystemTeams";
+const char * const PROCESS_VIEW_PROP_SHOW_PROCESS_TREE		= "ShowProcessTree";
+const char * const PROCESS_VIEW_PROP_SKIPPED_TEAMS			= "SkippedTeams";
+const char * const PROCESS_VIEW_PROP_REFRESHED_TEAMS		= "RefreshedTeams";
 const char * const PROCESS_VIEW_PROP_TEAM_MODEL				= "TeamModel";
 
 column_info team_view_colomn_info[] = {
@@ -156,6 +184,37 @@ column_info team_view_colomn_info[] = {
 	{ "", 									-1, 						false,	  0.0,	 0.0 	},			
 };
 
+// Indent per level of the process tree.
+const float PROCESS_TREE_INDENT = 12.0;
+
+// ====== CTeamNamePainter ======
+
+CTeamNamePainter::CTeamNamePainter(const char *name, const rgb_color &color) :
+	CLVTextPainter(name, false, color)
+{
+	indent = 0.0;
+}
+
+void CTeamNamePainter::SetIndent(float newIndent)
+{
+	indent = newIndent;
+
+	// the truncated text depends on the space left
+	mustTruncate = true;
+}
+
+void CTeamNamePainter::DrawItemColumn(BView *owner, BRect item_column_rect, bool complete)
+{
+	item_column_rect.left += indent;
+
+	CLVTextPainter::DrawItemColumn(owner, item_column_rect, complete);
+}
+
+float CTeamNamePainter::ContentWidth(BView *owner, BFont *font)
+{
+	return CLVTextPainter::ContentWidth(owner, font) + indent;
+}
+
 // ====== CUsagePainter ======
 
 CUsagePainter::CUsagePainter() :
@@ -321,10 +380,13 @@ void CCPUUsagePainter::DrawUsageBar(BView *owner, BRect borderRect, bool complet
 
 // ====== CProcessItem ======
 
-CProcessItem::CProcessItem(CTeamModelEntry *_teamModelEntry) :
+CProcessItem::CProcessItem(CTeamModelEntry *_teamModelEntry, CProcessView *_processView) :
 	CLVEasyItemEx(0, false, false, 20.0)
 {
 	teamModelEntry = _teamModelEntry;
+	processView	   = _processView;
+	parentItem	   = NULL;
+	depth		   = 0;
 
 	MY_ASSERT(teamModelEntry->TeamId() != -1);
 
@@ -343,20 +405,11 @@ CProcessItem::CProcessItem(CTeamModelEntry *_teamModelEntry) :
 	bool systemTeam = teamModelEntry->IsSystemTeam();
 	
 	if(fileName.Path() != NULL) {
-		BEntry 		appEntry(fileName.Path());
-		entry_ref	appEntryRef;
+		BBitmap *icon = NULL;
 
-		appEntry.GetRef(&appEntryRef);
+		CExecutableInfoCache::CreateInstance()->Lookup(teamModelEntry->AppDevice(),
+			teamModelEntry->AppNode(), fileName.Path(), NULL, NULL, &icon);
 
-		BBitmap *icon = new BBitmap(BRect(0,0,15,15), B_RGBA32);
-		
-		// This code also returns an icon for applications not on BeFS devices
-		// and/or without an icon in their resources.
-		if(BNodeInfo::GetTrackerIcon(&appEntryRef, icon, B_MINI_ICON) != B_OK) {
-			delete icon;
-			icon = NULL;
-		}
-		
 		BPath dir;
 		fileName.GetParent(&dir);
 
@@ -365,7 +418,7 @@ CProcessItem::CProcessItem(CTeamModelEntry *_teamModelEntry) :
 	}
 
 	SetColumnContent(COLUMN_NUM_NAME, 
-		new CLVTextPainter(name, false, systemTeam ? CColor::Blue : CColor::Black));	
+		new CTeamNamePainter(name, systemTeam ? CColor::Blue : CColor::Black));	
 	
 	SetColumnContent(COLUMN_NUM_TEAM_ID, new CLVTextPainter(idString, true));
 	SetColumnContent(COLUMN_NUM_THREAD_COUNT, new CLVTextPainter(threadCountString, true));
@@ -377,10 +430,24 @@ CProcessItem::CProcessItem(CTeamModelEntry *_teamModelEntry) :
 	
 	lastUserTime   = teamModelEntry->UserTime();
 	lastKernelTime = teamModelEntry->KernelTime();
+	lastUsedPages  = 0;
+	refreshed = cpuIdle = false;
 }
 
-void CProcessItem::Update(const system_info *sysInfo, bigtime_t cpuUsage)
+// Update
+// Refreshes the columns of the item. Teams which didn't change since
+// the last update are skipped: their CPU usage stays zero and their
+// memory usage only moves, if the used memory of the whole system
+// changed by more than 1%. Returns false, if the item was skipped.
+bool CProcessItem::Update(const CSystemSnapshot *snapshot, bigtime_t cpuUsage)
 {
+	uint64 usedPages = snapshot->SystemInfo().used_pages;
+	uint64 pageDelta = (usedPages > lastUsedPages) ? 
+		usedPages-lastUsedPages : lastUsedPages-usedPages;
+
+	if(refreshed && cpuIdle && !teamModelEntry->Changed() && pageDelta*100 <= lastUsedPages)
+		return false;
+
 	bigtime_t userTime   = teamModelEntry->UserTime();
 	bigtime_t kernelTime = teamModelEntry->KernelTime();
 
@@ -407,13 +474,15 @@ void CProcessItem::Update(const system_info *sysInfo, bigtime_t cpuUsage)
 										(GetColumnContentPainter(COLUMN_NUM_CPU_USAGE));
 
 		cpuUsagePainter->Update(percentCpuUsage, percentKernelUsage);		
+
+		cpuIdle = (totalUsageTime == 0);
 	}
 
 	size_t totalAreaSize = teamModelEntry->AreaSize();
 		
 	float percentMemUsage;
 		
-	percentMemUsage = (totalAreaSize / (float)(sysInfo->used_pages * B_PAGE_SIZE)) * 100.0;
+	percentMemUsage = (totalAreaSize / (float)(usedPages * B_PAGE_SIZE)) * 100.0;
 		
 	CMemUsagePainter *memUsagePainter = dynamic_cast<CMemUsagePainter *>
 											(GetColumnContentPainter(COLUMN_NUM_MEM_USAGE));
@@ -428,6 +497,27 @@ void CProcessItem::Update(const system_info *sysInfo, bigtime_t cpuUsage)
 		
 	lastUserTime   = userTime;
 	lastKernelTime = kernelTime;
+	lastUsedPages  = usedPages;
+	refreshed	   = true;
+
+	return true;
+}
+
+bool CProcessItem::SetParentItem(CProcessItem *newParentItem, int32 newDepth)
+{
+	parentItem = newParentItem;
+
+	if(depth == newDepth)
+		return false;
+
+	depth = newDepth;
+
+	CTeamNamePainter *namePainter = dynamic_cast<CTeamNamePainter *>
+										(GetColumnContentPainter(COLUMN_NUM_NAME));
+
+	namePainter->SetIndent(depth * PROCESS_TREE_INDENT);
+
+	return true;
 }
 
 void CProcessItem::DisplayContextMenu(BView *owner, BPoint point)
@@ -517,7 +607,7 @@ void CProcessItem::DisplayContextMenu(BView *owner, BPoint point)
 	int32 basePrio;
 	bool disablePrioMenu=false;
 	
-	if(CTeam(TeamId()).GetBasePriority(basePrio) == B_OK) {
+	if(teamModelEntry->ThreadModel()->GetBasePriority(basePrio) == B_OK) {
 		if(0 <= basePrio && basePrio <= 5) {
 			prioSubMenu->ItemAt(0)->SetMarked(true);
 		} else if(6 <= basePrio && basePrio <= 10) {
@@ -567,7 +657,48 @@ int CProcessItem::CompareItems(const CLVListItem* a_Item1, const CLVListItem* a_
 	return pi1->Compare(*pi2, KeyColumn);
 }	
 	
+// Compare
+// In the process tree a team is placed after its ancestors and only
+// siblings are compared by the column. Siblings with equal values are
+// ordered by team id, so the subtrees never interleave. Secondary sort
+// keys aren't used in this mode.
 int CProcessItem::Compare(const CProcessItem &other, int32 key) const
+{
+	if(!processView->showProcessTree)
+		return CompareColumn(other, key);
+
+	// The list view negates the result for descending columns. The
+	// tree order must not change, so it's negated here as well.
+	int order = (processView->listView->ColumnAt(key)->SortMode() == Descending) ? -1 : 1;
+
+	const CProcessItem *item1 = this;
+	const CProcessItem *item2 = &other;
+
+	while(item1->depth > item2->depth)
+		item1 = item1->parentItem;
+
+	while(item2->depth > item1->depth)
+		item2 = item2->parentItem;
+
+	if(item1 == item2) {
+		// One team is an ancestor of the other (or both are the same).
+		return (depth == other.depth) ? 0 : (depth > other.depth ? order : -order);
+	}
+
+	while(item1->parentItem != item2->parentItem) {
+		item1 = item1->parentItem;
+		item2 = item2->parentItem;
+	}
+
+	int result = item1->CompareColumn(*item2, key);
+
+	if(result == 0)
+		result = (item1->TeamId() < item2->TeamId()) ? -order : order;
+
+	return result;
+}
+
+int CProcessItem::CompareColumn(const CProcessItem &other, int32 key) const
 {
 	switch(key) {
 		case COLUMN_NUM_DIRECTORY:
@@ -626,6 +757,10 @@ CProcessView::CProcessView(BRect rect) :
 {
 	lastUpdateTime = 0;
 	sortItems = true;
+	updatingList = false;
+	showProcessTree = false;
+	journalSequence = 0;
+	skippedCount = refreshedCount = 0;
 
 	teamModel = NULL;
 
@@ -668,6 +803,14 @@ CProcessView::CProcessView(BRect rect) :
 	// it's enabled.
 	killButton->SetEnabled(false);
 
+	// --- Create top processes panel
+
+	BRect topTeamsRect(selectTeamButton->Frame().right+7, selectTeamButton->Frame().top,
+					   killButton->Frame().left-7, selectTeamButton->Frame().bottom);
+
+	topTeamsView = new BStringView(topTeamsRect, "TopTeamsView", "", 
+						B_FOLLOW_LEFT_RIGHT | B_FOLLOW_BOTTOM);
+
 	// --- Create listview
 
 	BRect listViewRect(7,7,
@@ -742,6 +885,7 @@ CProcessView::CProcessView(BRect rect) :
 
 	AddChild(containerView);
 	AddChild(selectTeamButton);
+	AddChild(topTeamsView);
 	AddChild(killButton);
 }
 
@@ -764,7 +908,10 @@ void CProcessView::AttachedToWindow()
 
 	listView->SetTarget(this);
 
-	hideSystemTeams = CTaskManagerPrefs().HideSystemTeams();
+	CTaskManagerPrefs prefs;
+
+	hideSystemTeams = prefs.HideSystemTeams();
+	showProcessTree = prefs.ShowProcessTree();
 	
 	teamModel = new CTeamModel(Window());
 
@@ -899,8 +1046,33 @@ status_t CProcessView::SetHideSystemTeams(bool newValue)
 	
 	hideSystemTeams = newValue;
 	
+	RebuildList();
+	
+	return B_OK;
+}
+
+status_t CProcessView::SetShowProcessTree(bool newValue)
+{
+	if(showProcessTree == newValue)
+		return B_OK;
+	
+	showProcessTree = newValue;
+	
+	// The new items aren't indented.
+	RebuildList();
+	
+	return B_OK;
+}
+
+// RebuildList
+// Replaces all items by new ones created from the team model.
+void CProcessView::RebuildList()
+{
 	int32 itemCount = listView->CountItems();
 	
+	for(int32 i=0 ; i<itemCount ; i++)
+		delete listView->ItemAt(i);
+
 	listView->RemoveItems(0, itemCount);
 	
 	BAutolock teamModelLock(teamModel->Looper());
@@ -909,12 +1081,60 @@ status_t CProcessView::SetHideSystemTeams(bool newValue)
 		CTeamModelEntry *entry = teamModel->EntryAt(i);
 	
 		if(!(hideSystemTeams && entry->IsSystemTeam()))
-			listView->AddItem(new CProcessItem(entry));
+			listView->AddItem(new CProcessItem(entry, this));
 	}
+
+	journalSequence = teamModel->Journal()->LastSequence();
 	
+	SortList();
+}
+
+// SortList
+// Sorts the list. In the process tree the items are linked to their
+// parents first.
+void CProcessView::SortList()
+{
+	if(showProcessTree)
+		LinkItems();
+
 	listView->SortItems();
-	
-	return B_OK;
+}
+
+// LinkItems
+// Sets the parent item of every item to the item of its nearest
+// ancestor in the list. Hidden system teams are skipped.
+void CProcessView::LinkItems()
+{
+	int32 itemCount = listView->CountItems();
+
+	CIdIndex<CProcessItem> itemIndex(itemCount*2);
+
+	for(int32 i=0 ; i<itemCount ; i++) {
+		CProcessItem *item = (CProcessItem *)listView->ItemAt(i);
+
+		itemIndex.Insert(item->TeamId(), item, 0);
+	}
+
+	for(int32 i=0 ; i<itemCount ; i++) {
+		CProcessItem *item = (CProcessItem *)listView->ItemAt(i);
+		CProcessItem *parentItem = NULL;
+		int32 depth = 0;
+
+		for(CTeamModelEntry *entry=item->Entry()->Parent() ; entry!=NULL ; entry=entry->Parent()) {
+			CProcessItem *ancestor = itemIndex.Find(entry->TeamId());
+
+			if(ancestor == NULL)
+				continue;
+
+			if(parentItem == NULL)
+				parentItem = ancestor;
+
+			depth++;
+		}
+
+		if(item->SetParentItem(parentItem, depth))
+			listView->InvalidateItem(i);
+	}
 }
 
 BHandler *CProcessView::ResolveSpecifier(BMessage *message, int32 index, 
@@ -924,11 +1144,19 @@ BHandler *CProcessView::ResolveSpecifier(BMessage *message, int32 index,
 		case B_SET_PROPERTY:
 		case B_GET_PROPERTY:
 			if( (strcmp(property, PROCESS_VIEW_PROP_HIDE_SYSTEM_TEAMS) == 0 || 
+				 strcmp(property, PROCESS_VIEW_PROP_SHOW_PROCESS_TREE) == 0 || 
 				 strcmp(property, PROCESS_VIEW_PROP_TEAM_MODEL) == 0) &&
 				what == B_DIRECT_SPECIFIER) {
 				
 				return this;
 			}
+
+			if( (strcmp(property, PROCESS_VIEW_PROP_SKIPPED_TEAMS) == 0 || 
+				 strcmp(property, PROCESS_VIEW_PROP_REFRESHED_TEAMS) == 0) &&
+				message->what == B_GET_PROPERTY && what == B_DIRECT_SPECIFIER) {
+				
+				return this;
+			}
 			break;
 	}
 	
@@ -1089,35 +1317,6 @@ void CProcessView::QuitTeam(team_id id)
 void CProcessView::MessageReceived(BMessage *message)
 {
 	switch(message->what) {
-	/*
-	case B_OBSERVER_NOTICE_CHANGE:
-		// The model changed
-		
-		int32 which;
-		
-		message->FindInt32("be:observe_change_what", &which);
-		
-		switch(which) {
-			case MSG_NOTIFY_ITEM_ADDED:
-				{
-					CTeamModelEntry *entry;
-					
-					if(message->FindPointer(MESSAGE_DATA_ID_ITEM, (void **)&entry) == B_OK) {
-						AddTeam(entry, true);
-					}
-				}
-				break;
-			case MSG_NOTIFY_ITEM_REMOVED:
-				{
-					CTeamModelEntry *entry;
-				
-					if(message->FindPointer(MESSAGE_DATA_ID_ITEM, (void **)&entry) == B_OK) {
-						RemoveTeam(entry);
-					}
-				}
-				break;
-		}
-		*/
 	case B_SET_PROPERTY:
 		{
 			int32 index;
@@ -1147,6 +1346,27 @@ void CProcessView::MessageReceived(BMessage *message)
 					
 					return;
 				}
+
+				if(strcmp(property, PROCESS_VIEW_PROP_SHOW_PROCESS_TREE) == 0 && 
+					what == B_DIRECT_SPECIFIER) {
+					// SET_PROPERTY for ShowProcessTree
+					
+					bool newShowProcessTree;
+					
+					status_t result = message->FindBool("data", &newShowProcessTree);
+
+					if(result == B_OK) {
+						message->PopSpecifier();
+
+						result = SetShowProcessTree(newShowProcessTree);
+					}
+					
+					BMessage reply(B_REPLY);
+					
+					send_script_reply(reply, result, message);
+					
+					return;
+				}
 			}
 			
 			CTabNotifcationView::MessageReceived(message);
@@ -1173,6 +1393,37 @@ void CProcessView::MessageReceived(BMessage *message)
 					
 					return;
 				}
+
+				if(strcmp(property, PROCESS_VIEW_PROP_SHOW_PROCESS_TREE) == 0 && 
+					what == B_DIRECT_SPECIFIER) {
+					// GET_PROPERTY for ShowProcessTree
+					
+					BMessage reply(B_REPLY);
+
+					reply.AddBool("result", showProcessTree);
+
+					send_script_reply(reply, B_OK, message);
+					message->PopSpecifier();
+					
+					return;
+				}
+
+				if( (strcmp(property, PROCESS_VIEW_PROP_SKIPPED_TEAMS) == 0 ||
+					 strcmp(property, PROCESS_VIEW_PROP_REFRESHED_TEAMS) == 0) && 
+					what == B_DIRECT_SPECIFIER) {
+					// GET_PROPERTY for SkippedTeams and RefreshedTeams
+					
+					BMessage reply(B_REPLY);
+
+					reply.AddInt32("result", 
+						strcmp(property, PROCESS_VIEW_PROP_SKIPPED_TEAMS) == 0 ? 
+							skippedCount : refreshedCount);
+
+					send_script_reply(reply, B_OK, message);
+					message->PopSpecifier();
+					
+					return;
+				}
 				
 				if(strcmp(property, PROCESS_VIEW_PROP_TEAM_MODEL) == 0 && 
 					what == B_DIRECT_SPECIFIER) {
@@ -1439,7 +1690,7 @@ void CProcessView::MessageReceived(BMessage *message)
 		{
 			// Context menu was closed. Enable sorting
 			sortItems = true;
-			listView->SortItems();
+			SortList();
 		}
 		break;
 	default:
@@ -1454,12 +1705,12 @@ void CProcessView::AddTeam(CTeamModelEntry *entry, bool sort)
 	if(hideSystemTeams && entry->IsSystemTeam()) {
 		// Don't add to list.
 	} else {
-		CProcessItem *item = new CProcessItem(entry);
+		CProcessItem *item = new CProcessItem(entry, this);
 		
 		listView->AddItem(item);
 
 		if(sort && sortItems) {
-			listView->SortItems();
+			SortList();
 		}
 	}
 }
@@ -1479,11 +1730,143 @@ void CProcessView::RemoveTeam(CTeamModelEntry *entry)
 	}
 }
 
+// compare function for BList::SortItems and bsearch
+static int compare_pointers(const void *a, const void *b)
+{
+	const void *pa = *(const void **)a;
+	const void *pb = *(const void **)b;
+
+	return (pa < pb) ? -1 : ((pa > pb) ? 1 : 0);
+}
+
+// TeamsChanged
+// Applies a batch of model changes to the list view. All removed
+// items are dropped in one pass over the list and the list is sorted
+// (or invalidated) only once for the whole batch.
+// While the view is hidden only the removed items are dropped (their
+// entries are deleted after this call). The rest is replayed from the
+// team journal by CatchUp(), when the view is shown again.
+void CProcessView::TeamsChanged(const CTeamModelBatch &batch)
+{
+	RemoveTeams(batch);
+
+	if(IsHidden())
+		return;
+
+	for(int32 i=0 ; i<batch.CountAdded() ; i++)
+		AddTeam(batch.AddedAt(i), false);
+
+	journalSequence = batch.Sequence();
+
+	if(updatingList) {
+		// UpdateListView() sorts the list afterwards.
+		return;
+	}
+
+	if(batch.CountAdded() > 0 && sortItems) {
+		SortList();
+	} else {
+		listView->Invalidate();
+	}
+}
+
+// RemoveTeams
+// Drops the items of all teams removed in 'batch'.
+void CProcessView::RemoveTeams(const CTeamModelBatch &batch)
+{
+	if(batch.CountRemoved() > 0) {
+		BList removed(batch.CountRemoved());
+
+		for(int32 i=0 ; i<batch.CountRemoved() ; i++)
+			removed.AddItem(batch.RemovedAt(i));
+
+		removed.SortItems(compare_pointers);
+
+		for(int i=0 ; i<listView->CountItems() ; i++) {
+			CProcessItem *processItem = dynamic_cast<CProcessItem *>(listView->ItemAt(i));
+		
+			MY_ASSERT(processItem != NULL);
+
+			CTeamModelEntry *entry = processItem->Entry();
+
+			if(bsearch(&entry, removed.Items(), removed.CountItems(), 
+				sizeof(void *), compare_pointers) != NULL) {
+				listView->RemoveItem(i--);
+				delete processItem;
+			}
+		}
+
+		// The parent items of the children may be gone.
+		if(showProcessTree)
+			LinkItems();
+	}
+}
+
+// CatchUp
+// Applies the team journal events the list missed while the view
+// was hidden. Falls back to rebuilding the list, if the journal has
+// overflowed since.
+void CProcessView::CatchUp()
+{
+	BAutolock teamModelAutoLocker(teamModel->Looper());
+
+	const CTeamJournal *journal = teamModel->Journal();
+
+	if(journalSequence == journal->LastSequence())
+		return;
+
+	if(!journal->CanReplay(journalSequence)) {
+		RebuildList();
+		return;
+	}
+
+	// Index the items, so every event is applied in constant time.
+	CIdIndex<CProcessItem> itemIndex(listView->CountItems()*2);
+
+	for(int32 i=0 ; i<listView->CountItems() ; i++) {
+		CProcessItem *item = (CProcessItem *)listView->ItemAt(i);
+
+		itemIndex.Insert(item->TeamId(), item, 0);
+	}
+
+	bool added = false;
+
+	for(int64 seq=journalSequence+1 ; seq<=journal->LastSequence() ; seq++) {
+		const team_event &event = journal->EventAt(seq);
+
+		// Removed items are already dropped by TeamsChanged().
+		if(event.type != TEAM_EVENT_ADDED || itemIndex.Find(event.team) != NULL)
+			continue;
+
+		// NULL, if the team was removed again later on.
+		CTeamModelEntry *entry = teamModel->FindEntry(event.team);
+
+		if(entry != NULL) {
+			AddTeam(entry, false);
+
+			CProcessItem *item = (CProcessItem *)listView->ItemAt(listView->CountItems()-1);
+
+			if(item != NULL && item->Entry() == entry)
+				itemIndex.Insert(event.team, item, 0);
+
+			added = true;
+		}
+	}
+
+	journalSequence = journal->LastSequence();
+
+	if(added && sortItems)
+		SortList();
+}
+
 void CProcessView::Select(BView *owner)
 {
 	// this method gets called, if the tab which contains this
 	// view is selected. 'owner' is a pointer to the BTabView.
 	
+	if(teamModel != NULL)
+		CatchUp();
+
 	UpdateListView();
 }
 
@@ -1506,42 +1889,92 @@ void CProcessView::UpdateListView()
 		return;
 
 	BAutolock teamModelAutoLocker(teamModel->Looper());
-	
-	system_info sysInfo;
+
+	// The snapshot is built by the sampler thread. Here I only
+	// apply it, so the window isn't locked during the kernel walk.
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(SNAPSHOT_ALL);
+
+	if(snapshot == NULL)
+		return;
+
+	// Update model
+	updatingList = true;
+	teamModel->Update(snapshot);
+	updatingList = false;
 
 	// maximum active time (commulated of all CPUs).
-	bigtime_t cpuActiveTime=0;
-	
-	bigtime_t timeSinceLastUpdate = (lastUpdateTime != 0) ? (system_time()-lastUpdateTime) : Window()->PulseRate();
+	bigtime_t timeSinceLastUpdate = (lastUpdateTime != 0) ?
+		(snapshot->TimeStamp()-lastUpdateTime) : Window()->PulseRate();
 		
-	if(get_system_info(&sysInfo) == B_OK) {
-		cpuActiveTime = sysInfo.cpu_count * timeSinceLastUpdate;
-	}	
+	bigtime_t cpuActiveTime = snapshot->SystemInfo().cpu_count * timeSinceLastUpdate;
 
 	// store time to calc time between updates (for next call)
-	lastUpdateTime = system_time();
+	lastUpdateTime = snapshot->TimeStamp();
 
 	// remeber old selection
 	CProcessItem *selItem = (CProcessItem *)listView->ItemAt(listView->CurrentSelection(0));
 
-	// Update model
-	teamModel->Update();
+	// Update entries. Unchanged teams are skipped and not redrawn.
+	skippedCount = refreshedCount = 0;
 
-	// Update entries	
 	for(int i=0 ; i<listView->CountItems() ; i++) {
 		CProcessItem *listViewItem = (CProcessItem *)listView->ItemAt(i);
 
-		listViewItem->Update(&sysInfo, cpuActiveTime);
+		if(listViewItem->Update(snapshot, cpuActiveTime)) {
+			refreshedCount++;
+
+			// Without the sorting the listview isn't updated.
+			if(!sortItems)
+				listView->InvalidateItem(i);
+		} else {
+			skippedCount++;
+		}
 	}
+
+	release_system_snapshot(snapshot);
+
+	UpdateTopTeams(cpuActiveTime);
 	
-	if(sortItems) {
-		listView->SortItems();
-	} else {
-		// Without the sorting the listview isn't updated.
-		listView->Invalidate();
-	}
+	if(refreshedCount > 0 && sortItems)
+		SortList();
 
 	// restore selection
 	int32 newSelection = listView->IndexOf(selItem);
 	listView->Select(newSelection);
 }
+
+// UpdateTopTeams
+// Shows the teams which used the most CPU time since the last update.
+// The list comes ranked from the team model, so no item is sorted.
+void CProcessView::UpdateTopTeams(bigtime_t cpuActiveTime)
+{
+	const int32 maxDisplayed = 3;
+
+	CTeamModelEntry *entries[CTeamModel::MAX_TOP_TEAMS];
+	int64 values[CTeamModel::MAX_TOP_TEAMS];
+
+	int32 count = teamModel->GetTopTeams(TOP_TEAMS_CPU, entries, 
+		CTeamModel::MAX_TOP_TEAMS, values);
+
+	BString text(B_TRANSLATE("Top:"));
+	int32 displayed = 0;
+
+	for(int32 i=0 ; i<count && displayed<maxDisplayed ; i++) {
+		if(values[i] <= 0)
+			continue;
+
+		if(hideSystemTeams && entries[i]->IsSystemTeam())
+			continue;
+
+		text << (displayed > 0 ? ", " : " ") << entries[i]->Name() << " "
+			 << (int32)(values[i] * 100 / MAX(cpuActiveTime, 1)) << "%";
+
+		displayed++;
+	}
+
+	if(displayed == 0)
+		text = "";
+
+	if(text != topTeamsView->Text())
+		topTeamsView->SetText(text.String());
+}
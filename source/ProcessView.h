@@ -53,6 +53,9 @@ extern column_info team_view_colomn_info[];
 
 // CProcessView
 extern const char * const PROCESS_VIEW_PROP_HIDE_SYSTEM_TEAMS;		// bool
+extern const char * const PROCESS_VIEW_PROP_SHOW_PROCESS_TREE;		// bool
+extern const char * const PROCESS_VIEW_PROP_SKIPPED_TEAMS;			// int32 (read only)
+extern const char * const PROCESS_VIEW_PROP_REFRESHED_TEAMS;		// int32 (read only)
 extern const char * const PROCESS_VIEW_PROP_TEAM_MODEL;				// BMessenger
 
 // ====== Message IDs ======
@@ -80,6 +83,7 @@ class CProcessItem;
 class CColumnListViewEx;
 class CTeamModel;
 class CTeamModelEntry;
+class CTeamModelBatch;
 class CTeamModelListener;
 
 class CProcessView : public CTabNotifcationView
@@ -101,6 +105,12 @@ class CProcessView : public CTabNotifcationView
 
 	void AddTeam(CTeamModelEntry *entry, bool sort);
 	void RemoveTeam(CTeamModelEntry *entry);
+	void TeamsChanged(const CTeamModelBatch &batch);
+	void RemoveTeams(const CTeamModelBatch &batch);
+	void CatchUp();
+	void RebuildList();
+	void SortList();
+	void LinkItems();
 
 	void KillTeamWithWarning(team_id id);
 	void ActivateTeam(team_id id);
@@ -108,9 +118,11 @@ class CProcessView : public CTabNotifcationView
 	void KillTeam(team_id id);
 
 	status_t SetHideSystemTeams(bool newValue);
+	status_t SetShowProcessTree(bool newValue);
 
 	void TeamSelected(int32 selIndex);
 	void UpdateListView();
+	void UpdateTopTeams(bigtime_t cpuActiveTime);
 	
 	int32 ShowWarning(const char *text, const char *button1, 
 				const char *prefName, bool asynchron=false, BMessage *msg=NULL);
@@ -119,14 +131,32 @@ class CProcessView : public CTabNotifcationView
 	// message is received.
 	bool				sortItems;		
 	
+	// Set during UpdateListView(), which sorts the list itself.
+	bool				updatingList;
+	
 	bool				hideSystemTeams;
+
+	// If set, the teams are ordered as process tree. Only
+	// siblings are sorted.
+	bool				showProcessTree;
+
+	// Sequence number of the last team journal event applied
+	// to the list.
+	int64				journalSequence;
+
+	// Number of items skipped (or refreshed) by CProcessItem::Update()
+	// during the last UpdateListView().
+	int32				skippedCount;
+	int32				refreshedCount;
 	bigtime_t			lastUpdateTime;
 	CColumnListViewEx  *listView;
 	BButton			   *killButton, *selectTeamButton;
+	BStringView		   *topTeamsView;
 	CTeamModel		   *teamModel;
 	CTeamModelListener *teamModelListener;
 	
 	friend class CTeamModelListener;
+	friend class CProcessItem;
 };
 
 #endif // PROCESS_VIEW_H
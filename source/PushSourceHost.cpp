@@ -0,0 +1,155 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "common.h"
+#include "my_assert.h"
+#include "PushSourceHost.h"
+
+// ====== CPushSourceHost::CSource ======
+
+CPushSourceHost::CSource::CSource(int32 _id, const char *_name, int32 _channelCount)
+{
+	id				= _id;
+	name			= _name;
+	channelCount	= _channelCount;
+	latest			= new data_sample[channelCount];
+	latestValid		= new bool[channelCount];
+	
+	for(int32 i=0 ; i<channelCount ; i++)
+		latestValid[i] = false;
+}
+
+CPushSourceHost::CSource::~CSource()
+{
+	delete [] latest;
+	delete [] latestValid;
+}
+
+// Drain
+// Reads the samples, which are in the ring when the drain starts.
+// Samples written meanwhile are left for the next drain, so this
+// never takes longer than reading one full ring. Samples with an
+// invalid channel are ignored.
+void CPushSourceHost::CSource::Drain()
+{
+	ring_sample sample;
+
+	int32 count = ring.CountReadable();
+
+	for(int32 i=0 ; i<count && ring.Read(sample) ; i++) {
+		if(sample.channel < 0 || sample.channel >= channelCount)
+			continue;
+			
+		if(sample.valid) {
+			latest[sample.channel].value		= sample.value;
+			latest[sample.channel].timeStamp	= sample.timeStamp;
+		}
+		
+		latestValid[sample.channel] = sample.valid != 0;
+	}
+}
+
+// ====== CPushSourceHost ======
+
+CPushSourceHost::CPushSourceHost() :
+	locker("PushSourceHost")
+{
+	nextSourceId	= 1;
+	lastDrain		= 0;
+}
+
+CPushSourceHost::~CPushSourceHost()
+{
+}
+
+int32 CPushSourceHost::RegisterPushSource(const char *name, area_id ringArea, 
+	int32 channelCount)
+{
+	if(name == NULL || channelCount <= 0)
+		return B_BAD_VALUE;
+
+	BAutolock autoLocker(locker);
+	
+	CSource *source = new CSource(nextSourceId, name, channelCount);
+	
+	status_t status = source->Attach(ringArea);
+	
+	if(status != B_OK) {
+		delete source;
+		return status;
+	}
+	
+	sources.AddItem(source);
+	
+	return nextSourceId++;
+}
+
+void CPushSourceHost::UnregisterPushSource(int32 sourceId)
+{
+	BAutolock autoLocker(locker);
+
+	CSource *source = FindSource(sourceId);
+	
+	if(source) {
+		sources.RemoveItem(source);
+		delete source;
+	}
+}
+
+bool CPushSourceHost::GetLatestSample(int32 sourceId, int32 channel, data_sample &sample)
+{
+	BAutolock autoLocker(locker);
+	
+	DrainIfNeeded();
+	
+	CSource *source = FindSource(sourceId);
+	
+	if(source == NULL || channel < 0 || channel >= source->channelCount ||
+	   !source->latestValid[channel])
+		return false;
+		
+	sample = source->latest[channel];
+	
+	return true;
+}
+
+// DrainIfNeeded
+// Drains the rings of all sources, if that wasn't done in this tick.
+// The locker must be held.
+void CPushSourceHost::DrainIfNeeded()
+{
+	bigtime_t now = system_time();
+	
+	if(now - lastDrain < FAST_PULSE_RATE/2)
+		return;
+		
+	for(int32 i=0 ; i<sources.CountItems() ; i++)
+		sources.ItemAt(i)->Drain();
+		
+	lastDrain = now;
+}
+
+CPushSourceHost::CSource *CPushSourceHost::FindSource(int32 sourceId)
+{
+	for(int32 i=0 ; i<sources.CountItems() ; i++) {
+		if(sources.ItemAt(i)->id == sourceId)
+			return sources.ItemAt(i);
+	}
+	
+	return NULL;
+}
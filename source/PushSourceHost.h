@@ -0,0 +1,67 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUSH_SOURCE_HOST_H
+#define PUSH_SOURCE_HOST_H
+
+#include "PointerList.h"
+#include "PerformanceCounter.h"
+#include "SampleRing.h"
+
+//: Host side of the push sources of the plugins.
+// The rings of all sources are drained at most once per half fast pulse,
+// by the first GetLatestSample() call of a tick. Only the latest sample
+// of each channel is kept.
+class CPushSourceHost : public ICounterPluginHost
+{
+	public:
+	CPushSourceHost();
+	virtual ~CPushSourceHost();
+
+	virtual int32 RegisterPushSource(const char *name, area_id ringArea, 
+							int32 channelCount);
+	virtual void UnregisterPushSource(int32 sourceId);
+	virtual bool GetLatestSample(int32 sourceId, int32 channel, data_sample &sample);
+
+	protected:
+	class CSource
+	{
+		public:
+		CSource(int32 _id, const char *_name, int32 _channelCount);
+		~CSource();
+		
+		status_t Attach(area_id ringArea) { return ring.Clone(ringArea); }
+		void Drain();
+		
+		int32			 id;
+		BString			 name;
+		CSampleRing		 ring;
+		int32			 channelCount;
+		data_sample		*latest;			// latest sample per channel
+		bool			*latestValid;
+	};
+	
+	void DrainIfNeeded();
+	CSource *FindSource(int32 sourceId);
+
+	BLocker					locker;
+	CPointerList<CSource>	sources;
+	int32					nextSourceId;
+	bigtime_t				lastDrain;
+};
+
+#endif // PUSH_SOURCE_HOST_H
@@ -0,0 +1,678 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#include "pch.h"
+#include "alert.h"
+#include "help.h"
+#include "my_assert.h"
+#include "RemotePlugin.h"
+
+#include <Catalog.h>
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "RemotePlugin"
+
+extern char **environ;
+
+// ==== CRemotePlugin ====
+
+CRemotePlugin::CRemotePlugin(const char *_path, bigtime_t _deadline, CPushSourceHost *_pushHost) :
+	requestLocker("RemotePluginRequest"),
+	channelLocker("RemotePluginChannels")
+{
+	path			= _path;
+	deadline		= _deadline;
+	pushHost		= _pushHost;
+	hostState		= HOST_FAILED;
+	startTime		= 0;
+	hostThread		= -1;
+	requestPort		= -1;
+	replyPort		= -1;
+	sourceId		= -1;
+	nextSerial		= 0;
+	nextChannel		= 0;
+	
+	for(int32 i=0 ; i<PLUGIN_HOST_CHANNEL_COUNT ; i++)
+		channelUsed[i] = false;
+}
+
+CRemotePlugin::~CRemotePlugin()
+{
+	if(requestPort >= 0) {
+		BMessage quit(PLUGIN_HOST_QUIT);
+		
+		send_plugin_host_message(requestPort, &quit, 0);
+	}
+	
+	if(hostThread >= 0) {
+		status_t exitValue;
+	
+		// A hanging plugin may prevent the host from quitting. A host,
+		// which didn't report yet, quits when the reply port is gone.
+		if(hostState != HOST_RUNNING)
+			kill_team(hostThread);
+		else if(wait_for_thread_etc(hostThread, B_RELATIVE_TIMEOUT, deadline, &exitValue) != B_OK)
+			kill_team(hostThread);
+	}
+	
+	if(sourceId >= 0)
+		pushHost->UnregisterPushSource(sourceId);
+		
+	if(replyPort >= 0)
+		delete_port(replyPort);
+}
+
+// Start
+// Launches the host process. The id of the main thread of the new team
+// is also the id of the team. The ready message of the host is picked
+// up by CheckHost().
+status_t CRemotePlugin::Start()
+{
+	replyPort = create_port(PLUGIN_HOST_PORT_CAPACITY, "PluginHost reply");
+	
+	if(replyPort < B_OK)
+		return replyPort;
+	
+	BPath hostPath = get_app_dir();
+	
+	hostPath.Append(PLUGIN_HOST_EXECUTABLE);
+	
+	BString portString;
+	
+	portString << replyPort;
+	
+	const char *args[] = { hostPath.Path(), path.String(), portString.String(), NULL };
+	
+	hostThread = load_image(3, args, (const char **)environ);
+	
+	if(hostThread < B_OK)
+		return hostThread;
+		
+	RETURN_IF_FAILED(resume_thread(hostThread));
+	
+	startTime = system_time();
+	hostState = HOST_STARTING;
+	
+	return B_OK;
+}
+
+// CheckHost
+// Returns B_OK, if the host is running. While it's starting, its
+// ready message is looked for without waiting. A host, which doesn't
+// report within PLUGIN_HOST_START_TIMEOUT, is killed. The failure is
+// reported once. The requestLocker must be held.
+status_t CRemotePlugin::CheckHost()
+{
+	if(hostState == HOST_STARTING) {
+		BMessage ready;
+		
+		if(receive_plugin_host_message(replyPort, &ready, 0) == B_OK &&
+		   ready.what == PLUGIN_HOST_READY) {
+			HostStarted(&ready);
+		} else if(system_time() - startTime > PLUGIN_HOST_START_TIMEOUT) {
+			kill_team(hostThread);
+			hostThread = -1;
+			hostState = HOST_FAILED;
+		
+			BString message(B_TRANSLATE("Can't start the plugin host for '\0'\nReason: \1"));
+		
+			message << path
+					<< strerror(B_TIMED_OUT);
+				
+			show_alert_async(message, NULL);
+		}
+	}
+	
+	switch(hostState) {
+		case HOST_STARTING:
+			return B_WOULD_BLOCK;
+		case HOST_RUNNING:
+			return B_OK;
+		default:
+			return B_NO_INIT;
+	}
+}
+
+// HostStarted
+// Handles the ready message of the host.
+void CRemotePlugin::HostStarted(BMessage *ready)
+{
+	status_t status = ready->FindInt32(PLUGIN_HOST_STATUS);
+	
+	if(status == B_OK) {
+		sourceId = pushHost->RegisterPushSource(path.String(), 
+			ready->FindInt32(PLUGIN_HOST_RING), PLUGIN_HOST_CHANNEL_COUNT);
+	
+		if(sourceId < B_OK) {
+			status = sourceId;
+			sourceId = -1;
+		}
+	}
+	
+	if(status != B_OK) {
+		hostState = HOST_FAILED;
+		
+		BString message(B_TRANSLATE("Can't start the plugin host for '\0'\nReason: \1"));
+		
+		message << path
+				<< strerror(status);
+				
+		show_alert_async(message, NULL);
+		
+		return;
+	}
+	
+	requestPort = ready->FindInt32(PLUGIN_HOST_PORT);
+	hostState	= HOST_RUNNING;
+}
+
+status_t CRemotePlugin::EnumChildren(IPerformanceCounterNamespace *counterNamespace, 
+	const char *parentPath, BList *children)
+{
+	// The namespace stops at the first plugin returning an error.
+	GetChildren(counterNamespace, parentPath, children);
+	
+	return B_OK;
+}
+
+status_t CRemotePlugin::GetChildren(IPerformanceCounterNamespace *counterNamespace, 
+	const char *parentPath, BList *children)
+{
+	BAutolock autoLocker(requestLocker);
+	
+	CEnumeration *enumeration = FindEnumeration(parentPath);
+	
+	if(enumeration == NULL) {
+		enumeration = new CEnumeration(parentPath);
+		enumerations.AddItem(enumeration);
+	}
+	
+	if(enumeration->serial >= 0) {
+		BMessage reply;
+		status_t status = TakeReply(enumeration->serial, &reply);
+		
+		if(status != B_WOULD_BLOCK)
+			enumeration->serial = -1;
+		
+		if(status == B_OK) {
+			enumeration->reply		= reply;
+			enumeration->answered	= true;
+		}
+	}
+	
+	if(enumeration->serial < 0) {
+		// Ask again, so the next enumeration gets the current children.
+		BMessage request(PLUGIN_HOST_ENUM_CHILDREN);
+	
+		request.AddString(PLUGIN_HOST_PATH, parentPath);
+		
+		int32 serial = SendRequest(&request);
+		
+		if(serial >= 0)
+			enumeration->serial = serial;
+	}
+	
+	if(!enumeration->answered)
+		return B_WOULD_BLOCK;
+	
+	AddChildren(counterNamespace, parentPath, &enumeration->reply, children);
+	
+	return B_OK;
+}
+
+// AddChildren
+// Creates the counters of an enumeration reply.
+void CRemotePlugin::AddChildren(IPerformanceCounterNamespace *counterNamespace, 
+	const char *parentPath, BMessage *reply, BList *children)
+{
+	const char *name;
+	
+	for(int32 i=0 ; reply->FindString(PLUGIN_HOST_NAME_FIELD, i, &name) == B_OK ; i++) {
+		const char *internalName = reply->FindString(PLUGIN_HOST_INTERNAL_NAME, i);
+		CRemoteDataProvider *provider = NULL;
+
+		if(reply->FindBool(PLUGIN_HOST_HAS_PROVIDER, i)) {
+			BString counterPath = parentPath;
+			BMessage archive;
+			
+			if(counterPath[counterPath.Length()-1] != '/')
+				counterPath.Append("/");
+				
+			counterPath.Append(internalName);
+		
+			reply->FindMessage(PLUGIN_HOST_ARCHIVE, i, &archive);
+		
+			provider = new CRemoteDataProvider(this, counterPath.String(),
+				archive.IsEmpty() ? NULL : &archive,
+				reply->FindInt32(PLUGIN_HOST_FLAGS, i),
+				reply->FindInt32(PLUGIN_HOST_UNIT, i),
+				reply->FindString(PLUGIN_HOST_DISPLAY_NAME, i));
+		}
+		
+		children->AddItem(new CRemoteCounter(counterNamespace, this, parentPath, 
+			name, internalName, provider));
+	}
+}
+
+IDataProvider *CRemotePlugin::InstantiateProvider(BMessage *archive)
+{
+	return new CRemoteDataProvider(this, archive);
+}
+
+// Subscribe
+// Asks the host to sample 'provider'. Returns the channel of the
+// samples or -1. The host isn't waited for. Channels are allocated
+// round robin, so samples of a former subscription, which are still
+// in the ring, aren't taken for samples of a new one.
+int32 CRemotePlugin::Subscribe(const CRemoteDataProvider *provider)
+{
+	{
+		BAutolock autoLocker(requestLocker);
+	
+		if(CheckHost() != B_OK)
+			return -1;
+	}
+
+	BAutolock autoLocker(channelLocker);
+	
+	int32 channel = -1;
+	
+	for(int32 i=0 ; i<PLUGIN_HOST_CHANNEL_COUNT ; i++) {
+		int32 candidate = (nextChannel + i) % PLUGIN_HOST_CHANNEL_COUNT;
+		
+		if(!channelUsed[candidate]) {
+			channel = candidate;
+			break;
+		}
+	}
+	
+	if(channel < 0)
+		return -1;
+		
+	BMessage request(PLUGIN_HOST_SUBSCRIBE);
+	
+	request.AddInt32(PLUGIN_HOST_CHANNEL, channel);
+	
+	// The host can instantiate an archive faster than
+	// it can look up a counter path.
+	if(provider->ProviderArchive())
+		request.AddMessage(PLUGIN_HOST_ARCHIVE, provider->ProviderArchive());
+	else
+		request.AddString(PLUGIN_HOST_PATH, provider->CounterPath());
+	
+	if(send_plugin_host_message(requestPort, &request, 0) != B_OK)
+		return -1;
+		
+	channelUsed[channel]	= true;
+	nextChannel				= (channel + 1) % PLUGIN_HOST_CHANNEL_COUNT;
+	
+	return channel;
+}
+
+void CRemotePlugin::Unsubscribe(int32 channel)
+{
+	BAutolock autoLocker(channelLocker);
+
+	BMessage request(PLUGIN_HOST_UNSUBSCRIBE);
+	
+	request.AddInt32(PLUGIN_HOST_CHANNEL, channel);
+	
+	send_plugin_host_message(requestPort, &request, 0);
+	
+	channelUsed[channel] = false;
+}
+
+// GetLatestSample
+// Samples older than the deadline are invalid. They are left over
+// by a plugin, which hangs.
+bool CRemotePlugin::GetLatestSample(int32 channel, data_sample &sample)
+{
+	if(sourceId < 0 || !pushHost->GetLatestSample(sourceId, channel, sample))
+		return false;
+		
+	return system_time() - sample.timeStamp <= deadline;
+}
+
+// SendRequest
+// The request isn't sent, while an abandoned request is outstanding,
+// so a hanging plugin costs the deadline only once and not for every
+// request.
+int32 CRemotePlugin::SendRequest(BMessage *request)
+{
+	BAutolock autoLocker(requestLocker);
+
+	RETURN_IF_FAILED(CheckHost());
+	
+	ReceiveReplies();
+
+	for(int32 i=0 ; i<requests.CountItems() ; i++) {
+		if(requests.ItemAt(i)->abandoned)
+			return B_TIMED_OUT;
+	}
+
+	int32 serial = nextSerial++;
+	
+	request->AddInt32(PLUGIN_HOST_SERIAL, serial);
+	
+	RETURN_IF_FAILED(send_plugin_host_message(requestPort, request, 0));
+	
+	requests.AddItem(new CRequest(serial));
+	
+	return serial;
+}
+
+status_t CRemotePlugin::TakeReply(int32 serial, BMessage *reply)
+{
+	BAutolock autoLocker(requestLocker);
+	
+	ReceiveReplies();
+	
+	CRequest *request = FindRequest(serial);
+	
+	if(request == NULL || request->abandoned)
+		return B_TIMED_OUT;
+		
+	if(request->answered) {
+		*reply = request->reply;
+		
+		requests.RemoveItem(request);
+		delete request;
+		
+		return reply->FindInt32(PLUGIN_HOST_STATUS);
+	}
+	
+	if(system_time() - request->sent > deadline) {
+		// The reply is dropped, when it arrives.
+		request->abandoned = true;
+		return B_TIMED_OUT;
+	}
+	
+	return B_WOULD_BLOCK;
+}
+
+// ReceiveReplies
+// Picks up the replies, which arrived, without waiting. Replies to
+// abandoned requests are dropped. The requestLocker must be held.
+void CRemotePlugin::ReceiveReplies()
+{
+	if(hostState != HOST_RUNNING)
+		return;
+
+	BMessage reply;
+
+	while(receive_plugin_host_message(replyPort, &reply, 0) == B_OK) {
+		CRequest *request;
+	
+		if(reply.what != PLUGIN_HOST_REPLY || 
+		   (request = FindRequest(reply.FindInt32(PLUGIN_HOST_SERIAL))) == NULL)
+			continue;
+			
+		if(request->abandoned) {
+			requests.RemoveItem(request);
+			delete request;
+		} else {
+			request->reply		= reply;
+			request->answered	= true;
+		}
+	}
+}
+
+CRemotePlugin::CRequest *CRemotePlugin::FindRequest(int32 serial)
+{
+	for(int32 i=0 ; i<requests.CountItems() ; i++) {
+		if(requests.ItemAt(i)->serial == serial)
+			return requests.ItemAt(i);
+	}
+	
+	return NULL;
+}
+
+CRemotePlugin::CEnumeration *CRemotePlugin::FindEnumeration(const char *parentPath)
+{
+	for(int32 i=0 ; i<enumerations.CountItems() ; i++) {
+		if(enumerations.ItemAt(i)->path == parentPath)
+			return enumerations.ItemAt(i);
+	}
+	
+	return NULL;
+}
+
+// ==== CRemoteCounter ====
+
+CRemoteCounter::CRemoteCounter(IPerformanceCounterNamespace *ns, CRemotePlugin *_plugin,
+	const char *parentPath, const char *_name, const char *_internalName,
+	CRemoteDataProvider *_dataProvider)
+{
+	namesp			= ns;
+	plugin			= _plugin;
+	name			= _name;
+	internalName	= _internalName;
+	dataProvider	= _dataProvider;
+	initChildren	= true;
+	
+	path = parentPath;
+	
+	if(path[path.Length()-1] != '/')
+		path.Append("/");
+		
+	path.Append(internalName);
+}
+
+CRemoteCounter::~CRemoteCounter()
+{
+	delete dataProvider;
+}
+
+int32 CRemoteCounter::CountChildren()
+{
+	InitChildren();
+	return children.CountItems();
+}
+
+IPerformanceCounter *CRemoteCounter::ChildAt(int32 i)
+{
+	InitChildren();
+	return children.ItemAt(i);
+}
+
+IDataProvider *CRemoteCounter::DataProvider()
+{
+	return dataProvider;
+}
+
+void CRemoteCounter::InitChildren()
+{
+	if(initChildren) {
+		BList newChildren;
+		
+		if(plugin->GetChildren(namesp, path.String(), &newChildren) == B_WOULD_BLOCK)
+			return;
+		
+		for(int32 i=0 ; i<newChildren.CountItems() ; i++)
+			children.AddItem((IPerformanceCounter *)newChildren.ItemAt(i));
+		
+		initChildren = false;
+	}
+}
+
+// ==== CRemoteDataProvider ====
+
+CRemoteDataProvider::CRemoteDataProvider(CRemotePlugin *_plugin, const char *_counterPath,
+	BMessage *_archive, uint32 _flags, uint32 _unit, const char *_displayName)
+{
+	plugin		= _plugin;
+	counterPath	= _counterPath;
+	hasArchive	= _archive != NULL;
+	flags		= _flags;
+	unit		= _unit;
+	displayName	= _displayName;
+	described	= true;
+	describeSerial = -1;
+	channel		= -1;
+	
+	if(hasArchive)
+		archive = *_archive;
+}
+
+CRemoteDataProvider::CRemoteDataProvider(CRemotePlugin *_plugin, BMessage *_archive)
+{
+	plugin		= _plugin;
+	archive		= *_archive;
+	hasArchive	= true;
+	flags		= 0;
+	unit		= DP_UNIT_NONE;
+	described	= false;
+	describeSerial = -1;
+	channel		= -1;
+	
+	// Shown until the host described the provider.
+	displayName	= archive.FindString("class");
+}
+
+CRemoteDataProvider::~CRemoteDataProvider()
+{
+	if(channel >= 0)
+		plugin->Unsubscribe(channel);
+}
+
+bool CRemoteDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+	
+	bool valid = GetNextSample(sample);
+	
+	value = sample.value;
+	
+	return valid;
+}
+
+bool CRemoteDataProvider::GetNextSample(data_sample &sample)
+{
+	sample.value		= 0.0;
+	sample.timeStamp	= system_time();
+
+	// Relative values can't be normalized without the flags.
+	if(!Describe())
+		return false;
+
+	if(channel < 0) {
+		// The first sample arrives with the next sampling of the host.
+		channel = plugin->Subscribe(this);
+		
+		return false;
+	}
+	
+	return plugin->GetLatestSample(channel, sample);
+}
+
+// Describe
+// Returns true, if the flags, unit and name are known. Otherwise the
+// host is asked for them. The reply is picked up by a later call.
+bool CRemoteDataProvider::Describe()
+{
+	if(described)
+		return true;
+		
+	if(describeSerial < 0) {
+		BMessage request(PLUGIN_HOST_DESCRIBE);
+	
+		request.AddMessage(PLUGIN_HOST_ARCHIVE, &archive);
+		
+		describeSerial = plugin->SendRequest(&request);
+		
+		return false;
+	}
+	
+	BMessage reply;
+	status_t status = plugin->TakeReply(describeSerial, &reply);
+	
+	if(status == B_WOULD_BLOCK)
+		return false;
+	
+	describeSerial = -1;
+	
+	if(status == B_TIMED_OUT)
+		return false;
+		
+	if(status != B_OK) {
+		// The host can't instantiate the archive. Don't ask again. The
+		// subscription won't deliver samples either.
+		described = true;
+		return true;
+	}
+		
+	flags		= reply.FindInt32(PLUGIN_HOST_FLAGS);
+	unit		= reply.FindInt32(PLUGIN_HOST_UNIT);
+	displayName	= reply.FindString(PLUGIN_HOST_DISPLAY_NAME);
+	described	= true;
+	
+	return true;
+}
+
+IDataProvider *CRemoteDataProvider::Clone()
+{
+	if(!described)
+		return new CRemoteDataProvider(plugin, &archive);
+
+	return new CRemoteDataProvider(plugin, counterPath.String(), 
+		hasArchive ? &archive : NULL, flags, unit, displayName.String());
+}
+
+// equal_flattened
+// Compares two messages by their flattened data.
+static bool equal_flattened(const BMessage &a, const BMessage &b)
+{
+	ssize_t size = a.FlattenedSize();
+	
+	if(size != b.FlattenedSize())
+		return false;
+		
+	char *bufferA = new char[size];
+	char *bufferB = new char[size];
+	
+	bool equal = a.Flatten(bufferA, size) == B_OK && 
+				 b.Flatten(bufferB, size) == B_OK &&
+				 memcmp(bufferA, bufferB, size) == 0;
+				 
+	delete [] bufferA;
+	delete [] bufferB;
+	
+	return equal;
+}
+
+bool CRemoteDataProvider::Equal(IDataProvider *other)
+{
+	CRemoteDataProvider *o = dynamic_cast<CRemoteDataProvider *>(other);
+	
+	if(o == NULL || o->plugin != plugin)
+		return false;
+	
+	if(hasArchive && o->hasArchive)
+		return equal_flattened(archive, o->archive);
+		
+	return counterPath.Length() > 0 && counterPath == o->counterPath;
+}
+
+status_t CRemoteDataProvider::Archive(BMessage *data, bool deep) const
+{
+	if(!hasArchive)
+		return B_ERROR;
+		
+	*data = archive;
+	
+	return B_OK;
+}
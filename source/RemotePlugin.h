@@ -0,0 +1,215 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef REMOTE_PLUGIN_H
+#define REMOTE_PLUGIN_H
+
+#include "PointerList.h"
+#include "PerformanceCounter.h"
+#include "PushSourceHost.h"
+#include "PluginHostProtocol.h"
+
+class CRemoteDataProvider;
+
+//: Plugin running in a plugin host process.
+// Nothing waits for the host. Start() only launches it, requests are
+// sent without waiting and their replies are picked up by later
+// calls. Until the host answered, an enumeration returns the last
+// known children or none. Data providers are sampled by the host,
+// which pushes the samples into a ring drained by 'pushHost'. A request
+// which isn't answered within 'deadline' is abandoned. No new requests
+// are sent, until the host answers it, so a plugin which hangs in the
+// host only loses its counters and samples.
+class CRemotePlugin : public IPerformanceCounterPlugin
+{
+	public:
+	CRemotePlugin(const char *path, bigtime_t deadline, CPushSourceHost *pushHost);
+	virtual ~CRemotePlugin();
+
+	// Launches the host process. The host reports, when it loaded the
+	// plugin. Requests before that are answered with B_WOULD_BLOCK.
+	status_t Start();
+
+	// Returns the children of the last answered enumeration of 'path'
+	// and asks the host again.
+	virtual status_t EnumChildren(IPerformanceCounterNamespace *counterNamespace, 
+							const char *path, BList *children);
+	// Like EnumChildren(), but returns B_WOULD_BLOCK, if the host
+	// didn't answer an enumeration of 'path' yet.
+	status_t GetChildren(IPerformanceCounterNamespace *counterNamespace, 
+							const char *path, BList *children);
+
+	// Creates a data provider from an archive of a class of the
+	// plugin. The provider asks the host for its flags, unit and
+	// name (see CRemoteDataProvider).
+	IDataProvider *InstantiateProvider(BMessage *archive);
+
+	// Sends 'request' to the host. Returns the serial of the request
+	// or an error code.
+	int32 SendRequest(BMessage *request);
+	// Returns B_OK and the reply, if the host answered the request
+	// 'serial'. Returns B_WOULD_BLOCK, if the reply is still outstanding,
+	// or B_TIMED_OUT, if the request was abandoned.
+	status_t TakeReply(int32 serial, BMessage *reply);
+
+	// Used by CRemoteDataProvider.
+	int32 Subscribe(const CRemoteDataProvider *provider);
+	void Unsubscribe(int32 channel);
+	bool GetLatestSample(int32 channel, data_sample &sample);
+
+	protected:
+	//: Request sent to the host.
+	class CRequest
+	{
+		public:
+		CRequest(int32 _serial) 
+			{ serial = _serial; sent = system_time(); answered = abandoned = false; }
+		
+		int32		serial;
+		bigtime_t	sent;
+		bool		answered;
+		bool		abandoned;		// deadline passed before the reply arrived
+		BMessage	reply;
+	};
+	
+	//: Cached enumeration of a path.
+	class CEnumeration
+	{
+		public:
+		CEnumeration(const char *_path) { path = _path; serial = -1; answered = false; }
+		
+		BString		path;
+		int32		serial;			// serial of the outstanding request or -1
+		bool		answered;
+		BMessage	reply;			// last answer
+	};
+
+	enum host_state {
+		HOST_STARTING,
+		HOST_RUNNING,
+		HOST_FAILED,
+	};
+
+	status_t CheckHost();
+	void HostStarted(BMessage *ready);
+	void ReceiveReplies();
+	CRequest *FindRequest(int32 serial);
+	CEnumeration *FindEnumeration(const char *path);
+	void AddChildren(IPerformanceCounterNamespace *counterNamespace, 
+			const char *parentPath, BMessage *reply, BList *children);
+
+	BString				 path;
+	bigtime_t			 deadline;
+	CPushSourceHost		*pushHost;
+	host_state			 hostState;
+	bigtime_t			 startTime;
+	thread_id			 hostThread;			// main thread of the host team
+	port_id				 requestPort;			// owned by the host
+	port_id				 replyPort;
+	int32				 sourceId;				// push source of the ring
+	
+	BLocker						 requestLocker;		// guards the members below
+	int32						 nextSerial;
+	CPointerList<CRequest>		 requests;
+	CPointerList<CEnumeration>	 enumerations;
+	
+	BLocker				 channelLocker;
+	bool				 channelUsed[PLUGIN_HOST_CHANNEL_COUNT];
+	int32				 nextChannel;
+};
+
+//: Counter of a CRemotePlugin.
+// The children are enumerated by the host, when they are
+// requested for the first time.
+class CRemoteCounter : public IPerformanceCounter
+{
+	public:
+	CRemoteCounter(IPerformanceCounterNamespace *ns, CRemotePlugin *plugin,
+		const char *parentPath, const char *name, const char *internalName,
+		CRemoteDataProvider *dataProvider);
+	virtual ~CRemoteCounter();
+
+	virtual int32 CountChildren();
+	virtual IPerformanceCounter *ChildAt(int32 i);
+	virtual IDataProvider *DataProvider();
+	virtual const char *Name() const { return name.String(); }
+	virtual const char *Path() const { return path.String(); }
+	virtual const char *InternalName() const { return internalName.String(); }
+
+	protected:
+	// The children are enumerated again, until the host answered.
+	void InitChildren();
+
+	IPerformanceCounterNamespace		*namesp;
+	CRemotePlugin						*plugin;
+	BString								 name;
+	BString								 internalName;
+	BString								 path;
+	CRemoteDataProvider					*dataProvider;
+	CPointerList<IPerformanceCounter>	 children;
+	bool								 initChildren;
+};
+
+//: Data provider sampled by the plugin host.
+// The subscription is sent to the host by the first GetNextSample(),
+// so providers which are only displayed in the counter tree don't
+// cost anything. The provider is identified by its counter path or,
+// if it was instantiated from an archive, by that archive. Providers
+// instantiated from an archive don't know their flags, unit and name,
+// until the host described them. They have no valid samples until then.
+class CRemoteDataProvider : public IDataProvider, public BArchivable,
+	public ISampledDataProvider
+{
+	public:
+	CRemoteDataProvider(CRemotePlugin *plugin, const char *counterPath,
+		BMessage *archive, uint32 flags, uint32 unit, const char *displayName);
+	// Provider, which isn't described yet.
+	CRemoteDataProvider(CRemotePlugin *plugin, BMessage *archive);
+	virtual ~CRemoteDataProvider();
+
+	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
+	virtual uint32 Flags() { Describe(); return flags; }
+	virtual uint32 Unit() { Describe(); return unit; }
+	virtual BString DisplayName() { Describe(); return displayName; }
+	
+	virtual IDataProvider *Clone();
+	virtual bool Equal(IDataProvider *other);
+
+	// Returns the archive of the provider in the host, so the
+	// archive can be instantiated without the plugin host, too.
+	virtual status_t Archive(BMessage *archive, bool deep) const;
+
+	const char *CounterPath() const { return counterPath.String(); }
+	const BMessage *ProviderArchive() const { return hasArchive ? &archive : NULL; }
+
+	protected:
+	bool Describe();
+
+	CRemotePlugin	*plugin;
+	BString			 counterPath;		// empty, if instantiated from an archive
+	BMessage		 archive;
+	bool			 hasArchive;
+	uint32			 flags;
+	uint32			 unit;
+	BString			 displayName;
+	bool			 described;			// false, until flags, unit and name are known
+	int32			 describeSerial;	// serial of the describe request or -1
+	int32			 channel;			// -1 if not subscribed
+};
+
+#endif // REMOTE_PLUGIN_H
@@ -0,0 +1,481 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "signature.h"
+#include "my_assert.h"
+#include "ReplayDataProvider.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ====== Globals ======
+
+const char * const REPLAY_ARCHIVE_PATH					= "REPLAY:Path";
+const char * const REPLAY_ARCHIVE_SPEED					= "REPLAY:Speed";
+const char * const REPLAY_ARCHIVE_START_TIME			= "REPLAY:StartTime";
+
+const char * const REPLAY_DATA_PROVIDER_ARCHIVE_NAME	= "REPLAY:Name";
+
+// Records are padded to a multiple of 8 bytes.
+static size_t record_size(size_t size)
+{
+	return (sizeof(session_record) + size + 7) & ~7;
+}
+
+// ====== CSessionRecording ======
+
+CSessionRecording::CSessionRecording(const char *_path)
+{
+	refCount	= 1;
+	path		= _path;
+	address		= NULL;
+	size		= 0;
+	startTime	= 0;
+	status		= B_OK;
+	
+	fd = open(_path, O_RDONLY);
+	
+	if(fd < 0) {
+		status = errno;
+		return;
+	}
+	
+	struct stat st;
+	
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(session_file_header)) {
+		status = B_BAD_DATA;
+		return;
+	}
+	
+	size = st.st_size;
+
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if(mapping == MAP_FAILED) {
+		status = errno;
+		return;
+	}
+	
+	address = (uint8 *)mapping;
+	
+	const session_file_header *header = (const session_file_header *)address;
+	
+	if(header->magic != SESSION_MAGIC || header->version != SESSION_VERSION) {
+		status = B_BAD_DATA;
+		return;
+	}
+	
+	startTime = header->startTime;
+	
+	BuildIndex();
+}
+
+CSessionRecording::~CSessionRecording()
+{
+	if(address)
+		munmap(address, size);
+		
+	if(fd >= 0)
+		close(fd);
+}
+
+void CSessionRecording::Acquire()
+{
+	atomic_add(&refCount, 1);
+}
+
+// Release
+// Deletes the recording with the last reference.
+void CSessionRecording::Release()
+{
+	if(atomic_add(&refCount, -1) == 1)
+		delete this;
+}
+
+// BuildIndex
+// Walks all records of the file and adds each sample to the index of
+// its counter.
+void CSessionRecording::BuildIndex()
+{
+	size_t pos = sizeof(session_file_header);
+	
+	while(pos + sizeof(session_record) <= size) {
+		const session_record *record = (const session_record *)(address + pos);
+		
+		if(record->size > size || pos + sizeof(session_record) + record->size > size) {
+			// truncated
+			break;
+		}
+		
+		const uint8 *payload = address + pos + sizeof(session_record);
+		
+		if(record->type == SESSION_RECORD_COUNTER && record->size > sizeof(session_counter)) {
+			const session_counter *info = (const session_counter *)payload;
+			
+			const char *names		= (const char *)payload + sizeof(session_counter);
+			size_t namesSize		= record->size - sizeof(session_counter);
+			size_t displayNameSize	= strnlen(names, namesSize);
+			
+			counter_entry *entry = new counter_entry;
+			
+			entry->id		= info->id;
+			entry->flags	= info->flags;
+			entry->unit		= info->unit;
+			
+			entry->displayName.SetTo(names, displayNameSize);
+			
+			if(displayNameSize < namesSize)
+				entry->name.SetTo(names + displayNameSize + 1, namesSize - displayNameSize - 1);
+			
+			counterList.AddItem(entry);
+		} else if(record->type == SESSION_RECORD_SAMPLE && record->size >= sizeof(session_sample)) {
+			const session_sample *sample = (const session_sample *)payload;
+			
+			counter_entry *entry = FindCounter(sample->id);
+			
+			if(entry)
+				entry->samples.AddItem((void *)sample);
+		}
+		
+		pos += record_size(record->size);
+	}
+}
+
+// FindCounter
+// A counter may be recorded more than once (by several views). The
+// samples of the first one are replayed.
+const CSessionRecording::counter_entry *CSessionRecording::FindCounter(const char *name) const
+{
+	for(int32 i=0 ; i<counterList.CountItems() ; i++) {
+		if(counterList.ItemAt(i)->name == name)
+			return counterList.ItemAt(i);
+	}
+	
+	return NULL;
+}
+
+// FindCounter
+// The recorder numbers the counters in the order of their records, so
+// the entry is usually found by its index.
+CSessionRecording::counter_entry *CSessionRecording::FindCounter(uint32 id) const
+{
+	if(counterList.CountItems() > 0) {
+		counter_entry *entry = (counter_entry *)counterList.ItemAt((int32)(id - counterList.ItemAt(0)->id));
+	
+		if(entry && entry->id == id)
+			return entry;
+	}
+
+	for(int32 i=0 ; i<counterList.CountItems() ; i++) {
+		counter_entry *entry = (counter_entry *)counterList.ItemAt(i);
+	
+		if(entry->id == id)
+			return entry;
+	}
+	
+	return NULL;
+}
+
+// ====== CReplayDataProvider ======
+
+CReplayDataProvider::CReplayDataProvider(CSessionRecording *_recording, const char *_name, 
+	float _speed, bigtime_t _startTime, IDataProvider *_live)
+{
+	recording	= _recording;
+	name		= _name;
+	speed		= _speed;
+	startTime	= _startTime;
+	live		= _live;
+
+	recording->Acquire();
+
+	Init();
+}
+
+// CReplayDataProvider
+// Shares the recording of the replay session, if it's the same file.
+CReplayDataProvider::CReplayDataProvider(BMessage *archive) :
+	BArchivable(archive)
+{
+	const char *path = archive->FindString(REPLAY_ARCHIVE_PATH);
+	
+	CReplaySession *session = CReplaySession::Instance();
+	
+	recording	= session && path ? session->RecordingOf(path) : NULL;
+	name		= archive->FindString(REPLAY_DATA_PROVIDER_ARCHIVE_NAME);
+	speed		= archive->FindFloat(REPLAY_ARCHIVE_SPEED);
+	startTime	= archive->FindInt64(REPLAY_ARCHIVE_START_TIME);
+	live		= NULL;
+	
+	if(recording)
+		recording->Acquire();
+	else
+		recording = new CSessionRecording(path ? path : "");
+	
+	Init();
+}
+
+CReplayDataProvider::~CReplayDataProvider()
+{
+	recording->Release();
+	delete live;
+}
+
+void CReplayDataProvider::Init()
+{
+	counter			= recording->FindCounter(name.String());
+	nextSample		= 0;
+	lastTimeStamp	= 0;
+	lastValue		= 0.0;
+	lastValid		= false;
+	
+	if(speed <= 0.0)
+		speed = 1.0;
+}
+
+BArchivable *CReplayDataProvider::Instantiate(BMessage *archive)
+{
+	if(!validate_instantiation(archive, "CReplayDataProvider"))
+		return NULL;
+		
+	return new CReplayDataProvider(archive);
+}
+
+status_t CReplayDataProvider::Archive(BMessage *data, bool deep) const
+{
+	BArchivable *archivableLive = dynamic_cast<BArchivable *>(live);
+
+	if(archivableLive)
+		return archivableLive->Archive(data, deep);
+
+	RETURN_IF_FAILED( BArchivable::Archive(data, deep) );
+	RETURN_IF_FAILED( data->AddString("add_on", APP_SIGNATURE) );
+	RETURN_IF_FAILED( data->AddString(REPLAY_ARCHIVE_PATH, recording->Path()) );
+	RETURN_IF_FAILED( data->AddString(REPLAY_DATA_PROVIDER_ARCHIVE_NAME, name) );
+	RETURN_IF_FAILED( data->AddFloat(REPLAY_ARCHIVE_SPEED, speed) );
+	RETURN_IF_FAILED( data->AddInt64(REPLAY_ARCHIVE_START_TIME, startTime) );
+	
+	return B_OK;
+}
+
+bool CReplayDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+	
+	bool valid = GetNextSample(sample);
+	
+	value = sample.value;
+	
+	return valid;
+}
+
+bool CReplayDataProvider::GetNextSample(data_sample &sample)
+{
+	bigtime_t position = recording->StartTime() + 
+		(bigtime_t)((system_time() - startTime) * (double)speed);
+		
+	int32 sampleCount = counter ? counter->CountSamples() : 0;
+		
+	bool relative = Flags() & DP_TYPE_RELATIVE;
+	bool found	  = false;
+	double sum	  = 0.0;
+	
+	while(nextSample < sampleCount && counter->SampleAt(nextSample)->time <= position) {
+		const session_sample *recorded = counter->SampleAt(nextSample++);
+		
+		if(relative && found && lastValid)
+			sum += lastValue;
+		
+		lastTimeStamp	= recorded->timeStamp;
+		lastValue		= recorded->value;
+		lastValid		= recorded->valid;
+		found			= true;
+	}
+	
+	if(found)
+		lastValue += sum;
+
+	if(!found && nextSample >= sampleCount) {
+		// End of the recording. Without a time stamp the sample isn't
+		// taken for the same reading (see CSampleNormalizer).
+		sample.value		= 0.0;
+		sample.timeStamp	= 0;
+		
+		return false;
+	}
+	
+	// If no sample is due, the last one is returned again.
+	sample.value		= lastValue;
+	sample.timeStamp	= lastTimeStamp;
+	
+	return lastValid;
+}
+
+uint32 CReplayDataProvider::Flags()
+{
+	if(counter)
+		return counter->flags;
+		
+	return live ? live->Flags() : DP_TYPE_ABSOLUTE;
+}
+
+uint32 CReplayDataProvider::Unit()
+{
+	if(counter)
+		return counter->unit;
+		
+	return live ? live->Unit() : DP_UNIT_NONE;
+}
+
+BString CReplayDataProvider::DisplayName()
+{
+	if(counter)
+		return counter->displayName;
+		
+	return live ? live->DisplayName() : name;
+}
+
+IDataProvider *CReplayDataProvider::Clone()
+{
+	return new CReplayDataProvider(recording, name.String(), speed, startTime,
+		live ? live->Clone() : NULL);
+}
+
+bool CReplayDataProvider::Equal(IDataProvider *other)
+{
+	CReplayDataProvider *o = dynamic_cast<CReplayDataProvider *>(other);
+	
+	return o && strcmp(o->recording->Path(), recording->Path()) == 0 && o->name == name;
+}
+
+// ====== CReplaySession ======
+
+CReplaySession::CReplaySession()
+{
+	speed		= 1.0;
+	startTime	= 0;
+	recording	= NULL;
+}
+
+CReplaySession::~CReplaySession()
+{
+	if(recording)
+		recording->Release();
+
+	RemoveFromList(ClassName());
+}
+
+CReplaySession *CReplaySession::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CReplaySession *session = NULL;
+
+	return CreateSingleton(session, "CReplaySession");
+}
+
+CReplaySession *CReplaySession::Instance()
+{
+	CReplaySession *session = dynamic_cast<CReplaySession *>(Find("CReplaySession"));
+	
+	return session && session->InitCheck() == B_OK ? session : NULL;
+}
+
+void CReplaySession::DeleteInstance()
+{
+	delete dynamic_cast<CReplaySession *>(Find("CReplaySession"));
+}
+
+status_t CReplaySession::Start(const char *_path, float _speed)
+{
+	// Replay providers of the former recording keep it.
+	if(recording)
+		recording->Release();
+	
+	// The path is passed to other teams (the Deskbar), which have
+	// another current directory.
+	BPath absolutePath(_path, NULL, true);
+	
+	path		= absolutePath.InitCheck() == B_OK ? absolutePath.Path() : _path;
+	speed		= _speed > 0.0 ? _speed : 1.0;
+	startTime	= system_time();
+	recording	= new CSessionRecording(path.String());
+	
+	return recording->InitCheck();
+}
+
+status_t CReplaySession::SetTo(BMessage *archive)
+{
+	const char *archivePath;
+	
+	RETURN_IF_FAILED( archive->FindString(REPLAY_ARCHIVE_PATH, &archivePath) );
+	
+	RETURN_IF_FAILED( Start(archivePath, archive->FindFloat(REPLAY_ARCHIVE_SPEED)) );
+	
+	startTime = archive->FindInt64(REPLAY_ARCHIVE_START_TIME);
+	
+	return B_OK;
+}
+
+status_t CReplaySession::Archive(BMessage *archive) const
+{
+	RETURN_IF_FAILED( archive->AddString(REPLAY_ARCHIVE_PATH, path) );
+	RETURN_IF_FAILED( archive->AddFloat(REPLAY_ARCHIVE_SPEED, speed) );
+	RETURN_IF_FAILED( archive->AddInt64(REPLAY_ARCHIVE_START_TIME, startTime) );
+	
+	return B_OK;
+}
+
+bool CReplaySession::IsArchivedIn(BMessage *archive) const
+{
+	const char *archivePath;
+	
+	return archive->FindString(REPLAY_ARCHIVE_PATH, &archivePath) == B_OK &&
+		path == archivePath &&
+		speed == archive->FindFloat(REPLAY_ARCHIVE_SPEED) &&
+		startTime == archive->FindInt64(REPLAY_ARCHIVE_START_TIME);
+}
+
+IDataProvider *CReplaySession::Substitute(IDataProvider *live, const char *name)
+{
+	if(recording->FindCounter(name) == NULL)
+		return NULL;
+		
+	return new CReplayDataProvider(recording, name, speed, startTime, live);
+}
+
+CSessionRecording *CReplaySession::RecordingOf(const char *recordingPath) const
+{
+	return recording && path == recordingPath ? recording : NULL;
+}
+
+// ====== Functions ======
+
+IDataProvider *replay_data_provider(IDataProvider *provider, const char *name)
+{
+	CReplaySession *session = CReplaySession::Instance();
+	
+	if(session == NULL || provider == NULL)
+		return provider;
+		
+	BString displayName = provider->DisplayName();
+		
+	IDataProvider *replay = session->Substitute(provider, name ? name : displayName.String());
+	
+	return replay ? replay : provider;
+}
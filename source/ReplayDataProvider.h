@@ -0,0 +1,196 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REPLAY_DATA_PROVIDER_H
+#define REPLAY_DATA_PROVIDER_H
+
+#include "Singleton.h"
+#include "PointerList.h"
+#include "DataProvider.h"
+#include "SessionRecorder.h"
+
+// ====== Archive Fields ======
+
+// CReplayDataProvider, CReplaySession
+extern const char * const REPLAY_ARCHIVE_PATH;				// string
+extern const char * const REPLAY_ARCHIVE_SPEED;				// float
+extern const char * const REPLAY_ARCHIVE_START_TIME;		// int64
+
+// CReplayDataProvider
+extern const char * const REPLAY_DATA_PROVIDER_ARCHIVE_NAME;	// string
+
+// ====== Class Defs ======
+
+//: Read only, memory mapped recording of a CSessionRecorder.
+// The file is walked once to index the samples of all counters. The
+// recording is shared by the replay session and all its replay
+// providers, so it's reference counted: the creator holds the first
+// reference. A truncated last record (the recorder crashed) is ignored.
+class CSessionRecording
+{
+	public:
+	struct counter_entry {
+		uint32		id;
+		uint32		flags;
+		uint32		unit;
+		BString		displayName;
+		BString		name;
+		BList		samples;			// const session_sample *
+
+		int32 CountSamples() const		{ return samples.CountItems(); }
+		const session_sample *SampleAt(int32 index) const
+			{ return (const session_sample *)samples.ItemAt(index); }
+	};
+
+	CSessionRecording(const char *path);
+	
+	void Acquire();
+	void Release();
+	
+	status_t InitCheck() const	{ return status; }
+	const char *Path() const	{ return path.String(); }
+	bigtime_t StartTime() const	{ return startTime; }
+
+	// Returns the first counter named 'name' or NULL.
+	const counter_entry *FindCounter(const char *name) const;
+	
+	protected:
+	~CSessionRecording();
+	
+	void BuildIndex();
+	counter_entry *FindCounter(uint32 id) const;
+
+	int32			 refCount;
+	status_t		 status;
+	BString			 path;
+	int				 fd;
+	uint8			*address;
+	size_t			 size;
+	bigtime_t		 startTime;
+	CPointerList<counter_entry> counterList;
+};
+
+//: Replays the samples of a recorded counter.
+// The recording time since the start of the recording is mapped to the
+// system time since 'startTime', accelerated by 'speed'. Each call of
+// GetNextSample() returns the latest sample which is due. The time
+// stamps are the recorded ones, so the views normalize the samples
+// exactly as they did during the recording. The deltas of relative
+// counters, whose samples are skipped at accelerated speed, are summed.
+// After the end of the recording the samples are invalid.
+//
+// If the provider replaces a live data provider (see CReplaySession),
+// it archives the live provider. So replayed views don't store the
+// replay in their settings.
+class _EXPORT CReplayDataProvider : public IDataProvider, public BArchivable,
+	public ISampledDataProvider
+{
+	public:
+	// Acquires a reference to 'recording'.
+	CReplayDataProvider(CSessionRecording *recording, const char *name, float speed, 
+		bigtime_t startTime, IDataProvider *live=NULL);
+	CReplayDataProvider(BMessage *archive);
+	virtual ~CReplayDataProvider();
+	
+	static BArchivable *Instantiate(BMessage *archive);
+	virtual status_t Archive(BMessage *archive, bool deep) const;
+
+	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
+	virtual uint32 Flags();
+	virtual uint32 Unit();
+	virtual BString DisplayName();
+	
+	virtual IDataProvider *Clone();
+	virtual bool Equal(IDataProvider *other);
+	
+	protected:
+	void Init();
+	
+	BString				 name;
+	float				 speed;
+	bigtime_t			 startTime;
+	IDataProvider		*live;				// replaced provider or NULL
+	CSessionRecording	*recording;
+	const CSessionRecording::counter_entry *counter;	// NULL, if not recorded
+	int32				 nextSample;
+	bigtime_t			 lastTimeStamp;
+	double				 lastValue;
+	bool				 lastValid;
+};
+
+//: The replay of a recording.
+// While a replay session exists, the views replace every data provider
+// of a recorded counter by a CReplayDataProvider (see
+// replay_data_provider()). All replay providers share the start time
+// of the session, so they stay in sync. They also share its recording,
+// which is indexed only once. Counters are matched by the name they
+// were recorded with: the counter path or, if it isn't known, the
+// display name. The deskbar replicant asks the
+// application for its session (MSG_GET_REPLAY_SESSION), so it replays,
+// too. It repeats the question while it runs and drops its session,
+// when the application ends the replay.
+class CReplaySession : public CSingleton
+{
+	public:
+	static CReplaySession *CreateInstance();
+	static CReplaySession *Instance();
+	
+	// Ends the replay. Replay providers keep their recording.
+	static void DeleteInstance();
+	
+	virtual ~CReplaySession();
+	virtual void Reactivate() {}
+
+	status_t InitCheck() const { return recording ? recording->InitCheck() : B_NO_INIT; }
+
+	// Starts the replay of 'path' now.
+	status_t Start(const char *path, float speed);
+	
+	// Continues a replay archived by Archive().
+	status_t SetTo(BMessage *archive);
+	status_t Archive(BMessage *archive) const;
+	
+	// Returns true, if 'archive' was archived by this session.
+	bool IsArchivedIn(BMessage *archive) const;
+	
+	// Returns a CReplayDataProvider replacing 'live' or NULL, if no
+	// counter named 'name' is recorded.
+	IDataProvider *Substitute(IDataProvider *live, const char *name);
+	
+	// Returns the recording of the session, if it's 'path'. The
+	// caller must acquire a reference.
+	CSessionRecording *RecordingOf(const char *path) const;
+	
+	protected:
+	CReplaySession();
+	
+	BString				 path;
+	float				 speed;
+	bigtime_t			 startTime;
+	CSessionRecording	*recording;
+	
+	friend class CSingleton;
+};
+
+// Returns 'provider' or, if a replay session is active and the counter 
+// is recorded, a replay provider replacing it. 'name' is the counter
+// path. If it's NULL, the counter was recorded by its display name
+// and that's used.
+IDataProvider *replay_data_provider(IDataProvider *provider, const char *name=NULL);
+
+#endif // REPLAY_DATA_PROVIDER_H
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "DataProvider.h"
+#include "SamplingContext.h"
+
+CSamplingContext::CSamplingContext()
+{
+	count = capacity = 0;
+
+	providers		= NULL;
+	batchProviders	= NULL;
+	samples			= NULL;
+	valid			= NULL;
+	batch			= NULL;
+	batchSamples	= NULL;
+	batchValid		= NULL;
+	batchIndices	= NULL;
+	sampled			= NULL;
+}
+
+CSamplingContext::~CSamplingContext()
+{
+	delete [] providers;
+	delete [] batchProviders;
+	delete [] samples;
+	delete [] valid;
+	delete [] batch;
+	delete [] batchSamples;
+	delete [] batchValid;
+	delete [] batchIndices;
+	delete [] sampled;
+}
+
+void CSamplingContext::MakeEmpty()
+{
+	count = 0;
+}
+
+// Reserve
+// Makes sure, that 'newCount' providers fit into the arrays. The
+// contents of the scratch arrays is lost.
+void CSamplingContext::Reserve(int32 newCount)
+{
+	if(newCount <= capacity)
+		return;
+
+	int32 newCapacity = capacity > 0 ? capacity : 8;
+
+	while(newCapacity < newCount)
+		newCapacity *= 2;
+
+	IDataProvider **newProviders = new IDataProvider *[newCapacity];
+	IBatchDataProvider **newBatchProviders = new IBatchDataProvider *[newCapacity];
+	data_sample *newSamples = new data_sample[newCapacity];
+	bool *newValid = new bool[newCapacity];
+
+	for(int32 i=0 ; i<count ; i++) {
+		newProviders[i]		 = providers[i];
+		newBatchProviders[i] = batchProviders[i];
+		newSamples[i]		 = samples[i];
+		newValid[i]			 = valid[i];
+	}
+
+	delete [] providers;
+	delete [] batchProviders;
+	delete [] samples;
+	delete [] valid;
+	delete [] batch;
+	delete [] batchSamples;
+	delete [] batchValid;
+	delete [] batchIndices;
+	delete [] sampled;
+
+	providers		= newProviders;
+	batchProviders	= newBatchProviders;
+	samples			= newSamples;
+	valid			= newValid;
+	batch			= new IDataProvider *[newCapacity];
+	batchSamples	= new data_sample[newCapacity];
+	batchValid		= new bool[newCapacity];
+	batchIndices	= new int32[newCapacity];
+	sampled			= new bool[newCapacity];
+
+	capacity = newCapacity;
+}
+
+int32 CSamplingContext::AddProvider(IDataProvider *provider)
+{
+	MY_ASSERT(provider != NULL);
+
+	Reserve(count+1);
+
+	providers[count]		 = provider;
+	batchProviders[count]	 = dynamic_cast<IBatchDataProvider *>(provider);
+	samples[count].value	 = 0.0;
+	samples[count].timeStamp = 0;
+	valid[count]			 = false;
+
+	return count++;
+}
+
+// Sample
+// The groups are sampled in order of their first member.
+void CSamplingContext::Sample()
+{
+	for(int32 i=0 ; i<count ; i++)
+		sampled[i] = false;
+
+	for(int32 i=0 ; i<count ; i++) {
+		if(sampled[i])
+			continue;
+
+		IBatchDataProvider *batchProvider = batchProviders[i];
+
+		if(batchProvider == NULL) {
+			samples[i].value	 = 0.0;
+			samples[i].timeStamp = 0;
+			valid[i] = get_next_sample(providers[i], samples[i]);
+			continue;
+		}
+
+		const void *kind = batchProvider->BatchKind();
+		int32 batchCount = 0;
+
+		for(int32 k=i ; k<count ; k++) {
+			if(!sampled[k] && batchProviders[k] != NULL && 
+			   batchProviders[k]->BatchKind() == kind) {
+				batch[batchCount]				   = providers[k];
+				batchSamples[batchCount].value	   = 0.0;
+				batchSamples[batchCount].timeStamp = 0;
+				batchIndices[batchCount]		   = k;
+				batchCount++;
+
+				sampled[k] = true;
+			}
+		}
+
+		batchProvider->GetNextSamples(batch, batchCount, batchSamples, batchValid);
+
+		for(int32 k=0 ; k<batchCount ; k++) {
+			int32 index = batchIndices[k];
+
+			samples[index] = batchSamples[k];
+			valid[index]  = batchValid[k];
+		}
+	}
+}
+
+bool CSamplingContext::GetSample(int32 index, data_sample &sample) const
+{
+	MY_ASSERT(index >= 0 && index < count);
+
+	sample = samples[index];
+
+	return valid[index];
+}
+
+// ====== CSampleNormalizer ======
+
+CSampleNormalizer::CSampleNormalizer()
+{
+	Reset();
+}
+
+void CSampleNormalizer::Reset()
+{
+	lastTimeStamp = 0;
+	lastValue	  = 0.0;
+	lastValid	  = false;
+}
+
+bool CSampleNormalizer::Normalize(IDataProvider *provider, const data_sample &sample, 
+	bool valid, bigtime_t defaultInterval, double &value)
+{
+	if(provider == NULL)
+		return false;
+
+	uint32 flags = provider->Flags();
+
+	value = sample.value;
+
+	if(flags & IDataProvider::DP_TYPE_RELATIVE) {
+		bigtime_t interval = defaultInterval;
+
+		if(sample.timeStamp != 0 && lastTimeStamp != 0) {
+			interval = sample.timeStamp - lastTimeStamp;
+
+			if(interval <= 0) {
+				// Still the same reading. The provider's delta is zero,
+				// which isn't the real rate.
+				value = lastValue;
+				return lastValid;
+			}
+		}
+
+		if(sample.timeStamp != 0)
+			lastTimeStamp = sample.timeStamp;
+
+		if(valid)
+			value /= (double)MAX(interval, 1);
+	}
+
+	if(valid && (flags & IDataProvider::DP_TYPE_PERCENT))
+		value *= 100.0;
+
+	lastValue = value;
+	lastValid = valid;
+
+	return valid;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLING_CONTEXT_H
+#define SAMPLING_CONTEXT_H
+
+#include "DataProvider.h"
+
+//: Samples the data providers of a view once per tick.
+// Providers implementing IBatchDataProvider are grouped by their batch
+// kind and each group is sampled by a single GetNextSamples() call. All
+// other providers are sampled one by one. The arrays are kept between
+// ticks.
+class CSamplingContext
+{
+	public:
+	CSamplingContext();
+	~CSamplingContext();
+
+	// Removes all providers. Doesn't delete them.
+	void MakeEmpty();
+
+	// Adds a provider and returns its index. The provider must stay
+	// valid until Sample() was called.
+	int32 AddProvider(IDataProvider *provider);
+	int32 CountProviders() const { return count; }
+
+	// Gets the next sample of all providers.
+	void Sample();
+
+	// Result of the last Sample() for the provider at 'index'.
+	bool GetSample(int32 index, data_sample &sample) const;
+
+	protected:
+	void Reserve(int32 newCount);
+
+	int32				  count;
+	int32				  capacity;
+	IDataProvider		**providers;
+	IBatchDataProvider	**batchProviders;	// NULL for unbatched providers
+	data_sample			 *samples;
+	bool				 *valid;
+
+	// scratch arrays for one batch
+	IDataProvider		**batch;
+	data_sample			 *batchSamples;
+	bool				 *batchValid;
+	int32				 *batchIndices;
+	bool				 *sampled;
+};
+
+//: Converts the raw samples of a data provider into display values.
+// Relative values are divided by the time between the readings of the
+// last two samples, so a late pulse doesn't show up as a spike. If the
+// provider returns the same reading twice, the last value is repeated.
+// Percent values are multiplied by 100, but not clipped.
+class CSampleNormalizer
+{
+	public:
+	CSampleNormalizer();
+
+	// Forgets the last reading. Call it, if the data provider changes.
+	void Reset();
+
+	// Returns false, if there is no value to display. 'defaultInterval'
+	// is used for the first relative sample and for samples without
+	// time stamp.
+	bool Normalize(IDataProvider *provider, const data_sample &sample, 
+		bool valid, bigtime_t defaultInterval, double &value);
+
+	protected:
+	bigtime_t	lastTimeStamp;
+	double		lastValue;
+	bool		lastValid;
+};
+
+#endif // SAMPLING_CONTEXT_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "SessionRecorder.h"
+
+// ====== Globals ======
+
+// Records are padded to a multiple of 8 bytes.
+static size_t record_size(size_t size)
+{
+	return (sizeof(session_record) + size + 7) & ~7;
+}
+
+// ====== CSessionRecorder ======
+
+const bigtime_t CSessionRecorder::FLUSH_INTERVAL = 5000000;		// 5 s
+
+CSessionRecorder::CSessionRecorder() :
+	locker("SessionRecorder")
+{
+	file			= NULL;
+	lastFlush		= 0;
+	nextCounterId	= 0;
+}
+
+CSessionRecorder::~CSessionRecorder()
+{
+	Stop();
+	
+	RemoveFromList(ClassName());
+}
+
+CSessionRecorder *CSessionRecorder::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CSessionRecorder *recorder = NULL;
+
+	return CreateSingleton(recorder, "CSessionRecorder");
+}
+
+CSessionRecorder *CSessionRecorder::Instance()
+{
+	CSessionRecorder *recorder = dynamic_cast<CSessionRecorder *>(Find("CSessionRecorder"));
+	
+	return recorder && recorder->IsRecording() ? recorder : NULL;
+}
+
+status_t CSessionRecorder::Start(const char *path)
+{
+	BAutolock autoLocker(locker);
+	
+	Stop();
+	
+	file = new BFile(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	
+	status_t status = file->InitCheck();
+	
+	if(status != B_OK) {
+		delete file;
+		file = NULL;
+		
+		return status;
+	}
+	
+	session_file_header header;
+	
+	header.magic	 = SESSION_MAGIC;
+	header.version	 = SESSION_VERSION;
+	header.startTime = system_time();
+	
+	buffer.SetSize(0);
+	buffer.Seek(0, SEEK_SET);
+	buffer.Write(&header, sizeof(header));
+	
+	lastFlush = header.startTime;
+	
+	return B_OK;
+}
+
+void CSessionRecorder::Stop()
+{
+	BAutolock autoLocker(locker);
+
+	if(file == NULL)
+		return;
+		
+	Flush();
+
+	delete file;
+	file = NULL;
+	
+	counterList.MakeEmpty();
+}
+
+void CSessionRecorder::Record(IDataProvider *provider, const char *name, 
+	const data_sample &sample, bool valid)
+{
+	BAutolock autoLocker(locker);
+	
+	if(file == NULL || provider == NULL || name == NULL)
+		return;
+		
+	counter *c = FindCounter(provider, name);
+
+	session_sample s;
+	
+	s.id		= c->id;
+	s.valid		= valid;
+	s.time		= system_time();
+	s.timeStamp	= sample.timeStamp;
+	s.value		= sample.value;
+	
+	AddRecord(SESSION_RECORD_SAMPLE, &s, sizeof(s));
+	
+	if(s.time - lastFlush > FLUSH_INTERVAL)
+		Flush();
+}
+
+void CSessionRecorder::Flush()
+{
+	BAutolock autoLocker(locker);
+
+	if(file && buffer.BufferLength() > 0) {
+		// The records are dropped, even if writing failed.
+		file->Write(buffer.Buffer(), buffer.BufferLength());
+	
+		buffer.SetSize(0);
+		buffer.Seek(0, SEEK_SET);
+	}
+	
+	lastFlush = system_time();
+}
+
+// FindCounter
+// Returns the counter of 'provider'. A new counter is created and its
+// record is written, if the provider wasn't recorded before.
+CSessionRecorder::counter *CSessionRecorder::FindCounter(IDataProvider *provider, const char *name)
+{
+	for(int32 i=0 ; i<counterList.CountItems() ; i++) {
+		counter *c = counterList.ItemAt(i);
+	
+		// The provider may be deleted and another one created at the
+		// same address. So the name is compared, too.
+		if(c->provider == provider && c->name == name)
+			return c;
+	}
+	
+	counter *c = new counter;
+	
+	c->id		= nextCounterId++;
+	c->provider	= provider;
+	c->name		= name;
+	
+	counterList.AddItem(c);
+	
+	session_counter info;
+	
+	info.id			= c->id;
+	info.flags		= provider->Flags();
+	info.unit		= provider->Unit();
+	info.reserved	= 0;
+	
+	BString displayName = provider->DisplayName();
+	
+	size_t displayNameSize	= displayName.Length() + 1;
+	size_t nameSize			= strlen(name) + 1;
+	
+	char *names = new char[displayNameSize + nameSize];
+	
+	memcpy(names, displayName.String(), displayNameSize);
+	memcpy(names + displayNameSize, name, nameSize);
+	
+	AddRecord(SESSION_RECORD_COUNTER, &info, sizeof(info), names, displayNameSize + nameSize);
+	
+	delete [] names;
+	
+	return c;
+}
+
+void CSessionRecorder::AddRecord(uint32 type, const void *header, size_t headerSize, 
+	const void *data, size_t dataSize)
+{
+	session_record record;
+	
+	record.type = type;
+	record.size = headerSize + dataSize;
+	
+	size_t padding = record_size(record.size) - sizeof(record) - record.size;
+	
+	static const uint8 zeros[8] = { 0 };
+
+	buffer.Write(&record, sizeof(record));
+	buffer.Write(header, headerSize);
+	
+	if(dataSize > 0)
+		buffer.Write(data, dataSize);
+		
+	buffer.Write(zeros, padding);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SESSION_RECORDER_H
+#define SESSION_RECORDER_H
+
+#include "Singleton.h"
+#include "PointerList.h"
+#include "DataProvider.h"
+
+#include <DataIO.h>
+
+// ====== File Format ======
+
+// A recording starts with a session_file_header followed by records.
+// Each record is a session_record followed by 'size' bytes (padded to
+// a multiple of 8). A counter record contains a session_counter
+// followed by the NUL terminated display name and the NUL terminated
+// name (the counter path, if known) of the counter. It precedes the
+// first sample of the counter. A sample record contains a
+// session_sample. The samples are the raw samples of the data
+// providers, so a replay passes them through the same normalization.
+// All times are system_time() in microseconds.
+const uint32 SESSION_MAGIC				= 'TMsr';
+const uint32 SESSION_VERSION			= 1;
+
+const uint32 SESSION_RECORD_COUNTER		= 1;
+const uint32 SESSION_RECORD_SAMPLE		= 2;
+
+struct session_file_header
+{
+	uint32	magic;
+	uint32	version;
+	int64	startTime;
+};
+
+struct session_record
+{
+	uint32	type;
+	uint32	size;				// size of the payload (without padding)
+};
+
+struct session_counter
+{
+	uint32	id;
+	uint32	flags;				// IDataProvider::Flags()
+	uint32	unit;				// IDataProvider::Unit()
+	uint32	reserved;
+};
+
+struct session_sample
+{
+	uint32	id;
+	uint32	valid;
+	int64	time;				// time the view took the sample
+	int64	timeStamp;			// data_sample::timeStamp
+	double	value;				// data_sample::value
+};
+
+// ====== Class Defs ======
+
+//: Records the raw samples of all displayed counters to a file.
+// Every data provider sampled by a view is a counter of its own, even
+// if two views display the same counter, because the samples of
+// relative counters are only meaningful in the sequence of their
+// provider. The records are buffered and written every FLUSH_INTERVAL.
+//
+// The recorder is created by the application. Views in other teams
+// (replicants) aren't recorded, as Instance() returns NULL there.
+class CSessionRecorder : public CSingleton
+{
+	public:
+	static CSessionRecorder *CreateInstance();
+	static CSessionRecorder *Instance();
+	
+	virtual ~CSessionRecorder();
+	virtual void Reactivate() {}
+
+	// Starts a new recording. An existing file is replaced.
+	status_t Start(const char *path);
+	void Stop();
+	bool IsRecording() const { return file != NULL; }
+
+	// 'name' identifies the counter in the replay. Pass the counter
+	// path, if it's known, otherwise the display name.
+	void Record(IDataProvider *provider, const char *name, 
+		const data_sample &sample, bool valid);
+	void Flush();
+
+	protected:
+	CSessionRecorder();
+	
+	struct counter {
+		uint32			 id;
+		IDataProvider	*provider;		// only used as key
+		BString			 name;
+	};
+
+	counter *FindCounter(IDataProvider *provider, const char *name);
+	void AddRecord(uint32 type, const void *header, size_t headerSize, 
+		const void *data=NULL, size_t dataSize=0);
+
+	static const bigtime_t	FLUSH_INTERVAL;
+	
+	BLocker					 locker;
+	BFile					*file;
+	BMallocIO				 buffer;		// records not yet written
+	bigtime_t				 lastFlush;
+	uint32					 nextCounterId;
+	CPointerList<counter>	 counterList;
+	
+	friend class CSingleton;
+};
+
+#endif // SESSION_RECORDER_H
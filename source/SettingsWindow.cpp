@@ -73,6 +73,25 @@ CSettingsWindow::CSettingsWindow() :
 								false		// invert value
 								));
 
+	BMessage *showProcessTreeProp = new BMessage;
+	
+	showProcessTreeProp->AddSpecifier(PROCESS_VIEW_PROP_SHOW_PROCESS_TREE);
+	showProcessTreeProp->AddSpecifier("View",   (int32)TAB_ID_TEAMS);		// "Teams" tab
+	showProcessTreeProp->AddSpecifier("View",   (int32)0);		// container for tabbed views
+	showProcessTreeProp->AddSpecifier("View",   "MainViewTab");
+	showProcessTreeProp->AddSpecifier("View",   "MainWindowView");
+	showProcessTreeProp->AddSpecifier("Window", "TaskManager");
+
+	miscGroup->AddChild(new CScriptingPrefCheckBox(
+								dummy,
+								showProcessTreeProp,
+								PREF_SHOW_PROCESS_TREE,
+								B_TRANSLATE("Show process tree"),
+								NULL,		// message
+								false,		// default value
+								false		// invert value
+								));
+
 	settingsView->InternalView()->AddChild(miscGroup);
 	
 	CSettingsGroup *teamColumnGroup = new CSettingsGroup(dummy, "Team Column Settings", 2);
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "SlidingExtent.h"
+
+// ====== CSlidingExtent::deque ======
+
+void CSlidingExtent::deque::PushBack(uint32 serial, float value)
+{
+	entry &e = items[(first+count) % capacity];
+	
+	e.serial = serial;
+	e.value	 = value;
+	
+	count++;
+}
+
+// ====== CSlidingExtent ======
+
+CSlidingExtent::CSlidingExtent(int32 _windowSize)
+{
+	windowSize = MAX(_windowSize, 1);
+
+	maxDeque.items	  = new entry[windowSize];
+	maxDeque.capacity = windowSize;
+	minDeque.items	  = new entry[windowSize];
+	minDeque.capacity = windowSize;
+
+	MakeEmpty();
+}
+
+CSlidingExtent::~CSlidingExtent()
+{
+	delete [] maxDeque.items;
+	delete [] minDeque.items;
+}
+
+void CSlidingExtent::MakeEmpty()
+{
+	serial = 0;
+
+	maxDeque.first = maxDeque.count = 0;
+	minDeque.first = minDeque.count = 0;
+}
+
+void CSlidingExtent::Add(float value)
+{
+	serial++;
+
+	// Make room for the new value. After that at most windowSize-1
+	// entries are left in each deque.
+	Expire(maxDeque);
+	Expire(minDeque);
+
+	// Values smaller than the new one can never be the maximum again.
+	while(maxDeque.count > 0 && maxDeque.Back().value <= value)
+		maxDeque.PopBack();
+
+	maxDeque.PushBack(serial, value);
+
+	// Same for greater values and the minimum.
+	while(minDeque.count > 0 && minDeque.Back().value >= value)
+		minDeque.PopBack();
+
+	minDeque.PushBack(serial, value);
+}
+
+// Expire
+// Drops all entries at the front of 'd', which are older than
+// 'windowSize' values (relative to the value currently added). The
+// unsigned difference is correct, even if 'serial' wrapped around.
+void CSlidingExtent::Expire(deque &d)
+{
+	while(d.count > 0 && serial - d.Front().serial >= (uint32)windowSize)
+		d.PopFront();
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SLIDING_EXTENT_H
+#define SLIDING_EXTENT_H
+
+//: Minimum and maximum of the last N values.
+// Both extents are kept in monotonic deques: the max deque holds the
+// values in decreasing order, the min deque in increasing order. A
+// value is dropped as soon as a newer value dominates it or it leaves
+// the window. Adding a value is amortized O(1), reading an extent O(1).
+class CSlidingExtent
+{
+	public:
+	CSlidingExtent(int32 windowSize);
+	~CSlidingExtent();
+
+	void Add(float value);
+	void MakeEmpty();
+
+	// Both return 0 if no value was added since the last MakeEmpty().
+	float Min() const	{ return minDeque.count > 0 ? minDeque.Front().value : 0.0; }
+	float Max() const	{ return maxDeque.count > 0 ? maxDeque.Front().value : 0.0; }
+
+	int32 WindowSize() const	{ return windowSize; }
+
+	protected:
+	struct entry {
+		uint32	serial;				// number of the Add() call
+		float	value;
+	};
+
+	// Ring buffer with room for 'windowSize' entries.
+	struct deque {
+		entry	*items;
+		int32	 first;
+		int32	 count;
+		int32	 capacity;
+
+		entry &Front() const	{ return items[first]; }
+		entry &Back() const		{ return items[(first+count-1) % capacity]; }
+		void PushBack(uint32 serial, float value);
+		void PopFront()			{ first = (first+1) % capacity; count--; }
+		void PopBack()			{ count--; }
+	};
+
+	void Expire(deque &d);
+
+	int32	windowSize;
+	uint32	serial;
+	deque	maxDeque;
+	deque	minDeque;
+};
+
+#endif // SLIDING_EXTENT_H
@@ -20,6 +20,11 @@
 #include "version.h"
 #include "my_assert.h"
 #include "CounterNamespaceImpl.h"
+#include "CounterExport.h"
+#include "TimeSeriesStore.h"
+#include "SessionRecorder.h"
+#include "ReplayDataProvider.h"
+#include "CounterCollector.h"
 #include "InstallationDialog.h"
 #include "AboutWindow.h"
 #include "MainWindow.h"
@@ -47,16 +52,34 @@ const char * const MESSAGE_DATA_ID_SHOW				= "SHOWREP:Show";
 CTaskManagerApplication::CTaskManagerApplication() : 
 	BApplication(APP_SIGNATURE)
 {
+	startTime = system_time();
+
 	mainWindow = NULL;
 	
 	// Init my only global object
 	InitGlobalNamespace();
 	
+	// Publish the values of all displayed counters for other teams.
+	CCounterExport::CreateInstance();
+	
+	// Record them, so they survive a restart.
+	CTimeSeriesStore::CreateInstance();
+	
 	showMainWindow = true;
+	printStartupTiming = false;
 }
 
 CTaskManagerApplication::~CTaskManagerApplication()
 {
+	CTimeSeriesStore *store = CTimeSeriesStore::Instance();
+	
+	if(store)
+		store->Flush();
+		
+	CSessionRecorder *recorder = CSessionRecorder::Instance();
+	
+	if(recorder)
+		recorder->Stop();
 }
 
 void CTaskManagerApplication::AboutRequested()
@@ -76,6 +99,12 @@ void CTaskManagerApplication::ArgvReceived(int32 argc, char **argv)
 		printf("  --show_deskbar_rep      Add replicant to deskbar and then quit\n");
 		printf("  --hide_deskbar_rep      Remove replicant from deskbar and then quit\n");
 		printf("  --tweak_deskbar         Make the deskbar topmost and then quit\n");
+		printf("  --startup_timing        Print startup and plugin load times\n");
+		printf("  --record <file>         Record the samples of all displayed counters\n");
+		printf("  --replay <file>         Display a recording instead of the live values\n");
+		printf("  --replay_speed <factor> Speed of the replay (default: 1)\n");
+		printf("  --collect <path> ...    Write counters to stdout without user interface\n");
+		printf("                          (see '--collect' without path for more options)\n");
 		
 		if(IsLaunching()) {
 			// Don't close application, if I receive this message when the
@@ -120,6 +149,32 @@ void CTaskManagerApplication::ArgvReceived(int32 argc, char **argv)
 			quit = true;		
 		}
 
+		if(IncludesOption(argc, argv, "startup_timing")) {
+			printStartupTiming = true;
+		}
+
+		const char *recordPath = OptionArgument(argc, argv, "record");
+		
+		if(recordPath) {
+			status_t status = CSessionRecorder::CreateInstance()->Start(recordPath);
+			
+			if(status != B_OK)
+				fprintf(stderr, "Can't record to '%s': %s\n", recordPath, strerror(status));
+		}
+		
+		const char *replayPath = OptionArgument(argc, argv, "replay");
+		
+		if(replayPath) {
+			// The views created after this point replay the recording.
+			const char *speed = OptionArgument(argc, argv, "replay_speed");
+			
+			status_t status = CReplaySession::CreateInstance()->Start(replayPath, 
+				speed ? atof(speed) : 1.0);
+			
+			if(status != B_OK)
+				fprintf(stderr, "Can't replay '%s': %s\n", replayPath, strerror(status));
+		}
+
 		if(IncludesOption(argc, argv, "install")) {
 			CInstallationDialog::CreateInstance();
 			
@@ -252,6 +307,18 @@ void CTaskManagerApplication::MessageReceived(BMessage *message)
 					mainWindow->Activate();
 				}
 			}
+			
+			if(printStartupTiming) {
+				printf("Main window shown after: %.1f ms\n", (system_time() - startTime) / 1000.0);
+			
+				CPerformanceCounterNamespace *counterNamespace = 
+					dynamic_cast<CPerformanceCounterNamespace *>((IPerformanceCounterNamespace *)global_Namespace);
+				
+				if(counterNamespace)
+					counterNamespace->PrintStartupTiming();
+					
+				printStartupTiming = false;
+			}
 
 			break;
 		case MSG_SHOW_REPLICANT:
@@ -266,6 +333,20 @@ void CTaskManagerApplication::MessageReceived(BMessage *message)
 				}
 			}
 			break;
+		case MSG_GET_REPLAY_SESSION:
+			// Sent by the deskbar replicant. The reply is empty, 
+			// if there is no replay.
+			{
+				BMessage reply(MSG_REPLAY_SESSION);
+				
+				CReplaySession *replay = CReplaySession::Instance();
+				
+				if(replay)
+					replay->Archive(&reply);
+					
+				message->SendReply(&reply);
+			}
+			break;
 		case MSG_TWEAK_DESKBAR:
 			{
 				BString errorString;
@@ -371,6 +452,19 @@ bool CTaskManagerApplication::IncludesOption(int32 argc, char **argv, const char
 	return false;
 }
 
+// OptionArgument
+// Returns the argument following the option or NULL, if the option
+// isn't included.
+const char *CTaskManagerApplication::OptionArgument(int32 argc, char **argv, const char *option)
+{
+	for(int i=1 ; i<argc-1 ; i++) {
+		if(strncmp(argv[i], "--", 2) == 0 && strcmp(&argv[i][2], option) == 0)
+			return argv[i+1];
+	}
+	
+	return NULL;
+}
+
 // ====== main ======
 
 int main(int argc, char **argv)
@@ -380,6 +474,14 @@ int main(int argc, char **argv)
 	SetMallocLeakChecking(true);
 	#endif // MEM_DEBUG
 
+	for(int i=1 ; i<argc ; i++) {
+		if(strcmp(argv[i], "--collect") == 0) {
+			// No BApplication, so the collector runs without a
+			// desktop session.
+			return collect_main(argc, argv);
+		}
+	}
+
 	new CTaskManagerApplication(); 
 
 	be_app->Run();
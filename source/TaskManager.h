@@ -37,6 +37,8 @@ extern"C" void SetMallocLeakChecking(bool);
 const int32 MSG_TWEAK_DESKBAR				= 'mDTW';
 const int32 MSG_SHOW_MAIN_WINDOW			= 'mSMW';
 const int32 MSG_SHOW_REPLICANT 				= 'mSRP';
+const int32 MSG_GET_REPLAY_SESSION			= 'mGRS';
+const int32 MSG_REPLAY_SESSION				= 'mRPS';	// reply to MSG_GET_REPLAY_SESSION
 
 // ====== Message Fields ======
 
@@ -61,9 +63,12 @@ class CTaskManagerApplication : public BApplication
 
 	protected:
 	bool IncludesOption(int32 argc, char **argv, const char *option);
+	const char *OptionArgument(int32 argc, char **argv, const char *option);
 	
 	BWindow *mainWindow;
 	bool showMainWindow;
+	bool printStartupTiming;
+	bigtime_t startTime;			// system_time() at construction
 };
 
 #endif // TASK_MANAGER_H
\ No newline at end of file
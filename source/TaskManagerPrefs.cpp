@@ -32,6 +32,7 @@ const char * const PREF_SHOW_KILL_WARNING					= "ShowKillWarning";
 const char * const PREF_SHOW_SYSTEM_KILL_WARNING			= "ShowSystemKillWarning";
 const char * const PREF_HIDE_DESKBAR_REPLICANT_ON_CLOSE		= "HideDeskbarRepOnClose";
 const char * const PREF_HIDE_SYSTEM_TEAMS					= "HideSystemTeams";
+const char * const PREF_SHOW_PROCESS_TREE					= "ShowProcessTree";
 const char * const PREF_SHOW_IN_ALL_WORKSPACES				= "ShowInAllWorkspaces";
 const char * const PREF_ADD_PERFORMANCE_WINDOW_RECT			= "AddPreformanceWindowRect";
 const char * const PREF_PERFORMANCE_LEGEND_BAR_WIDTH		= "PerfLegendBarWidth";
@@ -138,6 +139,15 @@ bool CTaskManagerPrefs::HideSystemTeams()
 	return hideSystemTeams;
 }
 
+bool CTaskManagerPrefs::ShowProcessTree()
+{
+	bool showProcessTree;
+	
+	Read(PREF_SHOW_PROCESS_TREE, showProcessTree, false);
+	
+	return showProcessTree;
+}
+
 bool CTaskManagerPrefs::HideDeskbarReplicantOnClose()
 {
 	bool hideDeskbarRep;
@@ -29,6 +29,7 @@ extern const char * const PREF_SHOW_KILL_WARNING;
 extern const char * const PREF_SHOW_SYSTEM_KILL_WARNING;
 extern const char * const PREF_HIDE_DESKBAR_REPLICANT_ON_CLOSE;
 extern const char * const PREF_HIDE_SYSTEM_TEAMS;
+extern const char * const PREF_SHOW_PROCESS_TREE;
 extern const char * const PREF_SHOW_IN_ALL_WORKSPACES;
 extern const char * const PREF_ADD_PERFORMANCE_WINDOW_RECT;
 extern const char * const PREF_PERFORMANCE_LEGEND_BAR_WIDTH;
@@ -86,6 +87,7 @@ class CTaskManagerPrefs : public CFilePreferences
 	void SetPerformanceLegendBarWidth(float width);
 	
 	bool HideSystemTeams();
+	bool ShowProcessTree();
 	bool HideDeskbarReplicantOnClose();
 	
 	// the array returned by this function belongs to the caller.
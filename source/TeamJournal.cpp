@@ -0,0 +1,49 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "TeamJournal.h"
+
+// ====== CTeamJournal ======
+
+CTeamJournal::CTeamJournal(int32 _capacity)
+{
+	MY_ASSERT(_capacity > 0);
+
+	capacity		= _capacity;
+	events			= new team_event[capacity];
+	nextSequence	= 1;
+}
+
+CTeamJournal::~CTeamJournal()
+{
+	delete [] events;
+}
+
+// Append
+// Overwrites the oldest event, if the journal is full.
+int64 CTeamJournal::Append(team_event_type type, team_id team)
+{
+	team_event &event = events[nextSequence % capacity];
+
+	event.sequence	= nextSequence;
+	event.type		= type;
+	event.team		= team;
+
+	return nextSequence++;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEAM_JOURNAL_H
+#define TEAM_JOURNAL_H
+
+// ====== Types ======
+
+enum team_event_type {
+	TEAM_EVENT_ADDED,
+	TEAM_EVENT_REMOVED
+};
+
+struct team_event {
+	int64			sequence;
+	team_event_type	type;
+	team_id			team;
+};
+
+//: Bounded journal of team model changes.
+// Every event gets a sequence number, which is one higher than the
+// one of the previous event. A consumer remembers the last sequence
+// number it has seen and can replay all later events, as long as they
+// are still in the ring. Otherwise (CanReplay() returns false) it has
+// to resynchronize with the model.
+// Only added and removed teams are recorded. Changed values are read
+// from the model, so they would only push the other events out.
+class CTeamJournal
+{
+	public:
+	CTeamJournal(int32 capacity=1024);
+	~CTeamJournal();
+
+	// Returns the sequence number of the new event.
+	int64 Append(team_event_type type, team_id team);
+
+	// Sequence number of the newest event (0 if empty).
+	int64 LastSequence() const		{ return nextSequence-1; }
+
+	// Sequence number of the oldest event still in the journal.
+	int64 FirstSequence() const
+	{
+		return (nextSequence > capacity) ? nextSequence-capacity : 1;
+	}
+
+	// True, if all events after 'sequence' are still available.
+	bool CanReplay(int64 sequence) const
+	{
+		return sequence >= FirstSequence()-1 && sequence <= LastSequence();
+	}
+
+	// 'sequence' must be between FirstSequence() and LastSequence().
+	const team_event &EventAt(int64 sequence) const
+	{
+		return events[sequence % capacity];
+	}
+
+	protected:
+	team_event	*events;
+	int32		 capacity;
+	int64		 nextSequence;
+};
+
+#endif // TEAM_JOURNAL_H
@@ -20,6 +20,10 @@
 #include "msg_helper.h"
 #include "my_assert.h"
 #include "PointerList.h"
+#include "ExecutableInfoCache.h"
+#include "SystemSnapshot.h"
+#include "ThreadModel.h"
+#include "TopKTracker.h"
 #include "PulseView.h"
 #include "Process.h"
 #include "ProcessView.h"
@@ -41,47 +45,106 @@ const char * const TEAM_MODEL_ENTRY_PROP_ACTIVATE		= "Activate";
 const char * const TEAM_MODEL_ENTRY_PROP_PRIORITY		= "Priority";
 
 const char * const TEAM_MODEL_PROP_TEAM					= "Team";
+const char * const TEAM_MODEL_PROP_TOP_CPU				= "TopCPU";
+const char * const TEAM_MODEL_PROP_TOP_MEMORY			= "TopMemory";
+const char * const TEAM_MODEL_PROP_TOP_THREADS			= "TopThreads";
+const char * const TEAM_MODEL_PROP_TOP_AREAS			= "TopAreas";
+const char * const TEAM_MODEL_PROP_EXECUTABLE_CACHE_HITS	= "ExecutableCacheHits";
+const char * const TEAM_MODEL_PROP_EXECUTABLE_CACHE_MISSES	= "ExecutableCacheMisses";
 
 // Message Fields
-const char * const MESSAGE_DATA_ID_ITEM					= "NOTIFY:Item";
+const char * const MESSAGE_DATA_ID_ADDED_TEAM_ID		= "NOTIFY:AddedTeamId";
+const char * const MESSAGE_DATA_ID_REMOVED_TEAM_ID		= "NOTIFY:RemovedTeamId";
+const char * const MESSAGE_DATA_ID_UPDATED_TEAM_ID		= "NOTIFY:UpdatedTeamId";
+const char * const MESSAGE_DATA_ID_SEQUENCE				= "NOTIFY:Sequence";
+
+// ====== Helpers ======
+
+// Returns the metric of the top teams scripting property 'property'
+// or -1, if it's no such property.
+static int32 top_teams_metric(const char *property)
+{
+	if(strcmp(property, TEAM_MODEL_PROP_TOP_CPU) == 0)
+		return TOP_TEAMS_CPU;
+	if(strcmp(property, TEAM_MODEL_PROP_TOP_MEMORY) == 0)
+		return TOP_TEAMS_AREA_SIZE;
+	if(strcmp(property, TEAM_MODEL_PROP_TOP_THREADS) == 0)
+		return TOP_TEAMS_THREAD_COUNT;
+	if(strcmp(property, TEAM_MODEL_PROP_TOP_AREAS) == 0)
+		return TOP_TEAMS_AREA_COUNT;
+
+	return -1;
+}
 
 // ====== CTeamModelEntry ======
 
-CTeamModelEntry::CTeamModelEntry(const team_info &teamInfo) :
-	BHandler("")
+CTeamModelEntry::CTeamModelEntry(team_id _id, team_id _parentId, const char *path,
+	dev_t device, ino_t node, const char *name) :
+	BHandler(name)
 {
-	id = teamInfo.team;
+	id = _id;
 	
 	idleTeam = systemTeam = false;
-	
-	CTeam team(id);
-	
-	if(team.GetPath(&fileName) == B_OK) {
-		systemTeam = team.IsSystemTeam();
-		
-		SetName(fileName.Leaf());	
+	changed = true;
+
+	threadModel = NULL;
+
+	parentId = _parentId;
+	parent = NULL;
+
+	appDevice = device;
+	appNode = node;
+
+	userTime = kernelTime = 0;
+	threadCount = areaCount = imageCount = 0;
+	areaSize = 0;
+
+	if(path != NULL) {
+		fileName.SetTo(path);
+
+		CExecutableInfoCache::CreateInstance()->Lookup(device, node, path,
+			NULL, &systemTeam, NULL);
 	} else {
-		if(!team.IsValid()) {
+		// for Teams without an image (e.g. the "Kernel-Team").
+		// All other teams only have no image while they are
+		// shutting down.
+		if(id != B_SYSTEM_TEAM) {
 			initResult = B_BAD_TEAM_ID;
 			return;
 		}
 
-		// for Teams without an image (e.g. the "Kernel-Team").
-		
-		if(id == B_SYSTEM_TEAM) {
-			// the Kernel-Team has always team-id B_SYSTEM_TEAM (2).
-			systemTeam = true;
-			idleTeam = true;
-		}
-		
-		SetName(teamInfo.args);
+		// the Kernel-Team has always team-id B_SYSTEM_TEAM (2).
+		systemTeam = true;
+		idleTeam = true;
 	}
 
-	Update(teamInfo);	
-	
 	initResult = B_OK;
 }
 
+CTeamModelEntry::~CTeamModelEntry()
+{
+	delete threadModel;
+
+	id = -1;
+}
+
+CThreadModel *CTeamModelEntry::ThreadModel()
+{
+	if(threadModel == NULL) {
+		threadModel = new CThreadModel(id);
+
+		const CSystemSnapshot *snapshot = acquire_system_snapshot(SNAPSHOT_THREADS);
+
+		if(snapshot != NULL) {
+			threadModel->Update(snapshot, snapshot->FindTeam(id));
+
+			release_system_snapshot(snapshot);
+		}
+	}
+
+	return threadModel;
+}
+
 BHandler *CTeamModelEntry::ResolveSpecifier(BMessage *message, int32 index,
       BMessage *specifier, int32 what, const char *property)
 {
@@ -248,29 +311,54 @@ void CTeamModelEntry::Update(const team_info &teamInfo)
 {
 	thread_info threadInfo;
 		
-	userTime=0;
-	kernelTime=0;
+	bigtime_t newUserTime=0;
+	bigtime_t newKernelTime=0;
 	
 	int32 cookie = 0;
 	ssize_t scookie = 0;
 	
 	while(get_next_thread_info(id, &cookie, &threadInfo) == B_OK) {
-		userTime   += threadInfo.user_time;
-		kernelTime += threadInfo.kernel_time;
+		newUserTime   += threadInfo.user_time;
+		newKernelTime += threadInfo.kernel_time;
 	}
 	
-	threadCount = teamInfo.thread_count;
-	areaCount   = teamInfo.area_count;
-	imageCount  = teamInfo.image_count;
-	
 	scookie = 0;	
-	areaSize = 0;
+	size_t newAreaSize = 0;
 		
 	area_info areaInfo;
 		
 	while(get_next_area_info(id, &scookie, &areaInfo) == B_OK) {
-		areaSize += areaInfo.ram_size;
+		newAreaSize += areaInfo.ram_size;
 	}
+
+	parentId = teamInfo.parent;
+
+	SetValues(newUserTime, newKernelTime, teamInfo.thread_count,
+		teamInfo.area_count, teamInfo.image_count, newAreaSize);
+}
+
+// Update
+// Copies the values of team 'index' from 'snapshot'. The snapshot
+// must contain the SNAPSHOT_THREADS and SNAPSHOT_AREAS parts.
+// Returns true, if any value changed.
+bool CTeamModelEntry::Update(const CSystemSnapshot *snapshot, int32 index)
+{
+	MY_ASSERT(snapshot->TeamId(index) == id);
+
+	team_id oldParentId = parentId;
+
+	parentId = snapshot->TeamParentId(index);
+
+	changed = SetValues(snapshot->TeamUserTime(index), snapshot->TeamKernelTime(index),
+		snapshot->TeamThreadCount(index), snapshot->TeamAreaCount(index),
+		snapshot->TeamImageCount(index), snapshot->TeamAreaSize(index));
+
+	if(threadModel)
+		threadModel->Update(snapshot, index);
+
+	changed = changed || parentId != oldParentId;
+
+	return changed;
 }
 
 void CTeamModelEntry::Update()
@@ -280,12 +368,29 @@ void CTeamModelEntry::Update()
 	if(get_team_info(id, &teamInfo) == B_OK) {
 		Update(teamInfo);
 	} else {
-		userTime = kernelTime = 0;
-		
-		threadCount = areaCount = imageCount = 0;
+		SetValues(0, 0, 0, 0, 0, areaSize);
 	}
 }
 
+// SetValues
+// Sets the values of this team. Returns true, if any value changed.
+bool CTeamModelEntry::SetValues(bigtime_t newUserTime, bigtime_t newKernelTime,
+	int32 newThreadCount, int32 newAreaCount, int32 newImageCount, size_t newAreaSize)
+{
+	bool differs = newUserTime != userTime || newKernelTime != kernelTime ||
+		newThreadCount != threadCount || newAreaCount != areaCount ||
+		newImageCount != imageCount || newAreaSize != areaSize;
+
+	userTime	= newUserTime;
+	kernelTime	= newKernelTime;
+	threadCount	= newThreadCount;
+	areaCount	= newAreaCount;
+	imageCount	= newImageCount;
+	areaSize	= newAreaSize;
+
+	return differs;
+}
+
 void CTeamModelEntry::MessageReceived(BMessage *message)
 {
 	switch(message->what)
@@ -318,11 +423,9 @@ void CTeamModelEntry::MessageReceived(BMessage *message)
 					} else if(strcmp(property, TEAM_MODEL_ENTRY_PROP_IMAGE_COUNT) == 0) {
 						reply.AddInt32("result", imageCount);
 					} else if(strcmp(property, TEAM_MODEL_ENTRY_PROP_PRIORITY) == 0) {
-						CTeam team(id);
-						
 						int32 prio;
 						
-						result = team.GetBasePriority(prio);
+						result = ThreadModel()->GetBasePriority(prio);
 					
 						if(result == B_OK) {
 							reply.AddInt32("result", prio);
@@ -448,6 +551,8 @@ void CTeamModelEntry::MessageReceived(BMessage *message)
 
 // ====== CTeamModel ======
 
+const int32 CTeamModel::MAX_TOP_TEAMS = 10;
+
 CTeamModel::CTeamModel(BLooper *looper) :
 	BHandler("TeamModel")
 {
@@ -457,6 +562,11 @@ CTeamModel::CTeamModel(BLooper *looper) :
 
 	messageRunner = NULL;
 
+	generation = 0;
+
+	for(int i=0 ; i<TOP_TEAMS_METRIC_COUNT ; i++)
+		topTeams[i] = new CTopKTracker(MAX_TOP_TEAMS);
+
 	// Tell roster to send messages, when an (desktop)
 	// application is launched or closed.
 	be_roster->StartWatching(this);	
@@ -466,6 +576,9 @@ CTeamModel::~CTeamModel()
 {
 	delete messageRunner;
 
+	for(int i=0 ; i<TOP_TEAMS_METRIC_COUNT ; i++)
+		delete topTeams[i];
+
 	be_roster->StopWatching(this);
 }
 
@@ -488,70 +601,235 @@ void CTeamModel::StartUpdate(bigtime_t pulseRate)
 	Update();
 }
 
-void CTeamModel::AddTeam(team_id id)
+// AddTeam
+// Adds a team the roster told me about. 'ref' is the app's executable.
+void CTeamModel::AddTeam(team_id id, const entry_ref *ref)
 {
+	if(teamIndex.Touch(id, generation) != NULL) {
+		// Already part of the model. This happens if the roster
+		// notifies me about a team I found during the last Update().
+		return;
+	}
+
 	team_info teamInfo;
-	get_team_info(id, &teamInfo);
+	BEntry appEntry(ref);
+	BPath appPath(&appEntry);
+	node_ref nodeRef;
 
-	AddTeam(&teamInfo);	
+	if(get_team_info(id, &teamInfo) != B_OK ||
+	   appPath.InitCheck() != B_OK ||
+	   appEntry.GetNodeRef(&nodeRef) != B_OK)
+		return;
+
+	CTeamModelEntry *entry = new CTeamModelEntry(id, teamInfo.parent,
+		appPath.Path(), nodeRef.device, nodeRef.node, ref->name);
+
+	entry->Update(teamInfo);
+
+	AddEntry(entry);
 }
 
-void CTeamModel::AddTeam(team_info *teamInfo)
+// AddTeam
+// Adds team 'index' of 'snapshot'. No kernel call is made.
+void CTeamModel::AddTeam(const CSystemSnapshot *snapshot, int32 index)
 {
-	CTeamModelEntry *entry = new CTeamModelEntry(*teamInfo);
+	CTeamModelEntry *entry = new CTeamModelEntry(snapshot->TeamId(index),
+		snapshot->TeamParentId(index), snapshot->TeamPath(index),
+		snapshot->TeamAppDevice(index), snapshot->TeamAppNode(index),
+		snapshot->TeamName(index));
+
+	entry->Update(snapshot, index);
 
+	AddEntry(entry);
+}
+
+void CTeamModel::AddEntry(CTeamModelEntry *entry)
+{
 	if(entry->InitCheck() == B_OK) {
 		entryList.AddItem(entry);
-		
+		teamIndex.Insert(entry->TeamId(), entry, generation);
+
+		Link(entry);
+		UpdateTopTeams(entry);
+
+		batch.added.AddItem(entry);
+	} else {
+		delete entry;
+	}
+}
+
+// DetachEntry
+// Removes the entry from everything but the entry list. It's
+// deleted by SendBatch().
+void CTeamModel::DetachEntry(CTeamModelEntry *entry)
+{
+	// Entries are only added to the looper, if they are
+	// addressed by a script.
+	if(entry->Looper() != NULL)
+		Looper()->RemoveHandler(entry);
+
+	teamIndex.Remove(entry->TeamId());
+
+	for(int i=0 ; i<TOP_TEAMS_METRIC_COUNT ; i++)
+		topTeams[i]->Remove(entry->TeamId());
+
+	// The children become roots.
+	Unlink(entry);
+
+	for(int32 i=0 ; i<entry->CountChildren() ; i++)
+		entry->ChildAt(i)->parent = NULL;
+
+	entry->children.MakeEmpty();
+
+	// An entry removed here was neither added nor updated in the
+	// same batch: Update() only removes entries it didn't find.
+	batch.removed.AddItem(entry);
+}
+
+// ScriptTarget
+// Returns 'entry' as target of a scripting message. The entry is
+// added to the looper on first use.
+BHandler *CTeamModel::ScriptTarget(CTeamModelEntry *entry)
+{
+	if(entry->Looper() == NULL)
 		Looper()->AddHandler(entry);
-		
-		BMessage msg;
-		
-		int32 index = entryList.CountItems()-1;
-		
-		msg.AddPointer(MESSAGE_DATA_ID_ITEM, entry);
-		msg.AddInt32(MESSAGE_DATA_ID_INDEX, index);
-		msg.AddInt32(MESSAGE_DATA_ID_TEAM_ID, entry->TeamId());
-		
-		SendNotices(MSG_NOTIFY_ITEM_ADDED, &msg);
-		
-		for(int i=0 ; i<listeners.CountItems() ; i++) {
-			ITeamModelListener *l = static_cast<ITeamModelListener *>(listeners.ItemAt(i));
-			
-			l->ItemAdded(entry, index);
+
+	return entry;
+}
+
+// UpdateTopTeams
+// Passes the values of 'entry' to the top teams trackers. The
+// trackers only reorder if a value differs from the last one.
+// The idle team isn't ranked by CPU usage, it would always lead.
+void CTeamModel::UpdateTopTeams(CTeamModelEntry *entry)
+{
+	team_id id = entry->TeamId();
+
+	if(!entry->IsIdleTeam())
+		topTeams[TOP_TEAMS_CPU]->SetDelta(id, entry->UserTime()+entry->KernelTime(), generation);
+
+	topTeams[TOP_TEAMS_AREA_SIZE]->Set(id, entry->AreaSize(), generation);
+	topTeams[TOP_TEAMS_THREAD_COUNT]->Set(id, entry->ThreadCount(), generation);
+	topTeams[TOP_TEAMS_AREA_COUNT]->Set(id, entry->AreaCount(), generation);
+}
+
+int32 CTeamModel::GetTopTeams(top_team_metric metric, CTeamModelEntry **entries,
+	int32 maxCount, int64 *values)
+{
+	MY_ASSERT(metric >= 0 && metric < TOP_TEAMS_METRIC_COUNT);
+
+	CTopKTracker *tracker = topTeams[metric];
+
+	int32 count = MIN(maxCount, tracker->CountTop());
+
+	for(int32 i=0 ; i<count ; i++) {
+		entries[i] = teamIndex.Find(tracker->TopIdAt(i));
+
+		if(values)
+			values[i] = tracker->TopValueAt(i);
+	}
+
+	return count;
+}
+
+// Link
+// Moves 'entry' (and its subtree) below the entry of its parent team.
+void CTeamModel::Link(CTeamModelEntry *entry)
+{
+	CTeamModelEntry *newParent = NULL;
+
+	if(entry->ParentId() != entry->TeamId())
+		newParent = teamIndex.Find(entry->ParentId());
+
+	// Team IDs are reused. Never make an entry its own ancestor.
+	for(CTeamModelEntry *e=newParent ; e!=NULL ; e=e->parent) {
+		if(e == entry) {
+			newParent = NULL;
+			break;
 		}
 	}
+
+	if(newParent == entry->parent)
+		return;
+
+	Unlink(entry);
+
+	if(newParent != NULL) {
+		entry->parent = newParent;
+		newParent->children.AddItem(entry);
+	}
+}
+
+// Unlink
+// Makes 'entry' a root.
+void CTeamModel::Unlink(CTeamModelEntry *entry)
+{
+	CTeamModelEntry *oldParent = entry->parent;
+
+	if(oldParent == NULL)
+		return;
+
+	oldParent->children.RemoveItem(entry);
+	entry->parent = NULL;
 }
 
-void CTeamModel::RemoveEntryAt(int index)
+// SendBatch
+// Records the added and removed teams since the last call in the journal
+// and notifies observers and listeners about all changes. Observers get a
+// single MSG_NOTIFY_ITEMS_CHANGED notice, which carries the sequence number
+// of the last journal event.
+void CTeamModel::SendBatch()
 {
-	CTeamModelEntry *entry = entryList.RemoveItem(index);
-	Looper()->RemoveHandler(entry);
+	if(batch.IsEmpty())
+		return;
 
 	BMessage msg;
 
-	msg.AddPointer(MESSAGE_DATA_ID_ITEM, entry);
-	msg.AddInt32(MESSAGE_DATA_ID_INDEX, index);
-	msg.AddInt32(MESSAGE_DATA_ID_TEAM_ID, entry->TeamId());
-	
-	SendNotices(MSG_NOTIFY_ITEM_REMOVED, &msg);
+	// Removals first: a reused team id must end up as added.
+	for(int32 i=0 ; i<batch.CountRemoved() ; i++) {
+		team_id id = batch.RemovedAt(i)->TeamId();
+
+		journal.Append(TEAM_EVENT_REMOVED, id);
+		msg.AddInt32(MESSAGE_DATA_ID_REMOVED_TEAM_ID, id);
+	}
+
+	for(int32 i=0 ; i<batch.CountAdded() ; i++) {
+		team_id id = batch.AddedAt(i)->TeamId();
+
+		journal.Append(TEAM_EVENT_ADDED, id);
+		msg.AddInt32(MESSAGE_DATA_ID_ADDED_TEAM_ID, id);
+	}
+
+	for(int32 i=0 ; i<batch.CountUpdated() ; i++)
+		msg.AddInt32(MESSAGE_DATA_ID_UPDATED_TEAM_ID, batch.UpdatedAt(i)->TeamId());
+
+	batch.sequence = journal.LastSequence();
+
+	msg.AddInt64(MESSAGE_DATA_ID_SEQUENCE, batch.sequence);
+
+	SendNotices(MSG_NOTIFY_ITEMS_CHANGED, &msg);
 
 	for(int i=0 ; i<listeners.CountItems() ; i++) {
 		ITeamModelListener *l = static_cast<ITeamModelListener *>(listeners.ItemAt(i));
 		
-		l->ItemRemoved(entry, index);
+		l->ItemsChanged(batch);
 	}
-	
-	delete entry;
+
+	for(int32 i=0 ; i<batch.CountRemoved() ; i++)
+		delete batch.RemovedAt(i);
+
+	batch.added.MakeEmpty();
+	batch.removed.MakeEmpty();
+	batch.updated.MakeEmpty();
 }
 
 void CTeamModel::RemoveTeam(team_id id)
 {
-	for(int i=0 ; i<entryList.CountItems() ; i++) {
-		if(entryList.ItemAt(i)->TeamId() == id) {
-			RemoveEntryAt(i);
-			break;
-		}
+	CTeamModelEntry *entry = teamIndex.Find(id);
+
+	if(entry != NULL) {
+		entryList.RemoveItem(entry);
+		DetachEntry(entry);
 	}
 }
 
@@ -567,56 +845,67 @@ CTeamModelEntry *CTeamModel::EntryAt(int32 index)
 
 void CTeamModel::Update()
 {
-	// create a list of all teams.
-	CPointerList<team_info> teamList;
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(SNAPSHOT_ALL);
 
-	team_info *teamInfo=new team_info;
-	int32 cookie=0;
-	
-	while(get_next_team_info(&cookie, teamInfo) == B_OK) {
-		teamList.AddItem(teamInfo);
-		teamInfo = new team_info;
-	}		
+	if(snapshot != NULL) {
+		Update(snapshot);
 
-	// delete last team_info, which wasn't added to list
-	delete teamInfo;
+		release_system_snapshot(snapshot);
+	}
+}
 
-	// remove all all entries from the list, which aren't part of
-	// the teamList. Update all other entries.
-	for(int i=0 ; i<entryList.CountItems() ; i++) {
-		bool found = false;
-	
-		for(int k=0 ; k<teamList.CountItems() ; k++) {
-			CTeamModelEntry *listEntry = entryList.ItemAt(i);
-			team_info *teamListItem = teamList.ItemAt(k);
-			
-			if(listEntry->TeamId() == teamListItem->team) {
-				// found in team list. 
-				
-				// Update the entry
-				listEntry->Update(*teamListItem);
-				
-				teamListItem->team = INT_MAX;
-				
-				found = true;
-				break;
-			}
-		}
-		
-		if(!found) {
-			// not in team list. Remove from list view.
-			RemoveEntryAt(i--);
+// Update
+// Synchronizes the model with 'snapshot'. Every team found in the
+// snapshot is stamped with the current generation in the team index;
+// entries left with an older stamp afterwards belong to teams which
+// have quit. Both passes are linear in the number of teams and no
+// kernel walk is done for teams already in the model.
+void CTeamModel::Update(const CSystemSnapshot *snapshot)
+{
+	generation++;
+
+	// Update all known entries and add the new ones.
+	for(int32 i=0 ; i<snapshot->CountTeams() ; i++) {
+		team_id id = snapshot->TeamId(i);
+
+		CTeamModelEntry *entry = teamIndex.Touch(id, generation);
+
+		if(entry != NULL) {
+			if(entry->Update(snapshot, i))
+				batch.updated.AddItem(entry);
+
+			UpdateTopTeams(entry);
+		} else {
+			AddTeam(snapshot, i);
 		}
 	}
-	
-	// add all new entries.
-	for(int i=0 ; i<teamList.CountItems() ; i++) {
-		team_info *item = (team_info *)teamList.ItemAt(i);
 
-		if(item->team != INT_MAX) {
-			AddTeam(item);
-		}
+	// Remove all entries, which weren't stamped in this update, in
+	// a single sweep: the remaining entries are moved to the front.
+	CPointerList<CTeamModelEntry>::iterator entries = entryList.Begin();
+	int32 entryCount = entryList.CountItems();
+	int32 keptCount = 0;
+
+	for(int32 i=0 ; i<entryCount ; i++) {
+		if(teamIndex.IsCurrent(entries[i]->TeamId(), generation))
+			entries[keptCount++] = entries[i];
+		else
+			DetachEntry(entries[i]);
 	}
+
+	if(keptCount < entryCount)
+		entryList.RemoveItems(keptCount, entryCount-keptCount);
+
+	// Relink entries whose parent changed or whose parent appeared.
+	// Orphans are adopted by another team, so this is rare.
+	for(int i=0 ; i<entryList.CountItems() ; i++) {
+		CTeamModelEntry *entry = entryList.ItemAt(i);
+
+		if(entry->Parent() == NULL || entry->Parent()->TeamId() != entry->ParentId())
+			Link(entry);
+	}
+
+	SendBatch();
 }
 
 void CTeamModel::SetPulseRate(bigtime_t rate)
@@ -653,9 +942,12 @@ void CTeamModel::MessageReceived(BMessage *message)
 		case B_SOME_APP_LAUNCHED:
 			{
 				team_id id;
+				entry_ref ref;
 				
-				if(message->FindInt32("be:team", &id) == B_OK) {
-					AddTeam(id);
+				if(message->FindInt32("be:team", &id) == B_OK &&
+				   message->FindRef("be:ref", &ref) == B_OK) {
+					AddTeam(id, &ref);
+					SendBatch();
 				}
 			}
 			break;
@@ -665,6 +957,7 @@ void CTeamModel::MessageReceived(BMessage *message)
 			
 				if(message->FindInt32("be:team", &id) == B_OK) {
 					RemoveTeam(id);
+					SendBatch();
 				}
 			}
 			break;
@@ -692,13 +985,83 @@ void CTeamModel::MessageReceived(BMessage *message)
 				BHandler::MessageReceived(message);
 			}
 			break;
+		case B_GET_PROPERTY:
+			{
+				int32 index;
+				BMessage specifier;
+				int32 what;
+				const char *property;
+				
+				if(message->GetCurrentSpecifier(&index, &specifier, &what, &property) == B_OK &&
+				   what == B_DIRECT_SPECIFIER) {
+					int32 count;
+
+					if(GetCountProperty(property, &count)) {
+						message->PopSpecifier();
+
+						BMessage reply(B_REPLY);
+						reply.AddInt32("result", count);
+
+						send_script_reply(reply, B_OK, message);
+
+						return;
+					}
+
+					int32 metric = top_teams_metric(property);
+
+					if(metric >= 0) {
+						message->PopSpecifier();
+
+						CTeamModelEntry *entries[MAX_TOP_TEAMS];
+
+						int32 count = GetTopTeams((top_team_metric)metric, entries, MAX_TOP_TEAMS);
+
+						BMessage reply(B_REPLY);
+
+						for(int32 i=0 ; i<count ; i++)
+							reply.AddInt32("result", entries[i]->TeamId());
+
+						send_script_reply(reply, B_OK, message);
+						
+						return;
+					}
+				}
+				
+				BHandler::MessageReceived(message);
+			}
+			break;
 		default:
 			BHandler::MessageReceived(message);
 	}
 }
 
+// GetCountProperty
+// Returns false, if 'property' isn't one of the count properties.
+// Otherwise 'value' (if not NULL) receives its value.
+bool CTeamModel::GetCountProperty(const char *property, int32 *value)
+{
+	int32 count;
+
+	if(strcmp(property, TEAM_MODEL_PROP_EXECUTABLE_CACHE_HITS) == 0)
+		count = CExecutableInfoCache::CreateInstance()->Hits();
+	else if(strcmp(property, TEAM_MODEL_PROP_EXECUTABLE_CACHE_MISSES) == 0)
+		count = CExecutableInfoCache::CreateInstance()->Misses();
+	else
+		return false;
+
+	if(value)
+		*value = count;
+
+	return true;
+}
+
 BHandler *CTeamModel::ResolveSpecifier(BMessage *message, int32 index, BMessage *specifier, int32 what, const char *property)
 {
+	if(message->what == B_GET_PROPERTY && what == B_DIRECT_SPECIFIER &&
+	   (top_teams_metric(property) >= 0 || GetCountProperty(property, NULL))) {
+		return this;
+	}
+
 	if(strcmp(property, TEAM_MODEL_PROP_TEAM) == 0) {
 		BMessage reply;
 	
@@ -713,7 +1076,7 @@ BHandler *CTeamModel::ResolveSpecifier(BMessage *message, int32 index, BMessage
 				for(int i=0 ; i<CountEntries() ; i++) {
 					if(strcmp(EntryAt(i)->Name(), name) == 0) {
 						message->PopSpecifier();
-						return EntryAt(i);
+						return ScriptTarget(EntryAt(i));
 					}
 				}
 			}
@@ -724,13 +1087,12 @@ BHandler *CTeamModel::ResolveSpecifier(BMessage *message, int32 index, BMessage
 		if(what == B_ID_SPECIFIER) {
 			int32 id;
 		
-			if(specifier->FindInt32("id", &id) == B_OK) {
-				for(int i=0 ; i<CountEntries() ; i++) {
-					if(EntryAt(i)->TeamId() == id) {
-						message->PopSpecifier();
-						return EntryAt(i);
-					}
-				}
+			CTeamModelEntry *entry;
+
+			if(specifier->FindInt32("id", &id) == B_OK &&
+			   (entry = teamIndex.Find(id)) != NULL) {
+				message->PopSpecifier();
+				return ScriptTarget(entry);
 			}
 			
 			send_script_reply(reply, B_BAD_VALUE, message);
@@ -743,7 +1105,7 @@ BHandler *CTeamModel::ResolveSpecifier(BMessage *message, int32 index, BMessage
 			if(specifier->FindInt32("index", &index) == B_OK) {
 				if(index >= 0 && index < CountEntries()) {
 					message->PopSpecifier();
-					return EntryAt(index);
+					return ScriptTarget(EntryAt(index));
 				} else {
 					send_script_reply(reply, B_BAD_INDEX, message);
 					return NULL;
@@ -759,7 +1121,7 @@ BHandler *CTeamModel::ResolveSpecifier(BMessage *message, int32 index, BMessage
 			if(specifier->FindInt32("index", &index) == B_OK) {
 				if(index >= 0 && index<CountEntries()) {
 					message->PopSpecifier();
-					return EntryAt(CountEntries()-index-1);
+					return ScriptTarget(EntryAt(CountEntries()-index-1));
 				} else {
 					send_script_reply(reply, B_BAD_INDEX, message);
 					return NULL;
@@ -797,6 +1159,48 @@ status_t CTeamModel::GetSupportedSuites(BMessage *message)
 			"",										// usage
 			0										// extra_data
 		},
+		{ 										// 3rd property
+			(char *)TEAM_MODEL_PROP_TOP_CPU,		// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 4th property
+			(char *)TEAM_MODEL_PROP_TOP_MEMORY,		// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 5th property
+			(char *)TEAM_MODEL_PROP_TOP_THREADS,	// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 6th property
+			(char *)TEAM_MODEL_PROP_TOP_AREAS,		// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 7th property
+			(char *)TEAM_MODEL_PROP_EXECUTABLE_CACHE_HITS,	// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
+		{ 										// 8th property
+			(char *)TEAM_MODEL_PROP_EXECUTABLE_CACHE_MISSES,	// name
+			{ B_GET_PROPERTY, 0 },					// commands
+			{ B_DIRECT_SPECIFIER, 0 },				// specifiers
+			"",										// usage
+			0										// extra_data
+		},
 		{										// terminate list
 			0,
 			{ 0 },
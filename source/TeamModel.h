@@ -18,14 +18,34 @@
 #ifndef TEAM_MODEL_H
 #define TEAM_MODEL_H
 
+#include "IdIndex.h"
+#include "TeamJournal.h"
+
+class CSystemSnapshot;
+class CThreadModel;
+class CTopKTracker;
+
+// ====== Types ======
+
+// Values by which CTeamModel ranks the teams.
+enum top_team_metric {
+	TOP_TEAMS_CPU,					// CPU time used since the last update
+	TOP_TEAMS_AREA_SIZE,
+	TOP_TEAMS_THREAD_COUNT,
+	TOP_TEAMS_AREA_COUNT,
+	TOP_TEAMS_METRIC_COUNT
+};
+
 // ====== Message IDs ======
 
-const int32 MSG_NOTIFY_ITEM_ADDED		= 'nTMA';
-const int32 MSG_NOTIFY_ITEM_REMOVED		= 'nTMR';
+const int32 MSG_NOTIFY_ITEMS_CHANGED	= 'nTMC';
 
 // ====== Message Fields ======
 
-extern const char * const MESSAGE_DATA_ID_ITEM;					// CTeamModelEntry *
+extern const char * const MESSAGE_DATA_ID_ADDED_TEAM_ID;		// int32 (array)
+extern const char * const MESSAGE_DATA_ID_REMOVED_TEAM_ID;		// int32 (array)
+extern const char * const MESSAGE_DATA_ID_UPDATED_TEAM_ID;		// int32 (array)
+extern const char * const MESSAGE_DATA_ID_SEQUENCE;				// int64
 
 // ====== Scripting Properties ======
 
@@ -40,12 +60,21 @@ extern const char * const TEAM_MODEL_ENTRY_PROP_IMAGE_COUNT;	// int32
 
 // TeamModel
 extern const char * const TEAM_MODEL_PROP_TEAM;					// TeamModelEntry
+extern const char * const TEAM_MODEL_PROP_TOP_CPU;				// int32 (array of team ids)
+extern const char * const TEAM_MODEL_PROP_TOP_MEMORY;			// int32 (array of team ids)
+extern const char * const TEAM_MODEL_PROP_TOP_THREADS;			// int32 (array of team ids)
+extern const char * const TEAM_MODEL_PROP_TOP_AREAS;			// int32 (array of team ids)
+extern const char * const TEAM_MODEL_PROP_EXECUTABLE_CACHE_HITS;	// int32
+extern const char * const TEAM_MODEL_PROP_EXECUTABLE_CACHE_MISSES;	// int32
 
 class CTeamModelEntry : public BHandler
 {
 	public:
-	CTeamModelEntry(const team_info &teamInfo);
-	virtual ~CTeamModelEntry() { id = -1; }
+	// 'path' is the path of the team's app image (NULL, if the team
+	// has none), 'device' and 'node' identify the image file.
+	CTeamModelEntry(team_id id, team_id parentId, const char *path,
+		dev_t device, ino_t node, const char *name);
+	virtual ~CTeamModelEntry();
 
 	virtual void MessageReceived(BMessage *message);
 	virtual BHandler *ResolveSpecifier(BMessage *message, int32 index,
@@ -57,6 +86,8 @@ class CTeamModelEntry : public BHandler
 	bool		IsSystemTeam() const	{ return systemTeam;  }
 	bool		IsIdleTeam() const		{ return idleTeam;    }
 	BPath		FileName() const		{ return fileName;    }
+	dev_t		AppDevice() const		{ return appDevice;   }
+	ino_t		AppNode() const			{ return appNode;     }
 	int32   	ThreadCount() const		{ return threadCount; }
 	int32   	ImageCount() const		{ return imageCount;  }
 	int32   	AreaCount()	const		{ return areaCount;	  }
@@ -64,13 +95,32 @@ class CTeamModelEntry : public BHandler
 	bigtime_t 	UserTime() const		{ return userTime;	  }
 	size_t		AreaSize() const		{ return areaSize;    }
 
+	// True, if the last update changed any value.
+	bool		Changed() const			{ return changed;     }
+
+	// Process tree. The parent is NULL, if the parent team isn't
+	// part of the model.
+	team_id		ParentId() const		{ return parentId;    }
+	CTeamModelEntry *Parent() const		{ return parent;      }
+	int32		CountChildren() const	{ return children.CountItems(); }
+	CTeamModelEntry *ChildAt(int32 i) const { return (CTeamModelEntry *)children.ItemAt(i); }
+
+	// The thread model is created on first use. From then on it's
+	// updated together with this entry.
+	CThreadModel *ThreadModel();
+
 	void Update();
 	void Update(const team_info &teamInfo);
+	bool Update(const CSystemSnapshot *snapshot, int32 index);
 	
 	protected:
-	
+	bool SetValues(bigtime_t newUserTime, bigtime_t newKernelTime, int32 newThreadCount,
+		int32 newAreaCount, int32 newImageCount, size_t newAreaSize);
+
 	team_id 	id;					// team_id
 	BPath	    fileName;
+	dev_t		appDevice;			// of the app image
+	ino_t		appNode;
 	int32		threadCount;
 	int32		imageCount;
 	int32		areaCount;
@@ -80,23 +130,69 @@ class CTeamModelEntry : public BHandler
 	status_t	initResult;
 	bool		systemTeam;			// is team part of operating system??
 	bool		idleTeam;			// is this team the idle task??
+	bool		changed;
+	CThreadModel *threadModel;		// NULL until first used
+
+	team_id		parentId;
+	CTeamModelEntry *parent;		// maintained by CTeamModel
+	BList		children;
+
+	friend class CTeamModel;
+};
+
+typedef CIdIndex<CTeamModelEntry> CTeamIndex;
+
+//: Set of changes made to the team model in one step.
+// The entries in the removed list are already removed from the model,
+// but they are deleted after all listeners were notified. The updated
+// list only contains entries whose values changed.
+class CTeamModelBatch
+{
+	public:
+	CTeamModelBatch() { sequence = 0; }
+
+	// Journal sequence number of the last event of this batch.
+	int64 Sequence() const						{ return sequence; }
+
+	int32 CountAdded() const					{ return added.CountItems(); }
+	int32 CountRemoved() const					{ return removed.CountItems(); }
+	int32 CountUpdated() const					{ return updated.CountItems(); }
+
+	CTeamModelEntry *AddedAt(int32 i) const		{ return (CTeamModelEntry *)added.ItemAt(i); }
+	CTeamModelEntry *RemovedAt(int32 i) const	{ return (CTeamModelEntry *)removed.ItemAt(i); }
+	CTeamModelEntry *UpdatedAt(int32 i) const	{ return (CTeamModelEntry *)updated.ItemAt(i); }
+
+	bool IsEmpty() const
+	{
+		return added.IsEmpty() && removed.IsEmpty() && updated.IsEmpty();
+	}
+
+	protected:
+	BList added;
+	BList removed;
+	BList updated;
+	int64 sequence;
+
+	friend class CTeamModel;
 };
 
 class ITeamModelListener
 {
 	public:
-	virtual void ItemAdded(CTeamModelEntry *entry, int32 index) = 0;
-	virtual void ItemRemoved(CTeamModelEntry *entry, int32 index) = 0;
+	// Called once for every batch of changes.
+	virtual void ItemsChanged(const CTeamModelBatch &batch) = 0;
 };
 
 //: Model for team views.
 // The model contains a list of the currently running teams in the system.
 // Every team is represented as CTeamModelEntry which contains additional
-// information about the team.
+// information about the team. The entries are linked to a process tree.
+// Sums over a subtree are kept by the CSystemSnapshot.
 // A view can choose two ways of notifications about model changes:
 // - synchronous: by attaching a CTeamModelListener to the model.
-// - asynchronous: by listening for MSG_NOTIFY_ITEM_ADDED and
-//   MSG_NOTIFY_ITEM_REMOVED notifications.
+// - asynchronous: by listening for MSG_NOTIFY_ITEMS_CHANGED notifications.
+// Added and removed teams are also recorded in a journal, so a consumer
+// which ignored some batches (e.g. while hidden) can catch up later.
 class CTeamModel : public BHandler
 {
 	public:
@@ -105,6 +201,10 @@ class CTeamModel : public BHandler
 
 	int32 CountEntries() const;
 	CTeamModelEntry *EntryAt(int32 index);
+	CTeamModelEntry *FindEntry(team_id id) const	{ return teamIndex.Find(id); }
+
+	// Every added and removed team is recorded in the journal.
+	const CTeamJournal *Journal() const				{ return &journal; }
 
 	virtual void MessageReceived(BMessage *message);
 	virtual BHandler *ResolveSpecifier(BMessage *message, int32 index,
@@ -116,19 +216,43 @@ class CTeamModel : public BHandler
 	void StartUpdate(bigtime_t pulseRate);
 
 	void Update();
+	void Update(const CSystemSnapshot *snapshot);
+
+	// Copies the (at most MAX_TOP_TEAMS) teams with the largest
+	// 'metric' into 'entries', largest first. If 'values' isn't NULL
+	// it receives the values. Returns the number of entries. O(maxCount).
+	int32 GetTopTeams(top_team_metric metric, CTeamModelEntry **entries,
+		int32 maxCount, int64 *values=NULL);
+
+	static const int32 MAX_TOP_TEAMS;
 
 	void AddTeamModelListener(ITeamModelListener *l);
 	void RemoveTeamModelListener(ITeamModelListener *l);
 	
 	protected:
-	void AddTeam(team_id id);
-	void AddTeam(team_info *teamInfo);
+	void AddTeam(team_id id, const entry_ref *ref);
+	void AddTeam(const CSystemSnapshot *snapshot, int32 index);
+	void AddEntry(CTeamModelEntry *entry);
+	bool GetCountProperty(const char *property, int32 *value);
 	void RemoveTeam(team_id id);
-	void RemoveEntryAt(int index);
+	void DetachEntry(CTeamModelEntry *entry);
+	BHandler *ScriptTarget(CTeamModelEntry *entry);
+	void Link(CTeamModelEntry *entry);
+	void Unlink(CTeamModelEntry *entry);
+	void SendBatch();
+	void UpdateTopTeams(CTeamModelEntry *entry);
 
 	BMessageRunner *messageRunner;
 	CPointerList<CTeamModelEntry> entryList;
 	BList listeners;
+	CTeamModelBatch batch;					// changes not yet sent to listeners
+
+	CTeamIndex	 teamIndex;
+	CTeamJournal journal;
+	uint32		 generation;			// incremented on every Update()
+
+	CTopKTracker *topTeams[TOP_TEAMS_METRIC_COUNT];
+
 };
 
 #endif // TEAM_MODEL_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "PointerList.h"
+#include "SystemSnapshot.h"
+#include "ThreadModel.h"
+
+// ====== CThreadModelEntry ======
+
+CThreadModelEntry::CThreadModelEntry(const CSystemSnapshot *snapshot, int32 index)
+{
+	id = snapshot->ThreadId(index);
+	name = snapshot->ThreadName(index);
+
+	userTime = kernelTime = 0;
+
+	Update(snapshot, index);
+
+	// A new thread didn't use any time yet, from the model's view.
+	userTimeDelta = kernelTimeDelta = 0;
+}
+
+void CThreadModelEntry::Update(const CSystemSnapshot *snapshot, int32 index)
+{
+	MY_ASSERT(snapshot->ThreadId(index) == id);
+
+	bigtime_t newUserTime	= snapshot->ThreadUserTime(index);
+	bigtime_t newKernelTime	= snapshot->ThreadKernelTime(index);
+
+	userTimeDelta	= newUserTime - userTime;
+	kernelTimeDelta	= newKernelTime - kernelTime;
+
+	userTime	= newUserTime;
+	kernelTime	= newKernelTime;
+	priority	= snapshot->ThreadPriority(index);
+	state		= snapshot->ThreadState(index);
+
+	if(strcmp(name.String(), snapshot->ThreadName(index)) != 0) {
+		// threads may rename themselves (rename_thread()).
+		name = snapshot->ThreadName(index);
+	}
+}
+
+// ====== CThreadModel ======
+
+CThreadModel::CThreadModel(team_id team) :
+	threadIndex(16)
+{
+	teamId			= team;
+	generation		= 0;
+	lastUpdateTime	= 0;
+	updateInterval	= 0;
+}
+
+CThreadModel::~CThreadModel()
+{
+}
+
+// Update
+// Synchronizes the model with the threads of team 'teamIndex' in
+// 'snapshot'. The threads of a team are stored consecutive in the
+// snapshot, so only this range is visited.
+void CThreadModel::Update(const CSystemSnapshot *snapshot, int32 teamIndex)
+{
+	MY_ASSERT(snapshot->Contents() & SNAPSHOT_THREADS);
+
+	generation++;
+
+	added.MakeEmpty();
+	removed.MakeEmpty();
+
+	updateInterval = (lastUpdateTime != 0) ? snapshot->TimeStamp() - lastUpdateTime : 0;
+	lastUpdateTime = snapshot->TimeStamp();
+
+	if(teamIndex >= 0) {
+		int32 end = snapshot->TeamEndThread(teamIndex);
+
+		for(int32 i=snapshot->TeamFirstThread(teamIndex) ; i<end ; i++) {
+			thread_id id = snapshot->ThreadId(i);
+
+			CThreadModelEntry *entry = threadIndex.Touch(id, generation);
+
+			if(entry != NULL) {
+				entry->Update(snapshot, i);
+			} else {
+				entry = new CThreadModelEntry(snapshot, i);
+
+				entryList.AddItem(entry);
+				threadIndex.Insert(id, entry, generation);
+				added.AddItem(entry);
+			}
+		}
+	}
+
+	// remove all threads, which weren't stamped in this update.
+	for(int32 i=0 ; i<entryList.CountItems() ; i++) {
+		CThreadModelEntry *entry = entryList.ItemAt(i);
+
+		if(!threadIndex.IsCurrent(entry->ThreadId(), generation)) {
+			entryList.RemoveItem(i--);
+			threadIndex.Remove(entry->ThreadId());
+
+			// deleted on next update
+			removed.AddItem(entry);
+		}
+	}
+}
+
+// GetBasePriority
+// Same as CTeam::GetBasePriority(), but without walking the threads
+// in the kernel.
+status_t CThreadModel::GetBasePriority(int32 &basePrio) const
+{
+	int32 threadCount = entryList.CountItems();
+
+	if(threadCount <= 0) {
+		basePrio = 0;
+		return B_BAD_VALUE;
+	}
+
+	int32 prio = 0;
+
+	for(int32 i=0 ; i<threadCount ; i++)
+		prio += entryList.ItemAt(i)->Priority();
+
+	basePrio = prio / threadCount;
+
+	return B_OK;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THREAD_MODEL_H
+#define THREAD_MODEL_H
+
+#include "IdIndex.h"
+
+class CSystemSnapshot;
+
+//: Model entry of a single thread.
+class CThreadModelEntry
+{
+	public:
+	CThreadModelEntry(const CSystemSnapshot *snapshot, int32 index);
+
+	thread_id		ThreadId() const		{ return id; }
+	const char *	Name() const			{ return name.String(); }
+	int32			Priority() const		{ return priority; }
+	thread_state	State() const			{ return state; }
+	bigtime_t		UserTime() const		{ return userTime; }
+	bigtime_t		KernelTime() const		{ return kernelTime; }
+
+	// CPU time used since the previous update.
+	bigtime_t		UserTimeDelta() const	{ return userTimeDelta; }
+	bigtime_t		KernelTimeDelta() const	{ return kernelTimeDelta; }
+
+	void Update(const CSystemSnapshot *snapshot, int32 index);
+
+	protected:
+	thread_id		id;
+	BString			name;
+	int32			priority;
+	thread_state	state;
+	bigtime_t		userTime;
+	bigtime_t		kernelTime;
+	bigtime_t		userTimeDelta;
+	bigtime_t		kernelTimeDelta;
+};
+
+//: Incrementally maintained list of the threads of a team.
+// The model is updated from a CSystemSnapshot. Threads are matched
+// by their thread_id through a CIdIndex, so an update is linear in
+// the number of threads of the team and doesn't touch the kernel.
+class CThreadModel
+{
+	public:
+	CThreadModel(team_id team);
+	~CThreadModel();
+
+	team_id TeamId() const						{ return teamId; }
+
+	int32 CountEntries() const					{ return entryList.CountItems(); }
+	CThreadModelEntry *EntryAt(int32 index)		{ return entryList.ItemAt(index); }
+	CThreadModelEntry *FindEntry(thread_id id) const { return threadIndex.Find(id); }
+
+	// Threads started and ended between the last two updates. The
+	// ended entries stay valid until the next update.
+	int32 CountAdded() const					{ return added.CountItems(); }
+	CThreadModelEntry *AddedAt(int32 index) const { return (CThreadModelEntry *)added.ItemAt(index); }
+	int32 CountRemoved() const					{ return removed.CountItems(); }
+	CThreadModelEntry *RemovedAt(int32 index)	{ return removed.ItemAt(index); }
+
+	// Time between the last two updates. The time deltas of the
+	// entries refer to this interval.
+	bigtime_t UpdateInterval() const			{ return updateInterval; }
+
+	void Update(const CSystemSnapshot *snapshot, int32 teamIndex);
+
+	// Average priority of the threads (see CTeam::GetBasePriority).
+	// Returns B_BAD_VALUE, if the team has no threads.
+	status_t GetBasePriority(int32 &basePrio) const;
+
+	protected:
+	team_id								teamId;
+	CPointerList<CThreadModelEntry>		entryList;
+	CIdIndex<CThreadModelEntry>			threadIndex;
+	uint32								generation;
+	BList								added;
+	CPointerList<CThreadModelEntry>		removed;
+	bigtime_t							lastUpdateTime;
+	bigtime_t							updateInterval;
+};
+
+#endif // THREAD_MODEL_H
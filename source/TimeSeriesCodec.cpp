@@ -0,0 +1,305 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "TimeSeriesCodec.h"
+
+// ====== Globals ======
+
+// Number of zero bits above the highest set bit. 'value' isn't zero.
+static int32 leading_zeros(uint32 value)
+{
+	int32 count = 0;
+
+	while((value & 0x80000000UL) == 0) {
+		value <<= 1;
+		count++;
+	}
+
+	return count;
+}
+
+// Number of zero bits below the lowest set bit. 'value' isn't zero.
+static int32 trailing_zeros(uint32 value)
+{
+	int32 count = 0;
+
+	while((value & 1) == 0) {
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+}
+
+static uint32 float_bits(float value)
+{
+	uint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float bits_float(uint32 bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Ranges of the delta of deltas. Each range has a prefix of 'index+1'
+// bits ('1...10', the last one '1111') and the value in 'bits' bits.
+static const struct { int64 low; int64 high; int32 bits; } DOD_RANGES[] = {
+	{ -63,		64,		7 },
+	{ -255,		256,	9 },
+	{ -2047,	2048,	12 },
+};
+
+const int32 DOD_RANGE_COUNT = sizeof(DOD_RANGES)/sizeof(DOD_RANGES[0]);
+
+// ====== CTimeSeriesEncoder ======
+
+CTimeSeriesEncoder::CTimeSeriesEncoder()
+{
+	Reset();
+}
+
+void CTimeSeriesEncoder::Reset()
+{
+	bytePos = bitPos = 0;
+	data[0] = 0;
+
+	count = 0;
+	firstTime = prevTime = prevDelta = 0;
+	prevValue = 0;
+	prevLeading = prevTrailing = -1;
+	min = max = 0.0;
+}
+
+void CTimeSeriesEncoder::Append(int64 time, float value)
+{
+	MY_ASSERT(!IsFull());
+
+	uint32 valueBits = float_bits(value);
+
+	if(count == 0) {
+		// The first time stamp is stored in the block header.
+		firstTime = prevTime = time;
+		min = max = value;
+		
+		WriteBits(valueBits, 32);
+	} else {
+		int64 delta = time - prevTime;
+		int64 dod	= delta - prevDelta;
+		
+		if(dod == 0) {
+			WriteBits(0, 1);
+		} else {
+			int32 i;
+		
+			for(i=0 ; i<DOD_RANGE_COUNT ; i++) {
+				if(dod >= DOD_RANGES[i].low && dod <= DOD_RANGES[i].high) {
+					// prefix '10', '110' or '1110'
+					WriteBits(((1 << (i+1)) - 1) << 1, i+2);
+					WriteBits((uint32)(dod - DOD_RANGES[i].low), DOD_RANGES[i].bits);
+					break;
+				}
+			}
+			
+			if(i == DOD_RANGE_COUNT) {
+				// Everything else. Gaps are clamped to 32 bits.
+				dod = MIN(MAX(dod, -2147483647LL), 2147483647LL);
+				delta = prevDelta + dod;
+			
+				WriteBits(0xf, 4);
+				WriteBits((uint32)(int32)dod, 32);
+			}
+		}
+
+		prevDelta = delta;
+		prevTime += delta;
+
+		uint32 xorValue = valueBits ^ prevValue;
+		
+		if(xorValue == 0) {
+			WriteBits(0, 1);
+		} else {
+			int32 leading  = MIN(leading_zeros(xorValue), 31);
+			int32 trailing = trailing_zeros(xorValue);
+			
+			WriteBits(1, 1);
+			
+			if(prevLeading >= 0 && leading >= prevLeading && trailing >= prevTrailing) {
+				// fits into the previous window
+				WriteBits(0, 1);
+				WriteBits(xorValue >> prevTrailing, 32 - prevLeading - prevTrailing);
+			} else {
+				int32 length = 32 - leading - trailing;
+			
+				WriteBits(1, 1);
+				WriteBits(leading, 5);
+				WriteBits(length-1, 5);
+				WriteBits(xorValue >> trailing, length);
+				
+				prevLeading	 = leading;
+				prevTrailing = trailing;
+			}
+		}
+		
+		min = MIN(min, value);
+		max = MAX(max, value);
+	}
+
+	prevValue = valueBits;
+	count++;
+}
+
+// WriteBits
+// Appends the lowest 'bitCount' bits of 'bits', highest bit first.
+void CTimeSeriesEncoder::WriteBits(uint32 bits, int32 bitCount)
+{
+	for(int32 i=bitCount-1 ; i>=0 ; i--) {
+		if((bits >> i) & 1)
+			data[bytePos] |= 0x80 >> bitPos;
+			
+		if(++bitPos == 8) {
+			bitPos = 0;
+			data[++bytePos] = 0;
+		}
+	}
+}
+
+// ====== CTimeSeriesDecoder ======
+
+CTimeSeriesDecoder::CTimeSeriesDecoder(const uint8 *_data, size_t _size,
+	int32 count, int64 firstTime)
+{
+	data		 = _data;
+	size		 = _size;
+	bytePos		 = 0;
+	bitPos		 = 0;
+	
+	remaining	 = count;
+	index		 = 0;
+	prevTime	 = firstTime;
+	prevDelta	 = 0;
+	prevValue	 = 0;
+	prevLeading	 = -1;
+	prevTrailing = -1;
+}
+
+bool CTimeSeriesDecoder::Next(int64 &time, float &value)
+{
+	if(remaining <= 0)
+		return false;
+
+	uint32 bits, bit;
+
+	if(index == 0) {
+		if(!ReadBits(32, bits))
+			return false;
+			
+		prevValue = bits;
+	} else {
+		// number of ones before the first zero (at most 4)
+		int32 prefix = 0;
+		
+		while(prefix < 4) {
+			if(!ReadBit(bit))
+				return false;
+				
+			if(bit == 0)
+				break;
+				
+			prefix++;
+		}
+		
+		int64 dod = 0;
+		
+		if(prefix > 0 && prefix <= DOD_RANGE_COUNT) {
+			if(!ReadBits(DOD_RANGES[prefix-1].bits, bits))
+				return false;
+				
+			dod = bits + DOD_RANGES[prefix-1].low;
+		} else if(prefix > DOD_RANGE_COUNT) {
+			if(!ReadBits(32, bits))
+				return false;
+				
+			dod = (int32)bits;
+		}
+		
+		prevDelta += dod;
+		prevTime  += prevDelta;
+		
+		if(!ReadBit(bit))
+			return false;
+			
+		if(bit == 1) {
+			if(!ReadBit(bit))
+				return false;
+				
+			if(bit == 0) {
+				// previous window
+				if(prevLeading < 0 || !ReadBits(32 - prevLeading - prevTrailing, bits))
+					return false;
+					
+				prevValue ^= bits << prevTrailing;
+			} else {
+				uint32 leading, length;
+				
+				if(!ReadBits(5, leading) || !ReadBits(5, length))
+					return false;
+				
+				length++;
+				
+				if(leading + length > 32 || !ReadBits(length, bits))
+					return false;
+					
+				prevLeading	 = leading;
+				prevTrailing = 32 - leading - length;
+				prevValue	^= bits << prevTrailing;
+			}
+		}
+	}
+	
+	time  = prevTime;
+	value = bits_float(prevValue);
+	
+	index++;
+	remaining--;
+	
+	return true;
+}
+
+bool CTimeSeriesDecoder::ReadBits(int32 bitCount, uint32 &bits)
+{
+	bits = 0;
+
+	for(int32 i=0 ; i<bitCount ; i++) {
+		if(bytePos >= size)
+			return false;
+			
+		bits = (bits << 1) | ((data[bytePos] >> (7 - bitPos)) & 1);
+		
+		if(++bitPos == 8) {
+			bitPos = 0;
+			bytePos++;
+		}
+	}
+	
+	return true;
+}
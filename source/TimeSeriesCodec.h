@@ -0,0 +1,99 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_SERIES_CODEC_H
+#define TIME_SERIES_CODEC_H
+
+//: Compresses a block of samples (Gorilla style).
+// Time stamps are stored in milliseconds as delta of deltas, which
+// is mostly a single bit for samples taken at a fixed rate. Values
+// are XORed with the previous value. Only the meaningful bits of the
+// result are stored; if they fit into the bit window of the previous
+// value, the window isn't stored again. The first time stamp of the
+// block isn't part of the data, it's stored in the block header.
+class CTimeSeriesEncoder
+{
+	public:
+	CTimeSeriesEncoder();
+
+	// Starts a new block.
+	void Reset();
+	
+	// 'time' is in milliseconds. The times must be ascending.
+	void Append(int64 time, float value);
+
+	// True, if another sample may not fit into the block.
+	bool IsFull() const			{ return bytePos >= BLOCK_DATA_SIZE - MAX_SAMPLE_SIZE; }
+	bool IsEmpty() const		{ return count == 0; }
+
+	int32 Count() const			{ return count; }
+	int64 FirstTime() const		{ return firstTime; }
+	int64 LastTime() const		{ return prevTime; }
+	float Min() const			{ return min; }
+	float Max() const			{ return max; }
+	
+	const uint8 *Data() const	{ return data; }
+	size_t Size() const			{ return bytePos + (bitPos > 0 ? 1 : 0); }
+
+	enum { BLOCK_DATA_SIZE = 2048, MAX_SAMPLE_SIZE = 16 };
+
+	protected:
+	void WriteBits(uint32 bits, int32 bitCount);
+
+	uint8	data[BLOCK_DATA_SIZE];
+	int32	bytePos;
+	int32	bitPos;				// bits used in data[bytePos]
+	
+	int32	count;
+	int64	firstTime;
+	int64	prevTime;
+	int64	prevDelta;
+	uint32	prevValue;
+	int32	prevLeading;		// bit window of the previous value
+	int32	prevTrailing;		// (-1 if none)
+	float	min;
+	float	max;
+};
+
+//: Decompresses a block written by CTimeSeriesEncoder.
+class CTimeSeriesDecoder
+{
+	public:
+	CTimeSeriesDecoder(const uint8 *data, size_t size, int32 count, int64 firstTime);
+
+	// Returns false after the last sample or if the data is corrupt.
+	bool Next(int64 &time, float &value);
+
+	protected:
+	bool ReadBits(int32 bitCount, uint32 &bits);
+	bool ReadBit(uint32 &bit) { return ReadBits(1, bit); }
+
+	const uint8	*data;
+	size_t		 size;
+	size_t		 bytePos;
+	int32		 bitPos;
+	
+	int32		 remaining;
+	int32		 index;
+	int64		 prevTime;
+	int64		 prevDelta;
+	uint32		 prevValue;
+	int32		 prevLeading;
+	int32		 prevTrailing;
+};
+
+#endif // TIME_SERIES_CODEC_H
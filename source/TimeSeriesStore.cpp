@@ -0,0 +1,745 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "common.h"
+#include "my_assert.h"
+#include "TimeSeriesStore.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ====== Globals ======
+
+// Directory in the user settings directory.
+const char * const TIME_SERIES_DIRECTORY	= "TaskMgr_history";
+const char * const TIME_SERIES_EXTENSION	= ".tms";
+
+// Records are padded to a multiple of 8 bytes.
+static size_t record_size(size_t size)
+{
+	return (sizeof(time_series_record) + size + 7) & ~7;
+}
+
+// Session files are named by their start time in seconds, so the
+// names sort by age.
+static bool is_session_file(const char *name)
+{
+	const char *extension = strrchr(name, '.');
+	
+	return extension && strcmp(extension, TIME_SERIES_EXTENSION) == 0 && isdigit(name[0]);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+int32 read_time_series_block(const uint8 *data, size_t size, int32 count, 
+	int64 firstTime, int64 from, int64 to, ITimeSeriesSink *sink)
+{
+	CTimeSeriesDecoder decoder(data, size, count, firstTime);
+		
+	int64 time;
+	float value;
+	int32 read = 0;
+		
+	while(decoder.Next(time, value)) {
+		if(time > to)
+			break;
+			
+		if(time >= from) {
+			sink->AddSample(time * 1000, value);
+			read++;
+		}
+	}
+	
+	return read;
+}
+
+// ====== CTimeSeriesFile ======
+
+CTimeSeriesFile::CTimeSeriesFile(const char *_path)
+{
+	path		= _path;
+	address		= NULL;
+	size		= 0;
+	startTime	= endTime = 0;
+	status		= B_OK;
+	
+	fd = open(_path, O_RDONLY);
+	
+	if(fd < 0) {
+		status = errno;
+		return;
+	}
+	
+	struct stat st;
+	
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(time_series_file_header)) {
+		status = B_BAD_DATA;
+		return;
+	}
+	
+	size = st.st_size;
+
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if(mapping == MAP_FAILED) {
+		status = errno;
+		return;
+	}
+	
+	address = (uint8 *)mapping;
+	
+	const time_series_file_header *header = (const time_series_file_header *)address;
+	
+	if(header->magic != TIME_SERIES_MAGIC || header->version != TIME_SERIES_VERSION) {
+		status = B_BAD_DATA;
+		return;
+	}
+	
+	startTime = endTime = header->startTime;
+	
+	BuildIndex();
+}
+
+CTimeSeriesFile::~CTimeSeriesFile()
+{
+	if(address)
+		munmap(address, size);
+		
+	if(fd >= 0)
+		close(fd);
+}
+
+// BuildIndex
+// Walks all records of the file. The payload of the blocks isn't touched.
+void CTimeSeriesFile::BuildIndex()
+{
+	size_t pos = sizeof(time_series_file_header);
+	
+	while(pos + sizeof(time_series_record) <= size) {
+		const time_series_record *record = (const time_series_record *)(address + pos);
+		
+		size_t next = pos + record_size(record->size);
+		
+		if(record->size > size || pos + sizeof(time_series_record) + record->size > size) {
+			// truncated
+			break;
+		}
+		
+		const uint8 *payload = address + pos + sizeof(time_series_record);
+		
+		if(record->type == TIME_SERIES_RECORD_SERIES && record->size > sizeof(uint32)) {
+			series_entry *entry = new series_entry;
+			
+			entry->id	= *(const uint32 *)payload;
+			entry->path.SetTo((const char *)payload + sizeof(uint32), 
+				record->size - sizeof(uint32));
+		
+			seriesList.AddItem(entry);
+		} else if(record->type == TIME_SERIES_RECORD_BLOCK && record->size >= sizeof(time_series_block)) {
+			const time_series_block *block = (const time_series_block *)payload;
+			
+			series_entry *entry = FindSeries(block->seriesId);
+			
+			if(entry) {
+				block_entry *blockEntry = new block_entry;
+				
+				blockEntry->firstTime	= block->firstTime;
+				blockEntry->lastTime	= block->lastTime;
+				blockEntry->block		= block;
+				blockEntry->dataSize	= record->size - sizeof(time_series_block);
+				
+				entry->blocks.AddItem(blockEntry);
+				
+				endTime = MAX(endTime, block->lastTime);
+			}
+		}
+		
+		pos = next;
+	}
+}
+
+CTimeSeriesFile::series_entry *CTimeSeriesFile::FindSeries(uint32 id) const
+{
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++) {
+		series_entry *entry = (series_entry *)seriesList.ItemAt(i);
+	
+		if(entry->id == id)
+			return entry;
+	}
+	
+	return NULL;
+}
+
+CTimeSeriesFile::series_entry *CTimeSeriesFile::FindSeries(const char *seriesPath) const
+{
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++) {
+		series_entry *entry = (series_entry *)seriesList.ItemAt(i);
+	
+		if(entry->path == seriesPath)
+			return entry;
+	}
+	
+	return NULL;
+}
+
+int32 CTimeSeriesFile::ReadRange(const char *seriesPath, int64 from, int64 to, 
+	ITimeSeriesSink *sink) const
+{
+	series_entry *entry = FindSeries(seriesPath);
+	
+	if(status != B_OK || entry == NULL || from > endTime || to < startTime)
+		return 0;
+
+	// Binary search for the first block, which ends after 'from'.
+	int32 low = 0, high = entry->blocks.CountItems();
+	
+	while(low < high) {
+		int32 mid = (low + high) / 2;
+		
+		if(entry->blocks.ItemAt(mid)->lastTime < from)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	int32 count = 0;
+	
+	for(int32 i=low ; i<entry->blocks.CountItems() ; i++) {
+		const block_entry *blockEntry = entry->blocks.ItemAt(i);
+		
+		if(blockEntry->firstTime > to)
+			break;
+			
+		const time_series_block *block = blockEntry->block;
+			
+		count += read_time_series_block((const uint8 *)(block+1), blockEntry->dataSize,
+			block->count, block->firstTime, from, to, sink);
+	}
+	
+	return count;
+}
+
+// ====== CTimeSeriesWriter ======
+
+CTimeSeriesWriter::CTimeSeriesWriter(const char *path, uint32 openMode, int64 startTime)
+{
+	size	= 0;
+	failed	= false;
+	file	= new BFile(path, B_READ_WRITE | B_CREATE_FILE | openMode);
+	status	= file->InitCheck();
+	
+	if(status != B_OK)
+		return;
+	
+	time_series_file_header header;
+	
+	header.magic	 = TIME_SERIES_MAGIC;
+	header.version	 = TIME_SERIES_VERSION;
+	header.startTime = startTime;
+	
+	if(file->Write(&header, sizeof(header)) != sizeof(header)) {
+		status = B_IO_ERROR;
+		return;
+	}
+	
+	size = sizeof(header);
+}
+
+CTimeSeriesWriter::~CTimeSeriesWriter()
+{
+	delete file;
+}
+
+status_t CTimeSeriesWriter::WriteSeries(uint32 seriesId, const char *path)
+{
+	return WriteRecord(TIME_SERIES_RECORD_SERIES, &seriesId, sizeof(uint32),
+		path, strlen(path)+1);
+}
+
+status_t CTimeSeriesWriter::WriteBlock(uint32 seriesId, const CTimeSeriesEncoder &encoder, 
+	off_t *dataOffset)
+{
+	time_series_block block;
+	
+	block.seriesId	= seriesId;
+	block.count		= encoder.Count();
+	block.firstTime	= encoder.FirstTime();
+	block.lastTime	= encoder.LastTime();
+	block.min		= encoder.Min();
+	block.max		= encoder.Max();
+	
+	if(dataOffset)
+		*dataOffset = size + sizeof(time_series_record) + sizeof(time_series_block);
+	
+	return WriteRecord(TIME_SERIES_RECORD_BLOCK, &block, sizeof(block), 
+		encoder.Data(), encoder.Size());
+}
+
+status_t CTimeSeriesWriter::WriteRecord(uint32 type, const void *header, size_t headerSize, 
+	const void *data, size_t dataSize)
+{
+	if(status != B_OK || failed)
+		return B_IO_ERROR;
+
+	time_series_record record;
+	
+	record.type = type;
+	record.size = headerSize + dataSize;
+	
+	size_t padding = record_size(record.size) - sizeof(record) - record.size;
+	
+	static const uint8 zeros[8] = { 0 };
+	
+	if(file->Write(&record, sizeof(record)) != sizeof(record) ||
+	   file->Write(header, headerSize) != (ssize_t)headerSize ||
+	   file->Write(data, dataSize) != (ssize_t)dataSize ||
+	   file->Write(zeros, padding) != (ssize_t)padding) {
+		// Remove the partial record. Otherwise all following records
+		// would be unreadable.
+		if(file->SetSize(size) != B_OK || file->Seek(size, SEEK_SET) != size)
+			failed = true;
+			
+		return B_IO_ERROR;
+	}
+
+	size += record_size(record.size);
+
+	return B_OK;
+}
+
+// ====== CTimeSeriesStore ======
+
+const bigtime_t	CTimeSeriesStore::FLUSH_INTERVAL	= 30*1000000LL;
+const off_t		CTimeSeriesStore::MAX_SESSION_SIZE	= 8*1024*1024;
+const off_t		CTimeSeriesStore::MAX_STORE_SIZE	= 64*1024*1024;
+const bigtime_t	CTimeSeriesStore::MAX_AGE			= 14*24*3600*1000000LL;
+
+CTimeSeriesStore::CTimeSeriesStore() :
+	locker("TimeSeriesStore"),
+	flushLocker("TimeSeriesStoreFlush")
+{
+	writer			= NULL;
+	nextSeriesId	= 0;
+	flushSem		= -1;
+	flushThread		= -1;
+	
+	if(find_directory(B_USER_SETTINGS_DIRECTORY, &directory) != B_OK)
+		return;
+		
+	directory.Append(TIME_SERIES_DIRECTORY);
+	
+	if(create_directory(directory.Path(), 0755) != B_OK)
+		return;
+	
+	if(OpenSession() != B_OK)
+		return;
+		
+	flushSem	= create_sem(0, "time series flush");
+	flushThread	= spawn_thread(FlushThread, "time series flush", 
+					B_LOW_PRIORITY, this);
+					
+	resume_thread(flushThread);
+}
+
+CTimeSeriesStore::~CTimeSeriesStore()
+{
+	// Deleting the semaphore terminates the flush thread.
+	if(flushSem >= 0) {
+		delete_sem(flushSem);
+	
+		status_t exitValue;
+		wait_for_thread(flushThread, &exitValue);
+	}
+
+	CloseSession();
+	
+	RemoveFromList(ClassName());
+}
+
+CTimeSeriesStore *CTimeSeriesStore::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CTimeSeriesStore *store = NULL;
+
+	return CreateSingleton(store, "CTimeSeriesStore");
+}
+
+CTimeSeriesStore *CTimeSeriesStore::Instance()
+{
+	CTimeSeriesStore *store = dynamic_cast<CTimeSeriesStore *>(Find("CTimeSeriesStore"));
+	
+	return store && store->InitCheck() == B_OK ? store : NULL;
+}
+
+void CTimeSeriesStore::Append(const char *path, bigtime_t time, float value)
+{
+	BAutolock autoLocker(locker);
+	
+	if(writer == NULL || writer->Failed())
+		return;
+	
+	series *s = FindSeries(path);
+
+	int64 timeMs = time / 1000;
+	
+	// FAST_PULSE_RATE is in microseconds.
+	if(timeMs < s->lastTime + FAST_PULSE_RATE/2000)
+		return;
+	
+	s->encoder.Append(timeMs, value);
+	s->lastTime = timeMs;
+	
+	if(s->encoder.IsFull())
+		WriteBlock(s);
+}
+
+// Flush
+// Writes the blocks of all series and syncs the session file. A new
+// session file is started, if the current one exceeds MAX_SESSION_SIZE.
+// The locker is only held while the blocks are written and the session
+// is switched, so Append() and ReadRange() never wait for the sync or
+// the retention.
+void CTimeSeriesStore::Flush()
+{
+	BAutolock flushAutoLocker(flushLocker);
+
+	CTimeSeriesWriter *closedWriter = NULL;
+
+	locker.Lock();
+
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++)
+		WriteBlock(seriesList.ItemAt(i));
+
+	if(writer && writer->Size() > MAX_SESSION_SIZE) {
+		// start a new session file
+		closedWriter = writer;
+		writer = NULL;
+		
+		OpenSession();
+	}
+	
+	// Only Flush() replaces the writer, so it stays valid after
+	// unlocking.
+	CTimeSeriesWriter *currentWriter = writer;
+	
+	locker.Unlock();
+
+	if(closedWriter) {
+		closedWriter->File()->Sync();
+		delete closedWriter;
+		
+		ApplyRetention();
+	}
+
+	if(currentWriter)
+		currentWriter->File()->Sync();
+}
+
+// FlushThread
+// Flushes the store every FLUSH_INTERVAL, until the semaphore is
+// deleted. The retention is applied once at the start.
+int32 CTimeSeriesStore::FlushThread(void *data)
+{
+	CTimeSeriesStore *store = static_cast<CTimeSeriesStore *>(data);
+	
+	{
+		BAutolock flushAutoLocker(store->flushLocker);
+		
+		store->ApplyRetention();
+	}
+	
+	while(acquire_sem_etc(store->flushSem, 1, B_RELATIVE_TIMEOUT, 
+		FLUSH_INTERVAL) == B_TIMED_OUT) {
+		store->Flush();
+	}
+	
+	return 0;
+}
+
+int32 CTimeSeriesStore::ReadRange(const char *path, bigtime_t from, bigtime_t to, 
+	ITimeSeriesSink *sink)
+{
+	BAutolock autoLocker(locker);
+	
+	BDirectory dir(directory.Path());
+	
+	if(dir.InitCheck() != B_OK)
+		return 0;
+	
+	BList names;
+	BEntry entry;
+	char name[B_FILE_NAME_LENGTH];
+	
+	while(dir.GetNextEntry(&entry) == B_OK) {
+		if(entry.GetName(name) == B_OK && is_session_file(name))
+			names.AddItem(strdup(name));
+	}
+	
+	names.SortItems(compare_names);
+
+	int32 count = 0;
+	
+	for(int32 i=0 ; i<names.CountItems() ; i++) {
+		char *fileName = (char *)names.ItemAt(i);
+		
+		BPath filePath(directory.Path(), fileName);
+		
+		if(filePath == sessionPath) {
+			count += ReadCurrentSession(path, from / 1000, to / 1000, sink);
+		} else {
+			CTimeSeriesFile *closed = ClosedFile(filePath.Path());
+			
+			if(closed)
+				count += closed->ReadRange(path, from / 1000, to / 1000, sink);
+		}
+		
+		free(fileName);
+	}
+	
+	return count;
+}
+
+// ReadCurrentSession
+// Reads the written blocks of the current session file by the index
+// and the samples, which weren't written yet, from the encoder. 'from'
+// and 'to' are in milliseconds.
+int32 CTimeSeriesStore::ReadCurrentSession(const char *path, int64 from, int64 to, 
+	ITimeSeriesSink *sink)
+{
+	series *s = FindSeries(path, false);
+	
+	if(s == NULL || writer == NULL)
+		return 0;
+		
+	uint8 data[CTimeSeriesEncoder::BLOCK_DATA_SIZE];
+	int32 count = 0;
+	
+	for(int32 i=0 ; i<s->blocks.CountItems() ; i++) {
+		const block_ref *block = s->blocks.ItemAt(i);
+		
+		if(block->lastTime < from)
+			continue;
+			
+		if(block->firstTime > to)
+			return count;
+			
+		if(block->dataSize > sizeof(data) || 
+		   writer->File()->ReadAt(block->offset, data, block->dataSize) != (ssize_t)block->dataSize)
+			continue;
+			
+		count += read_time_series_block(data, block->dataSize, block->count,
+			block->firstTime, from, to, sink);
+	}
+	
+	if(!s->encoder.IsEmpty()) {
+		count += read_time_series_block(s->encoder.Data(), s->encoder.Size(), 
+			s->encoder.Count(), s->encoder.FirstTime(), from, to, sink);
+	}
+	
+	return count;
+}
+
+// ClosedFile
+// Returns the cached index of an old session file.
+CTimeSeriesFile *CTimeSeriesStore::ClosedFile(const char *path)
+{
+	for(int32 i=0 ; i<closedFiles.CountItems() ; i++) {
+		if(strcmp(closedFiles.ItemAt(i)->Path(), path) == 0)
+			return closedFiles.ItemAt(i);
+	}
+	
+	CTimeSeriesFile *closed = new CTimeSeriesFile(path);
+	
+	if(closed->InitCheck() != B_OK) {
+		delete closed;
+		return NULL;
+	}
+	
+	closedFiles.AddItem(closed);
+	
+	return closed;
+}
+
+status_t CTimeSeriesStore::OpenSession()
+{
+	bigtime_t now = real_time_clock_usecs();
+
+	char name[B_FILE_NAME_LENGTH];
+	
+	// Never overwrite a session. Try the next seconds, if the
+	// last session started in the same second.
+	for(int32 i=0 ; i<10 && writer == NULL ; i++) {
+		sprintf(name, "%Ld%s", now / 1000000 + i, TIME_SERIES_EXTENSION);
+	
+		sessionPath.SetTo(directory.Path(), name);
+	
+		writer = new CTimeSeriesWriter(sessionPath.Path(), B_FAIL_IF_EXISTS, now / 1000);
+	
+		if(writer->InitCheck() != B_OK) {
+			delete writer;
+			writer = NULL;
+		}
+	}
+	
+	if(writer == NULL)
+		return B_ERROR;
+	
+	// The series records must be repeated in the new file. The blocks
+	// of the old file are read from that file now.
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++) {
+		seriesList.ItemAt(i)->defined = false;
+		seriesList.ItemAt(i)->blocks.MakeEmpty();
+	}
+	
+	return B_OK;
+}
+
+void CTimeSeriesStore::CloseSession()
+{
+	if(writer == NULL)
+		return;
+
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++)
+		WriteBlock(seriesList.ItemAt(i));
+
+	delete writer;
+	writer = NULL;
+}
+
+// ApplyRetention
+// Deletes the oldest session files, until the size of the remaining
+// files is below MAX_STORE_SIZE. Files older than MAX_AGE are deleted
+// anyway. The current session is never deleted. The flush locker must
+// be held, the locker is only acquired to drop cached indexes.
+void CTimeSeriesStore::ApplyRetention()
+{
+	BDirectory dir(directory.Path());
+	
+	if(dir.InitCheck() != B_OK)
+		return;
+	
+	BList names;
+	BEntry entry;
+	char name[B_FILE_NAME_LENGTH];
+	off_t totalSize = 0;
+	
+	while(dir.GetNextEntry(&entry) == B_OK) {
+		off_t entrySize;
+	
+		if(entry.GetName(name) == B_OK && is_session_file(name) && entry.GetSize(&entrySize) == B_OK) {
+			names.AddItem(strdup(name));
+			totalSize += entrySize;
+		}
+	}
+
+	names.SortItems(compare_names);
+	
+	int64 minStartTime = (real_time_clock_usecs() - MAX_AGE) / 1000000;
+	
+	for(int32 i=0 ; i<names.CountItems() ; i++) {
+		char *fileName = (char *)names.ItemAt(i);
+		
+		BPath filePath(directory.Path(), fileName);
+		
+		if(filePath != sessionPath && (totalSize > MAX_STORE_SIZE || atoll(fileName) < minStartTime)) {
+			BEntry fileEntry(filePath.Path());
+			off_t entrySize = 0;
+			
+			fileEntry.GetSize(&entrySize);
+			
+			locker.Lock();
+			
+			for(int32 k=0 ; k<closedFiles.CountItems() ; k++) {
+				if(strcmp(closedFiles.ItemAt(k)->Path(), filePath.Path()) == 0) {
+					delete closedFiles.RemoveItem(k);
+					break;
+				}
+			}
+			
+			locker.Unlock();
+			
+			if(fileEntry.Remove() == B_OK)
+				totalSize -= entrySize;
+		}
+		
+		free(fileName);
+	}
+}
+
+CTimeSeriesStore::series *CTimeSeriesStore::FindSeries(const char *path, bool create)
+{
+	for(int32 i=0 ; i<seriesList.CountItems() ; i++) {
+		if(seriesList.ItemAt(i)->path == path)
+			return seriesList.ItemAt(i);
+	}
+	
+	if(!create)
+		return NULL;
+	
+	series *s = new series;
+	
+	s->id		= nextSeriesId++;
+	s->path		= path;
+	s->defined	= false;
+	s->lastTime	= 0;
+	
+	seriesList.AddItem(s);
+	
+	return s;
+}
+
+// WriteBlock
+// Appends the current block of 's' to the session file and starts a
+// new one. Nothing is written, if the block is empty.
+status_t CTimeSeriesStore::WriteBlock(series *s)
+{
+	if(writer == NULL || s->encoder.IsEmpty())
+		return B_OK;
+		
+	if(!s->defined && writer->WriteSeries(s->id, s->path.String()) == B_OK)
+		s->defined = true;
+	
+	status_t status = B_IO_ERROR;
+	
+	if(s->defined) {
+		block_ref *ref = new block_ref;
+		
+		ref->dataSize	= s->encoder.Size();
+		ref->count		= s->encoder.Count();
+		ref->firstTime	= s->encoder.FirstTime();
+		ref->lastTime	= s->encoder.LastTime();
+		
+		status = writer->WriteBlock(s->id, s->encoder, &ref->offset);
+		
+		if(status == B_OK)
+			s->blocks.AddItem(ref);
+		else
+			delete ref;
+	}
+	
+	// The samples are dropped, even if writing failed.
+	s->encoder.Reset();
+	
+	return status;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_SERIES_STORE_H
+#define TIME_SERIES_STORE_H
+
+#include "Singleton.h"
+#include "PointerList.h"
+#include "TimeSeriesCodec.h"
+
+// ====== File Format ======
+
+// A session file starts with a time_series_file_header followed by
+// records. Each record is a time_series_record followed by 'size'
+// bytes (padded to a multiple of 8). A series record contains the id
+// (uint32) and the NUL terminated path of a series. It precedes the
+// first block of the series in the file. A block record contains a
+// time_series_block followed by the data written by a
+// CTimeSeriesEncoder. All times are real time in milliseconds.
+const uint32 TIME_SERIES_MAGIC			= 'TMts';
+const uint32 TIME_SERIES_VERSION		= 1;
+
+const uint32 TIME_SERIES_RECORD_SERIES	= 1;
+const uint32 TIME_SERIES_RECORD_BLOCK	= 2;
+
+struct time_series_file_header
+{
+	uint32	magic;
+	uint32	version;
+	int64	startTime;
+};
+
+struct time_series_record
+{
+	uint32	type;
+	uint32	size;				// size of the payload (without padding)
+};
+
+struct time_series_block
+{
+	uint32	seriesId;
+	int32	count;				// number of samples
+	int64	firstTime;
+	int64	lastTime;
+	float	min;
+	float	max;
+};
+
+// ====== Class Defs ======
+
+//: Receives the samples of a range read.
+class ITimeSeriesSink
+{
+	public:
+	virtual ~ITimeSeriesSink() {}
+	
+	// 'time' is real time in microseconds.
+	virtual void AddSample(bigtime_t time, float value) = 0;
+};
+
+// Passes the samples of an encoded block in [from, to] (in
+// milliseconds) to 'sink'. Returns the number of samples.
+int32 read_time_series_block(const uint8 *data, size_t size, int32 count, 
+	int64 firstTime, int64 from, int64 to, ITimeSeriesSink *sink);
+
+//: Read only, memory mapped session file.
+// The file is walked once to build the block index, which holds the
+// time range of every block of every series. A range read decodes only
+// the blocks overlapping the range. A truncated last record (the writer
+// crashed) is ignored.
+class CTimeSeriesFile
+{
+	public:
+	CTimeSeriesFile(const char *path);
+	~CTimeSeriesFile();
+
+	status_t InitCheck() const	{ return status; }
+	const char *Path() const	{ return path.String(); }
+	off_t Size() const			{ return size; }
+	int64 StartTime() const		{ return startTime; }
+	int64 EndTime() const		{ return endTime; }
+
+	// Passes all samples of 'seriesPath' in [from, to] (in
+	// milliseconds) to 'sink'. Returns the number of samples.
+	int32 ReadRange(const char *seriesPath, int64 from, int64 to, ITimeSeriesSink *sink) const;
+
+	protected:
+	struct block_entry {
+		int64						 firstTime;
+		int64						 lastTime;
+		const time_series_block		*block;
+		size_t						 dataSize;
+	};
+
+	struct series_entry {
+		uint32						 id;
+		BString						 path;
+		CPointerList<block_entry>	 blocks;	// ascending time
+	};
+
+	void BuildIndex();
+	series_entry *FindSeries(uint32 id) const;
+	series_entry *FindSeries(const char *path) const;
+
+	status_t		 status;
+	BString			 path;
+	int				 fd;
+	uint8			*address;
+	size_t			 size;
+	int64			 startTime;
+	int64			 endTime;
+	CPointerList<series_entry> seriesList;
+};
+
+//: Writes a session file.
+// The records are appended. If a record can't be written completely,
+// the file is truncated to the end of the last complete record. If
+// that fails, too, Failed() returns true and nothing is written
+// anymore.
+class CTimeSeriesWriter
+{
+	public:
+	// 'openMode' is combined with B_READ_WRITE and B_CREATE_FILE.
+	// 'startTime' is real time in milliseconds.
+	CTimeSeriesWriter(const char *path, uint32 openMode, int64 startTime);
+	~CTimeSeriesWriter();
+	
+	status_t InitCheck() const	{ return status; }
+	bool Failed() const			{ return failed; }
+	
+	// End of the last complete record.
+	off_t Size() const			{ return size; }
+	
+	BFile *File()				{ return file; }
+	
+	status_t WriteSeries(uint32 seriesId, const char *path);
+	
+	// Writes the block of 'encoder'. The offset of the encoded data in
+	// the file is returned in 'dataOffset'.
+	status_t WriteBlock(uint32 seriesId, const CTimeSeriesEncoder &encoder, 
+		off_t *dataOffset=NULL);
+	
+	protected:
+	status_t WriteRecord(uint32 type, const void *header, size_t headerSize, 
+		const void *data, size_t dataSize);
+
+	status_t	 status;
+	BFile		*file;
+	off_t		 size;
+	bool		 failed;
+};
+
+//: Append-only store of the values of the displayed counters.
+// Every run of the application writes a session file. The samples of
+// a series are compressed into blocks, which are appended when they
+// are full or every FLUSH_INTERVAL. So after a crash only the samples
+// of the last interval are lost. A session file is closed and a new one
+// is started when it exceeds MAX_SESSION_SIZE. The oldest session
+// files are deleted, if all files exceed MAX_STORE_SIZE or they are
+// older than MAX_AGE. Flushing, syncing and the retention are done by
+// a thread of the store, so the graph views, which append the samples,
+// never wait for them.
+//
+// The store keeps an index of the blocks written to the current session
+// file. So ReadRange() reads the current session without flushing it:
+// the written blocks are read by the index, the samples which weren't
+// written yet are decoded from the encoders.
+//
+// The store is created by the application. Graph views in other teams
+// (replicants) neither write nor read it, as Instance() returns NULL
+// there.
+class CTimeSeriesStore : public CSingleton
+{
+	public:
+	static CTimeSeriesStore *CreateInstance();
+	static CTimeSeriesStore *Instance();
+	
+	virtual ~CTimeSeriesStore();
+	virtual void Reactivate() {}
+
+	status_t InitCheck() const { return writer ? B_OK : B_NO_INIT; }
+
+	// 'time' is real time in microseconds. If more than one graph view
+	// displays a counter, only the samples of the first one are
+	// stored: samples closer than half the fast pulse rate to the last
+	// sample of the series are dropped.
+	void Append(const char *path, bigtime_t time, float value);
+	
+	// Called every FLUSH_INTERVAL by the flush thread.
+	void Flush();
+
+	// Reads the samples of 'path' in [from, to] from all sessions
+	// (including the current one). The times are in microseconds.
+	int32 ReadRange(const char *path, bigtime_t from, bigtime_t to, ITimeSeriesSink *sink);
+
+	protected:
+	CTimeSeriesStore();
+	
+	struct block_ref {
+		off_t				offset;			// of the encoded data
+		size_t				dataSize;
+		int32				count;
+		int64				firstTime;
+		int64				lastTime;
+	};
+
+	struct series {
+		uint32				id;
+		BString				path;
+		bool				defined;		// series record written to current file
+		int64				lastTime;
+		CTimeSeriesEncoder	encoder;
+		CPointerList<block_ref> blocks;		// written to the current file, ascending time
+	};
+
+	static int32 FlushThread(void *data);
+	
+	status_t OpenSession();
+	void CloseSession();
+	void ApplyRetention();
+	
+	int32 ReadCurrentSession(const char *path, int64 from, int64 to, ITimeSeriesSink *sink);
+	
+	// Returns NULL, if 'create' is false and the series isn't known.
+	series *FindSeries(const char *path, bool create=true);
+	status_t WriteBlock(series *s);
+	CTimeSeriesFile *ClosedFile(const char *path);
+	
+	static const bigtime_t	FLUSH_INTERVAL;
+	static const off_t		MAX_SESSION_SIZE;
+	static const off_t		MAX_STORE_SIZE;
+	static const bigtime_t	MAX_AGE;
+	
+	BLocker				 locker;
+	BLocker				 flushLocker;		// serializes Flush() and ApplyRetention()
+	BPath				 directory;
+	BPath				 sessionPath;
+	CTimeSeriesWriter	*writer;			// current session file, only replaced by Flush()
+	sem_id				 flushSem;			// deleted to stop the flush thread
+	thread_id			 flushThread;
+	uint32				 nextSeriesId;
+	CPointerList<series> seriesList;
+	CPointerList<CTimeSeriesFile> closedFiles;	// cached indexes of older sessions
+	
+	friend class CSingleton;
+};
+
+#endif // TIME_SERIES_STORE_H
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "TopKTracker.h"
+
+// ====== CTopKTracker ======
+
+CTopKTracker::CTopKTracker(int32 _k)
+{
+	k = _k;
+}
+
+CTopKTracker::~CTopKTracker()
+{
+	MakeEmpty();
+}
+
+void CTopKTracker::Set(int32 id, int64 value, uint32 generation)
+{
+	SetValue(id, value, generation);
+}
+
+void CTopKTracker::SetDelta(int32 id, int64 total, uint32 generation)
+{
+	node *n = index.Find(id);
+
+	int64 delta = (n != NULL) ? total - n->total : 0;
+
+	n = SetValue(id, delta, generation);
+	n->total = total;
+}
+
+// SetValue
+// Inserts or updates the node of 'id' and restores the order of
+// both containers. Returns the node.
+CTopKTracker::node *CTopKTracker::SetValue(int32 id, int64 value, uint32 generation)
+{
+	node *n = index.Touch(id, generation);
+
+	if(n == NULL) {
+		n = new node;
+
+		n->id		= id;
+		n->value	= value;
+		n->total	= 0;
+		n->heapPos	= -1;
+
+		index.Insert(id, n, generation);
+
+		PushHeap(n);
+		Balance();
+
+		return n;
+	}
+
+	if(n->value == value)
+		return n;
+
+	n->value = value;
+
+	if(n->heapPos == -1) {
+		top.RemoveItem(top.IndexOf(n));
+		InsertTop(n);
+	} else {
+		SiftUp(n->heapPos);
+		SiftDown(n->heapPos);
+	}
+
+	Balance();
+
+	return n;
+}
+
+void CTopKTracker::Remove(int32 id)
+{
+	node *n = index.Find(id);
+
+	if(n == NULL)
+		return;
+
+	if(n->heapPos == -1)
+		top.RemoveItem(top.IndexOf(n));
+	else
+		RemoveFromHeap(n);
+
+	index.Remove(id);
+	delete n;
+
+	Balance();
+}
+
+void CTopKTracker::RemoveStale(uint32 generation)
+{
+	BList stale;
+
+	for(int32 i=0 ; i<top.CountItems() ; i++) {
+		if(!index.IsCurrent(TopAt(i)->id, generation))
+			stale.AddItem(TopAt(i));
+	}
+
+	for(int32 i=0 ; i<heap.CountItems() ; i++) {
+		if(!index.IsCurrent(HeapAt(i)->id, generation))
+			stale.AddItem(HeapAt(i));
+	}
+
+	for(int32 i=0 ; i<stale.CountItems() ; i++)
+		Remove(((node *)stale.ItemAt(i))->id);
+}
+
+void CTopKTracker::MakeEmpty()
+{
+	for(int32 i=0 ; i<top.CountItems() ; i++)
+		delete TopAt(i);
+
+	for(int32 i=0 ; i<heap.CountItems() ; i++)
+		delete HeapAt(i);
+
+	top.MakeEmpty();
+	heap.MakeEmpty();
+	index.MakeEmpty();
+}
+
+// InsertTop
+// Inserts 'n' into the sorted top array. O(K).
+void CTopKTracker::InsertTop(node *n)
+{
+	int32 i = 0;
+
+	while(i < top.CountItems() && TopAt(i)->value >= n->value)
+		i++;
+
+	n->heapPos = -1;
+	top.AddItem(n, i);
+}
+
+void CTopKTracker::PushHeap(node *n)
+{
+	n->heapPos = heap.CountItems();
+	heap.AddItem(n);
+
+	SiftUp(n->heapPos);
+}
+
+CTopKTracker::node *CTopKTracker::PopHeap()
+{
+	node *n = HeapAt(0);
+
+	RemoveFromHeap(n);
+
+	return n;
+}
+
+// RemoveFromHeap
+// Replaces 'n' by the last node and moves that one to its place.
+void CTopKTracker::RemoveFromHeap(node *n)
+{
+	int32 pos  = n->heapPos;
+	int32 last = heap.CountItems()-1;
+
+	MY_ASSERT(pos >= 0 && HeapAt(pos) == n);
+
+	if(pos != last)
+		SwapHeap(pos, last);
+
+	heap.RemoveItem(last);
+	n->heapPos = -1;
+
+	if(pos < heap.CountItems()) {
+		node *moved = HeapAt(pos);
+
+		SiftUp(pos);
+		SiftDown(moved->heapPos);
+	}
+}
+
+void CTopKTracker::SiftUp(int32 pos)
+{
+	while(pos > 0) {
+		int32 parent = (pos-1)/2;
+
+		if(HeapAt(parent)->value >= HeapAt(pos)->value)
+			break;
+
+		SwapHeap(parent, pos);
+		pos = parent;
+	}
+}
+
+void CTopKTracker::SiftDown(int32 pos)
+{
+	int32 count = heap.CountItems();
+
+	for(;;) {
+		int32 largest = pos;
+		int32 left	  = 2*pos+1;
+		int32 right	  = 2*pos+2;
+
+		if(left < count && HeapAt(left)->value > HeapAt(largest)->value)
+			largest = left;
+
+		if(right < count && HeapAt(right)->value > HeapAt(largest)->value)
+			largest = right;
+
+		if(largest == pos)
+			break;
+
+		SwapHeap(pos, largest);
+		pos = largest;
+	}
+}
+
+void CTopKTracker::SwapHeap(int32 a, int32 b)
+{
+	node *na = HeapAt(a);
+	node *nb = HeapAt(b);
+
+	heap.ReplaceItem(a, nb);
+	heap.ReplaceItem(b, na);
+
+	na->heapPos = b;
+	nb->heapPos = a;
+}
+
+// Balance
+// Restores the invariant: 'top' holds min(K, n) nodes and none of
+// them is smaller than the largest node in the heap. After a single
+// change at most one node moves in each direction.
+void CTopKTracker::Balance()
+{
+	while(top.CountItems() < k && heap.CountItems() > 0)
+		InsertTop(PopHeap());
+
+	while(top.CountItems() > 0 && heap.CountItems() > 0 &&
+		  HeapAt(0)->value > TopAt(top.CountItems()-1)->value) {
+		node *low  = (node *)top.RemoveItem(top.CountItems()-1);
+		node *high = PopHeap();
+
+		InsertTop(high);
+		PushHeap(low);
+	}
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOP_K_TRACKER_H
+#define TOP_K_TRACKER_H
+
+#include "IdIndex.h"
+
+//: Keeps the K ids with the largest values.
+// The K largest nodes are kept in a small array sorted descending,
+// all others in a max-heap which knows the position of every node.
+// Changing the value of one id costs O(log n) (plus O(K) if it's part
+// of the top array). Setting an unchanged value is a hash lookup.
+// Reading the top K ids is O(K).
+class CTopKTracker
+{
+	public:
+	CTopKTracker(int32 k);
+	~CTopKTracker();
+
+	// Inserts 'id' or updates its value. 'generation' stamps the id
+	// for RemoveStale().
+	void Set(int32 id, int64 value, uint32 generation);
+
+	// Ranks 'id' by the growth of the monotonic counter 'total' since
+	// the last call. The first call for an id ranks it with 0.
+	void SetDelta(int32 id, int64 total, uint32 generation);
+
+	void Remove(int32 id);
+
+	// Removes all ids not stamped with 'generation'. Linear in the
+	// number of ids.
+	void RemoveStale(uint32 generation);
+
+	void MakeEmpty();
+
+	int32 K() const					{ return k; }
+	int32 CountTop() const			{ return top.CountItems(); }
+	int32 TopIdAt(int32 i) const	{ return TopAt(i)->id; }
+	int64 TopValueAt(int32 i) const	{ return TopAt(i)->value; }
+
+	protected:
+	struct node {
+		int32	id;
+		int64	value;
+		int64	total;		// last counter value (SetDelta only)
+		int32	heapPos;	// index in 'heap', -1 if in 'top'
+	};
+
+	node *SetValue(int32 id, int64 value, uint32 generation);
+
+	node *TopAt(int32 i) const		{ return (node *)top.ItemAt(i); }
+	node *HeapAt(int32 i) const		{ return (node *)heap.ItemAt(i); }
+
+	void InsertTop(node *n);
+	void PushHeap(node *n);
+	node *PopHeap();
+	void RemoveFromHeap(node *n);
+	void SiftUp(int32 pos);
+	void SiftDown(int32 pos);
+	void SwapHeap(int32 a, int32 b);
+	void Balance();
+
+	int32			 k;
+	BList			 top;			// node *, sorted descending
+	BList			 heap;			// node *, max-heap
+	CIdIndex<node>	 index;
+};
+
+#endif // TOP_K_TRACKER_H
@@ -215,7 +215,7 @@ CCPULedView::CCPULedView(BRect rect) :
 	const char *path = "/Total/CPU Usage/Average";
 	IDataProvider *dataProvider = global_Namespace->DataProvider(path);
 
-	SetDataProvider(dataProvider);
+	SetDataProvider(dataProvider, path);
 }
 
 CCPULedView::CCPULedView(BMessage *archive) :
@@ -249,7 +249,7 @@ CMemLedView::CMemLedView(BRect rect) :
 	const char *path = "/Total/Memory Usage";
 	IDataProvider *dataProvider = global_Namespace->DataProvider(path);
 
-	SetDataProvider(dataProvider);
+	SetDataProvider(dataProvider, path);
 
 	Init();
 }
@@ -18,6 +18,16 @@
 #ifndef DATA_PROVIDER_H
 #define DATA_PROVIDER_H
 
+//: A sample of a data provider.
+// The value is a double, so counters (CPU time in microseconds, sizes
+// in bytes) and their deltas keep their precision. Values are only
+// narrowed for display.
+struct data_sample
+{
+	double		value;
+	bigtime_t	timeStamp;		// system_time() of the underlying reading (0 if none)
+};
+
 //: Interface for data providers.
 class IDataProvider
 {
@@ -44,8 +54,8 @@ class IDataProvider
 	enum enumFlags {
 		//: Display the value "as is".
 		DP_TYPE_ABSOLUTE = 1,
-		// The returned value is divided by the time between the the 
-		// last two calls of GetNextValue() in milliseconds.
+		// The returned value is divided by the time between the readings
+		// of the last two samples in microseconds (see get_next_sample()).
 		DP_TYPE_RELATIVE = 2,
 		//: The value is in percent.
 		// The returned value is multiplyed by 100, before it's displayed
@@ -85,4 +95,66 @@ class ICPUDataProvider : public IDataProvider
 	virtual void SetCPUNum(int32 newCpu) = 0;
 };
 
+//: Optional interface for data providers, which know when a value was read.
+// A data provider implements this interface additionally to IDataProvider.
+// It's found by dynamic_cast, so the vtable of IDataProvider stays the
+// same for plugins built against older versions of this header.
+class ISampledDataProvider
+{
+	public:
+	ISampledDataProvider() {}
+	virtual ~ISampledDataProvider() {}
+
+	//: Get the next sample and the time it was read.
+	// Providers reading cached data should return the time stamp of
+	// the cached reading. The time stamp is set even if the sample is
+	// invalid, as long as a reading was taken.
+	virtual bool GetNextSample(data_sample &sample) = 0;
+};
+
+// Returns the next sample of 'provider'. Providers which don't implement
+// ISampledDataProvider are read by GetNextValue() and get the current
+// time as time stamp.
+inline bool get_next_sample(IDataProvider *provider, data_sample &sample)
+{
+	ISampledDataProvider *sampledProvider = dynamic_cast<ISampledDataProvider *>(provider);
+
+	if(sampledProvider != NULL)
+		return sampledProvider->GetNextSample(sample);
+
+	float value = 0.0;
+
+	sample.timeStamp = system_time();
+
+	bool valid = provider->GetNextValue(value);
+		
+	sample.value = value;
+		
+	return valid;
+}
+
+//: Optional interface for data providers, which can be sampled in batches.
+// A data provider implements this interface additionally to IDataProvider.
+// All providers returning the same BatchKind() are sampled together by
+// a single call of GetNextSamples() on one of them. This allows sharing
+// the expensive part (a system call, a lock) between all providers of
+// a kind.
+class IBatchDataProvider
+{
+	public:
+	IBatchDataProvider() {}
+	virtual ~IBatchDataProvider() {}
+
+	//: Get the batch kind.
+	// The address of a static variable of the add-on is a good choice,
+	// as it is unique across all loaded add-ons.
+	virtual const void *BatchKind() = 0;
+	//: Get the next samples of 'count' providers.
+	// All 'providers' return the same BatchKind() as this object.
+	// The object may be one of them. 'samples[i]' and 'valid[i]' receive
+	// the result of get_next_sample() for 'providers[i]'.
+	virtual void GetNextSamples(IDataProvider **providers, int32 count,
+		data_sample *samples, bool *valid) = 0;
+};
+
 #endif // DATA_PROVIDER_H
\ No newline at end of file
@@ -20,6 +20,17 @@
 
 #include "DataProvider.h"
 
+//: Cursor of a paged enumeration of counters.
+// Initialize all fields with 0 before the first page is requested.
+// 'done' is set, when the last page was returned.
+struct counter_cursor
+{
+	int32	part;		// used by the counter (own children, namespace)
+	int32	plugin;		// used by the namespace (index of the plugin)
+	int32	cookie;		// used by the plugin or counter
+	bool	done;
+};
+
 class IPerformanceCounter
 {
 	public:
@@ -43,6 +54,33 @@ class IPerformanceCounterNamespace
 	virtual status_t EnumChildren(const char *path, BList *children) = 0;
 	virtual IDataProvider *DataProvider(const char *path) = 0;
 	virtual IPerformanceCounter *Root() = 0;
+
+	//: Paged version of EnumChildren().
+	// Appends the next page of children of 'path' to 'children'.
+	// The caller owns the new counters.
+	virtual status_t GetNextChildren(const char *path, counter_cursor *cursor,
+							int32 maxCount, BList *children) = 0;
+	//: Number of children of 'path' or -1 if unknown.
+	virtual int32 CountChildrenHint(const char *path) = 0;
+};
+
+//: Optional interface for counters, which can enumerate their children in pages.
+// Unlike ChildAt() the children aren't cached by the counter. Each call
+// creates new objects, which are owned by the caller.
+class IPagedPerformanceCounter
+{
+	public:
+	IPagedPerformanceCounter() {}
+	virtual ~IPagedPerformanceCounter() {}
+
+	//: Append the next page of children to 'children'.
+	// About 'maxCount' children are added. Implementations may add more,
+	// if the children are cheap to create together.
+	virtual status_t GetNextChildren(counter_cursor *cursor, int32 maxCount, 
+							BList *children) = 0;
+	//: Number of children or -1 if unknown.
+	// This should be cheap. It is used to decide if a counter is a leaf.
+	virtual int32 CountChildrenHint() = 0;
 };
 
 class IPerformanceCounterPlugin
@@ -55,6 +93,87 @@ class IPerformanceCounterPlugin
 							BList *children) = 0;
 };
 
+//: Optional interface for plugins, which can enumerate children in pages.
+// A plugin implements this interface additionally to IPerformanceCounterPlugin.
+class IPagedCounterPlugin
+{
+	public:
+	IPagedCounterPlugin() {}
+	virtual ~IPagedCounterPlugin() {}
+
+	//: Append the next page of children of 'path'.
+	// The plugin uses 'cookie' to remember its position. It sets 'done'
+	// after the last page. See IPagedPerformanceCounter::GetNextChildren().
+	virtual status_t GetNextChildren(IPerformanceCounterNamespace *counterNamespace, 
+							const char *path, int32 *cookie, bool *done,
+							int32 maxCount, BList *children) = 0;
+	//: Number of children the plugin adds to 'path' or -1 if unknown.
+	virtual int32 CountChildrenHint(const char *path) = 0;
+};
+
+//: Services of the host for plugins (ABI version 2).
+// A push source is a producer (usually a thread of the plugin), which
+// writes timestamped samples into a CSampleRing (see SampleRing.h),
+// instead of being read by the UI thread. The host drains all rings
+// once per tick and keeps the latest sample of each channel.
+class ICounterPluginHost
+{
+	public:
+	ICounterPluginHost() {}
+	virtual ~ICounterPluginHost() {}
+
+	//: Register a push source.
+	// 'ringArea' is the area of the ring the plugin writes into. The
+	// channels of the samples must be between 0 and 'channelCount'-1.
+	// Returns the id of the source or an error code.
+	virtual int32 RegisterPushSource(const char *name, area_id ringArea, 
+							int32 channelCount) = 0;
+	//: Unregister a push source.
+	// Must be called before the ring area is deleted.
+	virtual void UnregisterPushSource(int32 sourceId) = 0;
+	//: Get the latest sample of 'channel'.
+	// Returns false, if the source didn't deliver a valid sample yet.
+	virtual bool GetLatestSample(int32 sourceId, int32 channel, data_sample &sample) = 0;
+};
+
+// ====== Plugin ABI ======
+
+// Version 1 plugins only export CreateCounterPlugin().
+// Version 2 plugins additionally export the int32 variable
+// 'counter_plugin_abi_version' and CreateCounterPluginV2(), which
+// receives the host interface. The host calls the newest entry point
+// both sides support.
+const int32 COUNTER_PLUGIN_ABI_VERSION = 2;
+
 typedef status_t (*counter_plugin_entry_point)(IPerformanceCounterPlugin **plugin);
+typedef status_t (*counter_plugin_entry_point_v2)(ICounterPluginHost *host, 
+							IPerformanceCounterPlugin **plugin);
+
+// ====== Plugin Manifest ======
+
+// A plugin may describe itself by a message resource (type B_MESSAGE_TYPE)
+// with this name. Plugins with a manifest are only loaded, when one of
+// their counters or data providers is used. Plugins without a manifest
+// are loaded at startup.
+#define PLUGIN_MANIFEST_RESOURCE	"TaskManager:Manifest"
+
+const uint32 PLUGIN_MANIFEST		= 'TMpm';		// 'what' of the manifest
+
+// manifest fields
+#define PLUGIN_MANIFEST_ROOT		"root"		// string (one per top level counter)
+#define PLUGIN_MANIFEST_CLASS		"class"		// string (one per archivable data provider)
+#define PLUGIN_MANIFEST_DEADLINE	"deadline"	// int64 (microseconds, only used if isolated)
+#define PLUGIN_MANIFEST_REQUIRES	"requires"	// string (path of a device or file, optional)
+
+// If the plugin is loaded by the plugin host (see PluginHostProtocol.h),
+// requests to the plugin are abandoned after the deadline and samples
+// older than the deadline are treated as invalid.
+//
+// The top level counters of a plugin with manifest are created from
+// the manifest. They must not have a data provider or children of their
+// own. Their children are enumerated by path as usual.
+//
+// If one of the "requires" entries doesn't exist, the top level counters
+// aren't shown. The classes can still be unarchived.
 
 #endif // PERFORMANCE_COUNTER_H
\ No newline at end of file
@@ -81,9 +81,47 @@ const char *CPerformanceCounter::Name() const
 	return InternalName();
 }
 
+status_t CPerformanceCounter::GetNextChildren(counter_cursor *cursor, int32 maxCount, 
+	BList *children)
+{
+	if(cursor->part == 0) {
+		int32 oldCount = children->CountItems();
+	
+		if(CreateChildren(&cursor->cookie, maxCount, children))
+			return B_OK;
+			
+		// own children done. Continue with the children from the plugins.
+		cursor->part	= 1;
+		cursor->cookie	= 0;
+		
+		maxCount -= children->CountItems() - oldCount;
+		
+		if(maxCount <= 0)
+			return B_OK;
+	}
+
+	return namesp->GetNextChildren(path.String(), cursor, maxCount, children);
+}
+
+int32 CPerformanceCounter::CountChildrenHint()
+{
+	int32 ownCount = CountOwnChildren();
+	int32 pluginCount = namesp->CountChildrenHint(path.String());
+	
+	if(ownCount < 0 || pluginCount < 0)
+		return -1;
+		
+	return ownCount + pluginCount;
+}
+
 void CPerformanceCounter::InitChildren()
 {
 	if(initChildren) {
+		int32 cookie = 0;
+		
+		while(CreateChildren(&cookie, INT32_MAX, &children))
+			;
+	
 		namesp->EnumChildren(path.String(), &children);
 
 		initChildren = false;
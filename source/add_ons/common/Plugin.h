@@ -22,7 +22,11 @@
 #include "DataProvider.h"
 #include "PerformanceCounter.h"
 
-class CPerformanceCounter : public IPerformanceCounter
+//: Base class for performance counters.
+// The children are the children created by the counter itself (see
+// CreateChildren()) followed by the children the plugins add to the
+// counter's path.
+class CPerformanceCounter : public IPerformanceCounter, public IPagedPerformanceCounter
 {
 	public:
 	CPerformanceCounter(IPerformanceCounterNamespace *counterNamespace, 
@@ -37,10 +41,20 @@ class CPerformanceCounter : public IPerformanceCounter
 	virtual const char *Name() const;
 	virtual const char *InternalName() const;
 	virtual const char *Path() const;
+
+	virtual status_t GetNextChildren(counter_cursor *cursor, int32 maxCount, 
+							BList *children);
+	virtual int32 CountChildrenHint();
 	
 	protected:
 	virtual void InitChildren();
 	
+	// Creates about 'maxCount' of the counter's own children, starting
+	// at 'cookie' (0 for the first call). Returns true, if more follow.
+	virtual bool CreateChildren(int32 *cookie, int32 maxCount, BList *children) { return false; }
+	// Number of own children or -1 if unknown.
+	virtual int32 CountOwnChildren() { return 0; }
+	
 	bool initChildren;
 	BString path;
 	BString internalName;
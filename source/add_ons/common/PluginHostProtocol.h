@@ -0,0 +1,118 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef TSKMGR_PLUGIN_HOST_PROTOCOL_H
+#define TSKMGR_PLUGIN_HOST_PROTOCOL_H
+
+// Protocol between TaskManager and the plugin host process.
+//
+// Plugins in the "isolated" subdirectory of the add-on directory are
+// loaded by a host process (one per plugin) instead of TaskManager.
+// TaskManager starts the host with the path of the add-on and the id
+// of its reply port as arguments. The host answers with a
+// PLUGIN_HOST_READY message containing its request port and the area
+// of a CSampleRing, into which it writes the samples of all subscribed
+// data providers. Each subscription uses its own channel of the ring.
+//
+// All messages are flattened BMessages written to the ports with the
+// code PLUGIN_HOST_PORT_CODE. Requests with a "serial" field are
+// answered by a PLUGIN_HOST_REPLY with the same serial. TaskManager
+// only waits until the deadline of the plugin for a reply; late
+// replies are dropped.
+
+#define PLUGIN_HOST_EXECUTABLE			"TaskManagerPluginHost"
+#define PLUGIN_HOST_SIGNATURE			"application/x-vnd.task_manager_plugin_host"
+
+const int32 PLUGIN_HOST_PORT_CODE		= 'TMph';
+const int32 PLUGIN_HOST_PORT_CAPACITY	= 64;
+const int32 PLUGIN_HOST_CHANNEL_COUNT	= 1024;		// max. concurrent subscriptions
+
+// Default for PLUGIN_MANIFEST_DEADLINE.
+const bigtime_t PLUGIN_HOST_DEFAULT_DEADLINE	= 1000000;
+// Time the host has to load the plugin.
+const bigtime_t PLUGIN_HOST_START_TIMEOUT		= 5000000;
+
+// host -> TaskManager
+const uint32 PLUGIN_HOST_READY			= 'PHrd';	// "status", "port", "ring"
+const uint32 PLUGIN_HOST_REPLY			= 'PHre';	// "serial", "status", ...
+
+// TaskManager -> host
+const uint32 PLUGIN_HOST_ENUM_CHILDREN	= 'PHec';	// "serial", "path"
+const uint32 PLUGIN_HOST_DESCRIBE		= 'PHde';	// "serial", "archive"
+const uint32 PLUGIN_HOST_SUBSCRIBE		= 'PHsu';	// "channel", "path" or "archive"
+const uint32 PLUGIN_HOST_UNSUBSCRIBE	= 'PHun';	// "channel"
+const uint32 PLUGIN_HOST_QUIT			= 'PHqu';
+
+// message fields
+#define PLUGIN_HOST_SERIAL				"serial"		// int32
+#define PLUGIN_HOST_STATUS				"status"		// int32
+#define PLUGIN_HOST_PORT				"port"			// int32 (port_id)
+#define PLUGIN_HOST_RING				"ring"			// int32 (area_id)
+#define PLUGIN_HOST_PATH				"path"			// string
+#define PLUGIN_HOST_ARCHIVE				"archive"		// message
+#define PLUGIN_HOST_CHANNEL				"channel"		// int32
+
+// Fields of an enumeration reply. They are repeated for each child.
+// "archive" is an empty message, if the child has no archivable data
+// provider. "flags", "unit" and "display_name" are also the fields
+// of a describe reply.
+#define PLUGIN_HOST_NAME_FIELD			"name"			// string
+#define PLUGIN_HOST_INTERNAL_NAME		"internal_name"	// string
+#define PLUGIN_HOST_HAS_PROVIDER		"has_provider"	// bool
+#define PLUGIN_HOST_FLAGS				"flags"			// int32
+#define PLUGIN_HOST_UNIT				"unit"			// int32
+#define PLUGIN_HOST_DISPLAY_NAME		"display_name"	// string
+
+// Helpers used by both sides.
+
+inline status_t send_plugin_host_message(port_id port, BMessage *message, bigtime_t timeout)
+{
+	ssize_t size = message->FlattenedSize();
+	char *buffer = new char[size];
+	
+	status_t status = message->Flatten(buffer, size);
+	
+	if(status == B_OK)
+		status = write_port_etc(port, PLUGIN_HOST_PORT_CODE, buffer, size, 
+			B_RELATIVE_TIMEOUT, timeout);
+	
+	delete [] buffer;
+	
+	return status;
+}
+
+inline status_t receive_plugin_host_message(port_id port, BMessage *message, bigtime_t timeout)
+{
+	ssize_t size = port_buffer_size_etc(port, B_RELATIVE_TIMEOUT, timeout);
+	
+	if(size < B_OK)
+		return size;
+		
+	char *buffer = new char[size];
+	int32 code;
+	
+	status_t status = read_port_etc(port, &code, buffer, size, B_RELATIVE_TIMEOUT, 0);
+	
+	if(status >= B_OK)
+		status = code == PLUGIN_HOST_PORT_CODE ? message->Unflatten(buffer) : B_BAD_DATA;
+	
+	delete [] buffer;
+	
+	return status;
+}
+
+#endif // TSKMGR_PLUGIN_HOST_PROTOCOL_H
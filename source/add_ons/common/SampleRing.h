@@ -0,0 +1,204 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TSKMGR_SAMPLE_RING_H
+#define TSKMGR_SAMPLE_RING_H
+
+// The ring is implemented inline, so plugins don't need to link
+// an additional source file.
+
+//: Element of a CSampleRing.
+struct ring_sample
+{
+	bigtime_t	timeStamp;		// system_time() of the reading
+	double		value;
+	int32		channel;
+	int32		valid;			// 0, if the channel has no valid value
+};
+
+//: Header at the start of the area of a CSampleRing.
+struct sample_ring_header
+{
+	uint32		magic;
+	int32		capacity;		// number of samples (a power of 2)
+	int32		writeIndex;		// only written by the producer
+	int32		readIndex;		// only written by the consumer
+	int32		overruns;		// samples dropped, because the ring was full
+};
+
+const uint32 SAMPLE_RING_MAGIC = 'TMsr';
+
+// The consumer may be in another team (see PluginHost).
+#ifdef B_CLONEABLE_AREA
+const uint32 SAMPLE_RING_PROTECTION = B_READ_AREA | B_WRITE_AREA | B_CLONEABLE_AREA;
+#else
+const uint32 SAMPLE_RING_PROTECTION = B_READ_AREA | B_WRITE_AREA;
+#endif
+
+//: Lock-free single producer, single consumer ring of samples.
+// The ring lives in an area, so producer and consumer may be in
+// different teams. The producer creates the area by Create(), the
+// consumer attaches to it by Clone(). Both indices only grow (modulo
+// 2^32), the slot of an index is 'index & (capacity-1)'. Each index is
+// written by one side only and published by atomic_set() after the
+// slot was written or read. The capacity is read from the header only
+// once, so the other side can't move the slots out of the area.
+class CSampleRing
+{
+	public:
+	CSampleRing() { area = -1; header = NULL; samples = NULL; capacity = 0; }
+	~CSampleRing() { if(area >= 0) delete_area(area); }
+
+	// Creates a new ring for 'capacity' samples (rounded up to a power of 2).
+	status_t Create(const char *name, int32 minCapacity)
+	{
+		int32 roundedCapacity = 1;
+		
+		while(roundedCapacity < minCapacity)
+			roundedCapacity *= 2;
+	
+		size_t size = sizeof(sample_ring_header) + roundedCapacity * sizeof(ring_sample);
+		
+		size = (size + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+		
+		void *address;
+		
+		area = create_area(name, &address, B_ANY_ADDRESS, size, B_NO_LOCK, 
+			SAMPLE_RING_PROTECTION);
+		
+		if(area < B_OK)
+			return area;
+			
+		header		= (sample_ring_header *)address;
+		samples		= (ring_sample *)(header + 1);
+		capacity	= roundedCapacity;
+		
+		header->capacity	= roundedCapacity;
+		header->writeIndex	= 0;
+		header->readIndex	= 0;
+		header->overruns	= 0;
+		
+		atomic_set((int32 *)&header->magic, SAMPLE_RING_MAGIC);
+		
+		return B_OK;
+	}
+
+	// Attaches to the ring in the area 'source'. The ring must fit
+	// into the area.
+	status_t Clone(area_id source)
+	{
+		void *address;
+	
+		area = clone_area("sample ring clone", &address, B_ANY_ADDRESS,
+			B_READ_AREA | B_WRITE_AREA, source);
+			
+		if(area < B_OK)
+			return area;
+		
+		area_info info;
+		
+		header		= (sample_ring_header *)address;
+		samples		= (ring_sample *)(header + 1);
+		capacity	= atomic_get(&header->capacity);
+		
+		if(get_area_info(area, &info) != B_OK ||
+		   info.size < sizeof(sample_ring_header) ||
+		   header->magic != SAMPLE_RING_MAGIC || 
+		   capacity <= 0 || (capacity & (capacity-1)) != 0 ||
+		   (size_t)capacity > (info.size - sizeof(sample_ring_header)) / sizeof(ring_sample)) {
+			delete_area(area);
+			area	 = -1;
+			header	 = NULL;
+			samples	 = NULL;
+			capacity = 0;
+			return B_BAD_DATA;
+		}
+		
+		return B_OK;
+	}
+	
+	area_id Area() const { return area; }
+	int32 CountOverruns() const { return header ? atomic_get(&header->overruns) : 0; }
+	
+	// Producer side. Returns false, if the ring is full. The sample is dropped then.
+	bool Write(int32 channel, bigtime_t timeStamp, double value, bool valid)
+	{
+		uint32 write = (uint32)header->writeIndex;
+		uint32 read  = (uint32)atomic_get(&header->readIndex);
+		
+		if(write - read >= (uint32)capacity) {
+			atomic_add(&header->overruns, 1);
+			return false;
+		}
+		
+		ring_sample &sample = samples[write & (capacity-1)];
+		
+		sample.timeStamp	= timeStamp;
+		sample.value		= value;
+		sample.channel		= channel;
+		sample.valid		= valid ? 1 : 0;
+		
+		atomic_set(&header->writeIndex, (int32)(write + 1));
+		
+		return true;
+	}
+	
+	// Consumer side. Takes one snapshot of the write index and returns
+	// the number of samples, which can be read by Read() now. A consumer
+	// should read at most that many samples in one go, so a producer,
+	// which writes as fast as it can, can't keep it busy. If the producer
+	// claims to be more than 'capacity' samples ahead, the excess is
+	// skipped and counted as overruns.
+	int32 CountReadable()
+	{
+		uint32 read  = (uint32)header->readIndex;
+		uint32 write = (uint32)atomic_get(&header->writeIndex);
+		
+		if(write - read > (uint32)capacity) {
+			atomic_add(&header->overruns, (int32)(write - read - capacity));
+			atomic_set(&header->readIndex, (int32)(write - capacity));
+			
+			return capacity;
+		}
+		
+		return (int32)(write - read);
+	}
+	
+	// Consumer side. Returns false, if the ring is empty.
+	bool Read(ring_sample &sample)
+	{
+		uint32 read  = (uint32)header->readIndex;
+		uint32 write = (uint32)atomic_get(&header->writeIndex);
+		
+		if(read == write)
+			return false;
+			
+		sample = samples[read & (capacity-1)];
+		
+		atomic_set(&header->readIndex, (int32)(read + 1));
+		
+		return true;
+	}
+	
+	protected:
+	area_id				 area;
+	sample_ring_header	*header;
+	ring_sample			*samples;
+	int32				 capacity;		// read once from the header
+};
+
+#endif // TSKMGR_SAMPLE_RING_H
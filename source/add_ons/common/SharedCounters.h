@@ -0,0 +1,210 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef TSKMGR_SHARED_COUNTERS_H
+#define TSKMGR_SHARED_COUNTERS_H
+
+// Layout of the area, into which TaskManager publishes the latest
+// values of all counters displayed in its views, and a reader
+// for that area. The reader is implemented inline, so monitoring
+// tools only need to include this file.
+//
+// The area starts with a counter_export_header, followed by the slot
+// array and the string table. A slot is appended, when a counter is
+// displayed for the first time. Slots are never moved or removed, but
+// they are deactivated, when the counter isn't displayed anymore.
+// An inactive slot is reused, if the same counter path is displayed
+// again. The string table only grows.
+//
+// Each slot is protected by a sequence lock: the writer increments
+// 'sequence' before and after it changes the slot, so the sequence
+// is odd while the slot is written. A reader copies the slot and
+// retries, if the sequence was odd or changed in the meantime. Polling
+// doesn't need any system call.
+//
+// The fields of a slot are written and read by plain memory accesses,
+// so they are ordered against the sequence by fences:
+// - writer: increment, release fence, fields, release fence, increment
+// - reader: read sequence, fields, acquire fence, read sequence
+// The first writer fence keeps the fields from being written before
+// the sequence is odd, the reader fence keeps them from being read
+// after the sequence was checked again.
+//
+// Whether a slot holds a value is only told by 'valid'. It's 0 until
+// the first value is published and whenever the latest sample of the
+// counter was invalid. 'timeStamp' is the time of the latest publish,
+// even for invalid samples.
+//
+// The deskbar replicant runs in the Deskbar and publishes its counters
+// in an area of its own.
+
+// Fences of the sequence lock (see above). Without the atomic builtins
+// (gcc 2) the fences only stop the compiler, which is sufficient for
+// the store order of x86.
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define COUNTER_EXPORT_ACQUIRE_FENCE()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define COUNTER_EXPORT_RELEASE_FENCE()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define COUNTER_EXPORT_ACQUIRE_FENCE()	__asm__ __volatile__("" : : : "memory")
+#define COUNTER_EXPORT_RELEASE_FENCE()	__asm__ __volatile__("" : : : "memory")
+#endif
+
+#define COUNTER_EXPORT_AREA_NAME			"TaskManager:Counters"
+#define COUNTER_EXPORT_DESKBAR_AREA_NAME	"TaskManager:Counters:Deskbar"
+
+const uint32 COUNTER_EXPORT_MAGIC		= 'TMce';
+const int32 COUNTER_EXPORT_VERSION		= 1;
+
+struct counter_export_header
+{
+	uint32		magic;
+	int32		version;
+	int32		slotCapacity;
+	int32		slotCount;				// initialized slots, only grows
+	int32		slotOffset;				// from the start of the area
+	int32		stringTableOffset;		// from the start of the area
+	int32		stringTableSize;
+	int32		stringTableUsed;
+	int32		generation;				// incremented, when a slot is (de)activated
+	team_id		writerTeam;
+};
+
+struct counter_export_slot
+{
+	int32		sequence;				// odd while the slot is written
+	int32		pathOffset;				// into the string table
+	int32		active;					// 0, if the counter isn't displayed anymore
+	int32		valid;					// 0, if there is no valid value (see above)
+	bigtime_t	timeStamp;				// time of the latest sample, never 0 once published
+	double		value;					// latest value as displayed
+	double		min;
+	double		max;
+	double		avg;
+};
+
+//: Copy of a slot taken by CCounterExportReader.
+struct counter_export_value
+{
+	bigtime_t	timeStamp;
+	double		value;
+	double		min;
+	double		max;
+	double		avg;
+	bool		valid;
+};
+
+//: Reader of the counter export of TaskManager.
+// Attach() clones the area once. All other methods only read memory.
+class CCounterExportReader
+{
+	public:
+	CCounterExportReader() { area = -1; header = NULL; }
+	~CCounterExportReader() { if(area >= 0) delete_area(area); }
+	
+	// Attaches to the area of the running TaskManager or, if 'areaName'
+	// is COUNTER_EXPORT_DESKBAR_AREA_NAME, of its deskbar replicant.
+	status_t Attach(const char *areaName=COUNTER_EXPORT_AREA_NAME)
+	{
+		area_id source = find_area(areaName);
+		
+		if(source < B_OK)
+			return source;
+			
+		void *address;
+		
+		area = clone_area("TaskManager counters clone", &address, B_ANY_ADDRESS,
+			B_READ_AREA, source);
+			
+		if(area < B_OK)
+			return area;
+			
+		header = (const counter_export_header *)address;
+		
+		if(header->magic != COUNTER_EXPORT_MAGIC || header->version != COUNTER_EXPORT_VERSION) {
+			delete_area(area);
+			area	= -1;
+			header	= NULL;
+			return B_BAD_DATA;
+		}
+		
+		return B_OK;
+	}
+	
+	// Team of TaskManager. The area stays readable after TaskManager
+	// quit, but the values aren't updated anymore then.
+	team_id WriterTeam() const { return header ? header->writerTeam : -1; }
+	
+	// Changes, when counters are added or removed.
+	int32 Generation() const { return header ? atomic_get((int32 *)&header->generation) : 0; }
+	
+	// Number of slots. Some of them may be inactive.
+	int32 CountCounters() const { return header ? atomic_get((int32 *)&header->slotCount) : 0; }
+	
+	const char *PathAt(int32 index) const
+	{
+		if(index < 0 || index >= CountCounters())
+			return NULL;
+			
+		return (const char *)header + header->stringTableOffset + Slot(index)->pathOffset;
+	}
+	
+	// Returns false, if the slot is inactive or was changed too often
+	// while it was read. Check 'value.valid' before using the values.
+	bool ReadCounter(int32 index, counter_export_value &value) const
+	{
+		if(index < 0 || index >= CountCounters())
+			return false;
+			
+		const counter_export_slot *slot = Slot(index);
+		
+		for(int32 retry=0 ; retry<MAX_RETRIES ; retry++) {
+			int32 begin = atomic_get((int32 *)&slot->sequence);
+			
+			if(begin & 1)
+				continue;
+				
+			value.timeStamp	= slot->timeStamp;
+			value.value		= slot->value;
+			value.min		= slot->min;
+			value.max		= slot->max;
+			value.avg		= slot->avg;
+			value.valid		= slot->valid != 0;
+			
+			bool active		= slot->active != 0;
+			
+			COUNTER_EXPORT_ACQUIRE_FENCE();
+			
+			if(atomic_get((int32 *)&slot->sequence) == begin)
+				return active;
+		}
+		
+		return false;
+	}
+	
+	protected:
+	static const int32 MAX_RETRIES = 100;
+
+	const counter_export_slot *Slot(int32 index) const
+	{
+		return (const counter_export_slot *)((const char *)header + header->slotOffset) + index;
+	}
+
+	area_id							 area;
+	const counter_export_header		*header;
+};
+
+#endif // TSKMGR_SHARED_COUNTERS_H
@@ -29,7 +29,7 @@ status_t CSystemInfo::GetSystemInfo(system_info *systemInfo, bigtime_t *_timeSta
 {
 	bigtime_t dist = system_time() - timeStamp;
 	
-	if(dist >= FAST_PULSE_RATE/2) {
+	if(dist >= max_cache_age()) {
 		// cached system info is out of date
 		RETURN_IF_FAILED( UpdateSystemInfo() );
 	}
@@ -57,3 +57,95 @@ CSystemInfo *CSystemInfo::CreateInstance()
 
 	return CreateSingleton(sysInfo, "CSystemInfo");
 }
+
+// ====== CCPUInfoCache ======
+
+CCPUInfoCache::CCPUInfoCache() :
+	locker("CPUInfoCache")
+{
+	cpuInfos	= NULL;
+	cpuCount	= 0;
+	capacity	= 0;
+	timeStamp	= 0;
+}
+
+CCPUInfoCache::~CCPUInfoCache()
+{
+	delete [] cpuInfos;
+}
+
+status_t CCPUInfoCache::Lock()
+{
+	if(!locker.Lock())
+		return B_ERROR;
+
+	status_t status = B_OK;
+
+	if(system_time() - timeStamp >= max_cache_age()) {
+		// cached cpu info is out of date
+		status = UpdateCPUInfo();
+	}
+
+	if(status != B_OK)
+		locker.Unlock();
+
+	return status;
+}
+
+void CCPUInfoCache::Unlock()
+{
+	locker.Unlock();
+}
+
+status_t CCPUInfoCache::UpdateCPUInfo()
+{
+	system_info sysInfo;
+
+	RETURN_IF_FAILED( get_cached_system_info(&sysInfo, NULL) );
+
+	if((int32)sysInfo.cpu_count > capacity) {
+		delete [] cpuInfos;
+
+		capacity = sysInfo.cpu_count;
+		cpuInfos = new cpu_info[capacity];
+	}
+
+	RETURN_IF_FAILED( get_cpu_info(0, sysInfo.cpu_count, cpuInfos) );
+
+	cpuCount  = sysInfo.cpu_count;
+	timeStamp = system_time();
+
+	return B_OK;
+}
+
+CCPUInfoCache *CCPUInfoCache::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CCPUInfoCache *cache = NULL;
+
+	return CreateSingleton(cache, "CCPUInfoCache");
+}
+
+// ====== CCPUInfoView ======
+
+CCPUInfoView::CCPUInfoView()
+{
+	cache  = CCPUInfoCache::CreateInstance();
+	status = cache->Lock();
+}
+
+CCPUInfoView::~CCPUInfoView()
+{
+	if(status == B_OK)
+		cache->Unlock();
+}
+
+bigtime_t CCPUInfoView::TotalActiveTime() const
+{
+	bigtime_t activeTime = 0;
+
+	for(int32 i=0 ; i<cache->cpuCount ; i++)
+		activeTime += cache->cpuInfos[i].active_time;
+
+	return activeTime;
+}
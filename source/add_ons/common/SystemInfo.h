@@ -46,4 +46,61 @@ inline status_t get_cached_system_info(system_info *systemInfo, bigtime_t *timeS
 	return instance->GetSystemInfo(systemInfo, timeStamp);
 }
 
+//: Per tick cache of the per CPU info.
+// The whole cpu_info array is read by one get_cpu_info() call, at most
+// once per max_cache_age(). The array is only reallocated, if the CPU
+// count grows. The cache is read through a CCPUInfoView.
+// Like every CSingleton the cache exists once per image: the app and
+// each add-on read their own copy.
+class CCPUInfoCache : public CSingleton
+{
+	public:
+	static CCPUInfoCache *CreateInstance();
+
+	virtual ~CCPUInfoCache();
+	virtual void Reactivate() {}
+
+	protected:
+	CCPUInfoCache();
+
+	// Locks the cache and refreshes it, if it's out of date.
+	status_t Lock();
+	void Unlock();
+
+	status_t UpdateCPUInfo();
+
+	BLocker		 locker;
+	cpu_info	*cpuInfos;
+	int32		 cpuCount;
+	int32		 capacity;			// size of 'cpuInfos'
+	bigtime_t	 timeStamp;
+
+	friend class CSingleton;
+	friend class CCPUInfoView;
+};
+
+//: Read-only view of the CCPUInfoCache.
+// The cache stays locked as long as the view exists, so all values
+// of a view belong to the same time stamp. Keep views short lived.
+class CCPUInfoView
+{
+	public:
+	CCPUInfoView();
+	~CCPUInfoView();
+
+	status_t InitCheck() const					{ return status; }
+
+	bigtime_t TimeStamp() const					{ return cache->timeStamp; }
+	int32 CountCPUs() const						{ return cache->cpuCount; }
+	const cpu_info *CPUInfos() const			{ return cache->cpuInfos; }
+	bigtime_t ActiveTime(int32 cpu) const		{ return cache->cpuInfos[cpu].active_time; }
+
+	// Sum of the active times of all CPUs.
+	bigtime_t TotalActiveTime() const;
+
+	protected:
+	CCPUInfoCache	*cache;
+	status_t		 status;
+};
+
 #endif // TSKMGR_SYSTEM_INFO_H
@@ -0,0 +1,814 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "my_assert.h"
+#include "common.h"
+#include "SystemSnapshot.h"
+
+// ====== CKernelDataSource ======
+
+bigtime_t CKernelDataSource::SystemTime()
+{
+	return system_time();
+}
+
+status_t CKernelDataSource::GetSystemInfo(system_info *info)
+{
+	return get_system_info(info);
+}
+
+status_t CKernelDataSource::GetCPUInfo(uint32 cpuCount, cpu_info *info)
+{
+	return get_cpu_info(0, cpuCount, info);
+}
+
+status_t CKernelDataSource::GetNextTeamInfo(int32 *cookie, team_info *info)
+{
+	return get_next_team_info(cookie, info);
+}
+
+status_t CKernelDataSource::GetNextThreadInfo(team_id team, int32 *cookie, thread_info *info)
+{
+	return get_next_thread_info(team, cookie, info);
+}
+
+status_t CKernelDataSource::GetNextAreaInfo(team_id team, ssize_t *cookie, area_info *info)
+{
+	return get_next_area_info(team, cookie, info);
+}
+
+status_t CKernelDataSource::GetNextImageInfo(team_id team, int32 *cookie, image_info *info)
+{
+	return get_next_image_info(team, cookie, info);
+}
+
+// ====== CSystemSnapshot ======
+
+CSystemSnapshot::CSystemSnapshot()
+{
+	refCount	 = 0;
+	contents	 = 0;
+	timeStamp	 = 0;
+	cpuCount	 = 0;
+	teamCount	 = 0;
+	threadCount	 = 0;
+	teamHashMask = 0;
+	threadHashMask = 0;
+	skippedAreaWalks = 0;
+	stringsSize	 = 0;
+}
+
+const int32 CSystemSnapshot::MAX_AREA_SIZE_AGE = 10;
+
+// Build
+// Reads the requested 'parts' from 'source'. Each team is visited
+// exactly once; its threads and areas are walked right away.
+status_t CSystemSnapshot::Build(ISystemDataSource *source, uint32 parts,
+	const CSystemSnapshot *previous)
+{
+	MY_ASSERT(source != NULL && previous != this);
+
+	const CSystemSnapshot *imagePrevious = previous;
+
+	if(imagePrevious != NULL && !(imagePrevious->Contents() & SNAPSHOT_TEAMS))
+		imagePrevious = NULL;
+
+	// The fingerprint needs the CPU times of both snapshots.
+	uint32 fingerprintParts = SNAPSHOT_THREADS | SNAPSHOT_AREAS;
+
+	if(previous != NULL && (previous->Contents() & fingerprintParts) != fingerprintParts)
+		previous = NULL;
+
+	if(parts & (SNAPSHOT_THREADS | SNAPSHOT_AREAS))
+		parts |= SNAPSHOT_TEAMS;
+
+	contents	= 0;
+	cpuCount	= 0;
+	teamCount	= 0;
+	threadCount	= 0;
+	stringsSize	= 0;
+	skippedAreaWalks = 0;
+
+	RETURN_IF_FAILED( source->GetSystemInfo(&systemInfo) );
+
+	timeStamp = source->SystemTime();
+
+	if(parts & SNAPSHOT_CPUS) {
+		cpuInfos.Reserve(systemInfo.cpu_count);
+
+		RETURN_IF_FAILED( source->GetCPUInfo(systemInfo.cpu_count, cpuInfos.Data()) );
+
+		cpuCount = systemInfo.cpu_count;
+	}
+
+	if(parts & SNAPSHOT_TEAMS) {
+		team_info	teamInfo;
+		int32		teamCookie = 0;
+
+		while(source->GetNextTeamInfo(&teamCookie, &teamInfo) == B_OK) {
+			int32 t = teamCount;
+
+			teamIds.Reserve(t+1);
+			teamThreadCounts.Reserve(t+1);
+			teamAreaCounts.Reserve(t+1);
+			teamImageCounts.Reserve(t+1);
+			teamUserTimes.Reserve(t+1);
+			teamKernelTimes.Reserve(t+1);
+			teamAreaSizes.Reserve(t+1);
+			teamAreaSizeAges.Reserve(t+1);
+			teamFirstThreads.Reserve(t+1);
+			teamEndThreads.Reserve(t+1);
+			teamParentIds.Reserve(t+1);
+			teamParents.Reserve(t+1);
+			teamFirstChilds.Reserve(t+1);
+			teamNextSiblings.Reserve(t+1);
+			teamSubtrees.Reserve(t+1);
+			teamImages.Reserve(t+1);
+
+			teamIds[t]			= teamInfo.team;
+			teamThreadCounts[t]	= teamInfo.thread_count;
+			teamAreaCounts[t]	= teamInfo.area_count;
+			teamImageCounts[t]	= teamInfo.image_count;
+			teamUserTimes[t]	= 0;
+			teamKernelTimes[t]	= 0;
+			teamAreaSizes[t]	= 0;
+			teamAreaSizeAges[t]	= 0;
+			teamFirstThreads[t]	= threadCount;
+			teamParentIds[t]	= teamInfo.parent;
+
+			ReadTeamImage(source, teamInfo, imagePrevious);
+
+			if(parts & SNAPSHOT_THREADS) {
+				thread_info threadInfo;
+				int32 threadCookie = 0;
+
+				while(source->GetNextThreadInfo(teamInfo.team, &threadCookie, &threadInfo) == B_OK) {
+					int32 i = threadCount;
+
+					threadIds.Reserve(i+1);
+					threadTeams.Reserve(i+1);
+					threadUserTimes.Reserve(i+1);
+					threadKernelTimes.Reserve(i+1);
+					threadPriorities.Reserve(i+1);
+					threadStates.Reserve(i+1);
+					threadNames.Reserve(i+1);
+
+					threadIds[i]		 = threadInfo.thread;
+					threadTeams[i]		 = t;
+					threadUserTimes[i]	 = threadInfo.user_time;
+					threadKernelTimes[i] = threadInfo.kernel_time;
+					threadPriorities[i]	 = threadInfo.priority;
+					threadStates[i]		 = threadInfo.state;
+
+					strlcpy(threadNames[i].name, threadInfo.name, B_OS_NAME_LENGTH);
+
+					teamUserTimes[t]	+= threadInfo.user_time;
+					teamKernelTimes[t]	+= threadInfo.kernel_time;
+
+					threadCount++;
+				}
+			}
+
+			teamEndThreads[t] = threadCount;
+
+			if((parts & SNAPSHOT_AREAS) && (parts & SNAPSHOT_THREADS) && 
+			   CopyAreaSize(t, previous)) {
+				skippedAreaWalks++;
+			} else if(parts & SNAPSHOT_AREAS) {
+				area_info areaInfo;
+				ssize_t areaCookie = 0;
+
+				while(source->GetNextAreaInfo(teamInfo.team, &areaCookie, &areaInfo) == B_OK) {
+					teamAreaSizes[t] += areaInfo.ram_size;
+				}
+			}
+
+			teamCount++;
+		}
+
+		BuildTeamHash();
+		BuildTeamTree();
+
+		if(parts & SNAPSHOT_THREADS)
+			BuildThreadHash();
+	}
+
+	contents = parts;
+
+	return B_OK;
+}
+
+// CopyAreaSize
+// Copies the area size of team 't' from 'previous', if the team's
+// fingerprint didn't change. A team which didn't run can't have
+// touched new pages itself. Returns false, if the areas must be walked.
+bool CSystemSnapshot::CopyAreaSize(int32 t, const CSystemSnapshot *previous)
+{
+	if(previous == NULL)
+		return false;
+
+	int32 p = previous->FindTeam(teamIds[t]);
+
+	if(p < 0 || previous->teamAreaSizeAges[p] >= MAX_AREA_SIZE_AGE)
+		return false;
+
+	if(previous->teamThreadCounts[p] != teamThreadCounts[t] ||
+	   previous->teamAreaCounts[p] != teamAreaCounts[t] ||
+	   previous->teamImageCounts[p] != teamImageCounts[t] ||
+	   previous->teamUserTimes[p] != teamUserTimes[t] ||
+	   previous->teamKernelTimes[p] != teamKernelTimes[t])
+		return false;
+
+	teamAreaSizes[t]	= previous->teamAreaSizes[p];
+	teamAreaSizeAges[t]	= previous->teamAreaSizeAges[p] + 1;
+
+	return true;
+}
+
+// ReadTeamImage
+// Fills the image column of team 'teamCount'. The values are copied
+// from 'previous', unless the team is new or its image count or args
+// changed. A forked team has the image of its parent until it calls
+// exec, which may load as many images as the parent had, but replaces
+// the args.
+void CSystemSnapshot::ReadTeamImage(ISystemDataSource *source,
+	const team_info &teamInfo, const CSystemSnapshot *previous)
+{
+	snapshot_image &image = teamImages[teamCount];
+
+	image.argsHash = HashArgs(teamInfo);
+
+	int32 p = previous != NULL ? previous->FindTeam(teamInfo.team) : -1;
+
+	if(p >= 0 && previous->teamImageCounts[p] == teamInfo.image_count &&
+	   previous->teamImages[p].argsHash == image.argsHash) {
+		const char *path = previous->TeamPath(p);
+
+		image.device	 = previous->teamImages[p].device;
+		image.node		 = previous->teamImages[p].node;
+		image.pathOffset = path != NULL ? AddString(path) : -1;
+		image.nameOffset = AddString(previous->TeamName(p));
+
+		return;
+	}
+
+	image_info imageInfo;
+	int32 cookie = 0;
+
+	// look for main application image
+	while(source->GetNextImageInfo(teamInfo.team, &cookie, &imageInfo) == B_OK) {
+		if(imageInfo.type == B_APP_IMAGE) {
+			const char *leaf = strrchr(imageInfo.name, '/');
+
+			image.device	 = imageInfo.device;
+			image.node		 = imageInfo.node;
+			image.pathOffset = AddString(imageInfo.name);
+			image.nameOffset = AddString(leaf != NULL ? leaf+1 : imageInfo.name);
+
+			return;
+		}
+	}
+
+	// Teams without an image (e.g. the "Kernel-Team").
+	image.device	 = -1;
+	image.node		 = -1;
+	image.pathOffset = -1;
+	image.nameOffset = AddString(teamInfo.args);
+}
+
+// HashArgs
+// FNV-1a hash of the args of a team.
+uint32 CSystemSnapshot::HashArgs(const team_info &teamInfo)
+{
+	uint32 hash = 2166136261UL;
+
+	for(int32 i=0 ; i<(int32)sizeof(teamInfo.args) && teamInfo.args[i] != 0 ; i++) {
+		hash ^= (uint8)teamInfo.args[i];
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+// AddString
+// Appends 'string' to the string pool and returns its offset.
+int32 CSystemSnapshot::AddString(const char *string)
+{
+	int32 offset = stringsSize;
+	int32 length = strlen(string) + 1;
+
+	strings.Reserve(offset + length);
+	memcpy(&strings[offset], string, length);
+
+	stringsSize += length;
+
+	return offset;
+}
+
+const char *CSystemSnapshot::TeamPath(int32 index) const
+{
+	int32 offset = teamImages[index].pathOffset;
+
+	return offset >= 0 ? &strings[offset] : NULL;
+}
+
+// BuildTeamHash
+// Fills the team hash. It's kept at a load factor below 1/2.
+void CSystemSnapshot::BuildTeamHash()
+{
+	int32 hashSize = 16;
+
+	while(hashSize < teamCount*2)
+		hashSize *= 2;
+
+	teamHash.Reserve(hashSize);
+	teamHashMask = hashSize-1;
+
+	for(int32 i=0 ; i<hashSize ; i++)
+		teamHash[i] = -1;
+
+	for(int32 t=0 ; t<teamCount ; t++) {
+		int32 i = HashIndex(teamIds[t], teamHashMask);
+
+		while(teamHash[i] != -1)
+			i = (i+1) & teamHashMask;
+
+		teamHash[i] = t;
+	}
+}
+
+// FindTeam
+// Returns the index of team 'id' or -1, if the team isn't part of
+// the snapshot.
+int32 CSystemSnapshot::FindTeam(team_id id) const
+{
+	if(teamCount == 0)
+		return -1;
+
+	int32 i = HashIndex(id, teamHashMask);
+
+	while(teamHash[i] != -1) {
+		if(teamIds[teamHash[i]] == id)
+			return teamHash[i];
+
+		i = (i+1) & teamHashMask;
+	}
+
+	return -1;
+}
+
+// BuildTeamTree
+// Links every team to its parent, if the parent is part of the
+// snapshot. Teams without a parent are roots. Afterwards the
+// subtree sums are added up bottom-up.
+void CSystemSnapshot::BuildTeamTree()
+{
+	for(int32 t=0 ; t<teamCount ; t++) {
+		teamFirstChilds[t]	= -1;
+		teamNextSiblings[t]	= -1;
+	}
+
+	for(int32 t=0 ; t<teamCount ; t++) {
+		int32 parent = (teamParentIds[t] != teamIds[t]) ? FindTeam(teamParentIds[t]) : -1;
+
+		teamParents[t] = parent;
+
+		if(parent >= 0) {
+			teamNextSiblings[t] = teamFirstChilds[parent];
+			teamFirstChilds[parent] = t;
+		}
+	}
+
+	BuildSubtreeTotals();
+}
+
+// BuildSubtreeTotals
+// Lists the teams in pre-order and adds the sums of every team to its
+// parent in reverse order, so each team is visited once. The walk is
+// limited to CountTeams() steps, so an inconsistent snapshot (team ids
+// are reused while the snapshot is taken) can't loop forever. Teams
+// caught in such a cycle only get their own values.
+void CSystemSnapshot::BuildSubtreeTotals()
+{
+	int32 orderCount = 0;
+
+	teamOrder.Reserve(teamCount);
+
+	for(int32 t=0 ; t<teamCount ; t++) {
+		subtree_totals &totals = teamSubtrees[t];
+
+		totals.team_count	= 1;
+		totals.user_time	= teamUserTimes[t];
+		totals.kernel_time	= teamKernelTimes[t];
+		totals.area_size	= teamAreaSizes[t];
+		totals.thread_count	= teamThreadCounts[t];
+		totals.image_count	= teamImageCounts[t];
+	}
+
+	for(int32 root=0 ; root<teamCount ; root++) {
+		if(teamParents[root] != -1)
+			continue;
+
+		int32 node = root;
+
+		while(orderCount < teamCount) {
+			teamOrder[orderCount++] = node;
+
+			// next node in pre-order
+			if(teamFirstChilds[node] != -1) {
+				node = teamFirstChilds[node];
+			} else {
+				while(node != root && teamNextSiblings[node] == -1)
+					node = teamParents[node];
+
+				if(node == root)
+					break;
+
+				node = teamNextSiblings[node];
+			}
+		}
+	}
+
+	for(int32 i=orderCount-1 ; i>=0 ; i--) {
+		int32 t = teamOrder[i];
+		int32 parent = teamParents[t];
+
+		if(parent == -1)
+			continue;
+
+		subtree_totals &totals		 = teamSubtrees[parent];
+		const subtree_totals &child	 = teamSubtrees[t];
+
+		totals.team_count	+= child.team_count;
+		totals.user_time	+= child.user_time;
+		totals.kernel_time	+= child.kernel_time;
+		totals.area_size	+= child.area_size;
+		totals.thread_count	+= child.thread_count;
+		totals.image_count	+= child.image_count;
+	}
+}
+
+// BuildThreadHash
+// Fills the thread hash. It's kept at a load factor below 1/2.
+void CSystemSnapshot::BuildThreadHash()
+{
+	int32 hashSize = 16;
+
+	while(hashSize < threadCount*2)
+		hashSize *= 2;
+
+	threadHash.Reserve(hashSize);
+	threadHashMask = hashSize-1;
+
+	for(int32 i=0 ; i<hashSize ; i++)
+		threadHash[i] = -1;
+
+	for(int32 t=0 ; t<threadCount ; t++) {
+		int32 i = HashIndex(threadIds[t], threadHashMask);
+
+		while(threadHash[i] != -1)
+			i = (i+1) & threadHashMask;
+
+		threadHash[i] = t;
+	}
+}
+
+// FindThread
+// Returns the index of thread 'id' or -1, if the thread isn't part
+// of the snapshot.
+int32 CSystemSnapshot::FindThread(thread_id id) const
+{
+	if(threadCount == 0)
+		return -1;
+
+	int32 i = HashIndex(id, threadHashMask);
+
+	while(threadHash[i] != -1) {
+		if(threadIds[threadHash[i]] == id)
+			return threadHash[i];
+
+		i = (i+1) & threadHashMask;
+	}
+
+	return -1;
+}
+
+// ====== CSnapshotCache ======
+
+// A part nobody asked for during that many builds isn't read anymore.
+const int32 CSnapshotCache::MAX_UNUSED_PART_BUILDS = 8;
+
+// Time the sampler waits after a failed build, before it tries again.
+const bigtime_t CSnapshotCache::FAILED_BUILD_DELAY = 100000;
+
+CSnapshotCache::CSnapshotCache() :
+	locker("SnapshotCache"),
+	sourceLocker("SnapshotCacheSource")
+{
+	source			= new CKernelDataSource();
+	current			= NULL;
+	buildCount		= 0;
+	buildResult		= B_OK;
+	samplePending	= false;
+	waiterCount		= 0;
+
+	for(int32 i=0 ; i<SNAPSHOT_PART_COUNT ; i++)
+		partRequests[i] = -MAX_UNUSED_PART_BUILDS;
+
+	wakeSem		= create_sem(0, "snapshot sampler wake");
+	publishSem	= create_sem(0, "snapshot sampler publish");
+
+	samplerThread = spawn_thread(SamplerThread, "snapshot sampler",
+						B_NORMAL_PRIORITY, this);
+
+	resume_thread(samplerThread);
+}
+
+CSnapshotCache::~CSnapshotCache()
+{
+	// Deleting the semaphore terminates the sampler thread.
+	delete_sem(wakeSem);
+	delete_sem(publishSem);
+
+	status_t exitValue;
+	wait_for_thread(samplerThread, &exitValue);
+
+	// Snapshots still referenced by consumers are lost at this point.
+	// That's ok, because the cache is only destroyed on shutdown.
+	if(current && --current->refCount == 0)
+		delete current;
+
+	freeList.MakeEmpty();
+
+	delete source;
+
+	RemoveFromList(ClassName());
+}
+
+// Acquire
+// Returns the latest snapshot which contains 'parts', no matter how
+// old it is. The returned snapshot is referenced and must be passed
+// to Release(). If the snapshot is older than max_cache_age() the
+// sampler is woken to build the next one.
+// Only if no snapshot contains 'parts' yet, the caller waits up to
+// 'timeout' for the sampler. Window threads pass 0, so they never
+// wait while holding their locks; they get NULL and try again on
+// their next pulse.
+const CSystemSnapshot *CSnapshotCache::Acquire(uint32 parts, bigtime_t timeout)
+{
+	if(parts & (SNAPSHOT_THREADS | SNAPSHOT_AREAS))
+		parts |= SNAPSHOT_TEAMS;
+
+	bigtime_t deadline = system_time() + timeout;
+
+	if(!locker.Lock())
+		return NULL;
+
+	RequestParts(parts);
+
+	while(true) {
+		if(current && (current->Contents() & parts) == parts) {
+			if(system_time() - current->TimeStamp() >= max_cache_age())
+				TriggerSample();
+
+			current->refCount++;
+
+			CSystemSnapshot *snapshot = current;
+
+			locker.Unlock();
+
+			return snapshot;
+		}
+
+		TriggerSample();
+
+		if(timeout <= 0 || system_time() >= deadline || buildResult != B_OK)
+			break;
+
+		// Wait for the next build. The sampler claims all registered
+		// waiters at once and releases one token for each.
+		atomic_add(&waiterCount, 1);
+
+		locker.Unlock();
+
+		status_t result = acquire_sem_etc(publishSem, 1, B_ABSOLUTE_TIMEOUT, deadline);
+
+		if(result != B_OK)
+			Unregister();
+
+		if(!locker.Lock())
+			return NULL;
+
+		// A spurious wakeup only costs another round: the snapshot
+		// is checked again in any case.
+	}
+
+	locker.Unlock();
+
+	return NULL;
+}
+
+// Unregister
+// Called by a waiter, which gave up waiting. If the sampler already
+// claimed the waiter, the token released for it is taken, so it
+// doesn't wake a later waiter for nothing.
+void CSnapshotCache::Unregister()
+{
+	int32 count;
+
+	do {
+		count = atomic_get(&waiterCount);
+	} while(count > 0 && atomic_test_and_set(&waiterCount, count-1, count) != count);
+
+	if(count <= 0)
+		acquire_sem_etc(publishSem, 1, B_RELATIVE_TIMEOUT, 0);
+}
+
+void CSnapshotCache::Release(const CSystemSnapshot *snapshot)
+{
+	BAutolock autoLocker(locker);
+
+	ReleaseSnapshot(const_cast<CSystemSnapshot *>(snapshot));
+}
+
+// ReleaseSnapshot
+// Drops a reference. Unreferenced snapshots are kept for the next
+// build. The locker must be locked.
+void CSnapshotCache::ReleaseSnapshot(CSystemSnapshot *snapshot)
+{
+	MY_ASSERT(snapshot->refCount > 0);
+
+	if(--snapshot->refCount == 0)
+		freeList.AddItem(snapshot);
+}
+
+// TriggerSample
+// Wakes the sampler thread, if it isn't already working on a new
+// snapshot. The locker must be locked.
+void CSnapshotCache::TriggerSample()
+{
+	if(!samplePending) {
+		samplePending = true;
+		release_sem(wakeSem);
+	}
+}
+
+void CSnapshotCache::SetDataSource(ISystemDataSource *newSource)
+{
+	MY_ASSERT(newSource != NULL);
+
+	{
+		BAutolock sourceAutoLocker(sourceLocker);
+
+		delete source;
+		source = newSource;
+	}
+
+	BAutolock autoLocker(locker);
+
+	// Snapshots of the old source mustn't be handed out anymore.
+	if(current) {
+		ReleaseSnapshot(current);
+		current = NULL;
+	}
+
+	for(int32 i=0 ; i<SNAPSHOT_PART_COUNT ; i++)
+		partRequests[i] = buildCount - MAX_UNUSED_PART_BUILDS;
+}
+
+// RequestParts
+// Marks 'parts' as asked for during the current build. The locker
+// must be locked.
+void CSnapshotCache::RequestParts(uint32 parts)
+{
+	for(int32 i=0 ; i<SNAPSHOT_PART_COUNT ; i++) {
+		if(parts & (1 << i))
+			partRequests[i] = buildCount;
+	}
+}
+
+// WantedParts
+// Returns the parts asked for during the last MAX_UNUSED_PART_BUILDS
+// builds. So the threads of all teams aren't walked forever, just
+// because a tooltip needed them once. The locker must be locked.
+uint32 CSnapshotCache::WantedParts() const
+{
+	uint32 parts = 0;
+
+	for(int32 i=0 ; i<SNAPSHOT_PART_COUNT ; i++) {
+		if(buildCount - partRequests[i] < MAX_UNUSED_PART_BUILDS)
+			parts |= 1 << i;
+	}
+
+	return parts;
+}
+
+int32 CSnapshotCache::SamplerThread(void *data)
+{
+	CSnapshotCache *cache = static_cast<CSnapshotCache *>(data);
+
+	while(acquire_sem(cache->wakeSem) == B_OK) {
+		if(cache->Sample() != B_OK) {
+			// Building again right away would busy loop, as every
+			// consumer triggers a new build. No build is triggered
+			// until the delay is over.
+			snooze(FAILED_BUILD_DELAY);
+
+			BAutolock autoLocker(cache->locker);
+
+			cache->samplePending = false;
+		}
+	}
+
+	return 0;
+}
+
+// Sample
+// Builds a new snapshot and publishes it. The kernel walk is done
+// without holding the locker, so consumers are never blocked by it.
+// All waiters are woken, even if the build failed. In that case
+// 'samplePending' stays set; the sampler thread clears it later.
+status_t CSnapshotCache::Sample()
+{
+	CSystemSnapshot *snapshot, *previous;
+	uint32 parts;
+
+	{
+		BAutolock autoLocker(locker);
+
+		snapshot = freeList.CountItems() > 0 ?
+			freeList.RemoveItem(freeList.CountItems()-1) : new CSystemSnapshot();
+
+		parts = WantedParts();
+
+		buildCount++;
+
+		// Keep the previous snapshot alive while building. It's
+		// immutable, so reading it without the lock is safe.
+		previous = current;
+
+		if(previous)
+			previous->refCount++;
+	}
+
+	status_t result;
+
+	{
+		BAutolock sourceAutoLocker(sourceLocker);
+
+		result = snapshot->Build(source, parts, previous);
+	}
+
+	BAutolock autoLocker(locker);
+
+	if(previous)
+		ReleaseSnapshot(previous);
+
+	if(result == B_OK) {
+		// publish
+		CSystemSnapshot *old = current;
+
+		snapshot->refCount = 1;			// reference held by 'current'
+		current = snapshot;
+
+		if(old)
+			ReleaseSnapshot(old);
+	} else {
+		freeList.AddItem(snapshot);
+	}
+
+	buildResult = result;
+
+	if(result == B_OK)
+		samplePending = false;
+
+	int32 waiters = atomic_set(&waiterCount, 0);
+
+	if(waiters > 0)
+		release_sem_etc(publishSem, waiters, 0);
+
+	return result;
+}
+
+CSnapshotCache *CSnapshotCache::CreateInstance()
+{
+	// Initialize to quiet compiler.
+	CSnapshotCache *cache = NULL;
+
+	return CreateSingleton(cache, "CSnapshotCache");
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TSKMGR_SYSTEM_SNAPSHOT_H
+#define TSKMGR_SYSTEM_SNAPSHOT_H
+
+#include "Singleton.h"
+
+// ====== Snapshot Parts ======
+
+// The system_info is always part of a snapshot.
+const uint32 SNAPSHOT_CPUS		= 0x0001;		// per CPU info
+const uint32 SNAPSHOT_TEAMS		= 0x0002;		// team list and counts
+const uint32 SNAPSHOT_THREADS	= 0x0004;		// threads and team CPU times (implies TEAMS)
+const uint32 SNAPSHOT_AREAS		= 0x0008;		// team memory usage (implies TEAMS)
+
+const uint32 SNAPSHOT_ALL		= SNAPSHOT_CPUS | SNAPSHOT_TEAMS |
+								  SNAPSHOT_THREADS | SNAPSHOT_AREAS;
+
+const int32 SNAPSHOT_PART_COUNT	= 4;
+
+//: Source of the raw data read into a CSystemSnapshot.
+// The default implementation (CKernelDataSource) asks the kernel.
+// Other implementations may feed recorded or synthetic data.
+class ISystemDataSource
+{
+	public:
+	virtual ~ISystemDataSource() {}
+
+	virtual bigtime_t SystemTime() = 0;
+	virtual status_t GetSystemInfo(system_info *info) = 0;
+	virtual status_t GetCPUInfo(uint32 cpuCount, cpu_info *info) = 0;
+	virtual status_t GetNextTeamInfo(int32 *cookie, team_info *info) = 0;
+	virtual status_t GetNextThreadInfo(team_id team, int32 *cookie, thread_info *info) = 0;
+	virtual status_t GetNextAreaInfo(team_id team, ssize_t *cookie, area_info *info) = 0;
+	virtual status_t GetNextImageInfo(team_id team, int32 *cookie, image_info *info) = 0;
+};
+
+//: ISystemDataSource reading the live system.
+class CKernelDataSource : public ISystemDataSource
+{
+	public:
+	virtual bigtime_t SystemTime();
+	virtual status_t GetSystemInfo(system_info *info);
+	virtual status_t GetCPUInfo(uint32 cpuCount, cpu_info *info);
+	virtual status_t GetNextTeamInfo(int32 *cookie, team_info *info);
+	virtual status_t GetNextThreadInfo(team_id team, int32 *cookie, thread_info *info);
+	virtual status_t GetNextAreaInfo(team_id team, ssize_t *cookie, area_info *info);
+	virtual status_t GetNextImageInfo(team_id team, int32 *cookie, image_info *info);
+};
+
+//: Growable array used for the columns of a CSystemSnapshot.
+// The memory is kept between snapshots. It only grows.
+template<class T>
+class CSnapshotColumn
+{
+	public:
+	CSnapshotColumn() { data = NULL; capacity = 0; }
+	~CSnapshotColumn() { delete [] data; }
+
+	// Makes sure, that 'count' items fit into the column.
+	// Existing items are preserved.
+	void Reserve(int32 count)
+	{
+		if(count <= capacity)
+			return;
+
+		int32 newCapacity = capacity > 0 ? capacity : 16;
+
+		while(newCapacity < count)
+			newCapacity *= 2;
+
+		T *newData = new T[newCapacity];
+
+		for(int32 i=0 ; i<capacity ; i++)
+			newData[i] = data[i];
+
+		delete [] data;
+
+		data	 = newData;
+		capacity = newCapacity;
+	}
+
+	T *Data() { return data; }
+
+	T &operator[](int32 index) { return data[index]; }
+	const T &operator[](int32 index) const { return data[index]; }
+
+	protected:
+	T		*data;
+	int32	 capacity;
+};
+
+// Element of the thread name column.
+struct snapshot_name
+{
+	char name[B_OS_NAME_LENGTH];
+};
+
+// Element of the team image column.
+struct snapshot_image
+{
+	dev_t	device;					// of the app image
+	ino_t	node;
+	int32	pathOffset;				// into the string pool, -1 if none
+	int32	nameOffset;
+	uint32	argsHash;				// of team_info::args, changes with exec
+};
+
+// Sums over a team and all its descendants.
+struct subtree_totals
+{
+	int32		team_count;
+	bigtime_t	user_time;
+	bigtime_t	kernel_time;
+	size_t		area_size;
+	int32		thread_count;
+	int32		image_count;
+};
+
+//: Columnar snapshot of the system state.
+// All teams, threads and per CPU infos are read in a single pass
+// and stored as struct-of-arrays. Team data is addressed by an index
+// between 0 and CountTeams()-1, which can be found for a team_id by
+// FindTeam(). The threads of a team are stored consecutive.
+// Snapshots published by CSnapshotCache are immutable.
+class CSystemSnapshot
+{
+	public:
+	CSystemSnapshot();
+
+	// If 'previous' is given, the area walk is skipped for teams whose
+	// fingerprint (thread, area and image count and CPU times) didn't
+	// change since 'previous'. Their area size is copied instead.
+	status_t Build(ISystemDataSource *source, uint32 parts,
+		const CSystemSnapshot *previous=NULL);
+
+	uint32 Contents() const						{ return contents; }
+	bigtime_t TimeStamp() const					{ return timeStamp; }
+	const system_info &SystemInfo() const		{ return systemInfo; }
+
+	// per CPU info
+	int32 CountCPUs() const						{ return cpuCount; }
+	bigtime_t CPUActiveTime(int32 cpu) const	{ return cpuInfos[cpu].active_time; }
+
+	// teams
+	int32 CountTeams() const					{ return teamCount; }
+	int32 FindTeam(team_id id) const;
+
+	team_id TeamId(int32 index) const			{ return teamIds[index]; }
+	int32 TeamThreadCount(int32 index) const	{ return teamThreadCounts[index]; }
+	int32 TeamAreaCount(int32 index) const		{ return teamAreaCounts[index]; }
+	int32 TeamImageCount(int32 index) const		{ return teamImageCounts[index]; }
+	bigtime_t TeamUserTime(int32 index) const	{ return teamUserTimes[index]; }
+	bigtime_t TeamKernelTime(int32 index) const	{ return teamKernelTimes[index]; }
+	size_t TeamAreaSize(int32 index) const		{ return teamAreaSizes[index]; }
+	int32 CountSkippedAreaWalks() const			{ return skippedAreaWalks; }
+	team_id TeamParentId(int32 index) const		{ return teamParentIds[index]; }
+
+	// App image of the team. The path is NULL for teams without one
+	// (the kernel team). The name is the leaf of the path or the team's
+	// args. The image is only looked up for new teams and teams whose
+	// image count or args changed.
+	const char *TeamPath(int32 index) const;
+	const char *TeamName(int32 index) const		{ return &strings[teamImages[index].nameOffset]; }
+	dev_t TeamAppDevice(int32 index) const		{ return teamImages[index].device; }
+	ino_t TeamAppNode(int32 index) const		{ return teamImages[index].node; }
+
+	// Process tree. All values are team indices (-1 if none).
+	int32 TeamParent(int32 index) const			{ return teamParents[index]; }
+	int32 TeamFirstChild(int32 index) const		{ return teamFirstChilds[index]; }
+	int32 TeamNextSibling(int32 index) const	{ return teamNextSiblings[index]; }
+
+	// Sums over the team and all its descendants. They are summed up
+	// once per Build(), so reading them is O(1).
+	void GetSubtreeTotals(int32 index, subtree_totals *totals) const
+	{
+		*totals = teamSubtrees[index];
+	}
+
+	// Index of first thread of the team and one past the last thread.
+	int32 TeamFirstThread(int32 index) const	{ return teamFirstThreads[index]; }
+	int32 TeamEndThread(int32 index) const		{ return teamEndThreads[index]; }
+
+	// threads
+	int32 CountThreads() const					{ return threadCount; }
+	int32 FindThread(thread_id id) const;
+
+	thread_id ThreadId(int32 index) const		{ return threadIds[index]; }
+	int32 ThreadTeam(int32 index) const			{ return threadTeams[index]; }
+	bigtime_t ThreadUserTime(int32 index) const	{ return threadUserTimes[index]; }
+	bigtime_t ThreadKernelTime(int32 index) const { return threadKernelTimes[index]; }
+	int32 ThreadPriority(int32 index) const		{ return threadPriorities[index]; }
+	thread_state ThreadState(int32 index) const	{ return threadStates[index]; }
+	const char *ThreadName(int32 index) const	{ return threadNames[index].name; }
+
+	protected:
+	void BuildTeamHash();
+	void BuildThreadHash();
+	void BuildTeamTree();
+	void BuildSubtreeTotals();
+	bool CopyAreaSize(int32 team, const CSystemSnapshot *previous);
+	void ReadTeamImage(ISystemDataSource *source, const team_info &teamInfo,
+		const CSystemSnapshot *previous);
+	int32 AddString(const char *string);
+	static uint32 HashArgs(const team_info &teamInfo);
+
+	// An area size is copied at most that many times in a row,
+	// because shared areas can grow without the team running.
+	static const int32 MAX_AREA_SIZE_AGE;
+	static int32 HashIndex(int32 id, int32 mask)
+	{
+		return (int32)(((uint32)id * 2654435761UL) >> 8) & mask;
+	}
+
+	int32		refCount;				// managed by CSnapshotCache
+	uint32		contents;
+	bigtime_t	timeStamp;
+	system_info	systemInfo;
+
+	int32 cpuCount;
+	CSnapshotColumn<cpu_info> cpuInfos;
+
+	int32 teamCount;
+	CSnapshotColumn<team_id> teamIds;
+	CSnapshotColumn<int32> teamThreadCounts;
+	CSnapshotColumn<int32> teamAreaCounts;
+	CSnapshotColumn<int32> teamImageCounts;
+	CSnapshotColumn<bigtime_t> teamUserTimes;
+	CSnapshotColumn<bigtime_t> teamKernelTimes;
+	CSnapshotColumn<size_t> teamAreaSizes;
+	CSnapshotColumn<int32> teamAreaSizeAges;		// builds since the last area walk
+	int32 skippedAreaWalks;
+	CSnapshotColumn<int32> teamFirstThreads;
+	CSnapshotColumn<int32> teamEndThreads;
+	CSnapshotColumn<team_id> teamParentIds;
+	CSnapshotColumn<int32> teamParents;
+	CSnapshotColumn<int32> teamFirstChilds;
+	CSnapshotColumn<int32> teamNextSiblings;
+	CSnapshotColumn<subtree_totals> teamSubtrees;
+	CSnapshotColumn<int32> teamOrder;			// pre-order, only used by BuildSubtreeTotals()
+	CSnapshotColumn<snapshot_image> teamImages;
+
+	// paths and names of the teams
+	int32 stringsSize;
+	CSnapshotColumn<char> strings;
+
+	// open addressing hash: team_id -> team index (-1 if empty)
+	int32 teamHashMask;
+	CSnapshotColumn<int32> teamHash;
+
+	int32 threadCount;
+	CSnapshotColumn<thread_id> threadIds;
+	CSnapshotColumn<int32> threadTeams;
+	CSnapshotColumn<bigtime_t> threadUserTimes;
+	CSnapshotColumn<bigtime_t> threadKernelTimes;
+	CSnapshotColumn<int32> threadPriorities;
+	CSnapshotColumn<thread_state> threadStates;
+	CSnapshotColumn<snapshot_name> threadNames;
+
+	// open addressing hash: thread_id -> thread index (-1 if empty)
+	int32 threadHashMask;
+	CSnapshotColumn<int32> threadHash;
+
+	friend class CSnapshotCache;
+};
+
+//: Per tick cache of the system snapshot.
+// Shares the system snapshot between all consumers in a team. The
+// snapshots are built by a sampler thread, so no consumer ever waits
+// for a kernel walk while holding its own (window) lock. A finished
+// snapshot is published by swapping the 'current' pointer. Consumers
+// hold a reference to the snapshot they acquired; the old snapshot
+// is recycled as build buffer once the last reference is released.
+//
+// Sampling is driven by demand: acquiring a snapshot which is older
+// than max_cache_age() wakes the sampler, but returns the current
+// snapshot right away. Only if no snapshot contains the requested
+// parts, the caller may wait for the sampler. A part is read as long
+// as it was asked for during the last MAX_UNUSED_PART_BUILDS builds.
+class CSnapshotCache : public CSingleton
+{
+	public:
+	static CSnapshotCache *CreateInstance();
+
+	virtual ~CSnapshotCache();
+	virtual void Reactivate() {}
+
+	// Returns a snapshot containing 'parts' or NULL if there is none
+	// within 'timeout'. Each successful call must be balanced by a
+	// call to Release().
+	const CSystemSnapshot *Acquire(uint32 parts, bigtime_t timeout=0);
+	void Release(const CSystemSnapshot *snapshot);
+
+	// Replaces the data source. The cache takes ownership.
+	void SetDataSource(ISystemDataSource *newSource);
+
+	protected:
+	CSnapshotCache();
+
+	static int32 SamplerThread(void *data);
+	status_t Sample();
+	void TriggerSample();
+	void Unregister();
+	void ReleaseSnapshot(CSystemSnapshot *snapshot);
+	void RequestParts(uint32 parts);
+	uint32 WantedParts() const;
+
+	static const int32 MAX_UNUSED_PART_BUILDS;
+	static const bigtime_t FAILED_BUILD_DELAY;
+
+	BLocker				 locker;			// guards everything but 'source'
+	BLocker				 sourceLocker;		// held while building
+	ISystemDataSource	*source;
+	CSystemSnapshot		*current;			// latest published snapshot
+	CPointerList<CSystemSnapshot> freeList;	// recycled build buffers
+	int32				 buildCount;
+	int32				 partRequests[SNAPSHOT_PART_COUNT];	// buildCount of the last request
+	status_t			 buildResult;		// result of the last build
+	bool				 samplePending;
+	int32				 waiterCount;		// accessed atomically
+	sem_id				 wakeSem;			// released to start a build
+	sem_id				 publishSem;		// released for each waiter after a build
+	thread_id			 samplerThread;
+
+	friend class CSingleton;
+};
+
+inline const CSystemSnapshot *acquire_system_snapshot(uint32 parts, bigtime_t timeout=0)
+{
+	return CSnapshotCache::CreateInstance()->Acquire(parts, timeout);
+}
+
+inline void release_system_snapshot(const CSystemSnapshot *snapshot)
+{
+	CSnapshotCache::CreateInstance()->Release(snapshot);
+}
+
+#endif // TSKMGR_SYSTEM_SNAPSHOT_H
@@ -18,6 +18,8 @@
 #include "pch.h"
 #include "common.h"
 
+#include <errno.h>
+
 // Common message fields
 const char * const MESSAGE_DATA_ID_COLOR	= "COMMON:Color";
 const char * const MESSAGE_DATA_ID_INDEX	= "COMMON:Index";
@@ -26,3 +28,36 @@ const char * const MESSAGE_DATA_ID_INDEX	= "COMMON:Index";
 const bigtime_t SLOW_PULSE_RATE				= 2000000;
 const bigtime_t NORMAL_PULSE_RATE			= 1000000;
 const bigtime_t FAST_PULSE_RATE	 			=  500000;
+
+// Cache Age
+const char * const MAX_CACHE_AGE_ENV		= "TASKMANAGER_MAX_CACHE_AGE";
+
+// read_max_cache_age
+// Returns the value of MAX_CACHE_AGE_ENV or, if it isn't set or isn't
+// a positive number of microseconds, half the fast pulse rate.
+static bigtime_t read_max_cache_age()
+{
+	const char *value = getenv(MAX_CACHE_AGE_ENV);
+	
+	if(value == NULL)
+		return FAST_PULSE_RATE/2;
+	
+	char *end;
+	
+	errno = 0;
+	
+	long long maxAge = strtoll(value, &end, 10);
+	
+	if(end == value || *end != '\0' || errno != 0 || maxAge <= 0)
+		return FAST_PULSE_RATE/2;
+		
+	return maxAge;
+}
+
+bigtime_t max_cache_age()
+{
+	// The environment is only read once.
+	static bigtime_t maxAge = read_max_cache_age();
+	
+	return maxAge;
+}
@@ -29,6 +29,17 @@ extern const bigtime_t SLOW_PULSE_RATE;
 extern const bigtime_t NORMAL_PULSE_RATE;
 extern const bigtime_t FAST_PULSE_RATE;
 
+// ====== Cache Age ======
+
+// Cached system data (system info, CPU info, snapshots) is read again,
+// if it's older than max_cache_age(). That's half the fast pulse rate,
+// unless the environment variable MAX_CACHE_AGE_ENV is set to a positive
+// number of microseconds. The environment is shared by the application and the plugins,
+// which have their own caches.
+extern const char * const MAX_CACHE_AGE_ENV;
+
+bigtime_t max_cache_age();
+
 // ====== Message Fields ======
 
 // Common message fields shared by various messages
@@ -18,6 +18,7 @@
 #include "pch.h"
 #include "my_assert.h"
 #include "SystemInfo.h"
+#include "SystemSnapshot.h"
 #include "NameInfo.h"
 #include "DataProvider.h"
 #include "DefaultDataProvider.h"
@@ -32,7 +33,7 @@ const char * const DATA_PROVIDER_ARCHIVE_DEV_ID		= "DATAPROVIDER:DevId";
 
 const char * const ADD_ON_SIGNATURE = "application/x-vnd.task_manager_default";
 
-const float MEGA_BYTE = 1024*1024;
+const double MEGA_BYTE = 1024*1024;
 
 // ==== CDefaultDataProviderBase =====
 
@@ -53,6 +54,80 @@ status_t CDefaultDataProviderBase::Archive(BMessage *archive, bool deep) const
 	return B_OK;
 }
 
+// ==== CSnapshotDataProvider ====
+
+// Only the addresses of these variables are used.
+static char snapshotBatchKind;
+static char cpuBatchKind;
+static char volumeBatchKind;
+
+const void *CSnapshotDataProvider::BatchKind()
+{
+	return &snapshotBatchKind;
+}
+
+// GetNextSamples
+// Acquires one snapshot containing the parts of all 'providers'
+// and computes all samples from it.
+void CSnapshotDataProvider::GetNextSamples(IDataProvider **providers, int32 count,
+	data_sample *samples, bool *valid)
+{
+	uint32 parts = 0;
+
+	for(int32 i=0 ; i<count ; i++) {
+		CSnapshotDataProvider *provider = dynamic_cast<CSnapshotDataProvider *>(providers[i]);
+
+		if(provider != NULL)
+			parts |= provider->SnapshotParts();
+		
+		valid[i] = false;
+	}
+
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(parts);
+
+	if(snapshot == NULL)
+		return;
+
+	for(int32 i=0 ; i<count ; i++) {
+		CSnapshotDataProvider *provider = dynamic_cast<CSnapshotDataProvider *>(providers[i]);
+
+		if(provider != NULL) {
+			samples[i].timeStamp = snapshot->TimeStamp();
+			valid[i] = provider->GetSnapshotValue(snapshot, samples[i].value);
+		}
+	}
+
+	release_system_snapshot(snapshot);
+}
+
+bool CSnapshotDataProvider::GetNextSnapshotValue(float &value)
+{
+	data_sample sample;
+
+	bool valid = GetNextSnapshotSample(sample);
+
+	if(valid)
+		value = sample.value;
+
+	return valid;
+}
+
+bool CSnapshotDataProvider::GetNextSnapshotSample(data_sample &sample)
+{
+	const CSystemSnapshot *snapshot = acquire_system_snapshot(SnapshotParts());
+
+	if(snapshot == NULL)
+		return false;
+
+	sample.timeStamp = snapshot->TimeStamp();
+
+	bool valid = GetSnapshotValue(snapshot, sample.value);
+
+	release_system_snapshot(snapshot);
+
+	return valid;
+}
+
 // ==== CCPUDataProvider ====
 
 CCPUDataProvider::CCPUDataProvider(int32 _cpuNum)
@@ -72,22 +147,27 @@ void CCPUDataProvider::Init()
 {
 	lastActiveTime = 0;
 
-	system_info sysInfo;
-	get_system_info(&sysInfo);
-	cpu_info* cpuInfos = new cpu_info[sysInfo.cpu_count];
-	get_cpu_info(0, sysInfo.cpu_count, cpuInfos);
-
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		if(cpuNum == CPU_NUM_ALL) {
-			// average usage of all cpu's
-			for(uint32 i=0 ; i<sysInfo.cpu_count ; i++) {
-				lastActiveTime += cpuInfos[i].active_time;
-			}
-		} else {
-			lastActiveTime = cpuInfos[cpuNum].active_time;
-		}
+	CCPUInfoView view;
+
+	if(view.InitCheck() == B_OK)
+		lastActiveTime = ActiveTime(view);
+}
+
+// ActiveTime
+// Returns the accumulated active time of the CPU(s) this provider
+// watches.
+bigtime_t CCPUDataProvider::ActiveTime(const CCPUInfoView &view) const
+{
+	bigtime_t activeTime = 0;
+
+	if(cpuNum == CPU_NUM_ALL) {
+		// average usage of all cpu's
+		activeTime = view.TotalActiveTime();
+	} else if(cpuNum < view.CountCPUs()) {
+		activeTime = view.ActiveTime(cpuNum);
 	}
-	delete[] cpuInfos;
+
+	return activeTime;
 }
 
 status_t CCPUDataProvider::Archive(BMessage *archive, bool deep) const
@@ -110,41 +190,67 @@ BArchivable *CCPUDataProvider::Instantiate(BMessage *archive)
 
 bool CCPUDataProvider::GetNextValue(float &value)
 {
-	system_info sysInfo;
-	get_system_info(&sysInfo);
-	cpu_info* cpuInfos = new cpu_info[sysInfo.cpu_count];
-	get_cpu_info(0, sysInfo.cpu_count, cpuInfos);
+	CCPUInfoView view;
 
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		// current accumulated CPU active time
-		bigtime_t activeTime=0;
+	double sampleValue;
 
-		uint32 cpuCount = 1;
+	if(view.InitCheck() != B_OK || !GetValue(view, sampleValue))
+		return false;
 
-		if(cpuNum == CPU_NUM_ALL) {
-			// show average usage of all cpu's
-		
-			for(uint32 i=0 ; i<sysInfo.cpu_count ; i++) {
-				activeTime += cpuInfos[i].active_time;
-			}
-			
-			cpuCount = sysInfo.cpu_count;
-		} else {
-			activeTime = cpuInfos[cpuNum].active_time;
-		}
+	value = sampleValue;
 
-		if(lastActiveTime != 0) {
-			value = (activeTime - lastActiveTime) / (float)cpuCount;
+	return true;
+}
 
-			lastActiveTime = activeTime;	
-			
-			return true;
-		}
+bool CCPUDataProvider::GetNextSample(data_sample &sample)
+{
+	CCPUInfoView view;
+
+	if(view.InitCheck() != B_OK)
+		return false;
+
+	sample.timeStamp = view.TimeStamp();
+
+	return GetValue(view, sample.value);
+}
 
-		lastActiveTime = activeTime;	
+const void *CCPUDataProvider::BatchKind()
+{
+	return &cpuBatchKind;
+}
+
+void CCPUDataProvider::GetNextSamples(IDataProvider **providers, int32 count,
+	data_sample *samples, bool *valid)
+{
+	CCPUInfoView view;
+
+	for(int32 i=0 ; i<count ; i++) {
+		CCPUDataProvider *provider = dynamic_cast<CCPUDataProvider *>(providers[i]);
+
+		valid[i] = false;
+
+		if(view.InitCheck() == B_OK && provider != NULL) {
+			samples[i].timeStamp = view.TimeStamp();
+			valid[i] = provider->GetValue(view, samples[i].value);
+		}
 	}
-	delete[] cpuInfos;
-	return false;
+}
+
+bool CCPUDataProvider::GetValue(const CCPUInfoView &view, double &value)
+{
+	// current accumulated CPU active time
+	bigtime_t activeTime = ActiveTime(view);
+
+	uint32 cpuCount = (cpuNum == CPU_NUM_ALL) ? view.CountCPUs() : 1;
+
+	bool valid = (lastActiveTime != 0);
+
+	if(valid)
+		value = (activeTime - lastActiveTime) / (double)cpuCount;
+
+	lastActiveTime = activeTime;
+
+	return valid;
 }
 
 BString CCPUDataProvider::DisplayName()
@@ -182,11 +288,23 @@ BArchivable *CMemoryDataProvider::Instantiate(BMessage *archive)
 }
 
 bool CMemoryDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+
+	if(GetNextSample(sample)) {
+		value = sample.value;
+		return true;
+	}
+	
+	return false;
+}
+
+bool CMemoryDataProvider::GetNextSample(data_sample &sample)
 {
 	system_info sysInfo;
 
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		value = sysInfo.used_pages;
+	if(get_cached_system_info(&sysInfo, &sample.timeStamp) == B_OK) {
+		sample.value = sysInfo.used_pages;
 		return true;
 	}
 	
@@ -223,11 +341,23 @@ bool CThreadCountDataProvider::Equal(IDataProvider *other)
 }
 	
 bool CThreadCountDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+
+	if(GetNextSample(sample)) {
+		value = sample.value;
+		return true;
+	}
+	
+	return false;
+}
+
+bool CThreadCountDataProvider::GetNextSample(data_sample &sample)
 {
 	system_info sysInfo;
 
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		value = sysInfo.used_threads;
+	if(get_cached_system_info(&sysInfo, &sample.timeStamp) == B_OK) {
+		sample.value = sysInfo.used_threads;
 		return true;
 	}
 	
@@ -259,11 +389,23 @@ bool CTeamCountDataProvider::Equal(IDataProvider *other)
 }
 	
 bool CTeamCountDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+
+	if(GetNextSample(sample)) {
+		value = sample.value;
+		return true;
+	}
+	
+	return false;
+}
+
+bool CTeamCountDataProvider::GetNextSample(data_sample &sample)
 {
 	system_info sysInfo;
 
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		value = sysInfo.used_teams;
+	if(get_cached_system_info(&sysInfo, &sample.timeStamp) == B_OK) {
+		sample.value = sysInfo.used_teams;
 		return true;
 	}
 	
@@ -331,35 +473,30 @@ bool CTeamCPUDataProvider::Equal(IDataProvider *other)
 		dynamic_cast<CTeamCPUDataProvider *>(other) != NULL;
 }
 
-bool CTeamCPUDataProvider::GetNextValue(float &value)
+uint32 CTeamCPUDataProvider::SnapshotParts()
 {
-	thread_info threadInfo;
+	return SNAPSHOT_THREADS;
+}
 
-	bigtime_t userTime=0, kernelTime=0;
-	bigtime_t activeTime;
-	int32 cookie = 0;
-	system_info sysInfo;
+bool CTeamCPUDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	bigtime_t activeTime = 0;
+	bool valid = false;
 
-	if(get_cached_system_info(&sysInfo, NULL) == B_OK) {
-		while(get_next_thread_info(teamId, &cookie, &threadInfo) == B_OK) {
-			userTime   += threadInfo.user_time;
-			kernelTime += threadInfo.kernel_time;
-		}
-	
-		activeTime = userTime + kernelTime;
+	int32 index = snapshot->FindTeam(teamId);
 
-		if(lastActiveTime != 0) {
-			value = (activeTime - lastActiveTime) / sysInfo.cpu_count;
+	if(index >= 0) {
+		activeTime = snapshot->TeamUserTime(index) + snapshot->TeamKernelTime(index);
 
-			lastActiveTime = userTime + kernelTime;
-		
-			return true;
+		if(lastActiveTime != 0) {
+			value = (activeTime - lastActiveTime) / (double)snapshot->SystemInfo().cpu_count;
+			valid = true;
 		}
-	} 
-	
-	lastActiveTime = userTime + kernelTime;
-	 
-	return false;
+	}
+
+	lastActiveTime = activeTime;
+
+	return valid;
 }
 
 BString CTeamCPUDataProvider::DisplayName()
@@ -393,16 +530,19 @@ bool CTeamMemoryDataProvider::Equal(IDataProvider *other)
 		dynamic_cast<CTeamMemoryDataProvider *>(other) != NULL;
 }
 
-bool CTeamMemoryDataProvider::GetNextValue(float &value)
+uint32 CTeamMemoryDataProvider::SnapshotParts()
+{
+	return SNAPSHOT_AREAS;
+}
+
+bool CTeamMemoryDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
 {
-	ssize_t cookie = 0;
 	size_t totalAreaSize = 0;
-		
-	area_info areaInfo;
-		
-	while(get_next_area_info(teamId, &cookie, &areaInfo) == B_OK) {
-		totalAreaSize += areaInfo.ram_size;
-	}
+
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0)
+		totalAreaSize = snapshot->TeamAreaSize(index);
 
 	value = totalAreaSize / 1024.0;
 	
@@ -445,17 +585,19 @@ bool CTeamThreadCountDataProvider::Equal(IDataProvider *other)
 		dynamic_cast<CTeamThreadCountDataProvider *>(other) != NULL;
 }
 	
-bool CTeamThreadCountDataProvider::GetNextValue(float &value)
+uint32 CTeamThreadCountDataProvider::SnapshotParts()
 {
-	team_info teamInfo;
-	
-	if( GetTeamInfo(&teamInfo) == B_OK ) {
-		value = teamInfo.thread_count;
-		
-		return true;
-	}
-	
-	return false;
+	return SNAPSHOT_TEAMS;
+}
+
+bool CTeamThreadCountDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0)
+		value = snapshot->TeamThreadCount(index);
+
+	return index >= 0;
 }
 
 // ==== CTeamAreaCountDataProvider ====
@@ -489,16 +631,19 @@ bool CTeamAreaCountDataProvider::Equal(IDataProvider *other)
 		dynamic_cast<CTeamAreaCountDataProvider *>(other) != NULL;
 }
 	
-bool CTeamAreaCountDataProvider::GetNextValue(float &value)
+uint32 CTeamAreaCountDataProvider::SnapshotParts()
 {
-	team_info teamInfo;
-	
-	if( GetTeamInfo(&teamInfo) == B_OK ) {
-		value = teamInfo.area_count;
-		return true;
-	}
-	
-	return false;
+	return SNAPSHOT_TEAMS;
+}
+
+bool CTeamAreaCountDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0)
+		value = snapshot->TeamAreaCount(index);
+
+	return index >= 0;
 }
 
 // ==== CTeamImageCountDataProvider ====
@@ -532,18 +677,312 @@ bool CTeamImageCountDataProvider::Equal(IDataProvider *other)
 		dynamic_cast<CTeamImageCountDataProvider *>(other) != NULL;
 }
 	
-bool CTeamImageCountDataProvider::GetNextValue(float &value)
+uint32 CTeamImageCountDataProvider::SnapshotParts()
 {
-	team_info teamInfo;
+	return SNAPSHOT_TEAMS;
+}
+
+bool CTeamImageCountDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0)
+		value = snapshot->TeamImageCount(index);
+
+	return index >= 0;
+}
 	
-	if( GetTeamInfo(&teamInfo) == B_OK ) {
-		value = teamInfo.image_count;
-		return true;
+// ==== CTeamSubtreeCPUDataProvider ====
+
+CTeamSubtreeCPUDataProvider::CTeamSubtreeCPUDataProvider(team_id team) :
+	CTeamInfoDataProvider(team)
+{
+	Init();
+}
+
+CTeamSubtreeCPUDataProvider::CTeamSubtreeCPUDataProvider(BMessage *archive) :
+	CTeamInfoDataProvider(archive)
+{
+	Init();
+}
+
+BArchivable *CTeamSubtreeCPUDataProvider::Instantiate(BMessage *archive)
+{
+	if(!validate_instantiation(archive, "CTeamSubtreeCPUDataProvider"))
+		return NULL;
+
+	return new CTeamSubtreeCPUDataProvider(archive);
+}
+
+BString CTeamSubtreeCPUDataProvider::DisplayName()
+{
+	return (BString("CPU Usage of ") << team_name(teamId) << " and children");
+}
+
+bool CTeamSubtreeCPUDataProvider::Equal(IDataProvider *other)
+{
+	return CTeamInfoDataProvider::Equal(other) &&
+		dynamic_cast<CTeamSubtreeCPUDataProvider *>(other) != NULL;
+}
+
+void CTeamSubtreeCPUDataProvider::Init()
+{
+	lastActiveTime = exitedTime = 0;
+	memberCount = 0;
+	currentMembers = 0;
+}
+
+uint32 CTeamSubtreeCPUDataProvider::SnapshotParts()
+{
+	return SNAPSHOT_THREADS;
+}
+
+// compare function for qsort
+static int compare_subtree_members(const void *a, const void *b)
+{
+	team_id teamA = *(const team_id *)a;
+	team_id teamB = *(const team_id *)b;
+
+	return (teamA < teamB) ? -1 : ((teamA > teamB) ? 1 : 0);
+}
+
+// CollectMembers
+// Stores the id and CPU time of team 'index' and all its descendants
+// in 'column', sorted by team id. Returns the number of members.
+int32 CTeamSubtreeCPUDataProvider::CollectMembers(const CSystemSnapshot *snapshot,
+	int32 index, CSnapshotColumn<subtree_member> &column)
+{
+	subtree_totals totals;
+
+	snapshot->GetSubtreeTotals(index, &totals);
+
+	column.Reserve(totals.team_count);
+
+	int32 count = 0;
+	int32 node = index;
+
+	while(count < totals.team_count) {
+		column[count].team	  = snapshot->TeamId(node);
+		column[count].cpuTime = snapshot->TeamUserTime(node) + snapshot->TeamKernelTime(node);
+		count++;
+
+		// next node in pre-order
+		if(snapshot->TeamFirstChild(node) != -1) {
+			node = snapshot->TeamFirstChild(node);
+		} else {
+			while(node != index && snapshot->TeamNextSibling(node) == -1)
+				node = snapshot->TeamParent(node);
+
+			if(node == index)
+				break;
+
+			node = snapshot->TeamNextSibling(node);
+		}
 	}
-	
-	return false;
+
+	qsort(column.Data(), count, sizeof(subtree_member), compare_subtree_members);
+
+	return count;
 }
-	
+
+// GetSnapshotValue
+// The subtree sums lose the CPU time of a child when it quits. That
+// time is kept in 'exitedTime' instead: the members of the last call
+// which are missing now add their last CPU time to it.
+bool CTeamSubtreeCPUDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index < 0) {
+		lastActiveTime = 0;
+		memberCount = 0;
+		return false;
+	}
+
+	CSnapshotColumn<subtree_member> &oldMembers = members[currentMembers];
+	CSnapshotColumn<subtree_member> &newMembers = members[1-currentMembers];
+
+	int32 newCount = CollectMembers(snapshot, index, newMembers);
+
+	for(int32 i=0, j=0 ; i<memberCount ; ) {
+		if(j >= newCount || oldMembers[i].team < newMembers[j].team) {
+			exitedTime += oldMembers[i].cpuTime;
+			i++;
+		} else if(oldMembers[i].team == newMembers[j].team) {
+			i++;
+			j++;
+		} else {
+			j++;
+		}
+	}
+
+	currentMembers = 1-currentMembers;
+	memberCount	   = newCount;
+
+	subtree_totals totals;
+
+	snapshot->GetSubtreeTotals(index, &totals);
+
+	bigtime_t activeTime = totals.user_time + totals.kernel_time + exitedTime;
+	bool valid = false;
+
+	if(lastActiveTime != 0) {
+		value = (activeTime - lastActiveTime) / (double)snapshot->SystemInfo().cpu_count;
+		valid = true;
+	}
+
+	lastActiveTime = activeTime;
+
+	return valid;
+}
+
+// ==== CTeamSubtreeMemoryDataProvider ====
+
+CTeamSubtreeMemoryDataProvider::CTeamSubtreeMemoryDataProvider(team_id team) :
+	CTeamInfoDataProvider(team)
+{}
+
+CTeamSubtreeMemoryDataProvider::CTeamSubtreeMemoryDataProvider(BMessage *archive) :
+	CTeamInfoDataProvider(archive)
+{}
+
+BArchivable *CTeamSubtreeMemoryDataProvider::Instantiate(BMessage *archive)
+{
+	if(!validate_instantiation(archive, "CTeamSubtreeMemoryDataProvider"))
+		return NULL;
+
+	return new CTeamSubtreeMemoryDataProvider(archive);
+}
+
+BString CTeamSubtreeMemoryDataProvider::DisplayName()
+{
+	return (BString("Mem Usage of ") << team_name(teamId) << " and children");
+}
+
+bool CTeamSubtreeMemoryDataProvider::Equal(IDataProvider *other)
+{
+	return CTeamInfoDataProvider::Equal(other) &&
+		dynamic_cast<CTeamSubtreeMemoryDataProvider *>(other) != NULL;
+}
+
+uint32 CTeamSubtreeMemoryDataProvider::SnapshotParts()
+{
+	return SNAPSHOT_AREAS;
+}
+
+bool CTeamSubtreeMemoryDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0) {
+		subtree_totals totals;
+
+		snapshot->GetSubtreeTotals(index, &totals);
+
+		value = totals.area_size / 1024.0;
+	}
+
+	return index >= 0;
+}
+
+// ==== CTeamSubtreeThreadCountDataProvider ====
+
+CTeamSubtreeThreadCountDataProvider::CTeamSubtreeThreadCountDataProvider(team_id team) :
+	CTeamInfoDataProvider(team)
+{}
+
+CTeamSubtreeThreadCountDataProvider::CTeamSubtreeThreadCountDataProvider(BMessage *archive) :
+	CTeamInfoDataProvider(archive)
+{}
+
+BArchivable *CTeamSubtreeThreadCountDataProvider::Instantiate(BMessage *archive)
+{
+	if(!validate_instantiation(archive, "CTeamSubtreeThreadCountDataProvider"))
+		return NULL;
+
+	return new CTeamSubtreeThreadCountDataProvider(archive);
+}
+
+BString CTeamSubtreeThreadCountDataProvider::DisplayName()
+{
+	return (BString("Thread count of ") << team_name(teamId) << " and children");
+}
+
+bool CTeamSubtreeThreadCountDataProvider::Equal(IDataProvider *other)
+{
+	return CTeamInfoDataProvider::Equal(other) &&
+		dynamic_cast<CTeamSubtreeThreadCountDataProvider *>(other) != NULL;
+}
+
+uint32 CTeamSubtreeThreadCountDataProvider::SnapshotParts()
+{
+	return SNAPSHOT_TEAMS;
+}
+
+bool CTeamSubtreeThreadCountDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0) {
+		subtree_totals totals;
+
+		snapshot->GetSubtreeTotals(index, &totals);
+
+		value = totals.thread_count;
+	}
+
+	return index >= 0;
+}
+
+// ==== CTeamSubtreeImageCountDataProvider ====
+
+CTeamSubtreeImageCountDataProvider::CTeamSubtreeImageCountDataProvider(team_id team) :
+	CTeamInfoDataProvider(team)
+{}
+
+CTeamSubtreeImageCountDataProvider::CTeamSubtreeImageCountDataProvider(BMessage *archive) :
+	CTeamInfoDataProvider(archive)
+{}
+
+BArchivable *CTeamSubtreeImageCountDataProvider::Instantiate(BMessage *archive)
+{
+	if(!validate_instantiation(archive, "CTeamSubtreeImageCountDataProvider"))
+		return NULL;
+
+	return new CTeamSubtreeImageCountDataProvider(archive);
+}
+
+BString CTeamSubtreeImageCountDataProvider::DisplayName()
+{
+	return (BString("Image count of ") << team_name(teamId) << " and children");
+}
+
+bool CTeamSubtreeImageCountDataProvider::Equal(IDataProvider *other)
+{
+	return CTeamInfoDataProvider::Equal(other) &&
+		dynamic_cast<CTeamSubtreeImageCountDataProvider *>(other) != NULL;
+}
+
+uint32 CTeamSubtreeImageCountDataProvider::SnapshotParts()
+{
+	return SNAPSHOT_TEAMS;
+}
+
+bool CTeamSubtreeImageCountDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	int32 index = snapshot->FindTeam(teamId);
+
+	if(index >= 0) {
+		subtree_totals totals;
+
+		snapshot->GetSubtreeTotals(index, &totals);
+
+		value = totals.image_count;
+	}
+
+	return index >= 0;
+}
+
 // ==== CThreadCPUDataProvider ====
 
 CThreadCPUDataProvider::CThreadCPUDataProvider(thread_id thread)
@@ -579,27 +1018,30 @@ bool CThreadCPUDataProvider::Equal(IDataProvider *other)
 	return (o && o->threadId == threadId);
 }
 
-bool CThreadCPUDataProvider::GetNextValue(float &value)
+uint32 CThreadCPUDataProvider::SnapshotParts()
 {
-	thread_info threadInfo;
-	system_info systemInfo;
-	
-	if(get_thread_info(threadId, &threadInfo) == B_OK &&
-	   get_cached_system_info(&systemInfo, NULL) == B_OK) {
-		bigtime_t activeTime = threadInfo.user_time + threadInfo.kernel_time;
-	
-		if(lastActiveTime > 0) {
-			value = (activeTime - lastActiveTime) / systemInfo.cpu_count;
+	return SNAPSHOT_THREADS;
+}
+
+bool CThreadCPUDataProvider::GetSnapshotValue(const CSystemSnapshot *snapshot, double &value)
+{
+	bool valid = false;
 
-			lastActiveTime = activeTime;
+	int32 index = snapshot->FindThread(threadId);
 
-			return true;
+	if(index >= 0) {
+		bigtime_t activeTime = snapshot->ThreadUserTime(index) + 
+							   snapshot->ThreadKernelTime(index);
+	
+		if(lastActiveTime > 0) {
+			value = (activeTime - lastActiveTime) / (double)snapshot->SystemInfo().cpu_count;
+			valid = true;
 		}
 
 		lastActiveTime = activeTime;
 	}
 	
-	return false;
+	return valid;
 }
 
 BString CThreadCPUDataProvider::DisplayName()
@@ -657,6 +1099,72 @@ BString CVolumeDataProviderBase::DisplayName()
 	return BString(name);
 }
 
+bool CVolumeDataProviderBase::GetNextValue(float &value)
+{
+	fs_info info;
+
+	double sampleValue;
+
+	if(volume->InitCheck() == B_OK && fs_stat_dev(volume->Device(), &info) == 0 &&
+	   GetVolumeValue(info, sampleValue)) {
+		value = sampleValue;
+		return true;
+	}
+	
+	return false;
+}
+
+const void *CVolumeDataProviderBase::BatchKind()
+{
+	return &volumeBatchKind;
+}
+
+// GetNextSamples
+// Several providers often watch the same volume (e.g. usage and
+// capacity). The fs_info of each device is read only once.
+void CVolumeDataProviderBase::GetNextSamples(IDataProvider **providers, int32 count,
+	data_sample *samples, bool *valid)
+{
+	bigtime_t timeStamp = system_time();
+
+	fs_info *infos = new fs_info[count];
+	bool *infoValid = new bool[count];
+
+	for(int32 i=0 ; i<count ; i++) {
+		CVolumeDataProviderBase *provider = dynamic_cast<CVolumeDataProviderBase *>(providers[i]);
+
+		valid[i] = infoValid[i] = false;
+
+		if(provider == NULL || provider->volume->InitCheck() != B_OK)
+			continue;
+
+		dev_t device = provider->volume->Device();
+
+		// look for a provider of the same device sampled before
+		int32 k;
+
+		for(k=0 ; k<i ; k++) {
+			if(infoValid[k] && infos[k].dev == device)
+				break;
+		}
+
+		if(k < i) {
+			infos[i] = infos[k];
+			infoValid[i] = true;
+		} else {
+			infoValid[i] = (fs_stat_dev(device, &infos[i]) == 0);
+		}
+
+		if(infoValid[i]) {
+			samples[i].timeStamp = timeStamp;
+			valid[i] = provider->GetVolumeValue(infos[i], samples[i].value);
+		}
+	}
+
+	delete [] infoValid;
+	delete [] infos;
+}
+
 // ==== CVolumeUsageAbsoluteDataProvider ====
 
 CVolumeUsageAbsoluteDataProvider::CVolumeUsageAbsoluteDataProvider(const BVolume &_volume) :
@@ -689,14 +1197,11 @@ BString CVolumeUsageAbsoluteDataProvider::DisplayName()
 	return BString("Usage of ") << CVolumeDataProviderBase::DisplayName();
 }
 
-bool CVolumeUsageAbsoluteDataProvider::GetNextValue(float &value)
+bool CVolumeUsageAbsoluteDataProvider::GetVolumeValue(const fs_info &info, double &value)
 {
-	if(volume->InitCheck() == B_OK) {
-		value = (volume->Capacity() - volume->FreeBytes()) / MEGA_BYTE;
-		return true;
-	}
+	value = (info.total_blocks - info.free_blocks) * info.block_size / MEGA_BYTE;
 	
-	return false;
+	return true;
 }
 
 // ==== CVolumeCapacityDataProvider ====
@@ -731,14 +1236,11 @@ BString CVolumeCapacityDataProvider::DisplayName()
 	return BString("Capacity of ") << CVolumeDataProviderBase::DisplayName();
 }
 
-bool CVolumeCapacityDataProvider::GetNextValue(float &value)
+bool CVolumeCapacityDataProvider::GetVolumeValue(const fs_info &info, double &value)
 {
-	if(volume->InitCheck() == B_OK) {
-		value = volume->Capacity() / MEGA_BYTE;
-		return true;
-	}
+	value = info.total_blocks * info.block_size / MEGA_BYTE;
 	
-	return false;
+	return true;
 }
 
 // ==== CVolumeUsageDataProvider ====
@@ -773,18 +1275,14 @@ BString CVolumeUsageDataProvider::DisplayName()
 	return BString("Usage of ") << CVolumeDataProviderBase::DisplayName();
 }
 
-bool CVolumeUsageDataProvider::GetNextValue(float &value)
+bool CVolumeUsageDataProvider::GetVolumeValue(const fs_info &info, double &value)
 {
-	if(volume->InitCheck() == B_OK) {
-		off_t capacity = volume->Capacity();
-		off_t usage = capacity - volume->FreeBytes();
-	
-		value = usage / (float)capacity;
-		
-		return true;
-	}
+	off_t capacity = info.total_blocks * info.block_size;
+	off_t usage = capacity - info.free_blocks * info.block_size;
+
+	value = usage / (double)capacity;
 	
-	return false;
+	return true;
 }
 
 
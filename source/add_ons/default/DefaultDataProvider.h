@@ -20,6 +20,10 @@
 
 #include "DataProvider.h"
 #include "Plugin.h"
+#include "SystemSnapshot.h"
+
+class CCPUInfoView;
+struct fs_info;
 
 // ==== signature ====
 
@@ -43,7 +47,34 @@ class _EXPORT CDefaultDataProviderBase : public CArchivableDataProvider
 	virtual status_t Archive(BMessage *archive, bool deep) const;
 };
 
-class _EXPORT CCPUDataProvider : public ICPUDataProvider, public BArchivable
+//: Base of all data providers reading the system snapshot.
+// All of them share one batch kind. A batch acquires the snapshot
+// only once with all the parts its members need.
+class _EXPORT CSnapshotDataProvider : public IBatchDataProvider, 
+	public ISampledDataProvider
+{
+	public:
+	virtual bool GetNextSample(data_sample &sample) { return GetNextSnapshotSample(sample); }
+
+	virtual const void *BatchKind();
+	virtual void GetNextSamples(IDataProvider **providers, int32 count,
+		data_sample *samples, bool *valid);
+
+	protected:
+	// Snapshot parts read by GetSnapshotValue().
+	virtual uint32 SnapshotParts() = 0;
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value) = 0;
+
+	// Implementation of GetNextValue() and GetNextSample() for a
+	// single provider.
+	bool GetNextSnapshotValue(float &value);
+	bool GetNextSnapshotSample(data_sample &sample);
+};
+
+//: CPU usage of a single CPU or of all CPUs.
+// Reads the CCPUInfoCache. A batch of CPU providers shares one view.
+class _EXPORT CCPUDataProvider : public ICPUDataProvider, public BArchivable,
+	public IBatchDataProvider, public ISampledDataProvider
 {
 	public:
 	CCPUDataProvider(int32 cpuNum);
@@ -53,6 +84,7 @@ class _EXPORT CCPUDataProvider : public ICPUDataProvider, public BArchivable
 	static BArchivable *Instantiate(BMessage *archive);
 
 	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
 	virtual uint32 Flags() { return DP_TYPE_RELATIVE | DP_TYPE_PERCENT; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 
@@ -64,6 +96,10 @@ class _EXPORT CCPUDataProvider : public ICPUDataProvider, public BArchivable
 	virtual int32 CPUNum() const { return cpuNum; }
 	virtual void SetCPUNum(int32 newCpu) { cpuNum = newCpu; }
 
+	virtual const void *BatchKind();
+	virtual void GetNextSamples(IDataProvider **providers, int32 count,
+		data_sample *samples, bool *valid);
+
 	enum enumCPUNum {
 		CPU_NUM_0=0,
 		CPU_NUM_1,
@@ -79,13 +115,15 @@ class _EXPORT CCPUDataProvider : public ICPUDataProvider, public BArchivable
 	
 	protected:
 	void Init();
+	bigtime_t ActiveTime(const CCPUInfoView &view) const;
+	bool GetValue(const CCPUInfoView &view, double &value);
 	
 	bigtime_t lastActiveTime;
 	int32 cpuNum;
 };
 
 class _EXPORT CMemoryDataProvider : 
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public ISampledDataProvider
 {
 	public:
 	CMemoryDataProvider();
@@ -99,12 +137,13 @@ class _EXPORT CMemoryDataProvider :
 	virtual bool Equal(IDataProvider *other);
 	
 	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_PAGES; }
 };
 
 class _EXPORT CThreadCountDataProvider :
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public ISampledDataProvider
 {
 	public:
 	CThreadCountDataProvider();
@@ -117,12 +156,13 @@ class _EXPORT CThreadCountDataProvider :
 	virtual bool Equal(IDataProvider *other);
 	
 	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 };
 
 class _EXPORT CTeamCountDataProvider : 
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public ISampledDataProvider
 {
 	public:
 	CTeamCountDataProvider();
@@ -135,12 +175,13 @@ class _EXPORT CTeamCountDataProvider :
 	virtual bool Equal(IDataProvider *other);
 	
 	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 };
 
 class _EXPORT CTeamInfoDataProvider : 
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public CSnapshotDataProvider
 {
 	public:
 	CTeamInfoDataProvider(team_id team);
@@ -149,6 +190,8 @@ class _EXPORT CTeamInfoDataProvider :
 	virtual status_t Archive(BMessage *archive, bool deep) const;
 
 	virtual bool Equal(IDataProvider *other);
+
+	virtual bool GetNextValue(float &value) { return GetNextSnapshotValue(value); }
 	
 	protected:
 	status_t GetTeamInfo(team_info *info)
@@ -175,7 +218,8 @@ class _EXPORT CTeamCPUDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_RELATIVE | DP_TYPE_PERCENT; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 	
-	virtual bool GetNextValue(float &value);
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 	
 	protected:
 	void Init();
@@ -199,7 +243,8 @@ class _EXPORT CTeamMemoryDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_KILOBYTE; }
 
-	virtual bool GetNextValue(float &value);
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 };
 
 class _EXPORT CTeamThreadCountDataProvider :
@@ -218,7 +263,8 @@ class _EXPORT CTeamThreadCountDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 	
-	virtual bool GetNextValue(float &value);
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 };
 
 class _EXPORT CTeamAreaCountDataProvider :
@@ -237,7 +283,8 @@ class _EXPORT CTeamAreaCountDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 	
-	virtual bool GetNextValue(float &value);
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 };
 
 class _EXPORT CTeamImageCountDataProvider :
@@ -256,11 +303,114 @@ class _EXPORT CTeamImageCountDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 	
-	virtual bool GetNextValue(float &value);
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
+};
+
+//: Team data providers summing over the team and all its descendants.
+// The sums are taken from the process tree of the system snapshot.
+class _EXPORT CTeamSubtreeCPUDataProvider :
+	public CTeamInfoDataProvider
+{
+	public:
+	CTeamSubtreeCPUDataProvider(team_id team);
+	CTeamSubtreeCPUDataProvider(BMessage *archive);
+
+	static BArchivable *Instantiate(BMessage *archive);
+
+	virtual IDataProvider *Clone() { return new CTeamSubtreeCPUDataProvider(teamId); }
+	virtual BString DisplayName();
+	virtual bool Equal(IDataProvider *other);
+
+	virtual uint32 Flags() { return DP_TYPE_RELATIVE | DP_TYPE_PERCENT; }
+	virtual uint32 Unit() { return DP_UNIT_NONE; }
+	
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
+	
+	protected:
+	struct subtree_member
+	{
+		team_id		team;
+		bigtime_t	cpuTime;
+	};
+
+	void Init();
+	int32 CollectMembers(const CSystemSnapshot *snapshot, int32 index,
+		CSnapshotColumn<subtree_member> &column);
+	
+	bigtime_t lastActiveTime;
+	bigtime_t exitedTime;		// CPU time of the teams which left the subtree
+
+	// Members of the subtree at the last call, sorted by team id.
+	// The two columns are used alternately.
+	CSnapshotColumn<subtree_member> members[2];
+	int32 memberCount;
+	int32 currentMembers;
+};
+
+class _EXPORT CTeamSubtreeMemoryDataProvider :
+	public CTeamInfoDataProvider
+{
+	public:
+	CTeamSubtreeMemoryDataProvider(team_id team);
+	CTeamSubtreeMemoryDataProvider(BMessage *archive);
+
+	static BArchivable *Instantiate(BMessage *archive);
+
+	virtual IDataProvider *Clone() { return new CTeamSubtreeMemoryDataProvider(teamId); }
+	virtual BString DisplayName();
+	virtual bool Equal(IDataProvider *other);
+
+	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
+	virtual uint32 Unit() { return DP_UNIT_KILOBYTE; }
+	
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
+};
+
+class _EXPORT CTeamSubtreeThreadCountDataProvider :
+	public CTeamInfoDataProvider
+{
+	public:
+	CTeamSubtreeThreadCountDataProvider(team_id team);
+	CTeamSubtreeThreadCountDataProvider(BMessage *archive);
+
+	static BArchivable *Instantiate(BMessage *archive);
+
+	virtual IDataProvider *Clone() { return new CTeamSubtreeThreadCountDataProvider(teamId); }
+	virtual BString DisplayName();
+	virtual bool Equal(IDataProvider *other);
+
+	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
+	virtual uint32 Unit() { return DP_UNIT_NONE; }
+	
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
+};
+
+class _EXPORT CTeamSubtreeImageCountDataProvider :
+	public CTeamInfoDataProvider
+{
+	public:
+	CTeamSubtreeImageCountDataProvider(team_id team);
+	CTeamSubtreeImageCountDataProvider(BMessage *archive);
+
+	static BArchivable *Instantiate(BMessage *archive);
+
+	virtual IDataProvider *Clone() { return new CTeamSubtreeImageCountDataProvider(teamId); }
+	virtual BString DisplayName();
+	virtual bool Equal(IDataProvider *other);
+
+	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
+	virtual uint32 Unit() { return DP_UNIT_NONE; }
+	
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 };
 
 class _EXPORT CThreadCPUDataProvider : 
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public CSnapshotDataProvider
 {
 	public:
 	CThreadCPUDataProvider(thread_id thread);
@@ -275,7 +425,9 @@ class _EXPORT CThreadCPUDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_RELATIVE | DP_TYPE_PERCENT; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 
-	virtual bool GetNextValue(float &value);
+	virtual bool GetNextValue(float &value) { return GetNextSnapshotValue(value); }
+	virtual uint32 SnapshotParts();
+	virtual bool GetSnapshotValue(const CSystemSnapshot *snapshot, double &value);
 	
 	virtual status_t Archive(BMessage *archive, bool deep) const;
 	
@@ -286,8 +438,10 @@ class _EXPORT CThreadCPUDataProvider :
 	bigtime_t lastActiveTime;
 };
 
+//: Base of all volume data providers.
+// A batch of volume providers reads the fs_info of each device only once.
 class _EXPORT CVolumeDataProviderBase :
-	public CDefaultDataProviderBase
+	public CDefaultDataProviderBase, public IBatchDataProvider
 {
 	public:
 	CVolumeDataProviderBase(const BVolume &_volume);
@@ -296,7 +450,15 @@ class _EXPORT CVolumeDataProviderBase :
 
 	virtual status_t Archive(BMessage *archive, bool deep) const;
 	virtual BString DisplayName();
+
+	virtual bool GetNextValue(float &value);
+
+	virtual const void *BatchKind();
+	virtual void GetNextSamples(IDataProvider **providers, int32 count,
+		data_sample *samples, bool *valid);
 	protected:
+	virtual bool GetVolumeValue(const fs_info &info, double &value) = 0;
+
 	BVolume *volume;
 };
 
@@ -316,7 +478,7 @@ class _EXPORT CVolumeUsageAbsoluteDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_MEGABYTE; }
 
-	virtual bool GetNextValue(float &value);
+	virtual bool GetVolumeValue(const fs_info &info, double &value);
 };
 
 class _EXPORT CVolumeCapacityDataProvider :
@@ -335,7 +497,7 @@ class _EXPORT CVolumeCapacityDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit() { return DP_UNIT_MEGABYTE; }
 
-	virtual bool GetNextValue(float &value);
+	virtual bool GetVolumeValue(const fs_info &info, double &value);
 };
 
 class _EXPORT CVolumeUsageDataProvider :
@@ -354,7 +516,7 @@ class _EXPORT CVolumeUsageDataProvider :
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE | DP_TYPE_PERCENT; }
 	virtual uint32 Unit() { return DP_UNIT_NONE; }
 
-	virtual bool GetNextValue(float &value);
+	virtual bool GetVolumeValue(const fs_info &info, double &value);
 };
 
 #endif // DEFAULT_DATA_PROVIDER_H
@@ -16,7 +16,9 @@
  */
  
 #include "pch.h"
+#include "my_assert.h"
 #include "Process.h"
+#include "SystemInfo.h"
 #include "Plugin.h"
 #include "NameInfo.h"
 #include "DefaultDataProvider.h"
@@ -101,6 +103,26 @@ status_t CDefaultPlugin::EnumChildren(
 	const char *path, 
 	BList *children)
 {
+	int32 cookie = 0;
+	bool done = false;
+	
+	while(!done)
+		RETURN_IF_FAILED( GetNextChildren(counterNamespace, path, &cookie, &done, INT32_MAX, children) );
+	
+	return B_OK;
+}
+
+status_t CDefaultPlugin::GetNextChildren(
+	IPerformanceCounterNamespace *counterNamespace, 
+	const char *path, 
+	int32 *cookie,
+	bool *done,
+	int32 maxCount,
+	BList *children)
+{
+	// Only the team list is paged. All other lists are returned at once.
+	*done = true;
+
 	if(strcmp(path, "/") == 0) {
 		// Root
 		children->AddItem(new CPerformanceCounter(counterNamespace, path, "Total", NULL));
@@ -142,22 +164,53 @@ status_t CDefaultPlugin::EnumChildren(
 				"Average", new CCPUDataProvider(CCPUDataProvider::CPU_NUM_ALL)));
 		
 	} else if(strcmp(path, "/Teams") == 0) {
-		int32 cookie=0;
+		// 'cookie' is the cookie of get_next_team_info().
 		team_info teamInfo;
 
-		while(get_next_team_info(&cookie, &teamInfo) == B_OK) {
+		for(int32 i=0 ; i<maxCount ; i++) {
+			if(get_next_team_info(cookie, &teamInfo) != B_OK)
+				return B_OK;
+		
 			BString name;
 
 			name << teamInfo.team;
 		
 			children->AddItem(new CTeamPerformanceCounter(teamInfo.team, 
 				counterNamespace, path, name.String(), NULL));
-		}		
+		}
+		
+		// page is full. There may be more teams.
+		*done = false;
 	} 
 	
 	return B_OK;
 }
 
+int32 CDefaultPlugin::CountChildrenHint(const char *path)
+{
+	if(strcmp(path, "/") == 0) {
+		return 3;
+	} else if(strcmp(path, "/Total") == 0) {
+		return 4;
+	} else if(strcmp(path, "/Volumes") == 0) {
+		// Counting the volumes would mean walking the volume roster.
+		return -1;
+	} else if(strcmp(path, "/Total/CPU Usage") == 0) {
+		system_info systemInfo;
+		get_cached_system_info(&systemInfo, NULL);
+		
+		return systemInfo.cpu_count + 1;
+	} else if(strcmp(path, "/Teams") == 0) {
+		system_info systemInfo;
+		get_cached_system_info(&systemInfo, NULL);
+		
+		return systemInfo.used_teams;
+	}
+	
+	// The plugin adds no children to other paths.
+	return 0;
+}
+
 // ==== CTeamPerformanceCounter ====
 
 CTeamPerformanceCounter::CTeamPerformanceCounter(
@@ -173,25 +226,37 @@ CTeamPerformanceCounter::CTeamPerformanceCounter(
 	name = team_name(teamId);
 }
 
-void CTeamPerformanceCounter::InitChildren()
+bool CTeamPerformanceCounter::CreateChildren(int32 *cookie, int32 maxCount, BList *children)
 {
-	if(initChildren) {
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "CPU Usage", 
-			new CTeamCPUDataProvider(teamId)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Memory Usage", 
-			new CTeamMemoryDataProvider(teamId)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Thread Count",
-			new CTeamThreadCountDataProvider(teamId)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Area Count", 
-			new CTeamAreaCountDataProvider(teamId)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Image Count", 
-			new CTeamImageCountDataProvider(teamId)));
-		
-		children.AddItem(new CThreadRootPerformanceCounter(teamId, namesp, Path(), 
-			"Threads", NULL));
-	}
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "CPU Usage", 
+		new CTeamCPUDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Memory Usage", 
+		new CTeamMemoryDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Thread Count",
+		new CTeamThreadCountDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Area Count", 
+		new CTeamAreaCountDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Image Count", 
+		new CTeamImageCountDataProvider(teamId)));
+
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Subtree CPU Usage", 
+		new CTeamSubtreeCPUDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Subtree Memory Usage", 
+		new CTeamSubtreeMemoryDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Subtree Thread Count",
+		new CTeamSubtreeThreadCountDataProvider(teamId)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Subtree Image Count", 
+		new CTeamSubtreeImageCountDataProvider(teamId)));
 	
-	CPerformanceCounter::InitChildren();
+	children->AddItem(new CThreadRootPerformanceCounter(teamId, namesp, Path(), 
+		"Threads", NULL));
+
+	return false;
+}
+
+int32 CTeamPerformanceCounter::CountOwnChildren()
+{
+	return 10;
 }
 
 const char *CTeamPerformanceCounter::Name() const
@@ -212,18 +277,21 @@ CVolumePerformaceCounter::CVolumePerformaceCounter(
 	volume = _volume;
 }
 
-void CVolumePerformaceCounter::InitChildren()
+bool CVolumePerformaceCounter::CreateChildren(int32 *cookie, int32 maxCount, BList *children)
 {
-	if(initChildren) {
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Used Bytes",
-			new CVolumeUsageAbsoluteDataProvider(volume)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Capacity",
-			new CVolumeCapacityDataProvider(volume)));
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "Usage (%)",
-			new CVolumeUsageDataProvider(volume)));
-	}
-	
-	CPerformanceCounter::InitChildren();
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Used Bytes",
+		new CVolumeUsageAbsoluteDataProvider(volume)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Capacity",
+		new CVolumeCapacityDataProvider(volume)));
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "Usage (%)",
+		new CVolumeUsageDataProvider(volume)));
+
+	return false;
+}
+
+int32 CVolumePerformaceCounter::CountOwnChildren()
+{
+	return 3;
 }
 
 // ==== CThreadRootPerformanceCounter ====
@@ -239,23 +307,36 @@ CThreadRootPerformanceCounter::CThreadRootPerformanceCounter(
 	teamId = id;
 }
 
-void CThreadRootPerformanceCounter::InitChildren()
+// CreateChildren
+// 'cookie' is the cookie of get_next_thread_info().
+bool CThreadRootPerformanceCounter::CreateChildren(int32 *cookie, int32 maxCount, BList *children)
 {
-	if(initChildren) {
-		thread_info threadInfo;
-		int32 cookie = 0;
+	thread_info threadInfo;
+
+	for(int32 i=0 ; i<maxCount ; i++) {
+		if(get_next_thread_info(teamId, cookie, &threadInfo) != B_OK)
+			return false;
 	
-		while(get_next_thread_info(teamId, &cookie, &threadInfo) == B_OK) {
-			BString name;
-			
-			name << threadInfo.thread;
+		BString name;
 		
-			children.AddItem(new CThreadPerformanceCounter(threadInfo.thread,
-				namesp, Path(), name.String(), NULL));
-		}
+		name << threadInfo.thread;
+	
+		children->AddItem(new CThreadPerformanceCounter(threadInfo.thread,
+			namesp, Path(), name.String(), NULL));
 	}
 	
-	CPerformanceCounter::InitChildren();
+	// page is full. There may be more threads.
+	return true;
+}
+
+int32 CThreadRootPerformanceCounter::CountOwnChildren()
+{
+	team_info teamInfo;
+	
+	if(get_team_info(teamId, &teamInfo) != B_OK)
+		return 0;
+		
+	return teamInfo.thread_count;
 }
 
 // ==== CThreadPerformanceCounter =====
@@ -273,14 +354,17 @@ CThreadPerformanceCounter::CThreadPerformanceCounter(
 	name = thread_name(threadId);
 }
 
-void CThreadPerformanceCounter::InitChildren()
+bool CThreadPerformanceCounter::CreateChildren(int32 *cookie, int32 maxCount, BList *children)
 {
-	if(initChildren) {
-		children.AddItem(new CPerformanceCounter(namesp, Path(), "CPU Usage", 
-			new CThreadCPUDataProvider(threadId)));
-	}
-	
-	CPerformanceCounter::InitChildren();
+	children->AddItem(new CPerformanceCounter(namesp, Path(), "CPU Usage", 
+		new CThreadCPUDataProvider(threadId)));
+
+	return false;
+}
+
+int32 CThreadPerformanceCounter::CountOwnChildren()
+{
+	return 1;
 }
 
 const char *CThreadPerformanceCounter::Name() const
@@ -20,7 +20,7 @@
 
 #include "PerformanceCounter.h"
 
-class CDefaultPlugin : public IPerformanceCounterPlugin
+class CDefaultPlugin : public IPerformanceCounterPlugin, public IPagedCounterPlugin
 {
 	public:
 	CDefaultPlugin();
@@ -28,6 +28,11 @@ class CDefaultPlugin : public IPerformanceCounterPlugin
 	virtual status_t EnumChildren(IPerformanceCounterNamespace *counterNamespace, 
 							const char *path, 
 							BList *children);
+
+	virtual status_t GetNextChildren(IPerformanceCounterNamespace *counterNamespace, 
+							const char *path, int32 *cookie, bool *done,
+							int32 maxCount, BList *children);
+	virtual int32 CountChildrenHint(const char *path);
 };
 
 class CTeamPerformanceCounter : public CPerformanceCounter
@@ -40,7 +45,8 @@ class CTeamPerformanceCounter : public CPerformanceCounter
 		const char *internalName,
 		IDataProvider *dataProvider);
 
-	virtual void InitChildren();
+	virtual bool CreateChildren(int32 *cookie, int32 maxCount, BList *children);
+	virtual int32 CountOwnChildren();
 	virtual const char *Name() const;
 	
 	protected:
@@ -58,7 +64,8 @@ class CVolumePerformaceCounter : public CPerformanceCounter
 		const char *internalName,
 		IDataProvider *dataProvider);
 		
-	virtual void InitChildren();
+	virtual bool CreateChildren(int32 *cookie, int32 maxCount, BList *children);
+	virtual int32 CountOwnChildren();
 	
 	protected:
 	BVolume volume;
@@ -74,7 +81,8 @@ class CThreadRootPerformanceCounter : public CPerformanceCounter
 		const char *name,
 		IDataProvider *dataProvider);
 
-	virtual void InitChildren();
+	virtual bool CreateChildren(int32 *cookie, int32 maxCount, BList *children);
+	virtual int32 CountOwnChildren();
 	
 	protected:
 	team_id teamId;	
@@ -90,7 +98,8 @@ class CThreadPerformanceCounter : public CPerformanceCounter
 		const char *internalName,
 		IDataProvider *dataProvider);
 
-	virtual void InitChildren();
+	virtual bool CreateChildren(int32 *cookie, int32 maxCount, BList *children);
+	virtual int32 CountOwnChildren();
 	virtual const char *Name() const;
 	
 	protected:
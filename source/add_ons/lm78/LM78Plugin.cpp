@@ -20,6 +20,7 @@
 #include "errno.h"
 #include "common.h"
 #include "Plugin.h"
+#include "SampleRing.h"
 #include "LM78Plugin.h"
 
 // ==== globals ====
@@ -29,7 +30,14 @@ const char * const LM78_DATA_PROVIDER_ARCHIVE_INDEX		= "LM78:Index";
 
 const char * const ADD_ON_SIGNATURE	= "application/x-vnd.task_manager_lm78";
 
-// ==== entry point ====
+const int32 LM78_CHANNEL_COUNT		= 10;		// lines per data block
+
+int32 counter_plugin_abi_version	= COUNTER_PLUGIN_ABI_VERSION;
+
+// NULL, if the plugin was created by the version 1 entry point.
+static ICounterPluginHost *pluginHost = NULL;
+
+// ==== entry points ====
 
 status_t __declspec(dllexport) CreateCounterPlugin(IPerformanceCounterPlugin **plugin)
 {
@@ -38,6 +46,13 @@ status_t __declspec(dllexport) CreateCounterPlugin(IPerformanceCounterPlugin **p
 	return (*plugin) != NULL ? B_OK : B_NO_MEMORY;
 }
 
+status_t __declspec(dllexport) CreateCounterPluginV2(ICounterPluginHost *host, IPerformanceCounterPlugin **plugin)
+{
+	pluginHost = host;
+	
+	return CreateCounterPlugin(plugin);
+}
+
 // ==== CLM87Plugin ====
 
 CLM78Plugin::CLM78Plugin()
@@ -108,13 +123,93 @@ CLM78DataInfo::CLM78DataInfo()
 		alert->Go();	
 	}
 
-	lastUpdate = 0;
+	lastUpdate		= 0;
+	sourceId		= -1;
+	producerThread	= -1;
+	quitProducer	= false;
+	
+	if(pluginHost)
+		StartProducer();
 }
 
 CLM78DataInfo::~CLM78DataInfo()
 {
+	if(producerThread >= 0) {
+		status_t exitValue;
+	
+		quitProducer = true;
+		
+		// The producer may be blocked reading the driver. Suspending
+		// and resuming it interrupts the read. It's repeated, in case
+		// the producer wasn't blocked yet.
+		do {
+			suspend_thread(producerThread);
+			resume_thread(producerThread);
+		} while(wait_for_thread_etc(producerThread, B_RELATIVE_TIMEOUT, 
+					FAST_PULSE_RATE/2, &exitValue) == B_TIMED_OUT);
+	}
+	
+	if(sourceId >= 0)
+		pluginHost->UnregisterPushSource(sourceId);
+
 	// close driver
-	fclose(lm78_driver);
+	if(lm78_driver)
+		fclose(lm78_driver);
+}
+
+// StartProducer
+// Creates the sample ring and registers it as push source. If that
+// fails, the data providers fall back to pulling the data.
+void CLM78DataInfo::StartProducer()
+{
+	// Some ticks of slack, if the host doesn't drain the ring.
+	if(sampleRing.Create("LM78 samples", LM78_CHANNEL_COUNT * 4) != B_OK)
+		return;
+		
+	int32 id = pluginHost->RegisterPushSource("LM78", sampleRing.Area(), LM78_CHANNEL_COUNT);
+	
+	if(id < B_OK)
+		return;
+		
+	producerThread = spawn_thread(ProducerThread, "LM78 producer", B_LOW_PRIORITY, this);
+
+	if(producerThread < B_OK || resume_thread(producerThread) != B_OK) {
+		pluginHost->UnregisterPushSource(id);
+		producerThread = -1;
+		return;
+	}
+	
+	sourceId = id;
+}
+
+// ProducerThread
+// Reads a data block each half fast pulse and pushes its values.
+int32 CLM78DataInfo::ProducerThread(void *data)
+{
+	CLM78DataInfo *info = (CLM78DataInfo *)data;
+
+	while(!info->quitProducer) {
+		info->Lock();
+		
+		if(info->ReadBlock()) {
+			bigtime_t now = system_time();
+		
+			for(int32 i=0 ; i<LM78_CHANNEL_COUNT ; i++) {
+				BString *line = info->data.ItemAt(i);
+				double value = 0.0;
+				
+				bool valid = line && ParseValue(*line, value);
+				
+				info->sampleRing.Write(i, now, value, valid);
+			}
+		}
+		
+		info->Unlock();
+	
+		snooze(FAST_PULSE_RATE/2);
+	}
+	
+	return 0;
 }
 	
 void CLM78DataInfo::Lock()
@@ -123,6 +218,19 @@ void CLM78DataInfo::Lock()
 }
 
 void CLM78DataInfo::Update()
+{
+	bigtime_t dist = system_time() - lastUpdate;
+	
+	if(dist >= FAST_PULSE_RATE/2)
+		ReadBlock();
+	
+	lastUpdate = system_time();
+}
+
+// ReadBlock
+// Reads one data block from the driver. Returns false, if the
+// driver isn't accessable or the read was interrupted.
+bool CLM78DataInfo::ReadBlock()
 {
 	// one data block consist of 10 lines:
 	// Vcore: xxxV
@@ -143,30 +251,53 @@ void CLM78DataInfo::Update()
 		
 		if(lm78_driver == NULL) {
 			// Still in use or not present.
-			return;
+			return false;
 		}
 	}
 
-	bigtime_t dist = system_time() - lastUpdate;
-	
-	if(dist >= FAST_PULSE_RATE/2) {
-		data.MakeEmpty();
+	data.MakeEmpty();
+
+	for(int i=0 ; i<LM78_CHANNEL_COUNT ; i++) {
+		char line[255];
+		int c, k=0;
 	
-		for(int i=0 ; i<10 ; i++) {
-			char line[255], c;
-			int k=0;
-		
-			while((c = fgetc(lm78_driver)) != '\n') {
-				line[k++] = c;
+		while((c = fgetc(lm78_driver)) != '\n') {
+			if(c == EOF) {
+				clearerr(lm78_driver);
+				data.MakeEmpty();
+				return false;
 			}
 		
-			line[k++] = '\0';
-		
-			data.AddItem(new BString(line));
+			// overlong lines are truncated.
+			if(k < (int)sizeof(line)-1)
+				line[k++] = c;
 		}
+	
+		line[k++] = '\0';
+	
+		data.AddItem(new BString(line));
 	}
 	
-	lastUpdate = system_time();
+	return true;
+}
+
+// ParseValue
+// Extracts the value of a line of a data block. Returns false, if
+// the sensor isn't present.
+bool CLM78DataInfo::ParseValue(const BString &dataString, double &value)
+{
+	if(dataString.FindFirst("not present") != B_ERROR)
+		return false;
+		
+	int32 dataBegin = dataString.FindFirst(':');
+	int32 dataEnd   = dataString.FindLast(' ');
+	
+	BString data;
+	dataString.CopyInto(data, dataBegin+1, dataEnd-dataBegin);
+	
+	value = atof(data.String());
+	
+	return true;
 }
 
 void CLM78DataInfo::Unlock()
@@ -217,6 +348,17 @@ CLM78DataProvider::~CLM78DataProvider()
 }
 
 bool CLM78DataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+	
+	bool valid = GetNextSample(sample);
+	
+	value = sample.value;
+	
+	return valid;
+}
+
+bool CLM78DataProvider::GetNextSample(data_sample &sample)
 {
 	if(!dataInfo) {
 		// The dataInfo locks the driver. Therefore I create it
@@ -224,6 +366,14 @@ bool CLM78DataProvider::GetNextValue(float &value)
 		dataInfo = new CLM78DataInfo();
 	}
 
+	sample.value		= 0.0;
+	sample.timeStamp	= system_time();
+
+	if(dataInfo->SourceId() >= 0) {
+		// pushed by the producer thread
+		return pluginHost->GetLatestSample(dataInfo->SourceId(), dataIndex, sample);
+	}
+
 	dataInfo->Lock();
 	dataInfo->Update();
 
@@ -233,19 +383,7 @@ bool CLM78DataProvider::GetNextValue(float &value)
 
 	dataInfo->Unlock();
 	
-	if(dataString.FindFirst("not present") == B_ERROR) {
-		int32 dataBegin = dataString.FindFirst(':');
-		int32 dataEnd   = dataString.FindLast(' ');
-		
-		BString data;
-		dataString.CopyInto(data, dataBegin+1, dataEnd-dataBegin);
-		
-		value = atof(data.String());
-		
-		return true;
-	}
-	
-	return false;
+	return CLM78DataInfo::ParseValue(dataString, sample.value);
 }
 
 bool CLM78DataProvider::Equal(IDataProvider *other)
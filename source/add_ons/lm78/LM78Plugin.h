@@ -36,6 +36,10 @@ class CLM78Plugin : public IPerformanceCounterPlugin
 	bool driverPresent;
 };
 
+// If the host supports push sources (plugin ABI version 2), the
+// driver is read by a producer thread, which writes the values into
+// a sample ring. The data providers only ask the host for the latest
+// sample then. Otherwise the driver is read by the data providers.
 class CLM78DataInfo
 {
 	public:
@@ -48,15 +52,30 @@ class CLM78DataInfo
 	
 	CPointerList<BString> &Data() { return data; }
 	
+	// Id of the push source or -1, if the data is pulled.
+	int32 SourceId() const { return sourceId; }
+	
+	static bool ParseValue(const BString &dataString, double &value);
+	
 	protected:
+	bool ReadBlock();
+	void StartProducer();
+	static int32 ProducerThread(void *data);
+	
 	BLocker lock;
 	CPointerList<BString> data;
 	bigtime_t lastUpdate;	
 
 	FILE *lm78_driver;
+	
+	CSampleRing sampleRing;
+	int32 sourceId;
+	thread_id producerThread;
+	volatile bool quitProducer;
 };
 
-class _EXPORT CLM78DataProvider : public CArchivableDataProvider
+class _EXPORT CLM78DataProvider : public CArchivableDataProvider, 
+	public ISampledDataProvider
 {
 	public:
 	CLM78DataProvider(const char *name, int32 index);
@@ -67,6 +86,7 @@ class _EXPORT CLM78DataProvider : public CArchivableDataProvider
 	static BArchivable *Instantiate(BMessage *archive);
 	
 	virtual bool GetNextValue(float &value);
+	virtual bool GetNextSample(data_sample &sample);
 	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
 	virtual uint32 Unit();
 	virtual BString DisplayName() { return dataName; }
@@ -85,5 +105,7 @@ extern const char * const LM78_DATA_PROVIDER_ARCHIVE_NAME;
 extern const char * const LM78_DATA_PROVIDER_ARCHIVE_INDEX;
 
 extern "C" status_t __declspec(dllexport) CreateCounterPlugin(IPerformanceCounterPlugin **plugin);
+extern "C" status_t __declspec(dllexport) CreateCounterPluginV2(ICounterPluginHost *host, IPerformanceCounterPlugin **plugin);
+extern "C" __declspec(dllexport) int32 counter_plugin_abi_version;
 
 #endif // LM78_PLUGIN_H
\ No newline at end of file
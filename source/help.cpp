@@ -34,11 +34,10 @@ BPath get_app_path()
 	int32 cookie=0;
 	image_info imageInfo;
 
-	team_id team = be_app->Team();
+	// Try to find image using the tag symbol. This also works without
+	// BApplication (see collect_main()).
 
-	// Try to find image using the tag symbol.
-
-	while(get_next_image_info(team, &cookie, &imageInfo) == B_OK) {
+	while(get_next_image_info(B_CURRENT_TEAM, &cookie, &imageInfo) == B_OK) {
 		void *location;
 
 		if(get_image_symbol(imageInfo.id, "taskmgr_image_tag_symbol", B_SYMBOL_TYPE_DATA, &location) == B_OK) {
@@ -51,6 +50,9 @@ BPath get_app_path()
 
 	// If the tag symbol can't be found use the BApplication methods.
 
+	if(be_app == NULL)
+		return BPath();
+
 	app_info appInfo;
 	status_t result = be_app->GetAppInfo(&appInfo);
 
@@ -38,6 +38,7 @@
 #include <image.h>
 #include <scheduler.h>
 #include <fs_attr.h>
+#include <fs_info.h>
 
 #include <Application.h>
 #include <MessageRunner.h>
@@ -49,6 +50,7 @@
 #include <File.h>
 #include <Path.h>
 #include <AppFileInfo.h>
+#include <Resources.h>
 #include <FindDirectory.h>
 #include <FilePanel.h>
 #include <Volume.h>
@@ -0,0 +1,397 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#include "pch.h"
+#include "common.h"
+#include "my_assert.h"
+#include "PluginHost.h"
+
+// ==== CHostNamespace ====
+
+status_t CHostNamespace::EnumChildren(const char *path, BList *children)
+{
+	return plugin->EnumChildren(this, path, children);
+}
+
+IDataProvider *CHostNamespace::DataProvider(const char *path)
+{
+	CPointerList<IPerformanceCounter> roots;
+	
+	IPerformanceCounter *counter = FindCounter(path, &roots);
+	
+	return counter && counter->DataProvider() ? counter->DataProvider()->Clone() : NULL;
+}
+
+status_t CHostNamespace::GetNextChildren(const char *path, counter_cursor *cursor,
+	int32 maxCount, BList *children)
+{
+	// All children are returned as one page.
+	if(cursor->done)
+		return B_OK;
+		
+	cursor->done = true;
+	
+	return EnumChildren(path, children);
+}
+
+// FindCounter
+// The tree is walked by IPerformanceCounter::ChildAt(), as some counters
+// create children of their own, which aren't returned by the plugin
+// for their path.
+IPerformanceCounter *CHostNamespace::FindCounter(const char *path, 
+	CPointerList<IPerformanceCounter> *roots)
+{
+	if(EnumChildren("/", roots) != B_OK)
+		return NULL;
+	
+	IPerformanceCounter *counter = NULL;
+	const char *component = path[0] == '/' ? path+1 : path;
+	
+	while(*component) {
+		const char *slash = strchr(component, '/');
+		int32 length = slash ? slash-component : strlen(component);
+		int32 count = counter ? counter->CountChildren() : roots->CountItems();
+		IPerformanceCounter *child = NULL;
+		
+		for(int32 i=0 ; i<count ; i++) {
+			IPerformanceCounter *candidate = counter ? counter->ChildAt(i) : roots->ItemAt(i);
+			const char *name = candidate->InternalName();
+			
+			if(strncmp(name, component, length) == 0 && name[length] == '\0') {
+				child = candidate;
+				break;
+			}
+		}
+		
+		if(child == NULL)
+			return NULL;
+			
+		counter		= child;
+		component	= slash ? slash+1 : component+length;
+	}
+	
+	return counter;
+}
+
+// ==== CPluginHost ====
+
+CPluginHost::CPluginHost(const char *addonPath, port_id _replyPort) :
+	changeLocker("PluginHostChanges")
+{
+	path			= addonPath;
+	replyPort		= _replyPort;
+	requestPort		= -1;
+	addonImage		= -1;
+	plugin			= NULL;
+	namesp			= NULL;
+	samplerThread	= -1;
+	quit			= false;
+	
+	for(int32 i=0 ; i<PLUGIN_HOST_CHANNEL_COUNT ; i++)
+		providers[i] = NULL;
+}
+
+CPluginHost::~CPluginHost()
+{
+	for(int32 i=0 ; i<PLUGIN_HOST_CHANNEL_COUNT ; i++)
+		delete providers[i];
+		
+	for(int32 i=0 ; i<changes.CountItems() ; i++)
+		delete changes.ItemAt(i)->provider;
+
+	delete namesp;
+	delete plugin;
+	
+	if(addonImage >= 0) unload_add_on(addonImage);
+	if(requestPort >= 0) delete_port(requestPort);
+}
+
+// Init
+// Loads the plugin and creates the request port and the sample ring.
+// The newest entry point both sides support is used (see
+// CPerformanceCounterNamespace::CPlugin::Load()).
+status_t CPluginHost::Init()
+{
+	requestPort = create_port(PLUGIN_HOST_PORT_CAPACITY, "PluginHost request");
+	
+	if(requestPort < B_OK)
+		return requestPort;
+
+	addonImage = load_add_on(path.String());
+	
+	if(addonImage < B_OK)
+		return addonImage;
+		
+	int32 *abiVersion = NULL;
+	counter_plugin_entry_point entryPoint;
+	counter_plugin_entry_point_v2 entryPointV2;
+	
+	if(get_image_symbol(addonImage, "counter_plugin_abi_version",
+		B_SYMBOL_TYPE_DATA, (void **)&abiVersion) == B_OK && *abiVersion >= 2 &&
+	   get_image_symbol(addonImage, "CreateCounterPluginV2", 
+		B_SYMBOL_TYPE_TEXT, (void **)&entryPointV2) == B_OK) {
+		RETURN_IF_FAILED(entryPointV2(&pushSourceHost, &plugin));
+	} else {
+		RETURN_IF_FAILED(get_image_symbol(addonImage, "CreateCounterPlugin", 
+			B_SYMBOL_TYPE_TEXT, (void **)&entryPoint));
+		
+		RETURN_IF_FAILED(entryPoint(&plugin));
+	}
+	
+	namesp = new CHostNamespace(plugin);
+	
+	// TaskManager drains the ring once per pulse. Leave room for some
+	// samplings of each channel in between.
+	return ring.Create("PluginHost samples", PLUGIN_HOST_CHANNEL_COUNT * 4);
+}
+
+int32 CPluginHost::Run()
+{
+	status_t status = Init();
+	
+	BMessage ready(PLUGIN_HOST_READY);
+	
+	ready.AddInt32(PLUGIN_HOST_STATUS, status);
+	ready.AddInt32(PLUGIN_HOST_PORT, requestPort);
+	ready.AddInt32(PLUGIN_HOST_RING, ring.Area());
+	
+	if(send_plugin_host_message(replyPort, &ready, PLUGIN_HOST_START_TIMEOUT) != B_OK || 
+	   status != B_OK)
+		return 1;
+		
+	samplerThread = spawn_thread(SamplerThread, "PluginHost sampler", B_NORMAL_PRIORITY, this);
+	
+	if(samplerThread < B_OK || resume_thread(samplerThread) != B_OK)
+		return 1;
+		
+	while(!quit) {
+		BMessage request;
+		
+		status = receive_plugin_host_message(requestPort, &request, FAST_PULSE_RATE);
+		
+		if(status == B_TIMED_OUT) {
+			// The reply port is deleted, when TaskManager quits.
+			port_info info;
+			
+			if(get_port_info(replyPort, &info) != B_OK)
+				quit = true;
+				
+			continue;
+		}
+		
+		if(status != B_OK)
+			break;
+			
+		HandleRequest(&request);
+	}
+	
+	quit = true;
+	
+	status_t exitValue;
+	
+	wait_for_thread(samplerThread, &exitValue);
+	
+	return 0;
+}
+
+void CPluginHost::HandleRequest(BMessage *request)
+{
+	BMessage reply(PLUGIN_HOST_REPLY);
+	BMessage archive;
+
+	switch(request->what) {
+		case PLUGIN_HOST_ENUM_CHILDREN:
+			SendReply(request, &reply, 
+				EnumChildren(request->FindString(PLUGIN_HOST_PATH), &reply));
+			break;
+		case PLUGIN_HOST_DESCRIBE:
+			request->FindMessage(PLUGIN_HOST_ARCHIVE, &archive);
+		
+			SendReply(request, &reply, Describe(&archive, &reply));
+			break;
+		case PLUGIN_HOST_SUBSCRIBE:
+			// The provider may be NULL, if the counter doesn't exist
+			// anymore. The channel just doesn't get any samples then.
+			ChangeSubscription(request->FindInt32(PLUGIN_HOST_CHANNEL), 
+				CreateProvider(request));
+			break;
+		case PLUGIN_HOST_UNSUBSCRIBE:
+			ChangeSubscription(request->FindInt32(PLUGIN_HOST_CHANNEL), NULL);
+			break;
+		case PLUGIN_HOST_QUIT:
+			quit = true;
+			break;
+	}
+}
+
+// SendReply
+// If the reply port is full, TaskManager has abandoned the
+// request anyway. The reply is dropped then.
+void CPluginHost::SendReply(BMessage *request, BMessage *reply, status_t status)
+{
+	reply->AddInt32(PLUGIN_HOST_SERIAL, request->FindInt32(PLUGIN_HOST_SERIAL));
+	reply->AddInt32(PLUGIN_HOST_STATUS, status);
+	
+	send_plugin_host_message(replyPort, reply, PLUGIN_HOST_DEFAULT_DEADLINE);
+}
+
+status_t CPluginHost::EnumChildren(const char *parentPath, BMessage *reply)
+{
+	if(parentPath == NULL)
+		return B_BAD_VALUE;
+
+	CPointerList<IPerformanceCounter> roots;
+	IPerformanceCounter *parent = NULL;
+	
+	if(strcmp(parentPath, "/") == 0) {
+		RETURN_IF_FAILED(namesp->EnumChildren(parentPath, &roots));
+	} else if((parent = namesp->FindCounter(parentPath, &roots)) == NULL) {
+		return B_ENTRY_NOT_FOUND;
+	}
+		
+	int32 count = parent ? parent->CountChildren() : roots.CountItems();
+	
+	for(int32 i=0 ; i<count ; i++) {
+		IPerformanceCounter *child = parent ? parent->ChildAt(i) : roots.ItemAt(i);
+		IDataProvider *provider = child->DataProvider();
+	
+		reply->AddString(PLUGIN_HOST_NAME_FIELD, child->Name());
+		reply->AddString(PLUGIN_HOST_INTERNAL_NAME, child->InternalName());
+		reply->AddBool(PLUGIN_HOST_HAS_PROVIDER, provider != NULL);
+		
+		// The fields are added for all children, so their
+		// index is the index of the child.
+		AddProviderInfo(provider, reply);
+	}
+	
+	return B_OK;
+}
+
+status_t CPluginHost::Describe(BMessage *archive, BMessage *reply)
+{
+	IDataProvider *provider = dynamic_cast<IDataProvider *>(instantiate_object(archive));
+	
+	if(provider == NULL)
+		return B_BAD_VALUE;
+		
+	AddProviderInfo(provider, reply);
+	
+	delete provider;
+	
+	return B_OK;
+}
+
+// AddProviderInfo
+// Adds flags, unit, display name and archive of 'provider' (which may
+// be NULL) to 'reply'.
+void CPluginHost::AddProviderInfo(IDataProvider *provider, BMessage *reply)
+{
+	BMessage archive;
+	BArchivable *archivable = dynamic_cast<BArchivable *>(provider);
+	
+	if(archivable == NULL || archivable->Archive(&archive, true) != B_OK)
+		archive.MakeEmpty();
+	
+	reply->AddInt32(PLUGIN_HOST_FLAGS, provider ? provider->Flags() : 0);
+	reply->AddInt32(PLUGIN_HOST_UNIT, provider ? provider->Unit() : 0);
+	reply->AddString(PLUGIN_HOST_DISPLAY_NAME, provider ? provider->DisplayName() : BString());
+	reply->AddMessage(PLUGIN_HOST_ARCHIVE, &archive);
+}
+
+// CreateProvider
+// Creates the data provider of a subscription request.
+IDataProvider *CPluginHost::CreateProvider(BMessage *request)
+{
+	BMessage archive;
+
+	if(request->FindMessage(PLUGIN_HOST_ARCHIVE, &archive) == B_OK)
+		return dynamic_cast<IDataProvider *>(instantiate_object(&archive));
+		
+	const char *counterPath = request->FindString(PLUGIN_HOST_PATH);
+
+	return counterPath ? namesp->DataProvider(counterPath) : NULL;
+}
+
+void CPluginHost::ChangeSubscription(int32 channel, IDataProvider *provider)
+{
+	if(channel < 0 || channel >= PLUGIN_HOST_CHANNEL_COUNT) {
+		delete provider;
+		return;
+	}
+
+	BAutolock autoLocker(changeLocker);
+	
+	changes.AddItem(new CSubscription(channel, provider));
+}
+
+int32 CPluginHost::SamplerThread(void *data)
+{
+	CPluginHost *host = (CPluginHost *)data;
+	
+	while(!host->quit) {
+		host->Sample();
+		
+		snooze(FAST_PULSE_RATE/2);
+	}
+	
+	return 0;
+}
+
+// Sample
+// Applies the pending subscription changes and writes one sample
+// of each subscribed data provider into the ring.
+void CPluginHost::Sample()
+{
+	changeLocker.Lock();
+	
+	for(int32 i=0 ; i<changes.CountItems() ; i++) {
+		CSubscription *change = changes.ItemAt(i);
+		
+		delete providers[change->channel];
+		providers[change->channel] = change->provider;
+	}
+	
+	changes.MakeEmpty();
+	
+	changeLocker.Unlock();
+	
+	for(int32 i=0 ; i<PLUGIN_HOST_CHANNEL_COUNT ; i++) {
+		if(providers[i] == NULL)
+			continue;
+			
+		data_sample sample;
+		
+		bool valid = get_next_sample(providers[i], sample);
+		
+		ring.Write(i, sample.timeStamp, sample.value, valid);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if(argc != 3) {
+		fprintf(stderr, "usage: %s <add-on path> <reply port>\n", argv[0]);
+		return 1;
+	}
+
+	// Plugins may show alerts.
+	BApplication app(PLUGIN_HOST_SIGNATURE);
+	
+	CPluginHost host(argv[1], atol(argv[2]));
+	
+	return host.Run();
+}
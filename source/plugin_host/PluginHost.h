@@ -0,0 +1,109 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef PLUGIN_HOST_H
+#define PLUGIN_HOST_H
+
+#include "PointerList.h"
+#include "PerformanceCounter.h"
+#include "SampleRing.h"
+#include "PushSourceHost.h"
+#include "PluginHostProtocol.h"
+
+//: Namespace passed to the plugin in the host.
+// Contains only the counters of that plugin.
+class CHostNamespace : public IPerformanceCounterNamespace
+{
+	public:
+	CHostNamespace(IPerformanceCounterPlugin *_plugin) { plugin = _plugin; }
+
+	virtual status_t EnumChildren(const char *path, BList *children);
+	virtual IDataProvider *DataProvider(const char *path);
+	// Not used by plugins.
+	virtual IPerformanceCounter *Root() { return NULL; }
+
+	virtual status_t GetNextChildren(const char *path, counter_cursor *cursor,
+							int32 maxCount, BList *children);
+	virtual int32 CountChildrenHint(const char *path) { return -1; }
+	
+	// Looks up the counter 'path' in the tree below 'roots'. The top
+	// level counters are added to 'roots' and owned by the caller.
+	IPerformanceCounter *FindCounter(const char *path, CPointerList<IPerformanceCounter> *roots);
+	
+	protected:
+	IPerformanceCounterPlugin *plugin;
+};
+
+//: Plugin host process.
+// Loads one plugin and serves the requests of TaskManager (see
+// PluginHostProtocol.h). The requests are handled by the main
+// thread. The subscribed data providers are sampled by a sampler
+// thread, so a plugin which hangs while sampling doesn't stop the
+// enumeration and vice versa. Version 2 plugins get a push source
+// host of their own. Their data providers read the latest pushed
+// sample, which the sampler forwards into the ring of TaskManager.
+class CPluginHost
+{
+	public:
+	CPluginHost(const char *addonPath, port_id replyPort);
+	~CPluginHost();
+
+	// Returns the exit code of the process.
+	int32 Run();
+
+	protected:
+	//: Change of a subscription.
+	// Applied by the sampler thread between two samplings.
+	class CSubscription
+	{
+		public:
+		CSubscription(int32 _channel, IDataProvider *_provider) 
+			{ channel = _channel; provider = _provider; }
+		
+		int32			 channel;
+		IDataProvider	*provider;			// NULL to unsubscribe
+	};
+
+	status_t Init();
+	void HandleRequest(BMessage *request);
+	void SendReply(BMessage *request, BMessage *reply, status_t status);
+	status_t EnumChildren(const char *path, BMessage *reply);
+	status_t Describe(BMessage *archive, BMessage *reply);
+	IDataProvider *CreateProvider(BMessage *request);
+	void ChangeSubscription(int32 channel, IDataProvider *provider);
+	
+	static void AddProviderInfo(IDataProvider *provider, BMessage *reply);
+	static int32 SamplerThread(void *data);
+	void Sample();
+	
+	BString						 path;
+	port_id						 replyPort;
+	port_id						 requestPort;
+	image_id					 addonImage;
+	CPushSourceHost				 pushSourceHost;	// destructed after the plugin
+	IPerformanceCounterPlugin	*plugin;
+	CHostNamespace				*namesp;
+	CSampleRing					 ring;
+	
+	BLocker						 changeLocker;		// guards 'changes'
+	CPointerList<CSubscription>	 changes;
+	IDataProvider				*providers[PLUGIN_HOST_CHANNEL_COUNT];	// only used by the sampler
+	thread_id					 samplerThread;
+	volatile bool				 quit;
+};
+
+#endif // PLUGIN_HOST_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the sequence lock of the counter export. A writer thread
+// publishes values into a few slots as fast as it can, while reader
+// threads poll them through CCounterExportReader. Every published
+// value satisfies:
+// - value, min, max and avg are equal.
+// - the time stamp is the value plus one.
+// - the value is valid, if it's odd.
+// - the values of a slot only grow.
+// A reader, which sees a slot breaking one of these rules, has read a
+// torn slot. Returns 1, if a torn slot was read.
+//
+// Usage: CounterExportStressTest [seconds] [readers]
+
+#include "pch.h"
+#include "CounterExport.h"
+
+// Not the name of the application's area, so the test can run while
+// TaskManager is running.
+#define TEST_AREA_NAME		"TaskManager:Counters:Test"
+
+const int32 SLOT_COUNT		= 4;
+const int32 MAX_READERS		= 16;
+
+struct reader_result
+{
+	int64	reads;
+	int64	failedReads;		// ReadCounter() gave up
+	int64	tornReads;
+};
+
+static volatile int32 quit = 0;
+static int32 slots[SLOT_COUNT];
+static reader_result results[MAX_READERS];
+
+static int32 writer_thread(void *data)
+{
+	CCounterExport *counterExport = CCounterExport::Instance();
+
+	int64 *published = (int64 *)data;
+
+	for(int64 counter=1 ; atomic_get((int32 *)&quit) == 0 ; counter++) {
+		counter_export_value value;
+
+		double v = (double)counter;
+
+		value.timeStamp	= counter+1;
+		value.value		= v;
+		value.min		= v;
+		value.max		= v;
+		value.avg		= v;
+		value.valid		= (counter & 1) != 0;
+
+		counterExport->Publish(slots[counter % SLOT_COUNT], value);
+
+		*published = counter;
+	}
+
+	return 0;
+}
+
+static int32 reader_thread(void *data)
+{
+	reader_result *result = (reader_result *)data;
+
+	CCounterExportReader reader;
+
+	if(reader.Attach(TEST_AREA_NAME) != B_OK) {
+		result->tornReads = -1;
+		return 0;
+	}
+
+	double last[SLOT_COUNT];
+
+	for(int32 i=0 ; i<SLOT_COUNT ; i++)
+		last[i] = 0.0;
+
+	while(atomic_get((int32 *)&quit) == 0) {
+		for(int32 i=0 ; i<SLOT_COUNT ; i++) {
+			counter_export_value value;
+
+			result->reads++;
+
+			if(!reader.ReadCounter(slots[i], value)) {
+				result->failedReads++;
+				continue;
+			}
+
+			// Nothing published yet.
+			if(value.value == 0.0)
+				continue;
+
+			bool torn = value.min != value.value || value.max != value.value ||
+				value.avg != value.value ||
+				value.timeStamp != (bigtime_t)value.value + 1 ||
+				value.valid != ((((int64)value.value) & 1) != 0) ||
+				value.value < last[i];
+
+			if(torn)
+				result->tornReads++;
+
+			last[i] = value.value;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int32 seconds = 5;
+	int32 readers = 4;
+
+	if(argc > 1)
+		seconds = MAX(atol(argv[1]), 1);
+
+	if(argc > 2)
+		readers = MIN(MAX(atol(argv[2]), 1), MAX_READERS);
+
+	CCounterExport *counterExport = CCounterExport::CreateInstance(TEST_AREA_NAME);
+
+	if(counterExport->InitCheck() != B_OK) {
+		fprintf(stderr, "Can't create the counter export: %s\n",
+			strerror(counterExport->InitCheck()));
+		return 1;
+	}
+
+	char path[64];
+
+	for(int32 i=0 ; i<SLOT_COUNT ; i++) {
+		sprintf(path, "/Test/Counter %ld", (long)i);
+		slots[i] = counterExport->Register(path);
+	}
+
+	int64 published = 0;
+	thread_id threads[MAX_READERS+1];
+
+	threads[0] = spawn_thread(writer_thread, "writer", B_NORMAL_PRIORITY, &published);
+
+	for(int32 i=0 ; i<readers ; i++) {
+		memset(&results[i], 0, sizeof(reader_result));
+		threads[i+1] = spawn_thread(reader_thread, "reader", B_NORMAL_PRIORITY, &results[i]);
+	}
+
+	for(int32 i=0 ; i<=readers ; i++)
+		resume_thread(threads[i]);
+
+	snooze((bigtime_t)seconds * 1000000);
+
+	atomic_set((int32 *)&quit, 1);
+
+	for(int32 i=0 ; i<=readers ; i++) {
+		status_t exitValue;
+		wait_for_thread(threads[i], &exitValue);
+	}
+
+	int64 reads = 0, failedReads = 0, tornReads = 0;
+	bool attached = true;
+
+	for(int32 i=0 ; i<readers ; i++) {
+		if(results[i].tornReads < 0) {
+			attached = false;
+			continue;
+		}
+
+		reads		+= results[i].reads;
+		failedReads	+= results[i].failedReads;
+		tornReads	+= results[i].tornReads;
+	}
+
+	printf("%lld values published, %lld reads by %ld readers: %lld gave up, %lld torn\n",
+		(long long)published, (long long)reads, (long)readers,
+		(long long)failedReads, (long long)tornReads);
+
+	if(!attached) {
+		fprintf(stderr, "A reader couldn't attach to the area.\n");
+		return 1;
+	}
+
+	return tornReads > 0 ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that CSampleNormalizer turns the deltas of a relative counter
+// into exact rates, even if the ticks are jittered:
+// - the time between two ticks varies by up to +/- 'jitter' percent.
+// - some ticks get the same (cached) reading twice.
+// The counter grows at a constant rate, so every rate must be equal
+// to that rate. Returns 1, if a rate is off.
+//
+// Usage: SampleNormalizerTest [ticks] [jitter in percent]
+
+#include "pch.h"
+#include "DataProvider.h"
+#include "SamplingContext.h"
+
+//: Relative counter, which grows by 'rate' per microsecond.
+// The time of the readings is simulated, so the test doesn't depend
+// on the scheduling of the test itself.
+class CJitterDataProvider : public IDataProvider, public ISampledDataProvider
+{
+	public:
+	CJitterDataProvider(double rate, uint32 flags);
+
+	// Sets the time of the next reading. If 'cached' is true, the next
+	// sample returns the last reading again.
+	void Tick(bigtime_t time, bool cached);
+
+	virtual bool GetNextSample(data_sample &sample);
+	virtual bool GetNextValue(float &value);
+	virtual uint32 Flags() { return flags; }
+	virtual uint32 Unit() { return DP_UNIT_NONE; }
+	virtual BString DisplayName() { return "Jitter"; }
+	virtual IDataProvider *Clone() { return new CJitterDataProvider(rate, flags); }
+	virtual bool Equal(IDataProvider *other) { return false; }
+
+	protected:
+	double		rate;
+	uint32		flags;
+	bigtime_t	now;
+	bigtime_t	readTime;
+	double		lastCounter;
+	double		lastDelta;
+	bool		cached;
+};
+
+CJitterDataProvider::CJitterDataProvider(double _rate, uint32 _flags)
+{
+	rate		= _rate;
+	flags		= _flags;
+	now			= 0;
+	readTime	= 0;
+	lastCounter	= 0.0;
+	lastDelta	= 0.0;
+	cached		= false;
+}
+
+void CJitterDataProvider::Tick(bigtime_t time, bool _cached)
+{
+	now		= time;
+	cached	= _cached;
+}
+
+bool CJitterDataProvider::GetNextSample(data_sample &sample)
+{
+	if(!cached || readTime == 0) {
+		double counter = rate * now;
+
+		lastDelta	= counter - lastCounter;
+		lastCounter	= counter;
+		readTime	= now;
+	}
+
+	sample.value	 = lastDelta;
+	sample.timeStamp = readTime;
+
+	return true;
+}
+
+bool CJitterDataProvider::GetNextValue(float &value)
+{
+	data_sample sample;
+
+	bool valid = GetNextSample(sample);
+
+	value = sample.value;
+
+	return valid;
+}
+
+// Simple LCG, so every run uses the same ticks.
+static uint32 next_random(uint32 &seed)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) & 0x7fff;
+}
+
+static int32 run(const char *name, uint32 flags, double rate, int32 ticks,
+	int32 jitter, bigtime_t interval)
+{
+	CJitterDataProvider provider(rate, flags);
+	CSampleNormalizer normalizer;
+
+	double expected = (flags & IDataProvider::DP_TYPE_PERCENT) ? rate * 100.0 : rate;
+	double maxError = 0.0;
+	int32 errors = 0;
+	uint32 seed = 42;
+	bigtime_t time = 1000000;
+
+	for(int32 i=0 ; i<ticks ; i++) {
+		int32 offset = (int32)(next_random(seed) % (2 * jitter + 1)) - jitter;
+		// The first two readings are fresh, so a repeated reading always
+		// repeats a checked rate.
+		bool cached = (next_random(seed) % 8) == 0 && i >= 2;
+
+		time += interval + interval * offset / 100;
+
+		provider.Tick(time, cached);
+
+		data_sample sample;
+		double value;
+
+		bool valid = get_next_sample(&provider, sample);
+
+		if(!normalizer.Normalize(&provider, sample, valid, interval, value))
+			continue;
+
+		// The first sample has no previous reading. Its delta is the
+		// counter since time 0, so it's only checked for relative values
+		// after it.
+		if(i == 0)
+			continue;
+
+		double error = fabs(value - expected) / expected;
+
+		if(error > maxError)
+			maxError = error;
+
+		if(error > 1e-9)
+			errors++;
+	}
+
+	printf("%-8s %6ld ticks, jitter %3ld%%: %ld wrong rates, max error %g\n",
+		name, (long)ticks, (long)jitter, (long)errors, maxError);
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int32 ticks = 10000;
+	int32 jitter = 50;
+	bigtime_t interval = 100000;
+
+	if(argc > 1)
+		ticks = MAX(atol(argv[1]), 2);
+
+	if(argc > 2)
+		jitter = MIN(MAX(atol(argv[2]), 0), 99);
+
+	int32 errors = 0;
+
+	// CPU time: 0.37 us per us, shown in percent.
+	errors += run("percent", IDataProvider::DP_TYPE_RELATIVE | IDataProvider::DP_TYPE_PERCENT,
+		0.37, ticks, jitter, interval);
+	// Bytes: 12345.678 bytes per us.
+	errors += run("relative", IDataProvider::DP_TYPE_RELATIVE,
+		12345.678, ticks, jitter, interval);
+
+	return errors > 0 ? 1 : 0;
+}
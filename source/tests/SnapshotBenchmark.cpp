@@ -0,0 +1,180 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long a window thread holds its lock per tick to get
+// the system snapshot:
+// - "sync":  the snapshot is built in the window thread, as it was
+//            done before the sampler thread existed.
+// - "cache": the snapshot is acquired from CSnapshotCache, which
+//            builds it in its sampler thread.
+// It also prints the share of teams, whose area size was copied from
+// the previous snapshot instead of walking their areas.
+//
+// Usage: SnapshotBenchmark [teams] [ticks] [tick interval in ms]
+
+#include "pch.h"
+#include "SystemSnapshot.h"
+#include "SyntheticDataSource.h"
+
+struct hold_stats {
+	bigtime_t	mean;
+	bigtime_t	p99;
+	bigtime_t	max;
+	int32		misses;				// ticks without snapshot
+	int64		teams;				// teams of all snapshots
+	int64		skippedAreaWalks;	// teams whose area size was copied
+};
+
+static int compare_times(const void *a, const void *b)
+{
+	bigtime_t ta = *(const bigtime_t *)a;
+	bigtime_t tb = *(const bigtime_t *)b;
+
+	return (ta < tb) ? -1 : ((ta > tb) ? 1 : 0);
+}
+
+static void compute_stats(bigtime_t *times, int32 count, hold_stats &stats)
+{
+	qsort(times, count, sizeof(bigtime_t), compare_times);
+
+	bigtime_t sum = 0;
+
+	for(int32 i=0 ; i<count ; i++)
+		sum += times[i];
+
+	stats.mean	= count > 0 ? sum / count : 0;
+	stats.p99	= count > 0 ? times[(count-1) * 99 / 100] : 0;
+	stats.max	= count > 0 ? times[count-1] : 0;
+}
+
+static void run_sync(int32 teamCount, int32 ticks, bigtime_t interval, hold_stats &stats)
+{
+	BLocker windowLocker("window");
+	CSyntheticDataSource source(teamCount, 0.01, 0.1);
+	CSystemSnapshot snapshots[2];
+	bigtime_t *times = new bigtime_t[ticks];
+
+	stats.misses			= 0;
+	stats.teams				= 0;
+	stats.skippedAreaWalks	= 0;
+
+	for(int32 i=0 ; i<ticks ; i++) {
+		CSystemSnapshot *snapshot = &snapshots[i % 2];
+		CSystemSnapshot *previous = i > 0 ? &snapshots[(i+1) % 2] : NULL;
+
+		bigtime_t start = system_time();
+
+		windowLocker.Lock();
+
+		if(snapshot->Build(&source, SNAPSHOT_ALL, previous) != B_OK)
+			stats.misses++;
+
+		windowLocker.Unlock();
+
+		stats.teams				+= snapshot->CountTeams();
+		stats.skippedAreaWalks	+= snapshot->CountSkippedAreaWalks();
+
+		times[i] = system_time() - start;
+
+		snooze(interval);
+	}
+
+	compute_stats(times, ticks, stats);
+
+	delete [] times;
+}
+
+static void run_cache(int32 teamCount, int32 ticks, bigtime_t interval, hold_stats &stats)
+{
+	BLocker windowLocker("window");
+	CSnapshotCache *cache = CSnapshotCache::CreateInstance();
+	bigtime_t *times = new bigtime_t[ticks];
+
+	cache->SetDataSource(new CSyntheticDataSource(teamCount, 0.01, 0.1));
+
+	stats.misses			= 0;
+	stats.teams				= 0;
+	stats.skippedAreaWalks	= 0;
+
+	for(int32 i=0 ; i<ticks ; i++) {
+		bigtime_t start = system_time();
+
+		windowLocker.Lock();
+
+		const CSystemSnapshot *snapshot = cache->Acquire(SNAPSHOT_ALL);
+
+		if(snapshot != NULL) {
+			stats.teams				+= snapshot->CountTeams();
+			stats.skippedAreaWalks	+= snapshot->CountSkippedAreaWalks();
+
+			cache->Release(snapshot);
+		} else {
+			stats.misses++;
+		}
+
+		windowLocker.Unlock();
+
+		times[i] = system_time() - start;
+
+		snooze(interval);
+	}
+
+	compute_stats(times, ticks, stats);
+
+	delete [] times;
+}
+
+static void print_stats(const char *mode, int32 teamCount, const hold_stats &stats)
+{
+	// Teams, whose area size was copied from the previous snapshot.
+	int32 skipped = stats.teams > 0 ? (int32)(stats.skippedAreaWalks * 100 / stats.teams) : 0;
+
+	printf("%-6s %6ld teams: lock held mean %7Ld us, p99 %7Ld us, max %7Ld us, "
+		"%ld ticks without snapshot, %3ld%% area walks skipped\n", mode, (long)teamCount,
+		stats.mean, stats.p99, stats.max, (long)stats.misses, (long)skipped);
+}
+
+int main(int argc, char **argv)
+{
+	int32 teamCounts[] = { 1000, 10000 };
+	int32 countCount = sizeof(teamCounts) / sizeof(teamCounts[0]);
+	int32 ticks = 100;
+	bigtime_t interval = 10000;
+
+	if(argc > 1) {
+		teamCounts[0] = atol(argv[1]);
+		countCount = 1;
+	}
+
+	if(argc > 2)
+		ticks = MAX(atol(argv[2]), 1);
+
+	if(argc > 3)
+		interval = atoll(argv[3]) * 1000;
+
+	for(int32 i=0 ; i<countCount ; i++) {
+		hold_stats stats;
+
+		run_sync(teamCounts[i], ticks, interval, stats);
+		print_stats("sync", teamCounts[i], stats);
+
+		run_cache(teamCounts[i], ticks, interval, stats);
+		print_stats("cache", teamCounts[i], stats);
+	}
+
+	return 0;
+}
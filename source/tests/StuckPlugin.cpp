@@ -0,0 +1,109 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Plugin, which hangs. It's loaded into a plugin host by
+// StuckPluginTest.
+// - The root has one counter "Stuck". Its data provider delivers
+//   STUCK_SAMPLE_COUNT values and hangs in GetNextValue() then.
+// - Enumerating any other path than the root hangs.
+
+#include "pch.h"
+#include "DataProvider.h"
+#include "PerformanceCounter.h"
+
+// Values delivered before GetNextValue() hangs (by all clones).
+const int32 STUCK_SAMPLE_COUNT	= 8;
+// Much longer than any deadline. The host is killed before.
+const bigtime_t STUCK_TIME		= 60000000;		// 60 s
+
+static int32 sampleCount = 0;
+
+class CStuckDataProvider : public IDataProvider
+{
+	public:
+	virtual bool GetNextValue(float &value)
+	{
+		if(atomic_add(&sampleCount, 1) >= STUCK_SAMPLE_COUNT)
+			snooze(STUCK_TIME);
+
+		value = 1.0;
+		return true;
+	}
+
+	virtual uint32 Flags() { return DP_TYPE_ABSOLUTE; }
+	virtual uint32 Unit() { return DP_UNIT_NONE; }
+	virtual BString DisplayName() { return "Stuck"; }
+	virtual IDataProvider *Clone() { return new CStuckDataProvider(); }
+	virtual bool Equal(IDataProvider *other) { return dynamic_cast<CStuckDataProvider *>(other) != NULL; }
+};
+
+class CStuckCounter : public IPerformanceCounter
+{
+	public:
+	CStuckCounter(IPerformanceCounterNamespace *ns, IPerformanceCounterPlugin *_plugin)
+	{
+		namesp	= ns;
+		plugin	= _plugin;
+	}
+
+	// The children are enumerated by the plugin, which hangs.
+	virtual int32 CountChildren()
+	{
+		BList children;
+
+		plugin->EnumChildren(namesp, Path(), &children);
+
+		return 0;
+	}
+
+	virtual IPerformanceCounter *ChildAt(int32 i) { return NULL; }
+	virtual IDataProvider *DataProvider() { return &dataProvider; }
+	virtual const char *Name() const { return "Stuck"; }
+	virtual const char *Path() const { return "/Stuck"; }
+	virtual const char *InternalName() const { return "Stuck"; }
+
+	protected:
+	IPerformanceCounterNamespace	*namesp;
+	IPerformanceCounterPlugin		*plugin;
+	CStuckDataProvider				 dataProvider;
+};
+
+class CStuckPlugin : public IPerformanceCounterPlugin
+{
+	public:
+	virtual status_t EnumChildren(IPerformanceCounterNamespace *counterNamespace,
+		const char *path, BList *children)
+	{
+		if(strcmp(path, "/") != 0) {
+			snooze(STUCK_TIME);
+			return B_OK;
+		}
+
+		children->AddItem(new CStuckCounter(counterNamespace, this));
+
+		return B_OK;
+	}
+};
+
+extern "C" status_t __declspec(dllexport) CreateCounterPlugin(IPerformanceCounterPlugin **plugin);
+
+status_t __declspec(dllexport) CreateCounterPlugin(IPerformanceCounterPlugin **plugin)
+{
+	*plugin = new CStuckPlugin();
+
+	return B_OK;
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that a plugin, which hangs in its plugin host, doesn't block
+// TaskManager. StuckPlugin is loaded by a TaskManagerPluginHost next
+// to the test (both are built by the Makefile) and driven through
+// CRemotePlugin:
+// - the root counters are enumerated.
+// - the "Stuck" counter is sampled, until its data provider hangs in
+//   the host. The samples must go invalid then.
+// - the children of "Stuck" are counted. The plugin hangs, so there
+//   must be none and later requests must be refused.
+// - the plugin is deleted, which kills the host.
+// No call may take as long as the deadline. Returns 1, if one did or
+// the samples didn't go invalid.
+//
+// Usage: StuckPluginTest [deadline in ms]
+
+#include "pch.h"
+#include "common.h"
+#include "alert.h"
+#include "help.h"
+#include "RemotePlugin.h"
+
+// The host needs much less to start, but it's a new team.
+const bigtime_t START_TIMEOUT	= 10000000;		// 10 s
+// StuckPlugin hangs after 8 samples, which take 2 s.
+const bigtime_t SAMPLE_TIMEOUT	= 15000000;		// 15 s
+const bigtime_t POLL_INTERVAL	= 50000;		// 50 ms
+
+static bigtime_t deadline = PLUGIN_HOST_DEFAULT_DEADLINE;
+static bigtime_t longestCall = 0;
+static int32 blockedCalls = 0;
+
+// RemotePlugin.cpp looks for the plugin host next to the
+// application. That's the directory of the test.
+BPath get_app_dir()
+{
+	image_info info;
+	int32 cookie = 0;
+
+	while(get_next_image_info(B_CURRENT_TEAM, &cookie, &info) == B_OK) {
+		if(info.type == B_APP_IMAGE) {
+			BPath appDir;
+
+			BPath(info.name).GetParent(&appDir);
+
+			return appDir;
+		}
+	}
+
+	return BPath(".");
+}
+
+status_t show_alert_async(const char *text, BHandler *target, const char *title, alert_type type)
+{
+	fprintf(stderr, "%s\n", text);
+
+	return B_OK;
+}
+
+status_t show_alert_async(const BString &string, BHandler *target, const char *title, alert_type type)
+{
+	return show_alert_async(string.String(), target, title, type);
+}
+
+// check_call
+// Records the duration of a call, which started at 'start'.
+static void check_call(const char *name, bigtime_t start)
+{
+	bigtime_t duration = system_time() - start;
+
+	longestCall = MAX(longestCall, duration);
+
+	if(duration >= deadline) {
+		printf("%s blocked for %Ld ms\n", name, duration/1000);
+		blockedCalls++;
+	}
+}
+
+// enum_roots
+// Returns the "Stuck" counter or NULL, if the host didn't
+// answer the enumeration in time.
+static IPerformanceCounter *enum_roots(CRemotePlugin *plugin, BList *roots)
+{
+	bigtime_t end = system_time() + START_TIMEOUT;
+
+	while(system_time() < end) {
+		bigtime_t start = system_time();
+		status_t status = plugin->GetChildren(NULL, "/", roots);
+
+		check_call("GetChildren(\"/\")", start);
+
+		if(status == B_OK)
+			break;
+
+		snooze(POLL_INTERVAL);
+	}
+
+	for(int32 i=0 ; i<roots->CountItems() ; i++) {
+		IPerformanceCounter *counter = (IPerformanceCounter *)roots->ItemAt(i);
+
+		if(strcmp(counter->Name(), "Stuck") == 0)
+			return counter;
+	}
+
+	return NULL;
+}
+
+// sample_until_stuck
+// Samples 'provider', until it delivered valid samples and stayed
+// invalid for twice the deadline. Returns false, if that didn't
+// happen within SAMPLE_TIMEOUT.
+static bool sample_until_stuck(IDataProvider *provider)
+{
+	bigtime_t end = system_time() + SAMPLE_TIMEOUT;
+	bigtime_t lastValid = 0;
+	int32 validSamples = 0;
+
+	while(system_time() < end) {
+		data_sample sample;
+
+		bigtime_t start = system_time();
+		bool valid = get_next_sample(provider, sample);
+
+		check_call("GetNextSample()", start);
+
+		if(valid) {
+			validSamples++;
+			lastValid = system_time();
+		} else if(validSamples > 0 && system_time() - lastValid > 2*deadline) {
+			printf("%ld valid samples, invalid for %Ld ms\n",
+				(long)validSamples, (system_time() - lastValid)/1000);
+			return true;
+		}
+
+		snooze(POLL_INTERVAL);
+	}
+
+	printf("%ld valid samples, %s\n", (long)validSamples,
+		validSamples > 0 ? "still valid" : "none");
+
+	return false;
+}
+
+// count_stuck_children
+// Counts the children of 'counter' for three times the deadline.
+// Returns false, if any children appear or the enumeration wasn't
+// abandoned.
+static bool count_stuck_children(CRemotePlugin *plugin, IPerformanceCounter *counter)
+{
+	bigtime_t end = system_time() + 3*deadline;
+	bool noChildren = true;
+
+	while(system_time() < end) {
+		bigtime_t start = system_time();
+		int32 count = counter->CountChildren();
+
+		check_call("CountChildren()", start);
+
+		if(count > 0)
+			noChildren = false;
+
+		snooze(POLL_INTERVAL);
+	}
+
+	// The host still hangs in the first enumeration.
+	BMessage request(PLUGIN_HOST_ENUM_CHILDREN);
+
+	request.AddString(PLUGIN_HOST_PATH, "/");
+
+	bigtime_t start = system_time();
+	int32 serial = plugin->SendRequest(&request);
+
+	check_call("SendRequest()", start);
+
+	printf("children: %s, next request: %s\n", noChildren ? "none" : "found",
+		serial == B_TIMED_OUT ? "refused" : "sent");
+
+	return noChildren && serial == B_TIMED_OUT;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1)
+		deadline = MAX(atol(argv[1]), 1) * 1000LL;
+
+	// Samples are written every FAST_PULSE_RATE/2 by the host and
+	// drained as often. A shorter deadline invalidates them in between.
+	if(deadline < FAST_PULSE_RATE*2) {
+		fprintf(stderr, "The deadline must be at least %Ld ms.\n", FAST_PULSE_RATE*2/1000);
+		return 1;
+	}
+
+	BPath pluginPath = get_app_dir();
+
+	pluginPath.Append("StuckPlugin");
+
+	CPushSourceHost pushHost;
+	CRemotePlugin *plugin = new CRemotePlugin(pluginPath.Path(), deadline, &pushHost);
+
+	status_t status = plugin->Start();
+
+	if(status != B_OK) {
+		fprintf(stderr, "Can't start the plugin host: %s\n", strerror(status));
+		delete plugin;
+		return 1;
+	}
+
+	BList roots;
+	IPerformanceCounter *counter = enum_roots(plugin, &roots);
+
+	bool passed = false;
+
+	if(counter == NULL || counter->DataProvider() == NULL) {
+		fprintf(stderr, "The plugin host didn't enumerate the counters of %s.\n",
+			pluginPath.Path());
+	} else {
+		bool stuck = sample_until_stuck(counter->DataProvider());
+
+		passed = count_stuck_children(plugin, counter) && stuck;
+	}
+
+	for(int32 i=0 ; i<roots.CountItems() ; i++)
+		delete (IPerformanceCounter *)roots.ItemAt(i);
+
+	// The host doesn't quit, so it's killed after the deadline.
+	bigtime_t start = system_time();
+
+	delete plugin;
+
+	bigtime_t quitTime = system_time() - start;
+
+	printf("longest call %Ld ms, host quit after %Ld ms (deadline %Ld ms)\n",
+		longestCall/1000, quitTime/1000, deadline/1000);
+
+	if(quitTime >= 2*deadline)
+		passed = false;
+
+	return (passed && blockedCalls == 0) ? 0 : 1;
+}
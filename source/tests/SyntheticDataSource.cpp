@@ -0,0 +1,260 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pch.h"
+#include "SyntheticDataSource.h"
+
+const int32 CSyntheticDataSource::CPU_COUNT = 4;
+const int32 CSyntheticDataSource::EXECUTABLE_COUNT = 32;
+
+// CPU time used by each CPU per tick at most.
+const bigtime_t SYNTHETIC_TICK = 100000;
+
+CSyntheticDataSource::CSyntheticDataSource(int32 _teamCount, float _churn, float _active,
+	int32 _threadsPerTeam, int32 _areasPerTeam)
+{
+	teamCount		= _teamCount;
+	churn			= _churn;
+	active			= _active;
+	threadsPerTeam	= _threadsPerTeam;
+	areasPerTeam	= _areasPerTeam;
+	nextTeamId		= 1000;
+	tickCount		= 0;
+	replacedCount	= 0;
+	lastFound		= 0;
+	randomState		= 12345;
+
+	for(int32 i=0 ; i<CPU_COUNT ; i++)
+		cpuTimes[i] = 0;
+
+	teams = new synthetic_team[teamCount];
+
+	for(int32 i=0 ; i<teamCount ; i++)
+		NewTeam(i);
+}
+
+CSyntheticDataSource::~CSyntheticDataSource()
+{
+	delete [] teams;
+}
+
+// Random
+// Small linear congruential generator, so all runs see the same system.
+uint32 CSyntheticDataSource::Random()
+{
+	randomState = randomState * 1103515245 + 12345;
+
+	return randomState >> 8;
+}
+
+// NewTeam
+// Starts a new team in slot 'index'. Its parent is one of the teams
+// started before it, so the teams form a tree.
+void CSyntheticDataSource::NewTeam(int32 index)
+{
+	synthetic_team &team = teams[index];
+
+	team.id			= nextTeamId++;
+	team.parent		= index > 0 ? teams[Random() % index].id : team.id;
+	team.cpuTime	= 0;
+	team.areaSize	= B_PAGE_SIZE * (1 + Random() % 64);
+}
+
+// Tick
+// Replaces the quitting teams and lets the active ones run. The new
+// teams are appended, as the kernel lists teams by ascending id.
+void CSyntheticDataSource::Tick()
+{
+	tickCount++;
+	replacedCount = (int32)(teamCount * churn);
+
+	// Mark the quitting teams. The root is never replaced, it's the
+	// parent of many teams.
+	for(int32 i=0 ; i<replacedCount ; i++)
+		teams[1 + Random() % MAX(teamCount-1, 1)].id = -1;
+
+	int32 count = 0;
+
+	for(int32 i=0 ; i<teamCount ; i++) {
+		if(teams[i].id != -1)
+			teams[count++] = teams[i];
+	}
+
+	replacedCount = teamCount - count;
+
+	while(count < teamCount)
+		NewTeam(count++);
+
+	int32 activeCount = (int32)(teamCount * active);
+
+	for(int32 i=0 ; i<activeCount ; i++) {
+		synthetic_team &team = teams[Random() % teamCount];
+
+		team.cpuTime  += 1 + Random() % 1000;
+		team.areaSize += B_PAGE_SIZE;
+	}
+
+	for(int32 i=0 ; i<CPU_COUNT ; i++)
+		cpuTimes[i] += Random() % SYNTHETIC_TICK;
+}
+
+// FindTeam
+// The snapshot builder asks for the threads and areas of the team
+// it just got, so the last index is tried first.
+int32 CSyntheticDataSource::FindTeam(team_id id)
+{
+	if(lastFound < teamCount && teams[lastFound].id == id)
+		return lastFound;
+
+	// The team ids are sorted.
+	int32 low = 0, high = teamCount-1;
+
+	while(low <= high) {
+		int32 mid = (low + high) / 2;
+
+		if(teams[mid].id == id)
+			return lastFound = mid;
+
+		if(teams[mid].id < id)
+			low = mid+1;
+		else
+			high = mid-1;
+	}
+
+	return -1;
+}
+
+// SystemTime
+// The real time, because CSnapshotCache compares the time stamps of
+// the snapshots with system_time().
+bigtime_t CSyntheticDataSource::SystemTime()
+{
+	return system_time();
+}
+
+status_t CSyntheticDataSource::GetSystemInfo(system_info *info)
+{
+	Tick();
+
+	memset(info, 0, sizeof(system_info));
+
+	info->cpu_count	 = CPU_COUNT;
+	info->used_teams = teamCount;
+	info->max_teams	 = teamCount*2;
+
+	return B_OK;
+}
+
+status_t CSyntheticDataSource::GetCPUInfo(uint32 cpuCount, cpu_info *info)
+{
+	for(uint32 i=0 ; i<cpuCount && i<(uint32)CPU_COUNT ; i++)
+		info[i].active_time = cpuTimes[i];
+
+	return B_OK;
+}
+
+status_t CSyntheticDataSource::GetNextTeamInfo(int32 *cookie, team_info *info)
+{
+	if(*cookie < 0 || *cookie >= teamCount)
+		return B_BAD_VALUE;
+
+	const synthetic_team &team = teams[(*cookie)++];
+
+	memset(info, 0, sizeof(team_info));
+
+	info->team			= team.id;
+	info->parent		= team.parent;
+	info->thread_count	= threadsPerTeam;
+	info->area_count	= areasPerTeam;
+	info->image_count	= 1;
+
+	sprintf(info->args, "team_%ld", (long)team.id);
+
+	return B_OK;
+}
+
+status_t CSyntheticDataSource::GetNextThreadInfo(team_id id, int32 *cookie, thread_info *info)
+{
+	int32 index = FindTeam(id);
+
+	if(index < 0)
+		return B_BAD_TEAM_ID;
+
+	if(*cookie < 0 || *cookie >= threadsPerTeam)
+		return B_BAD_VALUE;
+
+	memset(info, 0, sizeof(thread_info));
+
+	info->thread		= id * 16 + *cookie;
+	info->team			= id;
+	info->state			= B_THREAD_ASLEEP;
+	info->priority		= B_NORMAL_PRIORITY;
+	info->user_time		= teams[index].cpuTime;
+	info->kernel_time	= teams[index].cpuTime / 2;
+
+	sprintf(info->name, "thread_%ld", (long)*cookie);
+
+	(*cookie)++;
+
+	return B_OK;
+}
+
+status_t CSyntheticDataSource::GetNextAreaInfo(team_id id, ssize_t *cookie, area_info *info)
+{
+	int32 index = FindTeam(id);
+
+	if(index < 0)
+		return B_BAD_TEAM_ID;
+
+	if(*cookie < 0 || *cookie >= areasPerTeam)
+		return B_BAD_VALUE;
+
+	memset(info, 0, sizeof(area_info));
+
+	info->area		= id * 16 + *cookie;
+	info->team		= id;
+	info->size		= teams[index].areaSize;
+	info->ram_size	= teams[index].areaSize;
+
+	(*cookie)++;
+
+	return B_OK;
+}
+
+status_t CSyntheticDataSource::GetNextImageInfo(team_id id, int32 *cookie, image_info *info)
+{
+	if(FindTeam(id) < 0)
+		return B_BAD_TEAM_ID;
+
+	if(*cookie != 0)
+		return B_BAD_VALUE;
+
+	int32 executable = id % EXECUTABLE_COUNT;
+
+	memset(info, 0, sizeof(image_info));
+
+	info->id		= id * 16;
+	info->type		= B_APP_IMAGE;
+	info->device	= 1;
+	info->node		= executable + 1;
+
+	sprintf(info->name, "/boot/synthetic/executable_%ld", (long)executable);
+
+	(*cookie)++;
+
+	return B_OK;
+}
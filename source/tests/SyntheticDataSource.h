@@ -0,0 +1,81 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SYNTHETIC_DATA_SOURCE_H
+#define SYNTHETIC_DATA_SOURCE_H
+
+#include "SystemSnapshot.h"
+
+//: ISystemDataSource feeding a synthetic system.
+// Every call of GetSystemInfo() (once per CSystemSnapshot::Build())
+// advances the system by one tick: a 'churn' fraction of the teams
+// quits and is replaced by new teams with higher ids, and an 'active'
+// fraction of the teams uses CPU time. Team ids start at 1000, so they
+// never collide with B_SYSTEM_TEAM. Each team has a single app image,
+// one of EXECUTABLE_COUNT executables. The source is deterministic.
+class CSyntheticDataSource : public ISystemDataSource
+{
+	public:
+	CSyntheticDataSource(int32 teamCount, float churn, float active,
+		int32 threadsPerTeam=4, int32 areasPerTeam=8);
+	virtual ~CSyntheticDataSource();
+
+	virtual bigtime_t SystemTime();
+	virtual status_t GetSystemInfo(system_info *info);
+	virtual status_t GetCPUInfo(uint32 cpuCount, cpu_info *info);
+	virtual status_t GetNextTeamInfo(int32 *cookie, team_info *info);
+	virtual status_t GetNextThreadInfo(team_id team, int32 *cookie, thread_info *info);
+	virtual status_t GetNextAreaInfo(team_id team, ssize_t *cookie, area_info *info);
+	virtual status_t GetNextImageInfo(team_id team, int32 *cookie, image_info *info);
+
+	int32 CountTeams() const	{ return teamCount; }
+	int32 CountTicks() const	{ return tickCount; }
+
+	// Number of teams which quit (and were started) during the last tick.
+	int32 CountReplaced() const	{ return replacedCount; }
+
+	static const int32 CPU_COUNT;
+	static const int32 EXECUTABLE_COUNT;	// distinct app images
+
+	protected:
+	struct synthetic_team {
+		team_id		id;
+		team_id		parent;
+		bigtime_t	cpuTime;			// per thread
+		size_t		areaSize;			// per area
+	};
+
+	void Tick();
+	void NewTeam(int32 index);
+	int32 FindTeam(team_id id);
+	uint32 Random();
+
+	synthetic_team	*teams;
+	int32			 teamCount;
+	int32			 threadsPerTeam;
+	int32			 areasPerTeam;
+	float			 churn;
+	float			 active;
+	team_id			 nextTeamId;
+	int32			 tickCount;
+	int32			 replacedCount;
+	int32			 lastFound;			// index of the team found last
+	uint32			 randomState;
+	bigtime_t		 cpuTimes[4];
+};
+
+#endif // SYNTHETIC_DATA_SOURCE_H
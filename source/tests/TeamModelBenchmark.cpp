@@ -0,0 +1,101 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long CTeamModel::Update() takes per tick for a large
+// number of teams, of which a 'churn' fraction quits and is replaced
+// by new teams every tick. The snapshots are built outside of the
+// measured time.
+//
+// Usage: TeamModelBenchmark [churn in percent] [ticks] [teams]
+
+#include "pch.h"
+#include "SystemSnapshot.h"
+#include "TeamModel.h"
+#include "SyntheticDataSource.h"
+
+static void run(int32 teamCount, float churn, int32 ticks)
+{
+	BLooper *looper = new BLooper("TeamModelBenchmark");
+
+	looper->Lock();
+
+	CTeamModel *model = new CTeamModel(looper);
+	CSyntheticDataSource source(teamCount, churn, 0.1);
+	CSystemSnapshot snapshots[2];
+
+	bigtime_t total = 0, max = 0, initial = 0;
+	int32 replaced = 0;
+
+	for(int32 i=0 ; i<=ticks ; i++) {
+		CSystemSnapshot *snapshot = &snapshots[i % 2];
+		CSystemSnapshot *previous = i > 0 ? &snapshots[(i+1) % 2] : NULL;
+
+		if(snapshot->Build(&source, SNAPSHOT_ALL, previous) != B_OK) {
+			printf("Can't build snapshot.\n");
+			break;
+		}
+
+		bigtime_t start = system_time();
+
+		model->Update(snapshot);
+
+		bigtime_t time = system_time() - start;
+
+		if(i == 0) {
+			// first update adds all teams
+			initial = time;
+		} else {
+			total += time;
+			max = MAX(max, time);
+			replaced += source.CountReplaced();
+		}
+	}
+
+	printf("%6ld teams, %4.1f%% churn: initial %7Ld us, per tick mean %7Ld us, "
+		"max %7Ld us, %ld teams replaced per tick\n", (long)teamCount, churn*100,
+		initial, ticks > 0 ? total / ticks : 0, max,
+		(long)(ticks > 0 ? replaced / ticks : 0));
+
+	looper->RemoveHandler(model);
+	delete model;
+
+	looper->Quit();
+}
+
+int main(int argc, char **argv)
+{
+	int32 teamCounts[] = { 1000, 10000, 50000 };
+	int32 countCount = sizeof(teamCounts) / sizeof(teamCounts[0]);
+	float churn = 0.05;
+	int32 ticks = 20;
+
+	if(argc > 1)
+		churn = atof(argv[1]) / 100;
+
+	if(argc > 2)
+		ticks = MAX(atol(argv[2]), 1);
+
+	if(argc > 3) {
+		teamCounts[0] = atol(argv[3]);
+		countCount = 1;
+	}
+
+	for(int32 i=0 ; i<countCount ; i++)
+		run(teamCounts[i], churn, ticks);
+
+	return 0;
+}
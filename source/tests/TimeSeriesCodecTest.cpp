@@ -0,0 +1,330 @@
+/*
+ * Copyright 2000 by Thomas Krammer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that CTimeSeriesDecoder returns what CTimeSeriesEncoder was
+// given:
+// - deltas of deltas at the bounds of every range of the encoding.
+// - gaps, which don't fit into 32 bits. They are clamped, so the times
+//   must be the clamped times reported by the encoder.
+// - values, which fit into the bit window of the previous value. The
+//   size of the block shows, whether the window was reused.
+// - blocks filled until IsFull() by an encoder, which is reused by
+//   Reset(). A truncated block must not be read beyond its end.
+// Values are compared bit by bit. Returns 1, if a sample differs.
+//
+// Usage: TimeSeriesCodecTest [blocks]
+
+#include "pch.h"
+#include "TimeSeriesCodec.h"
+
+// A real time in milliseconds (2001).
+const int64 START_TIME			= 1000000000000LL;
+const int32 MAX_SAMPLES			= CTimeSeriesEncoder::BLOCK_DATA_SIZE * 8;
+
+struct codec_sample
+{
+	int64	time;
+	float	value;
+};
+
+static codec_sample samples[MAX_SAMPLES];
+
+// Simple LCG, so every run uses the same samples.
+static uint32 next_random(uint32 &seed)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) & 0x7fff;
+}
+
+static uint32 random_bits(uint32 &seed)
+{
+	return (next_random(seed) << 17) ^ (next_random(seed) << 2) ^ next_random(seed);
+}
+
+static float bits_float(uint32 bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static bool same_value(float a, float b)
+{
+	return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Encodes 'count' samples into 'encoder' (which must be empty) and
+// decodes them again. 'times' receives the times reported by the
+// encoder after each sample, which differ from the sample times only
+// after a clamped gap. Returns the number of wrong samples.
+static int32 round_trip(const char *name, CTimeSeriesEncoder &encoder,
+	const codec_sample *input, int32 count)
+{
+	static int64 times[MAX_SAMPLES];
+
+	int32 errors = 0;
+
+	for(int32 i=0 ; i<count ; i++) {
+		if(encoder.IsFull()) {
+			printf("%-12s block full after %ld of %ld samples\n", name, (long)i, (long)count);
+			return count - i;
+		}
+
+		encoder.Append(input[i].time, input[i].value);
+
+		times[i] = encoder.LastTime();
+	}
+
+	if(encoder.Size() > CTimeSeriesEncoder::BLOCK_DATA_SIZE || encoder.Count() != count)
+		errors++;
+
+	CTimeSeriesDecoder decoder(encoder.Data(), encoder.Size(), encoder.Count(),
+		encoder.FirstTime());
+
+	int64 time;
+	float value;
+
+	for(int32 i=0 ; i<count ; i++) {
+		if(!decoder.Next(time, value)) {
+			errors += count - i;
+			break;
+		}
+
+		if(time != times[i] || !same_value(value, input[i].value))
+			errors++;
+	}
+
+	// The decoder stops after 'count' samples.
+	if(decoder.Next(time, value))
+		errors++;
+
+	printf("%-12s %5ld samples in %4ld bytes: %ld wrong\n",
+		name, (long)count, (long)encoder.Size(), (long)errors);
+
+	return errors;
+}
+
+// Deltas of deltas at the bounds of all ranges, in both directions,
+// up to the largest one, which isn't clamped. Each one is followed by
+// its negation, so the delta stays positive.
+static int32 test_delta_ranges()
+{
+	static const int64 dods[] = {
+		1, -1, 63, 64, 65, -63, -64, 255, 256, 257, -255, -256, -257,
+		2047, 2048, 2049, -2047, -2048, -2049, 100000, 2147483647LL
+	};
+
+	const int32 dodCount = sizeof(dods)/sizeof(dods[0]);
+
+	CTimeSeriesEncoder encoder;
+
+	int64 time	= START_TIME;
+	int64 delta	= 5000;
+	int32 count	= 0;
+
+	samples[count].time		= time;
+	samples[count++].value	= 1.0;
+
+	time += delta;
+
+	samples[count].time		= time;
+	samples[count++].value	= 1.0;
+
+	for(int32 i=0 ; i<dodCount ; i++) {
+		for(int32 sign=1 ; sign>=-1 ; sign-=2) {
+			// A delta of delta of 0 between the pairs.
+			time += delta;
+			samples[count].time		= time;
+			samples[count++].value	= (float)i;
+
+			delta += sign * dods[i];
+			time  += delta;
+
+			samples[count].time		= time;
+			samples[count++].value	= (float)i;
+		}
+	}
+
+	// The times must be exact, as no gap exceeds 32 bits.
+	int32 errors = round_trip("dod ranges", encoder, samples, count);
+
+	for(int32 i=0 ; i<count ; i++) {
+		if(i > 0 && samples[i].time <= samples[i-1].time)
+			errors++;
+	}
+
+	if(encoder.LastTime() != samples[count-1].time)
+		errors++;
+
+	return errors;
+}
+
+// Gaps of more than 2^31 milliseconds (about 25 days) are clamped.
+static int32 test_clamp()
+{
+	CTimeSeriesEncoder encoder;
+
+	const int64 gap = 40LL*24*3600*1000;
+
+	int32 count = 0;
+
+	for(int32 i=0 ; i<8 ; i++) {
+		samples[count].time		= START_TIME + i * 1000;
+		samples[count++].value	= (float)i;
+	}
+
+	samples[count].time		= samples[count-1].time + gap;
+	samples[count++].value	= 100.0;
+
+	for(int32 i=0 ; i<8 ; i++) {
+		samples[count].time		= samples[count-1].time + 1000;
+		samples[count++].value	= (float)i;
+	}
+
+	int32 errors = round_trip("32 bit clamp", encoder, samples, count);
+
+	// The clamped time is behind the real one, but still ascending.
+	CTimeSeriesEncoder check;
+
+	for(int32 i=0 ; i<=8 ; i++)
+		check.Append(samples[i].time, samples[i].value);
+
+	if(check.LastTime() >= samples[8].time ||
+	   check.LastTime() != samples[7].time + 1000 + 2147483647LL)
+		errors++;
+
+	return errors;
+}
+
+// 1.0 and 1.5 differ in one bit, so all samples after the second one
+// reuse its window: a zero delta of delta (1 bit), a changed value
+// (1 bit), the window flag (1 bit) and the bit itself.
+static int32 test_window_reuse()
+{
+	CTimeSeriesEncoder encoder;
+
+	const int32 count = 200;
+
+	for(int32 i=0 ; i<count ; i++) {
+		samples[i].time		= START_TIME + i * 1000;
+		samples[i].value	= (i & 1) ? 1.5 : 1.0;
+	}
+
+	int32 errors = round_trip("window reuse", encoder, samples, count);
+
+	// first value, second sample (dod of 1000 and a new window), others
+	int32 bits = 32 + (4+12) + (2+5+5+1) + (count-2) * 4;
+
+	if(encoder.Size() != (size_t)(bits + 7) / 8)
+		errors++;
+
+	// A value, which doesn't fit into the window, followed by values
+	// which fit into the new one and values which are repeated.
+	uint32 seed = 7;
+
+	for(int32 i=0 ; i<count ; i++) {
+		samples[i].time = START_TIME + i * 1000;
+
+		switch(i % 4) {
+			case 0: samples[i].value = bits_float(random_bits(seed)); break;
+			case 1: samples[i].value = samples[i-1].value; break;
+			default: samples[i].value = bits_float(random_bits(seed) & 0x0000ff00); break;
+		}
+	}
+
+	encoder.Reset();
+
+	errors += round_trip("new windows", encoder, samples, count);
+
+	return errors;
+}
+
+// Fills blocks with random samples until they are full. Every fourth
+// block holds samples of the maximum size only.
+static int32 test_full_blocks(int32 blocks)
+{
+	CTimeSeriesEncoder encoder;
+
+	uint32 seed = 42;
+	int32 errors = 0;
+
+	for(int32 b=0 ; b<blocks ; b++) {
+		bool worst = (b % 4) == 3;
+
+		encoder.Reset();
+
+		int64 time = START_TIME;
+		int32 count = 0;
+
+		// Simulate the encoder to know when it's full.
+		CTimeSeriesEncoder probe;
+
+		while(!probe.IsFull() && count < MAX_SAMPLES) {
+			if(worst)
+				time += (count & 1) ? 1 : 3000000000LL;
+			else
+				time += 1000 + (int32)(next_random(seed) % 301) - 150;
+
+			samples[count].time		= time;
+			samples[count].value	= worst ? bits_float(random_bits(seed) | 1) :
+				(float)(next_random(seed) % 100) / 4;
+
+			probe.Append(samples[count].time, samples[count].value);
+			count++;
+		}
+
+		errors += round_trip(worst ? "full worst" : "full block", encoder, samples, count);
+
+		if(!encoder.IsFull())
+			errors++;
+
+		// A truncated block returns fewer samples, but doesn't read
+		// beyond its end.
+		CTimeSeriesDecoder truncated(encoder.Data(), encoder.Size() / 2,
+			encoder.Count(), encoder.FirstTime());
+
+		int64 t;
+		float v;
+		int32 decoded = 0;
+
+		while(truncated.Next(t, v))
+			decoded++;
+
+		if(decoded >= count)
+			errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int32 blocks = 8;
+
+	if(argc > 1)
+		blocks = MAX(atol(argv[1]), 1);
+
+	int32 errors = 0;
+
+	errors += test_delta_ranges();
+	errors += test_clamp();
+	errors += test_window_reuse();
+	errors += test_full_blocks(blocks);
+
+	return errors > 0 ? 1 : 0;
+}